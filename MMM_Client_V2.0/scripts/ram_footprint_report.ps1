@@ -0,0 +1,158 @@
+# Builds every configuration listed under [env:selected] and reports the static RAM
+# and Flash usage PlatformIO prints for each one. The DistributorManager and its
+# fixed pool (CFG_MAX_NUM_DISTRIBUTORS) are allocated once at boot and are not part
+# of the static figure, their size is sizeof(DistributorManager).
+
+param(
+    [string]$ProjectRoot = (Resolve-Path (Join-Path $PSScriptRoot "..")).Path,
+    [string]$ConfigFile = "platformio.ini",
+    [int]$MaxConfigs = 0,
+    [string]$CsvPath = ""
+)
+
+$ErrorActionPreference = "Stop"
+
+$projectIniPath = Join-Path $ProjectRoot $ConfigFile
+if (-not (Test-Path $projectIniPath)) {
+    throw "Could not find PlatformIO config: $projectIniPath"
+}
+
+$platformioExe = Join-Path $env:USERPROFILE ".platformio\penv\Scripts\platformio.exe"
+if (-not (Test-Path $platformioExe)) {
+    $platformioExe = "platformio"
+}
+
+$lines = Get-Content -Path $projectIniPath
+
+$selectedStart = -1
+for ($i = 0; $i -lt $lines.Count; $i++) {
+    if ($lines[$i] -match '^\s*\[env:selected\]\s*$') {
+        $selectedStart = $i
+        break
+    }
+}
+
+if ($selectedStart -lt 0) {
+    throw "[env:selected] section not found in $projectIniPath"
+}
+
+$selectedEnd = $lines.Count
+for ($i = $selectedStart + 1; $i -lt $lines.Count; $i++) {
+    if ($lines[$i] -match '^\s*\[.*\]\s*$') {
+        $selectedEnd = $i
+        break
+    }
+}
+
+$extendEntries = @()
+for ($i = $selectedStart + 1; $i -lt $selectedEnd; $i++) {
+    if ($lines[$i] -match '^\s*;?\s*extends\s*=\s*(.+?)\s*$') {
+        $extendValue = $Matches[1].Trim()
+        if (-not [string]::IsNullOrWhiteSpace($extendValue)) {
+            $extendEntries += [PSCustomObject]@{
+                LineIndex = $i
+                Value = $extendValue
+            }
+        }
+    }
+}
+
+if ($extendEntries.Count -eq 0) {
+    throw "No extends entries found under [env:selected] in $projectIniPath"
+}
+
+if ($MaxConfigs -gt 0 -and $MaxConfigs -lt $extendEntries.Count) {
+    $extendEntries = @($extendEntries | Select-Object -First $MaxConfigs)
+}
+
+Write-Host "Found $($extendEntries.Count) selectable configurations in [env:selected]." -ForegroundColor Cyan
+
+$results = @()
+$tempFiles = @()
+
+# Matches PlatformIO's size summary, e.g. "RAM:   [==        ]  15.2% (used 49812 bytes from 327680 bytes)"
+$usagePattern = '^(RAM|Flash):\s+\[.*\]\s+([\d\.]+)%\s+\(used\s+(\d+)\s+bytes\s+from\s+(\d+)\s+bytes\)'
+
+try {
+    foreach ($entry in $extendEntries) {
+        $tempLines = [System.Collections.Generic.List[string]]::new()
+        for ($lineIndex = 0; $lineIndex -lt $lines.Count; $lineIndex++) {
+            $line = $lines[$lineIndex]
+            if ($lineIndex -ge ($selectedStart + 1) -and $lineIndex -lt $selectedEnd -and $line -match '^\s*;?\s*extends\s*=') {
+                if ($lineIndex -eq $entry.LineIndex) {
+                    $tempLines.Add("extends = $($entry.Value)")
+                }
+                else {
+                    $tempLines.Add("; extends = $(([regex]::Match($line, '^\s*;?\s*extends\s*=\s*(.+?)\s*$')).Groups[1].Value.Trim())")
+                }
+            }
+            else {
+                $tempLines.Add($line)
+            }
+        }
+
+        $safeName = ($entry.Value -replace '[^A-Za-z0-9_\-]+', '_')
+        $tempPath = Join-Path $ProjectRoot ("platformio.footprint.$safeName.ini")
+        $tempFiles += $tempPath
+
+        $utf8NoBom = New-Object System.Text.UTF8Encoding($false)
+        [System.IO.File]::WriteAllLines($tempPath, $tempLines, $utf8NoBom)
+
+        Write-Host "\n=== Measuring: $($entry.Value) ===" -ForegroundColor Yellow
+        Push-Location $ProjectRoot
+        try {
+            $output = & $platformioExe run -e selected --project-conf $tempPath 2>&1 | ForEach-Object { "$_" }
+            $exitCode = $LASTEXITCODE
+        }
+        finally {
+            Pop-Location
+        }
+
+        $usage = @{}
+        foreach ($outLine in $output) {
+            $match = [regex]::Match($outLine.Trim(), $usagePattern)
+            if ($match.Success) {
+                $usage[$match.Groups[1].Value] = [PSCustomObject]@{
+                    Used = [int]$match.Groups[3].Value
+                    Total = [int]$match.Groups[4].Value
+                    Percent = [double]$match.Groups[2].Value
+                }
+            }
+        }
+
+        $results += [PSCustomObject]@{
+            Config = $entry.Value
+            Status = if ($exitCode -eq 0) { "PASS" } else { "FAIL" }
+            RamUsed = if ($usage.ContainsKey("RAM")) { $usage["RAM"].Used } else { $null }
+            RamTotal = if ($usage.ContainsKey("RAM")) { $usage["RAM"].Total } else { $null }
+            RamPercent = if ($usage.ContainsKey("RAM")) { $usage["RAM"].Percent } else { $null }
+            FlashUsed = if ($usage.ContainsKey("Flash")) { $usage["Flash"].Used } else { $null }
+            FlashPercent = if ($usage.ContainsKey("Flash")) { $usage["Flash"].Percent } else { $null }
+        }
+
+        if ($exitCode -ne 0) {
+            Write-Host "Result: FAIL ($($entry.Value))" -ForegroundColor Red
+        }
+    }
+}
+finally {
+    foreach ($tmp in $tempFiles) {
+        if (Test-Path $tmp) {
+            Remove-Item $tmp -Force -ErrorAction SilentlyContinue
+        }
+    }
+}
+
+Write-Host "\n=== RAM Footprint Report ===" -ForegroundColor Cyan
+$results | Format-Table -AutoSize
+
+if (-not [string]::IsNullOrWhiteSpace($CsvPath)) {
+    $results | Export-Csv -Path $CsvPath -NoTypeInformation
+    Write-Host "Report written to $CsvPath" -ForegroundColor Cyan
+}
+
+$failures = @($results | Where-Object { $_.Status -eq "FAIL" })
+if ($failures.Count -gt 0) {
+    exit 1
+}
+exit 0
@@ -0,0 +1,79 @@
+# Reports how far each note's software PWM pitch lands from equal temperament at a timer
+# resolution, for the polling tick engine, the deadline engine (CFG_SWPWM_DEADLINE_SCHEDULER)
+# and the phase accumulator engine (CFG_SWPWM_DDS). Positive cents are sharp. Note periods are
+# read from NoteTable.h so the report follows the firmware's table.
+
+param(
+    [string]$ProjectRoot = (Resolve-Path (Join-Path $PSScriptRoot "..")).Path,
+    [int]$ResolutionUs = 8,
+    [switch]$NotesDouble,
+    [string]$CsvPath = ""
+)
+
+$ErrorActionPreference = "Stop"
+
+$noteTablePath = Join-Path $ProjectRoot "src/Instruments/Components/NoteTable.h"
+if (-not (Test-Path $noteTablePath)) {
+    throw "Could not find note table: $noteTablePath"
+}
+
+# Pull the NOTE_PERIODS initializer out of the header, dropping the comments between rows
+$source = Get-Content -Path $noteTablePath -Raw
+$tableMatch = [regex]::Match($source, 'NOTE_PERIODS\s*=\s*\{(.*?)\};', [System.Text.RegularExpressions.RegexOptions]::Singleline)
+if (-not $tableMatch.Success) {
+    throw "NOTE_PERIODS not found in $noteTablePath"
+}
+$tableText = [regex]::Replace($tableMatch.Groups[1].Value, '//[^\n]*', '')
+$periods = @([regex]::Matches($tableText, '\d+') | ForEach-Object { [int]$_.Value })
+if ($periods.Count -ne 128) {
+    throw "Expected 128 note periods, found $($periods.Count)"
+}
+
+# A toggle happens every tick interval, notes double toggle twice per period
+$tickUs = if ($NotesDouble) { $ResolutionUs * 2 } else { $ResolutionUs }
+$twoTo32 = [math]::Pow(2, 32)
+
+function Get-Cents([double]$idealUs, [double]$actualUs) {
+    if ($actualUs -le 0) { return $null }
+    return [math]::Round(1200 * [math]::Log($idealUs / $actualUs, 2), 2)
+}
+
+$results = @()
+for ($note = 0; $note -lt 128; $note++) {
+    $frequency = 440.0 * [math]::Pow(2, ($note - 69) / 12.0)
+    $idealUs = 1000000.0 / $frequency / $(if ($NotesDouble) { 2 } else { 1 })
+
+    # Polling counts whole ticks of the truncated table period and adds one tick per toggle.
+    # The deadline engine times the table period itself to the microsecond.
+    $ticks = [math]::Floor($periods[$note] / $tickUs)
+    $pollingUs = if ($ticks -gt 0) { ($ticks + 1) * $ResolutionUs } else { 0 }
+    $deadlineUs = if ($NotesDouble) { [math]::Floor($periods[$note] / 2) } else { $periods[$note] }
+
+    # DDS wraps a 32 bit phase by the rounded frequency word every tick
+    $frequencyQ16 = [math]::Floor($frequency * 65536 + 0.5)
+    $increment = [math]::Min([math]::Floor(($frequencyQ16 * $tickUs * 65536 + 500000) / 1000000), $twoTo32 - 1)
+    $ddsUs = $twoTo32 * $ResolutionUs / $increment
+
+    $results += [PSCustomObject]@{
+        Note = $note
+        IdealUs = [math]::Round($idealUs, 2)
+        Ticks = $ticks
+        PollingCents = Get-Cents $idealUs $pollingUs
+        DeadlineCents = Get-Cents $idealUs $deadlineUs
+        DdsCents = Get-Cents $idealUs $ddsUs
+    }
+}
+
+Write-Host "\n=== Software PWM Tuning Error ($ResolutionUs us ticks) ===" -ForegroundColor Cyan
+$results | Format-Table -AutoSize
+
+foreach ($column in @("PollingCents", "DeadlineCents", "DdsCents")) {
+    $worst = ($results | Where-Object { $null -ne $_.$column } | ForEach-Object { [math]::Abs($_.$column) } | Measure-Object -Maximum).Maximum
+    Write-Host ("Worst {0}: {1}" -f $column, $worst)
+}
+
+if (-not [string]::IsNullOrWhiteSpace($CsvPath)) {
+    $results | Export-Csv -Path $CsvPath -NoTypeInformation
+    Write-Host "Report written to $CsvPath" -ForegroundColor Cyan
+}
+exit 0
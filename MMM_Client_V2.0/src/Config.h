@@ -21,6 +21,10 @@ using std::int8_t;
     #define CFG_NUM_SUBINSTRUMENTS 1
 #endif
 
+#ifndef CFG_MAX_NUM_DISTRIBUTORS
+    #define CFG_MAX_NUM_DISTRIBUTORS 16
+#endif
+
 #ifndef CFG_DEVICE_NAME
     #define CFG_DEVICE_NAME "New Device"
 #endif
@@ -33,10 +37,55 @@ using std::int8_t;
     #define CFG_TIMER_RESOLUTION_US 8
 #endif
 
+// Default pitch bend range at full deflection, channels can change it with RPN 0
+#ifndef CFG_PITCH_BEND_RANGE_CENTS
+    #define CFG_PITCH_BEND_RANGE_CENTS 200
+#endif
+
+// Control rate of LFOs and other modulation, these run outside the tick ISR
+#ifndef CFG_MODULATION_INTERVAL_US
+    #define CFG_MODULATION_INTERVAL_US 1000
+#endif
+
+// Vibrato depth with the modulation wheel fully up (CC1) and default rate (CC76 adjusts)
+#ifndef CFG_VIBRATO_DEPTH_CENTS
+    #define CFG_VIBRATO_DEPTH_CENTS 100
+#endif
+
+#ifndef CFG_VIBRATO_RATE_CENTIHZ
+    #define CFG_VIBRATO_RATE_CENTIHZ 550
+#endif
+
+// Glide time with the portamento time controller fully up (CC5), the curve is quadratic
+#ifndef CFG_PORTAMENTO_MAX_MS
+    #define CFG_PORTAMENTO_MAX_MS 2000
+#endif
+
 #ifndef CFG_NOTE_TIMEOUT_MS
     #define CFG_NOTE_TIMEOUT_MS 0
 #endif
 
+// How often changed instrument wear counters are written to local storage
+#ifndef CFG_WEAR_SAVE_INTERVAL_MS
+    #define CFG_WEAR_SAVE_INTERVAL_MS 600000
+#endif
+
+// Latency compensation (CFG_LATENCY_COMPENSATION). Every output is delayed by the lookahead minus
+// its instrument's latency. The lookahead is raised to at least the largest CFG_INSTRUMENT_LATENCY_US,
+// set it higher to leave room for calibrating over SysEx or to line up with slower devices.
+#ifndef CFG_LOOKAHEAD_US
+    #define CFG_LOOKAHEAD_US 0
+#endif
+
+#ifndef CFG_LATENCY_QUEUE_SIZE
+    #define CFG_LATENCY_QUEUE_SIZE 64
+#endif
+
+// Messages read from each network per loop pass, their note changes reach the outputs together
+#ifndef CFG_MAX_MESSAGES_PER_PASS
+    #define CFG_MAX_MESSAGES_PER_PASS 8
+#endif
+
 #ifndef CFG_MIN_NOTE
     #define CFG_MIN_NOTE 0
 #endif
@@ -66,17 +115,44 @@ using std::int8_t;
 #endif
 
 #ifndef CFG_COMPONENT_PWM
-    #if defined(CFG_INSTRUMENT_SWPWM) || defined(CFG_INSTRUMENT_HWPWM) || defined(CFG_INSTRUMENT_STEPSW) || defined(CFG_INSTRUMENT_STEPSWSHIFT)
+    #if defined(CFG_INSTRUMENT_SWPWM) || defined(CFG_INSTRUMENT_HWPWM) || defined(CFG_INSTRUMENT_TONEPWM) || defined(CFG_INSTRUMENT_STEPSW) || defined(CFG_INSTRUMENT_STEPSWSHIFT)
         #define CFG_COMPONENT_PWM
     #endif
 #endif
 
+// Peripherals the ESP32 tone instrument may take, voices past them play from the software tick.
+// The LED driver takes RMT channels from 0 up so one is left for it.
+#ifndef CFG_TONEPWM_RMT_CHANNELS
+    #ifdef CFG_EXTRA_ADDRESSABLE_LEDS
+        #define CFG_TONEPWM_RMT_CHANNELS 7
+    #else
+        #define CFG_TONEPWM_RMT_CHANNELS 8
+    #endif
+#endif
+
+#ifndef CFG_TONEPWM_MCPWM_TIMERS
+    #define CFG_TONEPWM_MCPWM_TIMERS 6
+#endif
+
 #ifndef CFG_COMPONENT_SHIFTREGISTER
     #if defined(CFG_INSTRUMENT_DULCIMER) || defined(CFG_INSTRUMENT_STEPSWSHIFT) || defined(CFG_INSTRUMENT_STEPPERSYNTHHW) || defined(CFG_INSTRUMENT_STEPPERSYNTHSW)
         #define CFG_COMPONENT_SHIFTREGISTER
     #endif
 #endif
 
+// Shift register drivers for CFG_SHIFTREGISTER_TYPE. HW_HWACCEL shifts from the Teensy 4.1's
+// FlexIO, other boards and pins without FlexIO bit-bang like HW_DEFAULT.
+#define HW_DEFAULT 0
+#define HW_HWACCEL 1
+
+#ifndef CFG_SHIFTREGISTER_TYPE
+    #define CFG_SHIFTREGISTER_TYPE HW_DEFAULT
+#endif
+
+#ifndef CFG_SHIFTREGISTER_DATA_HOLDTIME_NS
+    #define CFG_SHIFTREGISTER_DATA_HOLDTIME_NS 25
+#endif
+
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Platform Detection
@@ -100,6 +176,9 @@ using std::int8_t;
     #elif defined(ARDUINO_AVR_MEGA)
         #define PLATFORM_ARDUINO_MEGA
         constexpr Platform PLATFORM_TYPE = Platform::ArduinoMega;
+    #elif defined(PLATFORM_NATIVE)
+        // Host build for the unit tests (pio test -e native), no hardware
+        constexpr Platform PLATFORM_TYPE = Platform::_Native;
     #else
         #error "Unsupported platform. Add platform detection to Config.h"
     #endif
@@ -111,6 +190,7 @@ using std::int8_t;
 namespace HardwareConfig {
 
     constexpr uint8_t MAX_NUM_INSTRUMENTS = CFG_NUM_INSTRUMENTS * CFG_NUM_SUBINSTRUMENTS;
+    constexpr uint8_t MAX_NUM_DISTRIBUTORS = CFG_MAX_NUM_DISTRIBUTORS; // Size of the static distributor pool
 
     // Platform capabilities
     #ifdef PLATFORM_ESP32
@@ -131,6 +211,33 @@ namespace HardwareConfig {
     #endif
 
 
+    // Playable range of each instrument as {min, max} pairs, e.g. {24,96},{36,84}.
+    // Instruments left out of the list ({0, 0}) use CFG_MIN_NOTE to CFG_MAX_NOTE.
+    #ifdef CFG_INSTRUMENT_NOTE_RANGES
+        constexpr std::array<std::array<uint8_t, 2>, NUM_Instruments> INSTRUMENT_NOTE_RANGES = {{CFG_INSTRUMENT_NOTE_RANGES}};
+    #else
+        constexpr std::array<std::array<uint8_t, 2>, NUM_Instruments> INSTRUMENT_NOTE_RANGES = {};
+    #endif
+
+    // Time from output to audible onset of each instrument in microseconds, e.g. 6000,6000,0,0.
+    // Instruments left out of the list sound immediately.
+    #ifdef CFG_INSTRUMENT_LATENCY_US
+        constexpr std::array<uint32_t, NUM_Instruments> INSTRUMENT_LATENCY_US = {CFG_INSTRUMENT_LATENCY_US};
+    #else
+        constexpr std::array<uint32_t, NUM_Instruments> INSTRUMENT_LATENCY_US = {};
+    #endif
+
+    // CFG_LOOKAHEAD_US raised to the largest instrument latency
+    constexpr uint32_t lookaheadUs() {
+        uint32_t lookahead = CFG_LOOKAHEAD_US;
+        for (uint32_t value : INSTRUMENT_LATENCY_US) {
+            if (value > lookahead) lookahead = value;
+        }
+        return lookahead;
+    }
+
+    constexpr uint32_t LOOKAHEAD_US = lookaheadUs();
+
     #ifdef CFG_PINS_INSTRUMENT_PWM
         constexpr std::array<uint8_t, NUM_Instruments> PINS_INSTRUMENT_PWM = {CFG_PINS_INSTRUMENT_PWM};
     #else
@@ -45,6 +45,32 @@ namespace Midi {
     //MIDI Constants
     constexpr uint16_t CTRL_CENTER = 0x2000;
     constexpr uint8_t NUM_CH = 16;
+
+    // Universal SysEx IDs
+    constexpr uint8_t UniversalNonRealTime = 0x7E;
+    constexpr uint8_t UniversalRealTime    = 0x7F;
+    constexpr uint8_t AllCall              = 0x7F; // Universal SysEx device ID addressing every device
+}
+
+// Registered Parameter Numbers (14-bit, RPN MSB << 7 | RPN LSB)
+namespace MidiRPN {
+    constexpr uint16_t PitchBendSensitivity = 0x0000; // Data Entry MSB semitones, LSB cents
+    constexpr uint16_t Null = 0x3FFF;                 // Deselects so Data Entry is ignored
+}
+
+// MIDI Tuning Standard, universal SysEx F0 7E/7F <device> 08 <format> ... F7
+namespace MidiTuning {
+    constexpr uint8_t SubID = 0x08;
+
+    // Formats
+    constexpr uint8_t BulkDumpRequest = 0x00;
+    constexpr uint8_t BulkDump = 0x01;
+    constexpr uint8_t SingleNote = 0x02;        // tt ll [kk xx yy zz]...
+    constexpr uint8_t SingleNoteBank = 0x07;    // bb tt ll [kk xx yy zz]...
+    constexpr uint8_t ScaleOctave1Byte = 0x08;  // ff gg hh ss*12, 1 cent steps
+    constexpr uint8_t ScaleOctave2Byte = 0x09;  // ff gg hh [ss tt]*12, 14 bit over +-100 cents
+
+    constexpr uint32_t NoChange = 0x1FFFFF;     // 7F 7F 7F leaves a note untouched
 }
 
 // Control Change controller types (handled across all active channels)
@@ -54,11 +80,13 @@ namespace MidiCC {
     constexpr uint8_t BreathControl = 2;
     constexpr uint8_t FootPedal = 4;
     constexpr uint8_t PortamentoTime = 5;
+    constexpr uint8_t DataEntryMSB = 6;
     constexpr uint8_t Volume = 7;
     constexpr uint8_t Pan = 10;
     constexpr uint8_t Expression = 11;
     constexpr uint8_t EffectCtrl_1 = 12;
     constexpr uint8_t EffectCtrl_2 = 13;
+    constexpr uint8_t DataEntryLSB = 38;
     constexpr uint8_t DamperPedal = 64;
     constexpr uint8_t Portamento = 65;
     constexpr uint8_t Sostenuto = 66;
@@ -83,6 +111,12 @@ namespace MidiCC {
     constexpr uint8_t DetuneLevel = 94;
     constexpr uint8_t PhaserLevel = 95;
 
+    // Parameter numbers selected for Data Entry
+    constexpr uint8_t NRPN_LSB = 98;
+    constexpr uint8_t NRPN_MSB = 99;
+    constexpr uint8_t RPN_LSB = 100;
+    constexpr uint8_t RPN_MSB = 101;
+
     // Channel Mode messages (handled across all active channels)
     constexpr uint8_t Mute = 120;
     constexpr uint8_t Reset = 121;
@@ -115,6 +149,7 @@ namespace SysEx {
     constexpr uint8_t DeviceName = 0x23;
     constexpr uint8_t DeviceBoolean = 0x24;
     constexpr uint8_t DeviceNumPolyphonicNotes = 0x25;
+    constexpr uint8_t DeviceTuning = 0x26;
 
     // Command(Distributor Management)
     constexpr uint8_t GetNumOfDistributors = 0x30;
@@ -131,6 +166,8 @@ namespace SysEx {
     constexpr uint8_t DistributorMethod = 0x43;
     constexpr uint8_t DistributorBoolValues = 0x44;
     constexpr uint8_t DistributorMinMaxNotes = 0x45;
+    constexpr uint8_t DistributorStealPolicy = 0x46;
+    constexpr uint8_t DistributorVoiceSteals = 0x47;
 
     // Command(Instrument Control)
     constexpr uint8_t ResetAllInstruments = 0x50;
@@ -139,6 +176,11 @@ namespace SysEx {
     constexpr uint8_t SetInstrumentDirectMessage = 0x53;
     constexpr uint8_t SetInstrumentNoteOn = 0x54;
     constexpr uint8_t SetInstrumentNoteOff = 0x55;
+    constexpr uint8_t GetInstrumentWear = 0x56;
+    constexpr uint8_t ResetInstrumentWear = 0x57;
+    constexpr uint8_t InstrumentLatency = 0x58;
+    constexpr uint8_t GetInstrumentIsrProfile = 0x59;
+    constexpr uint8_t GetInstrumentIsrJitter = 0x5A;
 
     // Command(Extras)
     constexpr uint8_t ExtraStorage = 0x60;
@@ -172,7 +214,8 @@ enum class Platform
     _ArduinoMega,
     _ArduinoDue,
     _ArduinoMicro,
-    _ArduinoNano
+    _ArduinoNano,
+    _Native
 };
 
 // Algorithmic methods to distribute notes amongst instruments
@@ -183,5 +226,50 @@ enum class DistributionMethod
     RoundRobinBalance,      // Distributes notes in a circular manner (balances notes across instruments)
     Ascending,              // Plays note on lowest available instrument (balances notes across instruments)
     Descending,             // Plays note on highest available instrument (balances notes across instruments)
-    Stack                   // TODO: Play notes polyphonically on lowest available instrument until full
-};
\ No newline at end of file
+    Stack,                  // TODO: Play notes polyphonically on lowest available instrument until full
+    WearLevel               // Plays note on the least used available instrument (spreads wear across instruments)
+};
+
+// Policies used to pick a voice to take over when every instrument in a pool is busy
+enum class StealPolicy
+{
+    Oldest = 0,             // Steals the voice that has been sounding the longest
+    Quietest,               // Steals the voice started with the lowest velocity
+    Lowest,                 // Steals the voice playing the lowest note
+    Highest                 // Steals the voice playing the highest note
+};
+
+// Built-in tunings selectable over SysEx, historical temperaments are tuned from C
+enum class TuningPreset
+{
+    EqualTemperament = 0,
+    Pythagorean,
+    JustIntonation,         // 5-limit just intonation
+    QuarterCommaMeantone,
+    WerckmeisterIII,
+    Custom = 0x7F           // Retuned note by note with MTS messages
+};
+
+// Cumulative usage of one instrument, used for wear leveling and maintenance planning
+struct InstrumentWear
+{
+    uint32_t actuations = 0;    // Notes started on the instrument
+    uint32_t onTimeSeconds = 0; // Total time spent sounding
+};
+
+// CPU cycles spent in one call of an instrument's timer interrupt, collected with CFG_ISR_PROFILING
+struct IsrProfile
+{
+    uint32_t samples = 0;       // Calls measured, 0 if none were
+    uint32_t minCycles = 0;
+    uint32_t meanCycles = 0;
+    uint32_t maxCycles = 0;
+};
+
+// How far the start of a periodic timer interrupt strays from its nominal period, bin N counts
+// calls N us early or late and the last bin everything beyond. Collected with CFG_ISR_PROFILING.
+struct IsrJitter
+{
+    static constexpr uint8_t NUM_BINS = 16;
+    uint32_t bins[NUM_BINS] = {};
+};
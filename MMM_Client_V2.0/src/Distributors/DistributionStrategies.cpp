@@ -5,12 +5,88 @@
  */
 
 #include "DistributionStrategies.h"
+#include "Distributor.h"
 #include "../Constants.h"
 #include "../Device.h"
 #include "../Instruments/InstrumentControllerBase.h"
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Shared Strategy Helpers
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DistributionStrategy::startVoice(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) {
+    m_instrumentController->playNote(instrument, note, velocity, channel, m_distributor->getSlot());
+    m_distributor->m_voiceStealer.noteStarted(instrument, note, velocity, m_distributor->m_sourceNote);
+}
+
+void DistributionStrategy::releaseVoice(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) {
+    m_instrumentController->releaseNote(instrument, note, velocity, channel);
+    m_distributor->m_voiceStealer.noteStopped(instrument, note);
+}
+
+uint32_t DistributionStrategy::eligibleInstruments(uint8_t note) {
+    return m_distributor->getInstruments().to_ulong() & m_instrumentController->getEligibleInstruments(note);
+}
+
+bool DistributionStrategy::ownsVoice(uint8_t instrument, uint8_t channel) {
+    return m_instrumentController->isOwnedBy(instrument, m_distributor->getSlot(), channel);
+}
+
+bool DistributionStrategy::hasFreeVoice(uint8_t instrument) {
+    return m_instrumentController->getNumBusyNotes(instrument) < m_instrumentController->getMaxActiveNotes(instrument);
+}
+
+void DistributionStrategy::stealVoice(uint32_t candidates, uint8_t note, uint8_t velocity, uint8_t channel) {
+    // Pool is full and overwriting is disabled, drop the note
+    if (!m_distributor->getNoteOverwrite() || candidates == 0) return;
+
+    VoiceStealer& stealer = m_distributor->m_voiceStealer;
+
+    // Forget voices which were ended elsewhere (timeouts, stopAll or another distributor)
+    const uint32_t ownedVoices = m_instrumentController->getOwnedVoices(m_distributor->getSlot());
+    stealer.forgetIf([this, ownedVoices](uint8_t instrument, uint8_t sounding) {
+        return !(ownedVoices & (1UL << instrument)) || !m_instrumentController->isNoteBusy(instrument, sounding);
+    });
+
+    uint8_t victim;
+    uint8_t victimNote;
+    if (stealer.selectVictim(m_distributor->getStealPolicy(), candidates, victim, victimNote)) {
+        releaseVoice(victim, victimNote, 0, m_instrumentController->getOwnerChannel(victim));
+        overwriteVoice(victim, note, velocity, channel);
+        return;
+    }
+
+    // Every busy instrument belongs to another distributor, take the longest sounding one
+    victim = NONE;
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+        if (!(candidates & (1UL << i))) continue;
+        if (victim == NONE || m_instrumentController->getNoteStartTime(i) < m_instrumentController->getNoteStartTime(victim)) {
+            victim = i;
+        }
+    }
+    if (victim == NONE) return;
+
+    // Release the owner's note first so a polyphonic instrument stays within getMaxActiveNotes,
+    // and drop it from the owner's stealer so it isn't released a second time
+    Distributor* owner = Distributor::fromSlot(m_instrumentController->getOwner(victim));
+    if (owner == nullptr || !owner->m_voiceStealer.oldestNote(victim, victimNote)) {
+        victimNote = m_instrumentController->getOwnerNote(victim);
+    }
+    if (m_instrumentController->isNoteBusy(victim, victimNote)) {
+        m_instrumentController->releaseNote(victim, victimNote, 0, m_instrumentController->getOwnerChannel(victim));
+    }
+    if (owner != nullptr) owner->m_voiceStealer.noteStopped(victim, victimNote);
+    overwriteVoice(victim, note, velocity, channel);
+}
+
+void DistributionStrategy::overwriteVoice(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) {
+    m_distributor->m_voiceStealer.countSteal();
+    startVoice(instrument, note, velocity, channel);
+}
+
 // Round Robin with Load Balancing Strategy
 void RoundRobinBalanceStrategy::playNextInstrument(uint8_t note, uint8_t velocity, uint8_t channel) {
+    const uint32_t candidates = eligibleInstruments(note);
     uint8_t instrumentLeastActive = NONE;
 
     for (int i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
@@ -21,14 +97,17 @@ void RoundRobinBalanceStrategy::playNextInstrument(uint8_t note, uint8_t velocit
         m_currentInstrument = (m_currentInstrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) ? 0 : m_currentInstrument;
         
         // Check if valid instrument
-        if (!m_distributor->getInstruments()[m_currentInstrument]) continue;
+        if (!(candidates & (1UL << m_currentInstrument))) continue;
         
         // If there are no active notes this must be the least active Instrument return
-        uint8_t activeNotes = m_instrumentController->getNumActiveNotes(m_currentInstrument);
+        uint8_t activeNotes = m_instrumentController->getNumBusyNotes(m_currentInstrument);
         if (activeNotes == 0) {
-            m_instrumentController->playNote(m_currentInstrument, note, velocity, channel, static_cast<void*>(m_distributor));
+            startVoice(m_currentInstrument, note, velocity, channel);
             return;
         }
+
+        // Skip instruments which cannot take another note
+        if (!hasFreeVoice(m_currentInstrument)) continue;
         
         // Set this to Least Active Instrument if instrumentLeastActive is not yet set.
         if (instrumentLeastActive == NONE) {
@@ -37,13 +116,15 @@ void RoundRobinBalanceStrategy::playNextInstrument(uint8_t note, uint8_t velocit
         }
         
         // Update the Least Active Instrument if needed.
-        if (activeNotes < m_instrumentController->getNumActiveNotes(instrumentLeastActive)) {
+        if (activeNotes < m_instrumentController->getNumBusyNotes(instrumentLeastActive)) {
             instrumentLeastActive = m_currentInstrument;
         }   
     }
     if(instrumentLeastActive != NONE) {
-        m_instrumentController->playNote(instrumentLeastActive, note, velocity, channel, static_cast<void*>(m_distributor));
+        startVoice(instrumentLeastActive, note, velocity, channel);
+        return;
     }
+    stealVoice(candidates, note, velocity, channel);
 }
 
 void RoundRobinBalanceStrategy::stopActiveInstrument(uint8_t note, uint8_t velocity, uint8_t channel) {
@@ -56,10 +137,9 @@ void RoundRobinBalanceStrategy::stopActiveInstrument(uint8_t note, uint8_t veloc
 
         // Check if valid instrument
         if(m_distributor->getInstruments()[instrument] 
-            && m_instrumentController->getLastDistributor(instrument) == static_cast<void*>(m_distributor)
-            && m_instrumentController->getLastChannel(instrument) == channel 
-            && m_instrumentController->isNoteActive(instrument, note)) {
-            m_instrumentController->stopNote(instrument, note, velocity, channel);
+            && ownsVoice(instrument, channel) 
+            && m_instrumentController->isNoteBusy(instrument, note)) {
+            releaseVoice(instrument, note, velocity, channel);
             return;
         }
     }
@@ -67,6 +147,7 @@ void RoundRobinBalanceStrategy::stopActiveInstrument(uint8_t note, uint8_t veloc
 
 // Simple Round Robin Strategy
 void RoundRobinStrategy::playNextInstrument(uint8_t note, uint8_t velocity, uint8_t channel) {
+    const uint32_t candidates = eligibleInstruments(note);
     for (int i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
         m_currentInstrument++;
         
@@ -74,10 +155,14 @@ void RoundRobinStrategy::playNextInstrument(uint8_t note, uint8_t velocity, uint
         m_currentInstrument = (m_currentInstrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) ? 0 : m_currentInstrument;
         
         // Check if valid instrument
-        if (!m_distributor->getInstruments()[m_currentInstrument]) continue;
-        m_instrumentController->playNote(m_currentInstrument, note, velocity, channel, static_cast<void*>(m_distributor));
+        if (!(candidates & (1UL << m_currentInstrument))) continue;
+
+        // Skip busy instruments rather than overwriting them
+        if (!hasFreeVoice(m_currentInstrument)) continue;
+        startVoice(m_currentInstrument, note, velocity, channel);
         return;
     }
+    stealVoice(candidates, note, velocity, channel);
 }
 
 void RoundRobinStrategy::stopActiveInstrument(uint8_t note, uint8_t velocity, uint8_t channel) {
@@ -90,10 +175,9 @@ void RoundRobinStrategy::stopActiveInstrument(uint8_t note, uint8_t velocity, ui
 
         // Check if valid instrument
         if(m_distributor->getInstruments()[instrument] 
-            && m_instrumentController->getLastDistributor(instrument) == static_cast<void*>(m_distributor)
-            && m_instrumentController->getLastChannel(instrument) == channel 
-            && m_instrumentController->isNoteActive(instrument, note)) {
-            m_instrumentController->stopNote(instrument, note, velocity, channel);
+            && ownsVoice(instrument, channel) 
+            && m_instrumentController->isNoteBusy(instrument, note)) {
+            releaseVoice(instrument, note, velocity, channel);
             return;
         }
     }
@@ -101,23 +185,25 @@ void RoundRobinStrategy::stopActiveInstrument(uint8_t note, uint8_t velocity, ui
 
 // Ascending Strategy
 void AscendingStrategy::playNextInstrument(uint8_t note, uint8_t velocity, uint8_t channel) {
-    bool validInstrument = false;
+    const uint32_t candidates = eligibleInstruments(note);
     uint8_t instrumentLeastActive = NONE;
     uint8_t leastActiveNotes = 255;
     
     for (int i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
         // Check if valid instrument
-        if (!m_distributor->getInstruments()[i]) continue;
-        validInstrument = true;
+        if (!(candidates & (1UL << i))) continue;
         
         // Check if instrument has the least active notes
-        uint8_t activeNotes = m_instrumentController->getNumActiveNotes(i);
+        uint8_t activeNotes = m_instrumentController->getNumBusyNotes(i);
         
         // If there are no active notes this must be the least active instrument return
         if (activeNotes == 0){
-            m_instrumentController->playNote(i, note, velocity, channel, static_cast<void*>(m_distributor));
+            startVoice(i, note, velocity, channel);
             return;
         }
+
+        // Skip instruments which cannot take another note
+        if (!hasFreeVoice(i)) continue;
         
         // Update least active instrument
         if (activeNotes < leastActiveNotes) {
@@ -125,18 +211,19 @@ void AscendingStrategy::playNextInstrument(uint8_t note, uint8_t velocity, uint8
             instrumentLeastActive = i;
         }
     }
-    if(validInstrument) {
-        m_instrumentController->playNote(instrumentLeastActive, note, velocity, channel, static_cast<void*>(m_distributor));
+    if(instrumentLeastActive != NONE) {
+        startVoice(instrumentLeastActive, note, velocity, channel);
+        return;
     }
+    stealVoice(candidates, note, velocity, channel);
 }
 
 void AscendingStrategy::stopActiveInstrument(uint8_t note, uint8_t velocity, uint8_t channel) {
     for(uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; ++i){
         if(m_distributor->getInstruments()[i] 
-            && m_instrumentController->getLastDistributor(i) == static_cast<void*>(m_distributor)
-            && m_instrumentController->getLastChannel(i) == channel 
-            && m_instrumentController->isNoteActive(i, note)) {
-            m_instrumentController->stopNote(i, note, velocity, channel);
+            && ownsVoice(i, channel) 
+            && m_instrumentController->isNoteBusy(i, note)) {
+            releaseVoice(i, note, velocity, channel);
             return;
         }
     }
@@ -144,23 +231,25 @@ void AscendingStrategy::stopActiveInstrument(uint8_t note, uint8_t velocity, uin
 
 // Descending Strategy
 void DescendingStrategy::playNextInstrument(uint8_t note, uint8_t velocity, uint8_t channel) {
-    bool validInstrument = false;
+    const uint32_t candidates = eligibleInstruments(note);
     uint8_t instrumentLeastActive = NONE;
     uint8_t leastActiveNotes = 255;
     
     for (int i = (HardwareConfig::MAX_NUM_INSTRUMENTS - 1); i >= 0; i--) {
         // Check if valid instrument
-        if (!m_distributor->getInstruments()[i]) continue;
-        validInstrument = true;
+        if (!(candidates & (1UL << i))) continue;
         
         // Check if instrument has the least active notes
-        uint8_t activeNotes = m_instrumentController->getNumActiveNotes(i);
+        uint8_t activeNotes = m_instrumentController->getNumBusyNotes(i);
         
         // If there are no active notes this must be the least active Instrument return
         if (activeNotes == 0){
-            m_instrumentController->playNote(i, note, velocity, channel, static_cast<void*>(m_distributor));
+            startVoice(i, note, velocity, channel);
             return;
         }
+
+        // Skip instruments which cannot take another note
+        if (!hasFreeVoice(i)) continue;
         
         // Update least active instrument
         if (activeNotes < leastActiveNotes) {
@@ -168,19 +257,20 @@ void DescendingStrategy::playNextInstrument(uint8_t note, uint8_t velocity, uint
             instrumentLeastActive = i;
         }
     }
-    if(validInstrument) {
-        m_instrumentController->playNote(instrumentLeastActive, note, velocity, channel, static_cast<void*>(m_distributor));
+    if(instrumentLeastActive != NONE) {
+        startVoice(instrumentLeastActive, note, velocity, channel);
+        return;
     }
+    stealVoice(candidates, note, velocity, channel);
 }
 
 void DescendingStrategy::stopActiveInstrument(uint8_t note, uint8_t velocity, uint8_t channel) {
     for(int i = (HardwareConfig::MAX_NUM_INSTRUMENTS - 1); i >= 0; --i){
         // Check if valid instrument
         if(m_distributor->getInstruments()[i] 
-            && m_instrumentController->getLastDistributor(i) == static_cast<void*>(m_distributor)
-            && m_instrumentController->getLastChannel(i) == channel 
-            && m_instrumentController->isNoteActive(i, note)) {
-            m_instrumentController->stopNote(i, note, velocity, channel);
+            && ownsVoice(i, channel) 
+            && m_instrumentController->isNoteBusy(i, note)) {
+            releaseVoice(i, note, velocity, channel);
             return;
         }
     }
@@ -190,18 +280,67 @@ void DescendingStrategy::stopActiveInstrument(uint8_t note, uint8_t velocity, ui
 void StraightThroughStrategy::playNextInstrument(uint8_t note, uint8_t velocity, uint8_t channel) {
    
     uint8_t instrumentId = channel; // Map channel directly to instrument ID
-    if (instrumentId < HardwareConfig::MAX_NUM_INSTRUMENTS &&
-        m_distributor->getInstruments()[instrumentId]) {
-            m_instrumentController->playNote(instrumentId, note, velocity, channel, static_cast<void*>(m_distributor));
+    if (instrumentId >= HardwareConfig::MAX_NUM_INSTRUMENTS ||
+        !(eligibleInstruments(note) & (1UL << instrumentId))) return;
+
+    if (hasFreeVoice(instrumentId)) {
+        startVoice(instrumentId, note, velocity, channel);
+        return;
     }
+
+    // The channel's instrument is busy, only replace its note when overwriting is enabled
+    stealVoice(1UL << instrumentId, note, velocity, channel);
 }
 
 void StraightThroughStrategy::stopActiveInstrument(uint8_t note, uint8_t velocity, uint8_t channel) {
     int instrumentId = channel % HardwareConfig::MAX_NUM_INSTRUMENTS; // Map channel directly to instrument ID
     if(m_distributor->getInstruments()[instrumentId] 
-            && m_instrumentController->getLastDistributor(instrumentId) == static_cast<void*>(m_distributor)
-            && m_instrumentController->getLastChannel(instrumentId) == channel
-            && m_instrumentController->isNoteActive(instrumentId, note)){
-        m_instrumentController->stopNote(instrumentId, note, velocity, channel);
+            && ownsVoice(instrumentId, channel)
+            && m_instrumentController->isNoteBusy(instrumentId, note)){
+        releaseVoice(instrumentId, note, velocity, channel);
+    }
+}
+
+// Wear Level Strategy
+void WearLevelStrategy::playNextInstrument(uint8_t note, uint8_t velocity, uint8_t channel) {
+    const uint32_t candidates = eligibleInstruments(note);
+    uint8_t instrumentLeastActive = NONE;
+    uint8_t leastActiveNotes = 255;
+
+    // The controller keeps instruments ordered least used first, so the first idle one wins
+    for (uint8_t instrument : m_instrumentController->getWearOrder()) {
+        // Check if valid instrument
+        if (!(candidates & (1UL << instrument))) continue;
+
+        uint8_t activeNotes = m_instrumentController->getNumBusyNotes(instrument);
+        if (activeNotes == 0) {
+            startVoice(instrument, note, velocity, channel);
+            return;
+        }
+
+        // Skip instruments which cannot take another note
+        if (!hasFreeVoice(instrument)) continue;
+
+        // Update least active instrument, ties stay with the less worn one
+        if (activeNotes < leastActiveNotes) {
+            leastActiveNotes = activeNotes;
+            instrumentLeastActive = instrument;
+        }
+    }
+    if(instrumentLeastActive != NONE) {
+        startVoice(instrumentLeastActive, note, velocity, channel);
+        return;
+    }
+    stealVoice(candidates, note, velocity, channel);
+}
+
+void WearLevelStrategy::stopActiveInstrument(uint8_t note, uint8_t velocity, uint8_t channel) {
+    for(uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; ++i){
+        if(m_distributor->getInstruments()[i] 
+            && ownsVoice(i, channel) 
+            && m_instrumentController->isNoteBusy(i, note)) {
+            releaseVoice(i, note, velocity, channel);
+            return;
+        }
     }
 }
@@ -17,7 +17,7 @@ class InstrumentControllerBase;
  */
 class RoundRobinBalanceStrategy : public DistributionStrategy {   
 public:
-    RoundRobinBalanceStrategy(Distributor* distributor, std::shared_ptr<InstrumentControllerBase> instrController) 
+    RoundRobinBalanceStrategy(Distributor* distributor, InstrumentControllerBase* instrController) 
         : DistributionStrategy(distributor, instrController) {}
     void playNextInstrument(uint8_t note, uint8_t velocity, uint8_t channel) override;
     void stopActiveInstrument(uint8_t note, uint8_t velocity, uint8_t channel) override;
@@ -34,7 +34,7 @@ public:
 
 class RoundRobinStrategy : public DistributionStrategy { 
 public:
-    RoundRobinStrategy(Distributor* distributor, std::shared_ptr<InstrumentControllerBase> instrController) 
+    RoundRobinStrategy(Distributor* distributor, InstrumentControllerBase* instrController) 
         : DistributionStrategy(distributor, instrController) {}
     void playNextInstrument(uint8_t note, uint8_t velocity, uint8_t channel) override;
     void stopActiveInstrument(uint8_t note, uint8_t velocity, uint8_t channel) override;
@@ -50,7 +50,7 @@ public:
  */
 class AscendingStrategy : public DistributionStrategy {
 public:
-    AscendingStrategy(Distributor* distributor, std::shared_ptr<InstrumentControllerBase> instrController) 
+    AscendingStrategy(Distributor* distributor, InstrumentControllerBase* instrController) 
         : DistributionStrategy(distributor, instrController) {}
     void playNextInstrument(uint8_t note, uint8_t velocity, uint8_t channel) override;
     void stopActiveInstrument(uint8_t note, uint8_t velocity, uint8_t channel) override;
@@ -66,7 +66,7 @@ public:
  */
 class DescendingStrategy : public DistributionStrategy {
 public:
-    DescendingStrategy(Distributor* distributor, std::shared_ptr<InstrumentControllerBase> instrController) 
+    DescendingStrategy(Distributor* distributor, InstrumentControllerBase* instrController) 
         : DistributionStrategy(distributor, instrController) {}
     void playNextInstrument(uint8_t note, uint8_t velocity, uint8_t channel) override;
     void stopActiveInstrument(uint8_t note, uint8_t velocity, uint8_t channel) override;
@@ -82,7 +82,7 @@ public:
  */
 class StraightThroughStrategy : public DistributionStrategy {
 public:
-    StraightThroughStrategy(Distributor* distributor, std::shared_ptr<InstrumentControllerBase> instrController) 
+    StraightThroughStrategy(Distributor* distributor, InstrumentControllerBase* instrController) 
         : DistributionStrategy(distributor, instrController) {}
     void playNextInstrument(uint8_t note, uint8_t velocity, uint8_t channel) override;
     void stopActiveInstrument(uint8_t note, uint8_t velocity, uint8_t channel) override;
@@ -90,4 +90,20 @@ public:
     DistributionMethod getMethodType() const override {
         return DistributionMethod::StraightThrough;
     }
-}; 
\ No newline at end of file
+};
+
+/**
+ * Wear Level Strategy
+ * Chooses the least used available instrument, spreading actuations evenly across the pool
+ */
+class WearLevelStrategy : public DistributionStrategy {
+public:
+    WearLevelStrategy(Distributor* distributor, InstrumentControllerBase* instrController) 
+        : DistributionStrategy(distributor, instrController) {}
+    void playNextInstrument(uint8_t note, uint8_t velocity, uint8_t channel) override;
+    void stopActiveInstrument(uint8_t note, uint8_t velocity, uint8_t channel) override;
+
+    DistributionMethod getMethodType() const override {
+        return DistributionMethod::WearLevel;
+    }
+};
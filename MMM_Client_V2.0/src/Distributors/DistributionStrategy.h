@@ -11,24 +11,27 @@
 #include "../Constants.h"
 #include "../Device.h"
 #include "../Instruments/InstrumentControllerBase.h"
-#include "../Distributors/Distributor.h"
 #include <cstdint>
+#include <cstddef>
 #include <bitset>
-#include <memory>
 
 // Forward declarations
 class InstrumentControllerBase;
 class Distributor;
 
+// Bytes reserved in each Distributor to construct its strategy in place.
+// Concrete strategies add no members, Distributor.cpp asserts they fit.
+constexpr size_t DISTRIBUTION_STRATEGY_STORAGE = 4 * sizeof(void*);
+
 class DistributionStrategy {
 protected:
     Distributor* m_distributor;
-    std::shared_ptr<InstrumentControllerBase> m_instrumentController;
+    InstrumentControllerBase* m_instrumentController; // Non-owning, outlives every distributor
 
     uint8_t m_currentInstrument = 0;
 
 public:
-    DistributionStrategy(Distributor* distributor, std::shared_ptr<InstrumentControllerBase> instrController) 
+    DistributionStrategy(Distributor* distributor, InstrumentControllerBase* instrController) 
         : m_distributor(distributor), m_instrumentController(instrController) {};
     virtual ~DistributionStrategy() = default;
 
@@ -37,4 +40,24 @@ public:
 
     virtual DistributionMethod getMethodType() const = 0;
 
+protected:
+    // Shared helpers (implemented in DistributionStrategies.cpp)
+
+    /* Plays the note and records the voice for stealing */
+    void startVoice(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel);
+    /* Stops the note and forgets the voice */
+    void releaseVoice(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel);
+    /* Returns the instruments in the pool which can play the note */
+    uint32_t eligibleInstruments(uint8_t note);
+    /* Returns True if this distributor started the instrument's voice from the given channel */
+    bool ownsVoice(uint8_t instrument, uint8_t channel);
+    /* Returns True if the instrument can accept another note without overwriting */
+    bool hasFreeVoice(uint8_t instrument);
+    /* Called when every candidate instrument is busy. Releases a voice chosen by the
+       distributor's StealPolicy and plays the note on it if NOTEOVERWRITE is set,
+       otherwise the note is dropped. */
+    void stealVoice(uint32_t candidates, uint8_t note, uint8_t velocity, uint8_t channel);
+    /* Plays the note over whatever the instrument is sounding and counts it as a steal */
+    void overwriteVoice(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel);
+
 };
\ No newline at end of file
@@ -16,11 +16,24 @@
 #include "../Instruments/InstrumentControllerBase.h"
 #include "../Utility/BitManipulation.h"
 
-Distributor::Distributor(std::shared_ptr<InstrumentControllerBase> instrumentController)
-    : m_instrumentController(instrumentController)
+#include <new>
+
+// Every strategy is constructed in place inside the Distributor
+static_assert(sizeof(RoundRobinBalanceStrategy) <= DISTRIBUTION_STRATEGY_STORAGE, "Strategy storage too small");
+static_assert(sizeof(RoundRobinStrategy) <= DISTRIBUTION_STRATEGY_STORAGE, "Strategy storage too small");
+static_assert(sizeof(AscendingStrategy) <= DISTRIBUTION_STRATEGY_STORAGE, "Strategy storage too small");
+static_assert(sizeof(DescendingStrategy) <= DISTRIBUTION_STRATEGY_STORAGE, "Strategy storage too small");
+static_assert(sizeof(StraightThroughStrategy) <= DISTRIBUTION_STRATEGY_STORAGE, "Strategy storage too small");
+static_assert(sizeof(WearLevelStrategy) <= DISTRIBUTION_STRATEGY_STORAGE, "Strategy storage too small");
+
+// Attached distributors by pool slot, resolves the owner recorded with a voice
+static std::array<Distributor*, HardwareConfig::MAX_NUM_DISTRIBUTORS> attachedSlots = {};
+
+Distributor::Distributor()
 {
     // Initialize with default strategy
     updateDistributionStrategy();
+    rebuildNoteMap();
 }
 
 Distributor::~Distributor(){
@@ -28,6 +41,29 @@ Distributor::~Distributor(){
     if (m_instrumentController) {
         stopActiveNotes();
     }
+    if (m_slot < HardwareConfig::MAX_NUM_DISTRIBUTORS && attachedSlots[m_slot] == this) attachedSlots[m_slot] = nullptr;
+    destroyDistributionStrategy();
+}
+
+void Distributor::attach(InstrumentControllerBase& instrumentController, uint8_t slot){
+    m_instrumentController = &instrumentController;
+    m_slot = slot;
+    if (slot < HardwareConfig::MAX_NUM_DISTRIBUTORS) attachedSlots[slot] = this;
+    updateDistributionStrategy();
+    rebuildNoteMap();
+}
+
+Distributor* Distributor::fromSlot(uint8_t slot){
+    return (slot < HardwareConfig::MAX_NUM_DISTRIBUTORS) ? attachedSlots[slot] : nullptr;
+}
+
+void Distributor::reset(){
+    stopActiveNotes();
+    m_configs = {};
+    m_activeConfig = 0;
+    m_voiceStealer.resetStealCount();
+    updateDistributionStrategy();
+    rebuildNoteMap();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -56,7 +92,7 @@ void Distributor::processMessage(const MidiMessage& message){
         m_instrumentController->setKeyPressure(message.channel(), message.buffer[1], message.buffer[2]);
         break;
     case(Midi::ControlChange):
-        // controlChangeEvent(message.buffer[1],message.buffer[2]); //Implemented in MessageHandler
+        controlChangeEvent(message.buffer[1],message.buffer[2],message.channel());
         break;
     case(Midi::SysCommon):
         break;
@@ -70,22 +106,78 @@ void Distributor::processMessage(const MidiMessage& message){
 // Find the first instrument playing the given note and stop it
 void Distributor::noteOffEvent(uint8_t note, uint8_t velocity, uint8_t channel)
 {
+    note = m_noteMap[note & 0x7F];
+    if (note == NONE) return;
+
+    // A pressed pedal defers the release until pedal up
+    if (m_pedals.noteOff(channel, note)) return;
     m_distributionStrategy->stopActiveInstrument(note, velocity, channel);
 }
 
 // Get next instrument based on distribution method and play note
 void Distributor::noteOnEvent(uint8_t note, uint8_t velocity, uint8_t channel)
 {
+    // Check if note has 0 velocity representing a note off event
+    if(velocity == 0){
+        noteOffEvent(note, velocity, channel);
+        return;
+    }
+
+    // Outside the note range or no instrument in the pool can play it
+    m_sourceNote = note & 0x7F;
+    note = m_noteMap[m_sourceNote];
+    if (note == NONE) return;
+
+    // Striking a held note re-triggers it. Solenoid instruments must release
+    // before they can strike again, and PWM voices must not double up.
+    if (m_pedals.isHeld(channel, note)) {
+        m_pedals.clearHeld(channel, note);
+        m_distributionStrategy->stopActiveInstrument(note, 0, channel);
+    }
+
+    m_pedals.noteOn(channel, note);
+    m_distributionStrategy->playNextInstrument(note, velocity, channel);
+}
+
+// Sustain and sostenuto pedals (enabled by the Device DamperPedal flag).
+// Pedal up is handled with the flag off so held notes are never stranded.
+void Distributor::controlChangeEvent(uint8_t controller, uint8_t value, uint8_t channel)
+{
+    const bool down = Device::DamperPedal && value >= 64;
 
-    if (note < m_minNote || note > m_maxNote) {
+    switch(controller){
+    case(MidiCC::DamperPedal):
+        m_pedals.setSustain(channel, down);
+        break;
+    case(MidiCC::Sostenuto):
+        m_pedals.setSostenuto(channel, down);
+        break;
+    default:
         return;
     }
+    releaseHeldNotes(channel);
+}
 
-    // Check if note has 0 velocity representing a note off event
-    if(velocity == 0){
-        m_distributionStrategy->stopActiveInstrument(note, velocity, channel);
-    }else{
-        m_distributionStrategy->playNextInstrument(note, velocity, channel);
+void Distributor::releaseHeldNotes(uint8_t channel)
+{
+    NoteBitmap releases = m_pedals.takeReleases(channel);
+    if (!releases.any()) return;
+
+    // Notes whose solenoid already timed out are skipped by the strategy's active check
+    m_instrumentController->beginBatch();
+    releases.forEach([this, channel](uint8_t note) {
+        m_distributionStrategy->stopActiveInstrument(note, 0, channel);
+    });
+    m_instrumentController->commitBatch();
+}
+
+// Lifts both pedals on every channel, used when the DamperPedal flag is turned off
+void Distributor::releasePedals()
+{
+    for (uint8_t channel = 0; channel < NUM_Channels; channel++) {
+        m_pedals.setSustain(channel, false);
+        m_pedals.setSostenuto(channel, false);
+        releaseHeldNotes(channel);
     }
 }
 
@@ -98,7 +190,7 @@ void Distributor::noteOnEvent(uint8_t note, uint8_t velocity, uint8_t channel)
 
 bool Distributor::channelEnabled(uint8_t channel){
     if (channel >= 16) return false;
-    return m_channels[channel];
+    return config().channels[channel];
 }
 
 // Helper function to check if distributor handles the given instrument
@@ -106,27 +198,43 @@ bool Distributor::instrumentEnabled(int instrumentId) const noexcept {
     if (instrumentId < 0 || instrumentId >= NUM_Instruments) {
         return false;
     }
-    return m_instruments.test(instrumentId);
+    return config().instruments.test(instrumentId);
 }
 
 void Distributor::stopActiveNotes() {
-    // Iterate through all possible instruments and if this distributor
-    // is recorded as the last distributor for that instrument, stop the
-    // note to avoid hanging notes and clear the tracking pointer.
-
-    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; ++i) {
-        const void* last = m_instrumentController->getLastDistributor(i);
-        if (last == static_cast<const void*>(this)) {
-            // If instrument is active, stop it. Use stopNote which will
-            // also clear the _lastDistributor entry in most implementations.
-            if (m_instrumentController->getNumActiveNotes(i) != 0) {
-                m_instrumentController->stopNote(i, 0, 0, 0);
-            } else {
-                // Ensure the distributor tracking is cleared even if not active
-                m_instrumentController->setLastDistributor(i, nullptr, NONE);
+    if (!m_instrumentController) return;
+
+    // Only visit the instruments this distributor owns
+    uint32_t voices = m_instrumentController->getOwnedVoices(m_slot);
+    if (voices != 0) {
+        m_instrumentController->beginBatch();
+        while (voices) {
+            uint8_t i = __builtin_ctz(voices);
+            voices &= voices - 1;
+            stopOwnedVoice(i);
+        }
+        m_instrumentController->commitBatch();
+    }
+    m_voiceStealer.clear();
+    m_pedals.clear();
+}
+
+void Distributor::stopOwnedVoice(uint8_t instrument) {
+    const uint8_t channel = m_instrumentController->getOwnerChannel(instrument);
+
+    if (m_instrumentController->getMaxActiveNotes(instrument) > 1) {
+        // Polyphonic instruments may sound several of this distributor's notes
+        for (uint8_t note = 0; note < 128 && m_instrumentController->getNumBusyNotes(instrument) != 0; ++note) {
+            if (m_instrumentController->isNoteBusy(instrument, note)) {
+                m_instrumentController->releaseNote(instrument, note, 0, channel);
             }
         }
+    } else if (m_instrumentController->getNumBusyNotes(instrument) != 0) {
+        m_instrumentController->releaseNote(instrument, m_instrumentController->getOwnerNote(instrument), 0, channel);
     }
+
+    // Some instruments keep the record after stopNote, clear it explicitly
+    m_instrumentController->releaseVoiceOwner(instrument);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -138,31 +246,33 @@ std::array<uint8_t,DISTRIBUTOR_NUM_CFG_BYTES> Distributor::toSerial()
 {
     std::array<std::uint8_t,DISTRIBUTOR_NUM_CFG_BYTES> distributorObj = {}; // Initialize all bytes to 0
 
-    // m_distributorBools already contains all bool flags as bits
-    uint16_t distributorBoolByte = m_distributorBools;
+    const DistributorConfig& cfg = config();
+
+    // distributorBools already contains all bool flags as bits
+    uint16_t distributorBoolByte = cfg.distributorBools;
 
     // Store in 7-bit MIDI format
     distributorObj[0] = 0; //Distributor ID MSB Generated in MsgHandler
     distributorObj[1] = 0; //Distributor ID LSB Generated in MsgHandler
     
     // Channels: 16 bits encoded in 3 MIDI 7-bit bytes
-    auto channelsMidi = Utility::encodeTo7Bit(m_channels);
+    auto channelsMidi = Utility::encodeTo7Bit(cfg.channels);
     distributorObj[2] = channelsMidi[0];
     distributorObj[3] = channelsMidi[1];
     distributorObj[4] = channelsMidi[2];
     
     // Instruments: 32 bits encoded in 5 MIDI 7-bit bytes
-    auto instrumentsMidi = Utility::encodeTo7Bit(m_instruments);
+    auto instrumentsMidi = Utility::encodeTo7Bit(cfg.instruments);
     distributorObj[5] = instrumentsMidi[0];
     distributorObj[6] = instrumentsMidi[1];
     distributorObj[7] = instrumentsMidi[2];
     distributorObj[8] = instrumentsMidi[3];
     distributorObj[9] = instrumentsMidi[4];
 
-    distributorObj[10] = static_cast<uint8_t>(m_distributionMethod) & 0x7F;
-    distributorObj[11] = 0; // Reserved
-    distributorObj[12] = m_minNote & 0x7F;
-    distributorObj[13] = m_maxNote & 0x7F;
+    distributorObj[10] = static_cast<uint8_t>(cfg.distributionMethod) & 0x7F;
+    distributorObj[11] = static_cast<uint8_t>(cfg.stealPolicy) & 0x7F;
+    distributorObj[12] = cfg.minNote & 0x7F;
+    distributorObj[13] = cfg.maxNote & 0x7F;
     distributorObj[14] = (distributorBoolByte >> 7)  & 0x7F;
     distributorObj[15] = (distributorBoolByte >> 0) & 0x7F;
 
@@ -170,144 +280,322 @@ std::array<uint8_t,DISTRIBUTOR_NUM_CFG_BYTES> Distributor::toSerial()
 }
 
 uint16_t Distributor::getDistributorBoolValues() const {
-    return m_distributorBools;
+    return config().distributorBools;
 }
 
 bool Distributor::getMuted() const {
-    return m_distributorBools & DISTRIBUTOR_BOOL_MASK::MUTED;
+    return config().distributorBools & DISTRIBUTOR_BOOL_MASK::MUTED;
 }
 
 bool Distributor::getNoteOverwrite() const {
-    return m_distributorBools & DISTRIBUTOR_BOOL_MASK::NOTEOVERWRITE;
+    return config().distributorBools & DISTRIBUTOR_BOOL_MASK::NOTEOVERWRITE;
+}
+
+bool Distributor::getOctaveFold() const {
+    return config().distributorBools & DISTRIBUTOR_BOOL_MASK::OCTAVEFOLD;
 }
 
 //Returns Distributor Channels
 std::bitset<NUM_Channels> Distributor::getChannels() const {
-    return m_channels;
+    return config().channels;
 }
 
 //Returns Distributor Instruments
 std::bitset<NUM_Instruments> Distributor::getInstruments() const {
-    return m_instruments;
+    return config().instruments;
 }
 
 //Returns Distribution Method
 DistributionMethod Distributor::getDistributionMethod() const {
-    return m_distributionMethod;
+    return config().distributionMethod;
 }
 
 uint8_t Distributor::getMinNote() const {
-    return m_minNote;
+    return config().minNote;
 }
 
 uint8_t Distributor::getMaxNote() const {
-    return m_maxNote;
+    return config().maxNote;
 }
 
+StealPolicy Distributor::getStealPolicy() const {
+    return config().stealPolicy;
+}
+
+//Returns the number of voices stolen since boot or the last reset
+uint32_t Distributor::getVoiceSteals() const {
+    return m_voiceStealer.getStealCount();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setters
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 //Configures Distributor from construct (expects 7-bit MIDI format)
 void Distributor::setDistributor(const uint8_t data[]){
-    // Stop any active notes before changing configuration
-    stopActiveNotes();
-    
+    DistributorConfig& cfg = editConfig();
+
     // Decode Distributor Construct from 7-bit MIDI format
-    
+
     // Channels: Decode from 3 MIDI 7-bit bytes (bytes 2-4)
-    m_channels = Utility::decodeFrom7Bit<NUM_Channels>(&data[2]);
-    
+    cfg.channels = Utility::decodeFrom7Bit<NUM_Channels>(&data[2]);
+
     // Instruments: Decode from 5 MIDI 7-bit bytes (bytes 5-9)
-    m_instruments = Utility::decodeFrom7Bit<NUM_Instruments>(&data[5]);
-    
-    // Other fields
-    m_distributionMethod = static_cast<DistributionMethod>(data[10]);
-    m_minNote = data[12] & 0x7F;
-    m_maxNote = data[13] & 0x7F;
-    uint16_t boolData = (static_cast<uint16_t>(data[14]) << 7) | static_cast<uint16_t>(data[15]);
-    m_distributorBools = boolData;
+    cfg.instruments = Utility::decodeFrom7Bit<NUM_Instruments>(&data[5]);
 
-    // Update strategy if distribution method changed
-    updateDistributionStrategy();
+    // Other fields
+    cfg.distributionMethod = static_cast<DistributionMethod>(data[10]);
+    cfg.stealPolicy = (data[11] <= static_cast<uint8_t>(StealPolicy::Highest))
+        ? static_cast<StealPolicy>(data[11]) : StealPolicy::Oldest;
+    cfg.minNote = data[12] & 0x7F;
+    cfg.maxNote = data[13] & 0x7F;
+    cfg.distributorBools = (static_cast<uint16_t>(data[14]) << 7) | static_cast<uint16_t>(data[15]);
+
+    commitConfig();
 }
 
 //Configures Distributor Distribution Method
 void Distributor::setDistributionMethod(DistributionMethod distribution){
-    stopActiveNotes();
-    m_distributionMethod = distribution;
-    updateDistributionStrategy();
+    editConfig().distributionMethod = distribution;
+    commitConfig();
 }
 
 void Distributor::setDistributorBoolValues(uint16_t boolValues){
-    stopActiveNotes();
-    m_distributorBools = boolValues;
+    editConfig().distributorBools = boolValues;
+    commitConfig();
 }
 
 void Distributor::toggleMuted(){
-    stopActiveNotes();
-    m_distributorBools ^= DISTRIBUTOR_BOOL_MASK::MUTED; // Toggle the MUTED bit
+    editConfig().distributorBools ^= DISTRIBUTOR_BOOL_MASK::MUTED; // Toggle the MUTED bit
+    commitConfig();
 }
 
 //Configures Distributor Boolean
 void Distributor::setMuted(bool muted){
-    bool currentMuted = m_distributorBools & DISTRIBUTOR_BOOL_MASK::MUTED;
-    if(currentMuted != muted) stopActiveNotes();
+    DistributorConfig& cfg = editConfig();
     if(muted) {
-        m_distributorBools |= DISTRIBUTOR_BOOL_MASK::MUTED;
+        cfg.distributorBools |= DISTRIBUTOR_BOOL_MASK::MUTED;
     } else {
-        m_distributorBools &= ~DISTRIBUTOR_BOOL_MASK::MUTED;
+        cfg.distributorBools &= ~DISTRIBUTOR_BOOL_MASK::MUTED;
     }
+    commitConfig();
 }
 
 
 //Configures Distributor Note Overwrite
 void Distributor::setNoteOverwrite(bool noteOverwrite){
-    stopActiveNotes();
+    DistributorConfig& cfg = editConfig();
     if(noteOverwrite) {
-        m_distributorBools |= DISTRIBUTOR_BOOL_MASK::NOTEOVERWRITE;
+        cfg.distributorBools |= DISTRIBUTOR_BOOL_MASK::NOTEOVERWRITE;
     } else {
-        m_distributorBools &= ~DISTRIBUTOR_BOOL_MASK::NOTEOVERWRITE;
+        cfg.distributorBools &= ~DISTRIBUTOR_BOOL_MASK::NOTEOVERWRITE;
     }
+    commitConfig();
 }
 
 //Configures Distributor Minimum and Maximum Notes
 void Distributor::setMinMaxNote(uint8_t minNote, uint8_t maxNote){
-    stopActiveNotes();
-    m_minNote = minNote;
-    m_maxNote = maxNote;
+    DistributorConfig& cfg = editConfig();
+    cfg.minNote = minNote;
+    cfg.maxNote = maxNote;
+    commitConfig();
 }
 
 //Configures Distributor accepted MIDI channels
 void Distributor::setChannels(std::bitset<NUM_Channels> channels){
-    stopActiveNotes();
-    m_channels = channels;
+    editConfig().channels = channels;
+    commitConfig();
 }
-    
+
 //Configures Distributor Instrument Pool
 void Distributor::setInstruments(std::bitset<NUM_Instruments> instruments){
-    stopActiveNotes();
-    m_instruments = instruments;
+    editConfig().instruments = instruments;
+    commitConfig();
+}
+
+//Configures the policy used to take over a voice when the pool is full
+void Distributor::setStealPolicy(StealPolicy policy){
+    editConfig().stealPolicy = policy;
+    commitConfig();
+}
+
+void Distributor::resetVoiceSteals(){
+    m_voiceStealer.resetStealCount();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Configuration Swap
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DistributorConfig::isValid() const {
+    if (maxNote > 127 || minNote > maxNote) return false;
+    if (static_cast<uint8_t>(distributionMethod) > static_cast<uint8_t>(DistributionMethod::WearLevel)) return false;
+    if (static_cast<uint8_t>(stealPolicy) > static_cast<uint8_t>(StealPolicy::Highest)) return false;
+    return true;
+}
+
+DistributorConfig& Distributor::editConfig(){
+    DistributorConfig& shadow = m_configs[m_activeConfig ^ 1];
+    shadow = config();
+    return shadow;
+}
+
+// Messages are handled one at a time so swapping between calls to
+// processMessage() never splits an event across two configurations.
+bool Distributor::commitConfig(){
+    const uint8_t nextIndex = m_activeConfig ^ 1;
+    const DistributorConfig& next = m_configs[nextIndex];
+    if (!next.isValid()) return false;
+
+    const DistributorConfig& previous = config();
+    std::array<uint8_t, 128> nextNoteMap;
+    buildNoteMap(next, nextNoteMap);
+    releaseInvalidVoices(previous, next, nextNoteMap);
+
+    const bool methodChanged = next.distributionMethod != previous.distributionMethod;
+    m_activeConfig = nextIndex;
+    m_noteMap = nextNoteMap;
+    if (methodChanged) updateDistributionStrategy();
+    return true;
+}
+
+void Distributor::rebuildNoteMap(){
+    buildNoteMap(config(), m_noteMap);
+}
+
+void Distributor::buildNoteMap(const DistributorConfig& cfg, std::array<uint8_t, 128>& noteMap) const {
+    noteMap.fill(NONE);
+    if (!m_instrumentController) return;
+
+    const uint32_t pool = cfg.instruments.to_ulong();
+    const bool fold = cfg.distributorBools & DISTRIBUTOR_BOOL_MASK::OCTAVEFOLD;
+
+    for (uint8_t note = cfg.minNote; note <= cfg.maxNote && note < 128; note++) {
+        if (pool & m_instrumentController->getEligibleInstruments(note)) {
+            noteMap[note] = note;
+            continue;
+        }
+        if (!fold) continue;
+
+        // Search outwards one octave at a time, the lower octave wins a tie
+        for (uint8_t shift = 12; shift < 128; shift += 12) {
+            if (note >= shift && (pool & m_instrumentController->getEligibleInstruments(note - shift))) {
+                noteMap[note] = note - shift;
+                break;
+            }
+            if (note + shift < 128 && (pool & m_instrumentController->getEligibleInstruments(note + shift))) {
+                noteMap[note] = note + shift;
+                break;
+            }
+        }
+    }
+}
+
+void Distributor::releaseInvalidVoices(const DistributorConfig& previous, const DistributorConfig& next,
+    const std::array<uint8_t, 128>& nextNoteMap){
+    using namespace DISTRIBUTOR_BOOL_MASK;
+    if (!m_instrumentController) return;
+
+    // Muting silences everything this distributor is playing
+    if ((next.distributorBools & MUTED) && !(previous.distributorBools & MUTED)) {
+        stopActiveNotes();
+        return;
+    }
+
+    const std::bitset<NUM_Channels> removedChannels = previous.channels & ~next.channels;
+    const std::bitset<NUM_Instruments> removedInstruments = previous.instruments & ~next.instruments;
+    // StraightThrough only releases notes on the instrument matching the channel
+    const bool toStraightThrough = next.distributionMethod == DistributionMethod::StraightThrough
+        && previous.distributionMethod != DistributionMethod::StraightThrough;
+
+    // Target notes reached from a source whose note-off would now be dropped or routed
+    // to another note (narrowed range, octave folding changes)
+    NoteBitmap remapped;
+    for (uint8_t note = 0; note < 128; ++note) {
+        if (m_noteMap[note] != NONE && m_noteMap[note] != nextNoteMap[note]) remapped.set(m_noteMap[note]);
+    }
+
+    if (removedChannels.none() && removedInstruments.none() && !remapped.any() && !toStraightThrough) return;
+
+    m_instrumentController->beginBatch();
+    uint32_t voices = m_instrumentController->getOwnedVoices(m_slot);
+    uint32_t validVoices = 0;
+    while (voices) {
+        uint8_t i = __builtin_ctz(voices);
+        voices &= voices - 1;
+        if (m_instrumentController->getNumBusyNotes(i) == 0) continue;
+
+        const uint8_t channel = m_instrumentController->getOwnerChannel(i);
+        const bool voiceInvalid = removedInstruments[i]
+            || (channel < NUM_Channels && removedChannels[channel])
+            || (toStraightThrough && i != channel);
+
+        if (voiceInvalid) {
+            stopOwnedVoice(i);
+            m_voiceStealer.instrumentStopped(i);
+            continue;
+        }
+        validVoices |= (1UL << i);
+    }
+
+    if (remapped.any()) {
+        // A voice survives while its own source note still maps to the note it sounds
+        m_voiceStealer.forgetRemapped(validVoices, nextNoteMap, [this](uint8_t instrument, uint8_t note) {
+            if (m_instrumentController->isNoteBusy(instrument, note)) {
+                m_instrumentController->releaseNote(instrument, note, 0, m_instrumentController->getOwnerChannel(instrument));
+            }
+        });
+
+        // Voices the stealer no longer tracks have no known source, stop any remapped target
+        while (validVoices) {
+            uint8_t i = __builtin_ctz(validVoices);
+            validVoices &= validVoices - 1;
+            const uint8_t channel = m_instrumentController->getOwnerChannel(i);
+            remapped.forEach([this, i, channel](uint8_t note) {
+                if (m_instrumentController->isNoteBusy(i, note) && !m_voiceStealer.isTracked(i, note)) {
+                    m_instrumentController->releaseNote(i, note, 0, channel);
+                }
+            });
+        }
+    }
+    m_instrumentController->commitBatch();
+
+    for (uint8_t channel = 0; channel < NUM_Channels; ++channel) {
+        if (removedChannels[channel]) m_pedals.clearChannel(channel);
+    }
 }
 
 //Updates the distribution strategy based on the current method
 void Distributor::updateDistributionStrategy(){
-    stopActiveNotes();
-    switch(m_distributionMethod) {
+    destroyDistributionStrategy();
+    switch(config().distributionMethod) {
         case DistributionMethod::RoundRobinBalance:
-            m_distributionStrategy = std::make_unique<RoundRobinBalanceStrategy>(this, m_instrumentController);
+            m_distributionStrategy = new (m_strategyStorage) RoundRobinBalanceStrategy(this, m_instrumentController);
             break;
         case DistributionMethod::RoundRobin:
-            m_distributionStrategy = std::make_unique<RoundRobinStrategy>(this, m_instrumentController);
+            m_distributionStrategy = new (m_strategyStorage) RoundRobinStrategy(this, m_instrumentController);
             break;
         case DistributionMethod::Ascending:
-            m_distributionStrategy = std::make_unique<AscendingStrategy>(this, m_instrumentController);
+            m_distributionStrategy = new (m_strategyStorage) AscendingStrategy(this, m_instrumentController);
             break;
         case DistributionMethod::Descending:
-            m_distributionStrategy = std::make_unique<DescendingStrategy>(this, m_instrumentController);
+            m_distributionStrategy = new (m_strategyStorage) DescendingStrategy(this, m_instrumentController);
             break;
         case DistributionMethod::StraightThrough:
-            m_distributionStrategy = std::make_unique<StraightThroughStrategy>(this, m_instrumentController);
+            m_distributionStrategy = new (m_strategyStorage) StraightThroughStrategy(this, m_instrumentController);
+            break;
+        case DistributionMethod::WearLevel:
+            m_distributionStrategy = new (m_strategyStorage) WearLevelStrategy(this, m_instrumentController);
             break;
         default:
             // Fallback to RoundRobinBalance as default
-            m_distributionStrategy = std::make_unique<RoundRobinBalanceStrategy>(this, m_instrumentController);
+            m_distributionStrategy = new (m_strategyStorage) RoundRobinBalanceStrategy(this, m_instrumentController);
             break;
     }
-}
\ No newline at end of file
+}
+
+void Distributor::destroyDistributionStrategy(){
+    if (m_distributionStrategy == nullptr) return;
+    m_distributionStrategy->~DistributionStrategy();
+    m_distributionStrategy = nullptr;
+}
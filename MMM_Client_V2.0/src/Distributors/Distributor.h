@@ -16,13 +16,14 @@
 #include "../MsgHandling/MidiMessage.h"
 #include "../Constants.h"
 #include "DistributionStrategy.h"
+#include "VoiceStealer.h"
+#include "PedalEngine.h"
 
 // Forward declarations
 class InstrumentControllerBase;
 
 #include <array>
 #include <cstdint>
-#include <memory>
 #include <bitset>
 using std::int8_t;
 
@@ -33,42 +34,77 @@ constexpr uint8_t DISTRIBUTOR_NUM_CFG_BYTES = 24;
 namespace DISTRIBUTOR_BOOL_MASK {
     constexpr uint16_t MUTED         = 1 << 0;
     constexpr uint16_t NOTEOVERWRITE = 1 << 1;
+    constexpr uint16_t OCTAVEFOLD    = 1 << 2; // Move notes no pooled instrument can play to the nearest playable octave
+};
+
+/* Distributor settings. Edits are made to a shadow copy which is validated
+   and swapped in as a whole by commitConfig(). */
+struct DistributorConfig {
+    std::bitset<NUM_Channels> channels = 0;       //Represents Enabled MIDI Channels
+    std::bitset<NUM_Instruments> instruments = 0; //Represents Enabled Instruments
+    uint16_t distributorBools = DISTRIBUTOR_BOOL_MASK::NOTEOVERWRITE; // A full pool steals a voice like it always overwrote one
+    uint8_t minNote = 0;
+    uint8_t maxNote = 127;
+    DistributionMethod distributionMethod = DistributionMethod::RoundRobinBalance;
+    StealPolicy stealPolicy = StealPolicy::Oldest;
+
+    /* Returns True if every field holds a legal value */
+    bool isValid() const;
 };
 
 /* Routes Midi Notes to various instrument groups via configurable algorithms. */
 class Distributor{
 private:
 
-    std::shared_ptr<InstrumentControllerBase> m_instrumentController;
+    InstrumentControllerBase* m_instrumentController = nullptr; // Non-owning
+    uint8_t m_slot = NONE; // Pool slot, identifies this distributor in voice ownership records
+
+    //Active and shadow configuration, m_activeConfig indexes the one in use
+    std::array<DistributorConfig, 2> m_configs;
+    uint8_t m_activeConfig = 0;
 
-    //Each Bit Represents an Enabled Channel/Instrument (limits max number of instruments to 32)
-    std::bitset<NUM_Channels> m_channels = 0; //Represents Enabled MIDI Channels
-    std::bitset<NUM_Instruments> m_instruments = 0; //Represents Enabled Instruments
+    //Strategy pattern for distribution methods, constructed in place in m_strategyStorage
+    alignas(DistributionStrategy) uint8_t m_strategyStorage[DISTRIBUTION_STRATEGY_STORAGE];
+    DistributionStrategy* m_distributionStrategy = nullptr;
 
-    //Strategy pattern for distribution methods
-    std::unique_ptr<DistributionStrategy> m_distributionStrategy;
+    //Voices started by this distributor, used to pick a voice to steal
+    VoiceStealer m_voiceStealer;
 
-    //Settings
-    uint16_t m_distributorBools = 0; // Initialize with all features disabled
-    uint8_t m_minNote = 0;
-    uint8_t m_maxNote = 127;
-    DistributionMethod m_distributionMethod = DistributionMethod::RoundRobinBalance;
+    //Incoming note -> note to distribute (NONE drops it). Folds in the note range and
+    //octave folding, rebuilt on every config commit so the note path only indexes it.
+    std::array<uint8_t, 128> m_noteMap;
+    //Incoming note of the note on being distributed, recorded with each voice it starts
+    uint8_t m_sourceNote = 0;
+
+    //Sustain and sostenuto hold state
+    PedalEngine m_pedals;
 
 public:
 
     friend class DistributionStrategy;
 
-    explicit Distributor(std::shared_ptr<InstrumentControllerBase> instrumentController);
+    Distributor();
     ~Distributor();
 
-    // Disable copy (unique_ptr is not copyable) and enable move semantics
+    // Distributors live at a fixed address in the DistributorManager pool. The strategy
+    // and the instrument controller's ownership tracking both point back at this object.
     Distributor(const Distributor&) = delete;
     Distributor& operator=(const Distributor&) = delete;
-    Distributor(Distributor&&) noexcept = default;
-    Distributor& operator=(Distributor&&) noexcept = default;
+    Distributor(Distributor&&) = delete;
+    Distributor& operator=(Distributor&&) = delete;
+
+    /* Binds the instrument controller and the pool slot used to record voice ownership */
+    void attach(InstrumentControllerBase& instrumentController, uint8_t slot);
+    uint8_t getSlot() const { return m_slot; }
+    /* Returns the attached distributor in a pool slot, or nullptr */
+    static Distributor* fromSlot(uint8_t slot);
+    /* Stops this distributor's notes and restores the default configuration */
+    void reset();
 
     /* Determines which instruments the message is for */
     void processMessage(const MidiMessage& message);
+    /* Releases every note held by the sustain and sostenuto pedals */
+    void releasePedals();
 
     /* Returns a Byte array representing this Distributor in 7-bit MIDI format */
     std::array<uint8_t,DISTRIBUTOR_NUM_CFG_BYTES> toSerial();
@@ -76,11 +112,14 @@ public:
     uint16_t getDistributorBoolValues() const;
     bool getMuted() const;
     bool getNoteOverwrite() const;
+    bool getOctaveFold() const;
     std::bitset<NUM_Channels> getChannels() const;
     std::bitset<NUM_Instruments> getInstruments() const;
     DistributionMethod getDistributionMethod() const;
     uint8_t getMinNote() const;
     uint8_t getMaxNote() const;
+    StealPolicy getStealPolicy() const;
+    uint32_t getVoiceSteals() const;
 
     void setDistributor(const uint8_t data[]);
     void setDistributionMethod(DistributionMethod);
@@ -92,17 +131,43 @@ public:
     void setMinMaxNote(uint8_t minNote, uint8_t maxNote);
     void setChannels(std::bitset<NUM_Channels> channels);
     void setInstruments(std::bitset<NUM_Instruments> instruments);
+    void setStealPolicy(StealPolicy policy);
+    void resetVoiceSteals();
 
     void toggleMuted();
 
+    /* Returns the shadow configuration, initialised from the active one, for editing */
+    DistributorConfig& editConfig();
+    /* Validates the shadow configuration and swaps it in. Sounding notes keep their
+       voice unless the new configuration no longer routes them. Returns False if rejected. */
+    bool commitConfig();
+
 private:
 
+    const DistributorConfig& config() const { return m_configs[m_activeConfig]; }
+
+    /* Rebuilds m_noteMap from the active configuration and instrument eligibility */
+    void rebuildNoteMap();
+    void buildNoteMap(const DistributorConfig& cfg, std::array<uint8_t, 128>& noteMap) const;
+
+    /* Stops the voices this distributor owns which the next configuration would orphan */
+    void releaseInvalidVoices(const DistributorConfig& previous, const DistributorConfig& next,
+        const std::array<uint8_t, 128>& nextNoteMap);
+
     //Midi Message Events
     void noteOnEvent(uint8_t key, uint8_t velocity, uint8_t channel);
     void noteOffEvent(uint8_t key, uint8_t velocity, uint8_t channel);
+    void controlChangeEvent(uint8_t controller, uint8_t value, uint8_t channel);
+
+    /* Stops every note the instrument is sounding for this distributor and drops the ownership */
+    void stopOwnedVoice(uint8_t instrument);
+
+    /* Stops every held note the pedals no longer retain as one batch */
+    void releaseHeldNotes(uint8_t channel);
     
     // Update the distribution strategy when method changes
     void updateDistributionStrategy();
+    void destroyDistributionStrategy();
 
 
     //-------- Helper Functions --------//
@@ -13,6 +13,12 @@
 // Private constructor
 DistributorManager::DistributorManager(std::shared_ptr<InstrumentControllerBase> instrumentController)
     : m_ptrInstrumentController(instrumentController) {
+    m_ptrInstrumentController->buildEligibility();
+
+    // Every pool slot shares the one controller, nothing is allocated after this
+    for (uint8_t slot = 0; slot < HardwareConfig::MAX_NUM_DISTRIBUTORS; slot++) {
+        m_pool[slot].attach(*m_ptrInstrumentController, slot);
+    }
 }
 
 // Singleton instance getter
@@ -32,28 +38,39 @@ std::shared_ptr<DistributorManager> DistributorManager::getInstance(std::shared_
 // Distributor Management
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-// Create a default Distributor and add it to the Distribution Pool
-void DistributorManager::addDistributor()
+// Claims a free pool slot and appends it to the distributor order.
+// Returns NONE if the pool is full.
+uint8_t DistributorManager::claimSlot()
 {
-    m_distributors.emplace_back(m_ptrInstrumentController);
-    localStorageAddDistributor();
-    broadcastDistributorChanged();
+    if (m_numDistributors >= HardwareConfig::MAX_NUM_DISTRIBUTORS) return NONE;
+
+    for (uint8_t slot = 0; slot < HardwareConfig::MAX_NUM_DISTRIBUTORS; slot++) {
+        if (m_slotsInUse.test(slot)) continue;
+        m_slotsInUse.set(slot);
+        m_pool[slot].reset();
+        m_order[m_numDistributors++] = slot;
+        return slot;
+    }
+    return NONE;
 }
 
-// Add an existing Distributor to the Distribution Pool
-void DistributorManager::addDistributor(Distributor&& distributor)
+// Create a default Distributor and add it to the Distribution Pool
+void DistributorManager::addDistributor()
 {
-    m_distributors.push_back(std::move(distributor));
+    if (claimSlot() == NONE) return;
     localStorageAddDistributor();
+    rebuildChannelRoutes();
     broadcastDistributorChanged();
 }
 
 // Create a Distributor from a Construct and add it to the Distribution Pool
 void DistributorManager::addDistributor(const uint8_t data[])
 {
-    m_distributors.emplace_back(m_ptrInstrumentController);
-    m_distributors.back().setDistributor(data);
+    uint8_t slot = claimSlot();
+    if (slot == NONE) return;
+    m_pool[slot].setDistributor(data);
     localStorageAddDistributor();
+    rebuildChannelRoutes();
     broadcastDistributorChanged();
 }
 
@@ -63,15 +80,17 @@ void DistributorManager::setDistributor(const uint8_t data[])
 {
     // Decode distributor ID from the first two bytes
     uint16_t distributorID = (static_cast<uint16_t>(data[0]) << 7) | static_cast<uint16_t>(data[1]);
-    
+    if (distributorID >= HardwareConfig::MAX_NUM_DISTRIBUTORS) return;
+
     // If distributor ID is beyond current range, add new distributors
-    while (distributorID >= m_distributors.size()) {
+    while (distributorID >= m_numDistributors) {
         addDistributor();
     }
-    
+
     // Update the specified distributor
-    m_distributors[distributorID].setDistributor(data);
+    distributorAt(distributorID).setDistributor(data);
     localStorageUpdateDistributor(distributorID, data);
+    rebuildChannelRoutes();
     broadcastDistributorChanged();
 }
 
@@ -82,22 +101,51 @@ void DistributorManager::setDistributor(const uint8_t data[])
 // Send message to all distributors which accept the designated message's channel.
 void DistributorManager::distributeMessage(const MidiMessage& message)
 {
-    for (uint8_t i = 0; i < m_distributors.size(); i++) {
-        if (m_distributors[i].getChannels().test(message.channel())) {
-            m_distributors[i].processMessage(message);
-        }
+    const uint8_t channel = message.channel() & 0x0F;
+    for (uint8_t i = 0; i < m_numChannelRoutes[channel]; i++) {
+        m_pool[m_channelRoutes[channel][i]].processMessage(message);
     }
 }
 
+// Releases the notes every distributor's pedals are holding
+void DistributorManager::releasePedals()
+{
+    for (uint8_t i = 0; i < m_numDistributors; i++) {
+        m_pool[m_order[i]].releasePedals();
+    }
+}
 
+void DistributorManager::rebuildChannelRoutes()
+{
+    m_numChannelRoutes = {};
+
+    for (uint8_t i = 0; i < m_numDistributors; i++) {
+        const uint8_t slot = m_order[i];
+        if (m_pool[slot].getMuted()) continue;
+        std::bitset<NUM_Channels> channels = m_pool[slot].getChannels();
+        for (uint8_t channel = 0; channel < NUM_Channels; channel++) {
+            if (channels.test(channel)) m_channelRoutes[channel][m_numChannelRoutes[channel]++] = slot;
+        }
+    }
+}
 
 // Removes the designated Distributor from the Distribution Pool
 void DistributorManager::removeDistributor(uint8_t id)
 {
-    if (m_distributors.empty()) return;
-    if (id >= m_distributors.size()) id = static_cast<uint8_t>(m_distributors.size() - 1);
-    m_distributors.erase(m_distributors.begin() + id);
+    if (m_numDistributors == 0) return;
+    if (id >= m_numDistributors) id = m_numDistributors - 1;
+
+    // Free the slot then close the gap so later distributors keep consecutive IDs
+    const uint8_t slot = m_order[id];
+    m_pool[slot].reset();
+    m_slotsInUse.reset(slot);
+    for (uint8_t i = id; i + 1 < m_numDistributors; i++) {
+        m_order[i] = m_order[i + 1];
+    }
+    m_numDistributors--;
+
     localStorageRemoveDistributor(id);
+    rebuildChannelRoutes();
     broadcastDistributorChanged();
 }
 
@@ -105,35 +153,40 @@ void DistributorManager::removeDistributor(uint8_t id)
 void DistributorManager::removeAllDistributors()
 {
     m_ptrInstrumentController->stopAll(); // Safety Stops all Playing Notes
-    m_distributors.clear();
+    for (uint8_t i = 0; i < m_numDistributors; i++) {
+        m_pool[m_order[i]].reset();
+    }
+    m_slotsInUse.reset();
+    m_numDistributors = 0;
     localStorageClearDistributors();
+    rebuildChannelRoutes();
     broadcastDistributorChanged();
 }
 
 // Returns the indexed Distributor from the Distribution Pool
 Distributor& DistributorManager::getDistributor(uint8_t index)
 {
-    if (m_distributors.empty()) {
-        m_distributors.emplace_back(m_ptrInstrumentController);
+    if (m_numDistributors == 0) {
+        claimSlot();
     }
 
-    if (index >= m_distributors.size()) index = static_cast<uint8_t>(m_distributors.size() - 1);
-    return (m_distributors[index]);
+    if (index >= m_numDistributors) index = m_numDistributors - 1;
+    return distributorAt(index);
 }
 
 // Returns indexed Distributor Construct
 std::array<uint8_t, DISTRIBUTOR_NUM_CFG_BYTES> DistributorManager::getDistributorSerial(uint8_t index)
 {
-    if (m_distributors.empty()) {
+    if (m_numDistributors == 0) {
         return {};
     }
 
-    if (index >= m_distributors.size()) {
-        index = static_cast<uint8_t>(m_distributors.size() - 1);
+    if (index >= m_numDistributors) {
+        index = m_numDistributors - 1;
     }
 
     // Append Distributor ID to the Construct
-    auto distributorObj = m_distributors[index].toSerial();
+    auto distributorObj = distributorAt(index).toSerial();
     distributorObj[0] = static_cast<uint8_t>((index >> 7) & 0x7F);
     distributorObj[1] = static_cast<uint8_t>((index >> 0) & 0x7F);
     return distributorObj;
@@ -145,16 +198,16 @@ std::array<uint8_t, DISTRIBUTOR_NUM_CFG_BYTES> DistributorManager::getDistributo
 
 std::bitset<NUM_Channels> DistributorManager::getDistributorChannels(uint8_t distributorId)
 {
-    if (distributorId < m_distributors.size()) {
-        return m_distributors[distributorId].getChannels();
+    if (distributorId < m_numDistributors) {
+        return distributorAt(distributorId).getChannels();
     }
     return 0;
 }
 
 std::bitset<NUM_Instruments> DistributorManager::getDistributorInstruments(uint8_t distributorId)
 {
-    if (distributorId < m_distributors.size()) {
-        return m_distributors[distributorId].getInstruments();
+    if (distributorId < m_numDistributors) {
+        return distributorAt(distributorId).getInstruments();
     }
     return 0;
 }
@@ -167,16 +220,16 @@ std::bitset<NUM_Instruments> DistributorManager::getDistributorInstruments(uint8
 
 void DistributorManager::localStorageAddDistributor()
 {
-    uint8_t distIndex = m_distributors.size() - 1;
+    uint8_t distIndex = m_numDistributors - 1;
     LocalStorageFactory::getInstance().setDistributorConstruct(distIndex, getDistributorSerial(distIndex).data());
-    LocalStorageFactory::getInstance().setNumOfDistributors(m_distributors.size());
+    LocalStorageFactory::getInstance().setNumOfDistributors(m_numDistributors);
 }
 
 void DistributorManager::localStorageRemoveDistributor(uint8_t id)
 {
-    LocalStorageFactory::getInstance().setNumOfDistributors(m_distributors.size());
+    LocalStorageFactory::getInstance().setNumOfDistributors(m_numDistributors);
 
-    for (size_t i = id; i < m_distributors.size(); i++) {
+    for (size_t i = id; i < m_numDistributors; i++) {
         LocalStorageFactory::getInstance().setDistributorConstruct(i, getDistributorSerial(i).data());
     }
 }
@@ -188,7 +241,7 @@ void DistributorManager::localStorageUpdateDistributor(uint16_t distributorID, c
 
 void DistributorManager::localStorageClearDistributors()
 {
-    LocalStorageFactory::getInstance().setNumOfDistributors(m_distributors.size());
+    LocalStorageFactory::getInstance().setNumOfDistributors(m_numDistributors);
 }
 
 #endif
@@ -199,55 +252,78 @@ void DistributorManager::localStorageClearDistributors()
 
 void DistributorManager::setDistributorChannels(uint8_t distributorId, std::bitset<NUM_Channels> channels)
 {
-    if (distributorId < m_distributors.size()) {
-        m_distributors[distributorId].setChannels(channels);
+    if (distributorId < m_numDistributors) {
+        distributorAt(distributorId).setChannels(channels);
         localStorageUpdateDistributor(distributorId, getDistributorSerial(distributorId).data());
+        rebuildChannelRoutes();
         broadcastDistributorChanged();
     }
 }
 
 void DistributorManager::setDistributorInstruments(uint8_t distributorId, std::bitset<NUM_Instruments> instruments)
 {
-    if (distributorId < m_distributors.size()) {
-        m_distributors[distributorId].setInstruments(instruments);
+    if (distributorId < m_numDistributors) {
+        distributorAt(distributorId).setInstruments(instruments);
         localStorageUpdateDistributor(distributorId, getDistributorSerial(distributorId).data());
+        rebuildChannelRoutes();
         broadcastDistributorChanged();
     }
 }
 
 void DistributorManager::setDistributorMethod(uint8_t distributorId, DistributionMethod method)
 {
-    if (distributorId < m_distributors.size()) {
-        m_distributors[distributorId].setDistributionMethod(method);
+    if (distributorId < m_numDistributors) {
+        distributorAt(distributorId).setDistributionMethod(method);
         localStorageUpdateDistributor(distributorId, getDistributorSerial(distributorId).data());
+        rebuildChannelRoutes();
         broadcastDistributorChanged();
     }
 }
 
 void DistributorManager::setDistributorBoolValues(uint8_t distributorId, uint16_t boolValues)
 {
-    if (distributorId < m_distributors.size()) {
-        m_distributors[distributorId].setDistributorBoolValues(boolValues);
+    if (distributorId < m_numDistributors) {
+        distributorAt(distributorId).setDistributorBoolValues(boolValues);
         localStorageUpdateDistributor(distributorId, getDistributorSerial(distributorId).data());
+        rebuildChannelRoutes();
         broadcastDistributorChanged();
     }
 }
 
 void DistributorManager::setDistributorMinMaxNotes(uint8_t distributorId, uint8_t minNote, uint8_t maxNote)
 {
-    if (distributorId < m_distributors.size()) {
-        m_distributors[distributorId].setMinMaxNote(minNote, maxNote);
+    if (distributorId < m_numDistributors) {
+        distributorAt(distributorId).setMinMaxNote(minNote, maxNote);
+        localStorageUpdateDistributor(distributorId, getDistributorSerial(distributorId).data());
+        rebuildChannelRoutes();
+        broadcastDistributorChanged();
+    }
+}
+
+void DistributorManager::setDistributorStealPolicy(uint8_t distributorId, StealPolicy policy)
+{
+    if (distributorId < m_numDistributors) {
+        distributorAt(distributorId).setStealPolicy(policy);
         localStorageUpdateDistributor(distributorId, getDistributorSerial(distributorId).data());
+        rebuildChannelRoutes();
         broadcastDistributorChanged();
     }
 }
 
+// Steal counters are runtime statistics and are not persisted
+void DistributorManager::resetDistributorVoiceSteals(uint8_t distributorId)
+{
+    if (distributorId < m_numDistributors) {
+        distributorAt(distributorId).resetVoiceSteals();
+    }
+}
+
 void DistributorManager::toggleDistributorMute(uint8_t distributorId)
 {
-    if (distributorId < m_distributors.size()) {
-        m_distributors[distributorId].toggleMuted();
+    if (distributorId < m_numDistributors) {
+        distributorAt(distributorId).toggleMuted();
         localStorageUpdateDistributor(distributorId, getDistributorSerial(distributorId).data());
-        m_ptrInstrumentController->stopAll();
+        rebuildChannelRoutes();
         broadcastDistributorChanged();
     }
 }
@@ -258,32 +334,48 @@ void DistributorManager::toggleDistributorMute(uint8_t distributorId)
 
 DistributionMethod DistributorManager::getDistributorMethod(uint8_t distributorId)
 {
-    if (distributorId < m_distributors.size()) {
-        return m_distributors[distributorId].getDistributionMethod();
+    if (distributorId < m_numDistributors) {
+        return distributorAt(distributorId).getDistributionMethod();
     }
     return DistributionMethod::RoundRobinBalance; // Default fallback
 }
 
 uint16_t DistributorManager::getDistributorBoolValues(uint8_t distributorId)
 {
-    if (distributorId < m_distributors.size()) {
-        return m_distributors[distributorId].getDistributorBoolValues();
+    if (distributorId < m_numDistributors) {
+        return distributorAt(distributorId).getDistributorBoolValues();
     }
     return 0;
 }
 
 uint8_t DistributorManager::getDistributorMinNote(uint8_t distributorId)
 {
-    if (distributorId < m_distributors.size()) {
-        return m_distributors[distributorId].getMinNote();
+    if (distributorId < m_numDistributors) {
+        return distributorAt(distributorId).getMinNote();
     }
     return 0;
 }
 
 uint8_t DistributorManager::getDistributorMaxNote(uint8_t distributorId)
 {
-    if (distributorId < m_distributors.size()) {
-        return m_distributors[distributorId].getMaxNote();
+    if (distributorId < m_numDistributors) {
+        return distributorAt(distributorId).getMaxNote();
     }
     return 127;
 }
+
+StealPolicy DistributorManager::getDistributorStealPolicy(uint8_t distributorId)
+{
+    if (distributorId < m_numDistributors) {
+        return distributorAt(distributorId).getStealPolicy();
+    }
+    return StealPolicy::Oldest;
+}
+
+uint32_t DistributorManager::getDistributorVoiceSteals(uint8_t distributorId)
+{
+    if (distributorId < m_numDistributors) {
+        return distributorAt(distributorId).getVoiceSteals();
+    }
+    return 0;
+}
@@ -15,8 +15,9 @@
     #include "../Extras/LocalStorage/LocalStorageFactory.h"
 #endif
 
-#include <vector>
 #include <array>
+#include <bitset>
+#include <memory>
 #include <cstdint>
 #include <functional>
 
@@ -29,7 +30,18 @@ class InstrumentControllerBase;
  */
 class DistributorManager {
 private:
-    std::vector<Distributor> m_distributors;
+    // Statically sized pool, slots never move so each Distributor keeps its address.
+    // m_order maps the positional distributor ID used over SysEx to a pool slot.
+    std::array<Distributor, HardwareConfig::MAX_NUM_DISTRIBUTORS> m_pool;
+    std::array<uint8_t, HardwareConfig::MAX_NUM_DISTRIBUTORS> m_order = {};
+    std::bitset<HardwareConfig::MAX_NUM_DISTRIBUTORS> m_slotsInUse;
+    uint8_t m_numDistributors = 0;
+
+    // Pool slots of the unmuted distributors listening on each channel.
+    // Rebuilt whenever a distributor is added, removed or reconfigured.
+    std::array<std::array<uint8_t, HardwareConfig::MAX_NUM_DISTRIBUTORS>, NUM_Channels> m_channelRoutes = {};
+    std::array<uint8_t, NUM_Channels> m_numChannelRoutes = {};
+
     std::shared_ptr<InstrumentControllerBase> m_ptrInstrumentController;
     std::function<void()> m_deviceChangedCallback;
 
@@ -48,7 +60,6 @@ public:
     
     // Distributor management
     void addDistributor(); 
-    void addDistributor(Distributor&& distributor); 
     void addDistributor(const uint8_t data[]); 
     void setDistributor(const uint8_t data[]); 
     void removeDistributor(uint8_t id);
@@ -57,7 +68,7 @@ public:
     // Distributor access
     Distributor& getDistributor(uint8_t id);
     std::array<uint8_t, DISTRIBUTOR_NUM_CFG_BYTES> getDistributorSerial(uint8_t id);
-    size_t getDistributorCount() const { return m_distributors.size(); }
+    size_t getDistributorCount() const { return m_numDistributors; }
 
     /**
      * Set callback for distributor changes
@@ -67,6 +78,7 @@ public:
     
     // Message processing
     void distributeMessage(const MidiMessage& message);
+    void releasePedals();
 
     
     // Distributor configuration helpers
@@ -76,6 +88,8 @@ public:
     void setDistributorMinMaxNotes(uint8_t distributorId, uint8_t minNote, uint8_t maxNote);
     void toggleDistributorMute(uint8_t distributorId);
     void setDistributorBoolValues(uint8_t distributorId, uint16_t boolValues);
+    void setDistributorStealPolicy(uint8_t distributorId, StealPolicy policy);
+    void resetDistributorVoiceSteals(uint8_t distributorId);
     
     // Distributor query helpers
     std::bitset<NUM_Channels> getDistributorChannels(uint8_t distributorId);
@@ -84,8 +98,16 @@ public:
     uint16_t getDistributorBoolValues(uint8_t distributorId);
     uint8_t getDistributorMinNote(uint8_t distributorId);
     uint8_t getDistributorMaxNote(uint8_t distributorId);
+    StealPolicy getDistributorStealPolicy(uint8_t distributorId);
+    uint32_t getDistributorVoiceSteals(uint8_t distributorId);
 
 private:
+    Distributor& distributorAt(uint8_t id) { return m_pool[m_order[id]]; }
+    uint8_t claimSlot();
+
+    // Rebuilds m_channelRoutes from the current distributor configurations
+    void rebuildChannelRoutes();
+
     // Helper to broadcast distributor changes
     void broadcastDistributorChanged() {
         if (m_deviceChangedCallback) {
@@ -0,0 +1,97 @@
+/*
+ * PedalEngine.cpp
+ *
+ * Sustain and sostenuto hold tracking for distributors.
+ */
+
+#include "PedalEngine.h"
+
+void PedalEngine::noteOn(uint8_t channel, uint8_t note)
+{
+    if (channel >= NUM_Channels) return;
+    m_keysDown[channel].set(note);
+}
+
+bool PedalEngine::noteOff(uint8_t channel, uint8_t note)
+{
+    if (channel >= NUM_Channels) return false;
+    m_keysDown[channel].reset(note);
+
+    const uint16_t channelBit = 1 << channel;
+    bool sustained = m_sustainDown & channelBit;
+    bool sostenutoHeld = (m_sostenutoDown & channelBit) && m_sostenuto[channel].test(note);
+    if (!sustained && !sostenutoHeld) return false;
+
+    m_held[channel].set(note);
+    return true;
+}
+
+bool PedalEngine::isHeld(uint8_t channel, uint8_t note) const
+{
+    if (channel >= NUM_Channels) return false;
+    return m_held[channel].test(note);
+}
+
+void PedalEngine::clearHeld(uint8_t channel, uint8_t note)
+{
+    if (channel >= NUM_Channels) return;
+    m_held[channel].reset(note);
+}
+
+void PedalEngine::setSustain(uint8_t channel, bool down)
+{
+    if (channel >= NUM_Channels) return;
+    if (down) m_sustainDown |= (1 << channel);
+    else m_sustainDown &= ~(1 << channel);
+}
+
+// Sostenuto only holds the notes sounding at the moment it is pressed
+void PedalEngine::setSostenuto(uint8_t channel, bool down)
+{
+    if (channel >= NUM_Channels) return;
+    const uint16_t channelBit = 1 << channel;
+
+    if (down) {
+        if (m_sostenutoDown & channelBit) return; // Repeated pedal down does not recapture
+        m_sostenutoDown |= channelBit;
+        for (uint8_t w = 0; w < 4; w++) {
+            m_sostenuto[channel].words[w] = m_keysDown[channel].words[w] | m_held[channel].words[w];
+        }
+    } else {
+        m_sostenutoDown &= ~channelBit;
+        m_sostenuto[channel].clear();
+    }
+}
+
+NoteBitmap PedalEngine::takeReleases(uint8_t channel)
+{
+    NoteBitmap releases;
+    if (channel >= NUM_Channels) return releases;
+
+    const uint16_t channelBit = 1 << channel;
+    if (m_sustainDown & channelBit) return releases; // Sustain retains everything
+
+    for (uint8_t w = 0; w < 4; w++) {
+        uint32_t retained = (m_sostenutoDown & channelBit) ? m_sostenuto[channel].words[w] : 0;
+        releases.words[w] = m_held[channel].words[w] & ~retained;
+        m_held[channel].words[w] &= retained;
+    }
+    return releases;
+}
+
+void PedalEngine::clearChannel(uint8_t channel)
+{
+    if (channel >= NUM_Channels) return;
+    m_keysDown[channel].clear();
+    m_held[channel].clear();
+    m_sostenuto[channel].clear();
+}
+
+void PedalEngine::clear()
+{
+    for (uint8_t i = 0; i < NUM_Channels; i++) {
+        m_keysDown[i].clear();
+        m_held[i].clear();
+        m_sostenuto[i].clear();
+    }
+}
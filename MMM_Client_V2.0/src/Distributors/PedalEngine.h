@@ -0,0 +1,69 @@
+/*
+ * PedalEngine.h
+ *
+ * Sustain (CC64) and sostenuto (CC66) handling for a distributor.
+ * Note releases that arrive while a pedal holds them are parked in a
+ * 128-bit per-channel bitmap and handed back in one batch when the
+ * pedals no longer retain them.
+ */
+
+#pragma once
+
+#include "../Constants.h"
+#include <array>
+#include <cstdint>
+
+// One bit per MIDI note
+struct NoteBitmap {
+    std::array<uint32_t, 4> words = {};
+
+    void set(uint8_t note) { words[(note >> 5) & 0x03] |= (1UL << (note & 0x1F)); }
+    void reset(uint8_t note) { words[(note >> 5) & 0x03] &= ~(1UL << (note & 0x1F)); }
+    bool test(uint8_t note) const { return words[(note >> 5) & 0x03] & (1UL << (note & 0x1F)); }
+    bool any() const { return (words[0] | words[1] | words[2] | words[3]) != 0; }
+    void clear() { words = {}; }
+
+    /* Calls fn(note) for every set bit in ascending order */
+    template<typename Fn>
+    void forEach(Fn fn) const {
+        for (uint8_t w = 0; w < 4; w++) {
+            uint32_t bits = words[w];
+            while (bits) {
+                uint8_t bit = __builtin_ctz(bits);
+                bits &= bits - 1;
+                fn(static_cast<uint8_t>((w << 5) | bit));
+            }
+        }
+    }
+};
+
+class PedalEngine {
+private:
+    std::array<NoteBitmap, NUM_Channels> m_keysDown;   // Keys currently pressed
+    std::array<NoteBitmap, NUM_Channels> m_held;       // Releases deferred by a pedal
+    std::array<NoteBitmap, NUM_Channels> m_sostenuto;  // Notes captured when sostenuto went down
+
+    uint16_t m_sustainDown = 0;   // Each bit represents a channel
+    uint16_t m_sostenutoDown = 0; // Each bit represents a channel
+
+public:
+    /* Records a key press */
+    void noteOn(uint8_t channel, uint8_t note);
+    /* Records a key release. Returns True if a pedal holds the note (release is deferred) */
+    bool noteOff(uint8_t channel, uint8_t note);
+
+    /* Returns True if the note is only sounding because a pedal holds it */
+    bool isHeld(uint8_t channel, uint8_t note) const;
+    void clearHeld(uint8_t channel, uint8_t note);
+
+    void setSustain(uint8_t channel, bool down);
+    void setSostenuto(uint8_t channel, bool down);
+
+    /* Removes and returns every held note the pedals no longer retain */
+    NoteBitmap takeReleases(uint8_t channel);
+
+    /* Clears key and hold state for one channel */
+    void clearChannel(uint8_t channel);
+    /* Clears all key and hold state (pedal positions are kept) */
+    void clear();
+};
@@ -0,0 +1,169 @@
+/*
+ * VoiceStealer.cpp
+ *
+ * Voice bookkeeping for distributor voice stealing.
+ */
+
+#include "VoiceStealer.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Voice Tracking
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Link the voice at the tail of the LRU list and add it to its slots
+void VoiceStealer::noteStarted(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t source)
+{
+    if (instrument >= NUM_Instruments) return;
+    note &= 0x7F;
+
+    // A retriggered note becomes the newest voice
+    uint8_t v = find(instrument, note);
+    if (v != NONE) remove(v);
+
+    // Out of entries, forget the oldest voice
+    if (~m_used == 0) remove(m_head);
+    v = __builtin_ctzll(~m_used);
+
+    Voice& voice = m_voices[v];
+    voice.instrument = instrument;
+    voice.note = note;
+    voice.velocity = velocity & 0x7F;
+    voice.source = source & 0x7F;
+    voice.prev = m_tail;
+    voice.next = NONE;
+    if (m_tail != NONE) m_voices[m_tail].next = v;
+    else m_head = v;
+    m_tail = v;
+
+    const uint64_t bit = 1ULL << v;
+    m_used |= bit;
+    m_velocitySlots[voice.velocity >> SLOT_SHIFT] |= bit;
+    m_noteSlots[voice.note >> SLOT_SHIFT] |= bit;
+    m_voicesPerInstrument[instrument]++;
+    m_instrumentMask |= (1UL << instrument);
+}
+
+void VoiceStealer::noteStopped(uint8_t instrument, uint8_t note)
+{
+    if (instrument >= NUM_Instruments || !(m_instrumentMask & (1UL << instrument))) return;
+    uint8_t v = find(instrument, note & 0x7F);
+    if (v != NONE) remove(v);
+}
+
+void VoiceStealer::instrumentStopped(uint8_t instrument)
+{
+    if (instrument >= NUM_Instruments || !(m_instrumentMask & (1UL << instrument))) return;
+    forgetIf([instrument](uint8_t i, uint8_t) { return i == instrument; });
+}
+
+void VoiceStealer::clear()
+{
+    m_voices = {};
+    m_head = NONE;
+    m_tail = NONE;
+    m_used = 0;
+    m_velocitySlots = {};
+    m_noteSlots = {};
+    m_instrumentMask = 0;
+    m_voicesPerInstrument = {};
+}
+
+uint8_t VoiceStealer::find(uint8_t instrument, uint8_t note) const
+{
+    uint64_t voices = m_used;
+    while (voices) {
+        uint8_t v = __builtin_ctzll(voices);
+        voices &= voices - 1;
+        if (m_voices[v].instrument == instrument && m_voices[v].note == note) return v;
+    }
+    return NONE;
+}
+
+// Unlink the voice from the LRU list and its slots
+void VoiceStealer::remove(uint8_t v)
+{
+    Voice& voice = m_voices[v];
+    if (voice.prev != NONE) m_voices[voice.prev].next = voice.next;
+    else m_head = voice.next;
+    if (voice.next != NONE) m_voices[voice.next].prev = voice.prev;
+    else m_tail = voice.prev;
+
+    const uint64_t bit = 1ULL << v;
+    m_used &= ~bit;
+    m_velocitySlots[voice.velocity >> SLOT_SHIFT] &= ~bit;
+    m_noteSlots[voice.note >> SLOT_SHIFT] &= ~bit;
+    if (--m_voicesPerInstrument[voice.instrument] == 0) m_instrumentMask &= ~(1UL << voice.instrument);
+    voice = {};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Victim Selection
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool VoiceStealer::selectVictim(StealPolicy policy, uint32_t candidates, uint8_t& instrument, uint8_t& note) const
+{
+    if ((candidates & m_instrumentMask) == 0) return false;
+
+    uint8_t v = NONE;
+    switch (policy) {
+        case StealPolicy::Quietest:
+            v = selectFromSlots(m_velocitySlots, &Voice::velocity, candidates, true);
+            break;
+        case StealPolicy::Lowest:
+            v = selectFromSlots(m_noteSlots, &Voice::note, candidates, true);
+            break;
+        case StealPolicy::Highest:
+            v = selectFromSlots(m_noteSlots, &Voice::note, candidates, false);
+            break;
+        case StealPolicy::Oldest:
+        default:
+            // Walk from the oldest voice, candidates are nearly always the whole list
+            for (uint8_t i = m_head; i != NONE; i = m_voices[i].next) {
+                if (candidates & (1UL << m_voices[i].instrument)) {
+                    v = i;
+                    break;
+                }
+            }
+            break;
+    }
+    if (v == NONE) return false;
+
+    instrument = m_voices[v].instrument;
+    note = m_voices[v].note;
+    return true;
+}
+
+bool VoiceStealer::oldestNote(uint8_t instrument, uint8_t& note) const
+{
+    if (instrument >= NUM_Instruments || !(m_instrumentMask & (1UL << instrument))) return false;
+    for (uint8_t i = m_head; i != NONE; i = m_voices[i].next) {
+        if (m_voices[i].instrument == instrument) {
+            note = m_voices[i].note;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Find the first slot holding a candidate then the extreme value within that slot
+uint8_t VoiceStealer::selectFromSlots(const std::array<uint64_t, NUM_SLOTS>& slots, uint8_t Voice::*value,
+    uint32_t candidates, bool lowest) const
+{
+    for (uint8_t s = 0; s < NUM_SLOTS; s++) {
+        uint64_t voices = slots[lowest ? s : (NUM_SLOTS - 1 - s)];
+
+        uint8_t victim = NONE;
+        while (voices) {
+            uint8_t i = __builtin_ctzll(voices);
+            voices &= voices - 1;
+            if (!(candidates & (1UL << m_voices[i].instrument))) continue;
+            if (victim == NONE
+                || (lowest && m_voices[i].*value < m_voices[victim].*value)
+                || (!lowest && m_voices[i].*value > m_voices[victim].*value)) {
+                victim = i;
+            }
+        }
+        if (victim != NONE) return victim;
+    }
+    return NONE;
+}
@@ -0,0 +1,104 @@
+/*
+ * VoiceStealer.h
+ *
+ * Tracks the voices a distributor has started so a victim can be chosen
+ * when every instrument in its pool is busy. A voice is one sounding note,
+ * so a polyphonic instrument holds several. Voices are kept in an
+ * intrusive LRU list (oldest first) and in coarse velocity and pitch
+ * slots, so each StealPolicy resolves without sorting or scanning the pool.
+ */
+
+#pragma once
+
+#include "../Constants.h"
+#include <array>
+#include <cstdint>
+
+class VoiceStealer {
+public:
+    // Voices tracked at once. Past this the oldest voice is forgotten, it keeps
+    // sounding but can no longer be chosen as a victim.
+    static constexpr uint8_t MAX_VOICES = 64;
+
+private:
+    // Velocity and note slots are 16 values wide (128 / 8)
+    static constexpr uint8_t NUM_SLOTS = 8;
+    static constexpr uint8_t SLOT_SHIFT = 4;
+
+    struct Voice {
+        uint8_t instrument = NONE;
+        uint8_t note = 0;
+        uint8_t velocity = 0;
+        uint8_t source = 0; // Incoming note the distributor mapped to this note
+        uint8_t prev = NONE; // Intrusive LRU list (head = oldest, tail = newest)
+        uint8_t next = NONE;
+    };
+    std::array<Voice, MAX_VOICES> m_voices;
+    uint8_t m_head = NONE;
+    uint8_t m_tail = NONE;
+
+    // Each bit represents a tracked voice
+    uint64_t m_used = 0;
+    std::array<uint64_t, NUM_SLOTS> m_velocitySlots = {};
+    std::array<uint64_t, NUM_SLOTS> m_noteSlots = {};
+
+    // Each bit represents an instrument with at least one tracked voice
+    uint32_t m_instrumentMask = 0;
+    std::array<uint8_t, NUM_Instruments> m_voicesPerInstrument = {};
+
+    uint32_t m_stealCount = 0;
+
+public:
+    /* Records a note, started for the incoming source note, as the newest sounding voice */
+    void noteStarted(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t source);
+    /* Removes one note from tracking */
+    void noteStopped(uint8_t instrument, uint8_t note);
+    /* Removes every note of an instrument from tracking */
+    void instrumentStopped(uint8_t instrument);
+    /* Forgets every tracked voice (steal count is kept) */
+    void clear();
+
+    /* Finds the voice to steal among the candidate instruments. Returns False if there is none. */
+    bool selectVictim(StealPolicy policy, uint32_t candidates, uint8_t& instrument, uint8_t& note) const;
+    /* Finds the longest sounding tracked note of an instrument. Returns False if there is none. */
+    bool oldestNote(uint8_t instrument, uint8_t& note) const;
+
+    uint32_t getInstrumentMask() const { return m_instrumentMask; }
+    bool isTracked(uint8_t instrument, uint8_t note) const { return find(instrument, note & 0x7F) != NONE; }
+
+    /* Forgets every voice for which ended(instrument, note) returns True */
+    template<typename Fn>
+    void forgetIf(Fn ended) {
+        uint64_t voices = m_used;
+        while (voices) {
+            uint8_t v = __builtin_ctzll(voices);
+            voices &= voices - 1;
+            if (ended(m_voices[v].instrument, m_voices[v].note)) remove(v);
+        }
+    }
+
+    /* Forgets every voice of the given instruments whose source note noteMap no longer
+       sends to the note it is sounding, calling remapped(instrument, note) for each */
+    template<typename Fn>
+    void forgetRemapped(uint32_t instruments, const std::array<uint8_t, 128>& noteMap, Fn remapped) {
+        uint64_t voices = m_used;
+        while (voices) {
+            uint8_t v = __builtin_ctzll(voices);
+            voices &= voices - 1;
+            const Voice& voice = m_voices[v];
+            if (!(instruments & (1UL << voice.instrument)) || noteMap[voice.source] == voice.note) continue;
+            remapped(voice.instrument, voice.note);
+            remove(v);
+        }
+    }
+
+    void countSteal() { m_stealCount++; }
+    uint32_t getStealCount() const { return m_stealCount; }
+    void resetStealCount() { m_stealCount = 0; }
+
+private:
+    uint8_t find(uint8_t instrument, uint8_t note) const;
+    void remove(uint8_t voice);
+    uint8_t selectFromSlots(const std::array<uint64_t, NUM_SLOTS>& slots, uint8_t Voice::*value,
+        uint32_t candidates, bool lowest) const;
+};
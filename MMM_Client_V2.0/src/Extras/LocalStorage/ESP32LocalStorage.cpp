@@ -81,7 +81,7 @@ bool ESP32LocalStorage::openNvs() {
     return (g_err == ESP_OK);
 }
 
-esp_err_t ESP32LocalStorage::readNvsBlob(const char *key, uint8_t* result, uint8_t arrayLength) {
+esp_err_t ESP32LocalStorage::readNvsBlob(const char *key, uint8_t* result, uint16_t arrayLength) {
     size_t arraySize = sizeof(uint8_t) * arrayLength;
     uint8_t tempResult[arrayLength];
 
@@ -132,7 +132,7 @@ uint8_t ESP32LocalStorage::readNvsU8(const char *key, uint8_t defaultValue) {
     }
 }
 
-esp_err_t ESP32LocalStorage::writeNvsBlob(const char *key, const uint8_t* data, uint8_t arrayLength) {
+esp_err_t ESP32LocalStorage::writeNvsBlob(const char *key, const uint8_t* data, uint16_t arrayLength) {
     size_t arraySize = sizeof(uint8_t) * arrayLength;
     
     if (!openNvs()) {
@@ -288,6 +288,18 @@ void ESP32LocalStorage::setDistributorConstruct(uint16_t distributorNum, const u
     writeNvsBlob(ptr_key, construct, DISTRIBUTOR_NUM_CFG_BYTES);
 }
 
+bool ESP32LocalStorage::getInstrumentWear(InstrumentWear* wear, uint8_t numInstruments) {
+    // Stored as one blob so a save is a single NVS commit
+    uint16_t length = sizeof(InstrumentWear) * numInstruments;
+    esp_err_t err = readNvsBlob("Instrument_wear", reinterpret_cast<uint8_t*>(wear), length);
+    return (err == ESP_OK);
+}
+
+void ESP32LocalStorage::setInstrumentWear(const InstrumentWear* wear, uint8_t numInstruments) {
+    uint16_t length = sizeof(InstrumentWear) * numInstruments;
+    writeNvsBlob("Instrument_wear", reinterpret_cast<const uint8_t*>(wear), length);
+}
+
 bool ESP32LocalStorage::initializeDeviceConfiguration(DistributorManager& distributorManager) {
     // Ensure NVS is properly initialized
     if (!isAvailable()) {
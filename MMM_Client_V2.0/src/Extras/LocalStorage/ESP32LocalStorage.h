@@ -44,7 +44,7 @@ private:
      * @param arrayLength Length of buffer
      * @return ESP error code
      */
-    esp_err_t readNvsBlob(const char *key, uint8_t* result, uint8_t arrayLength);
+    esp_err_t readNvsBlob(const char *key, uint8_t* result, uint16_t arrayLength);
 
     /**
      * @brief Read uint8_t value from NVS
@@ -61,7 +61,7 @@ private:
      * @param arrayLength Length of data
      * @return ESP error code
      */
-    esp_err_t writeNvsBlob(const char *key, const uint8_t* data, uint8_t arrayLength);
+    esp_err_t writeNvsBlob(const char *key, const uint8_t* data, uint16_t arrayLength);
 
     /**
      * @brief Write uint8_t value to NVS
@@ -101,6 +101,9 @@ public:
     
     void getDistributorConstruct(uint16_t distributorNum, uint8_t* construct) override;
     void setDistributorConstruct(uint16_t distributorNum, const uint8_t* construct) override;
+
+    bool getInstrumentWear(InstrumentWear* wear, uint8_t numInstruments) override;
+    void setInstrumentWear(const InstrumentWear* wear, uint8_t numInstruments) override;
 };
 
 #endif // PLATFORM_ESP32
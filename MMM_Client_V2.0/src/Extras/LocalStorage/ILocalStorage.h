@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "Constants.h"
 #include <cstdint>
 #include <string>
 
@@ -111,4 +112,20 @@ public:
      * @param construct Configuration data to store
      */
     virtual void setDistributorConstruct(uint16_t distributorNum, const uint8_t* construct) = 0;
+
+    // Instrument Wear Counters (kept through resetDeviceConfig, they describe the hardware)
+    /**
+     * @brief Get stored instrument wear counters
+     * @param wear Array to receive one entry per instrument
+     * @param numInstruments Number of entries in the array
+     * @return true if counters were loaded, false if none are stored
+     */
+    virtual bool getInstrumentWear(InstrumentWear* wear, uint8_t numInstruments) = 0;
+
+    /**
+     * @brief Store instrument wear counters
+     * @param wear Array holding one entry per instrument
+     * @param numInstruments Number of entries in the array
+     */
+    virtual void setInstrumentWear(const InstrumentWear* wear, uint8_t numInstruments) = 0;
 };
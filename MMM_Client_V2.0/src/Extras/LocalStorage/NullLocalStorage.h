@@ -40,4 +40,7 @@ public:
     
     void getDistributorConstruct(uint16_t distributorNum, uint8_t* construct) override {}
     void setDistributorConstruct(uint16_t distributorNum, const uint8_t* construct) override {}
+
+    bool getInstrumentWear(InstrumentWear* wear, uint8_t numInstruments) override { return false; }
+    void setInstrumentWear(const InstrumentWear* wear, uint8_t numInstruments) override {}
 };
@@ -74,6 +74,11 @@ uint16_t Teensy41LocalStorage::getDistributorAddress(uint16_t distributorNum) {
     return ADDR_DISTRIBUTORS_START + (distributorNum * DISTRIBUTOR_NUM_CFG_BYTES);
 }
 
+// Wear counters sit after the largest distributor pool so neither region moves the other
+uint16_t Teensy41LocalStorage::getInstrumentWearAddress() {
+    return getDistributorAddress(HardwareConfig::MAX_NUM_DISTRIBUTORS);
+}
+
 void Teensy41LocalStorage::resetDeviceConfig() {
     if (!m_initialized) {
         return;
@@ -210,6 +215,40 @@ void Teensy41LocalStorage::setDistributorConstruct(uint16_t distributorNum, cons
     }
 }
 
+bool Teensy41LocalStorage::getInstrumentWear(InstrumentWear* wear, uint8_t numInstruments) {
+    if (!m_initialized) {
+        return false;
+    }
+
+    uint16_t addr = getInstrumentWearAddress();
+    uint16_t magic = (static_cast<uint16_t>(EEPROM.read(addr)) << 8) | static_cast<uint16_t>(EEPROM.read(addr + 1));
+    if (magic != WEAR_MAGIC) {
+        return false; // Never saved, erased flash would read as maxed out counters
+    }
+
+    uint8_t* data = reinterpret_cast<uint8_t*>(wear);
+    for (uint16_t i = 0; i < sizeof(InstrumentWear) * numInstruments; i++) {
+        data[i] = EEPROM.read(addr + 2 + i);
+    }
+    return true;
+}
+
+void Teensy41LocalStorage::setInstrumentWear(const InstrumentWear* wear, uint8_t numInstruments) {
+    if (!m_initialized) {
+        return;
+    }
+
+    uint16_t addr = getInstrumentWearAddress();
+    EEPROM.update(addr, static_cast<uint8_t>((WEAR_MAGIC >> 8) & 0xFF));
+    EEPROM.update(addr + 1, static_cast<uint8_t>(WEAR_MAGIC & 0xFF));
+
+    // update() skips unchanged bytes, most saves only touch the low counter bytes
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(wear);
+    for (uint16_t i = 0; i < sizeof(InstrumentWear) * numInstruments; i++) {
+        EEPROM.update(addr + 2 + i, data[i]);
+    }
+}
+
 bool Teensy41LocalStorage::initializeDeviceConfiguration(DistributorManager& distributorManager) {
     // Ensure storage is properly initialized
     if (!isAvailable()) {
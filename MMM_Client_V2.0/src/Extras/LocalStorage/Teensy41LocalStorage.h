@@ -29,6 +29,7 @@
  * - 0x001A: Number of distributors (1 byte)
  * - 0x001B: Reserved (1 byte)
  * - 0x001C-0x107B: Distributor constructs (256 distributors * 16 bytes each = 4096 bytes)
+ * - After MAX_NUM_DISTRIBUTORS constructs: Wear magic (2 bytes) then 8 bytes of wear counters per instrument
  */
 class Teensy41LocalStorage : public ILocalStorage {
 private:
@@ -39,6 +40,7 @@ private:
     static constexpr uint16_t ADDR_DEVICE_BOOL = 0x0018;
     static constexpr uint16_t ADDR_NUM_DISTRIBUTORS = 0x001A;
     static constexpr uint16_t ADDR_DISTRIBUTORS_START = 0x001C;
+    static constexpr uint16_t WEAR_MAGIC = 0xB7C8;
     
     bool m_initialized;
     
@@ -60,6 +62,12 @@ private:
      */
     uint16_t getDistributorAddress(uint16_t distributorNum);
 
+    /**
+     * @brief Get EEPROM address of the instrument wear counters
+     * @return EEPROM address of the wear magic number
+     */
+    uint16_t getInstrumentWearAddress();
+
 public:
     /**
      * @brief Construct Teensy41LocalStorage instance
@@ -91,6 +99,9 @@ public:
     
     void getDistributorConstruct(uint16_t distributorNum, uint8_t* construct) override;
     void setDistributorConstruct(uint16_t distributorNum, const uint8_t* construct) override;
+
+    bool getInstrumentWear(InstrumentWear* wear, uint8_t numInstruments) override;
+    void setInstrumentWear(const InstrumentWear* wear, uint8_t numInstruments) override;
 };
 
 #endif // PLATFORM_TEENSY41
@@ -5,31 +5,29 @@
 #include "Instruments/InstrumentControllerBase.h"
 #include "Instruments/Components/NoteTable.h"
 #include "Arduino.h"
-#include <cmath>
-#include "esp32-hal-ledc.h"
+#include "driver/ledc.h"
 
 // Define constants for PWM configuration
 constexpr uint8_t pwmPins[] = {CFG_PINS_INSTRUMENT_PWM};
 constexpr uint8_t numPwmPins = sizeof(pwmPins) / sizeof(pwmPins[0]);
+static_assert(numPwmPins <= Ledc::NUM_MODES * Ledc::CHANNELS_PER_MODE, "The ESP32 LEDC drives at most 16 pins");
+constexpr uint8_t numVoices = (numPwmPins < HardwareConfig::MAX_NUM_INSTRUMENTS) ? numPwmPins : HardwareConfig::MAX_NUM_INSTRUMENTS;
+
+using LedcBinding = LedcAllocator<HardwareConfig::MAX_NUM_INSTRUMENTS>::Binding;
 
 // Static member definitions - properly scoped as class members
 std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_HwPWM::m_activeNotes = {};
 uint8_t ESP32_HwPWM::m_numActiveNotes = 0;
-std::array<double, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_HwPWM::lastFrequency = {};
-std::array<double, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_HwPWM::m_noteFrequency = {};
-std::array<double, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_HwPWM::m_activeFrequency = {};
-std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_HwPWM::m_ledcChannels = {};
+std::array<uint32_t, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_HwPWM::m_targetFrequency = {};
+ModulationEngine ESP32_HwPWM::m_modulation;
+LedcAllocator<HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_HwPWM::m_allocator;
+std::array<LedcBinding, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_HwPWM::m_appliedBinding = {};
+std::array<std::array<Ledc::TimerSetting, Ledc::TIMERS_PER_MODE>, Ledc::NUM_MODES> ESP32_HwPWM::m_appliedTimer = {};
+std::array<std::array<uint32_t, Ledc::TIMERS_PER_MODE>, Ledc::NUM_MODES> ESP32_HwPWM::m_appliedFrequency = {};
 
 ESP32_HwPWM::ESP32_HwPWM() : InstrumentControllerBase()
 {
-    // Initialize LedC channels for each instrument
-    // Use channels 0, 2, 4, 6, 8, 10, 12, 14 to ensure each uses a unique timer
-    // This avoids timer sharing which causes frequency interference
-
-    for(uint8_t i = 0; i < numPwmPins && i < HardwareConfig::MAX_NUM_INSTRUMENTS; ++i){
-        m_ledcChannels[i] = i * 2; // Map: instrument 0->ch0, 1->ch2, 2->ch4, etc.
-        initializeLedcChannel(i, pwmPins[i]);
-    }
+    initializeLedc();
 
     delay(500); // Wait a half second for safety
 
@@ -38,41 +36,105 @@ ESP32_HwPWM::ESP32_HwPWM() : InstrumentControllerBase()
     m_noteStartTime.fill(0); // No notes started initially
 }
 
-void ESP32_HwPWM::initializeLedcChannel(uint8_t instrument, uint8_t pin)
+// Starts all 8 timers off the 80MHz APB clock. Pins stay plain low outputs until a voice is
+// given a channel, the channel is routed to its pin then.
+void ESP32_HwPWM::initializeLedc()
 {
-    // Configure LedC channel - only do full setup once during initialization
-    ledcSetup(m_ledcChannels[instrument], 1000, LEDC_RESOLUTION); // Start with 1kHz, will be changed when notes play
-    ledcAttachPin(pin, m_ledcChannels[instrument]);
-    ledcWrite(m_ledcChannels[instrument], 0); // Start with output off
+    for (uint8_t mode = 0; mode < Ledc::NUM_MODES; mode++) {
+        for (uint8_t timer = 0; timer < Ledc::TIMERS_PER_MODE; timer++) {
+            ledc_timer_config_t config = {};
+            config.speed_mode = static_cast<ledc_mode_t>(mode);
+            config.duty_resolution = LEDC_TIMER_10_BIT;
+            config.timer_num = static_cast<ledc_timer_t>(timer);
+            config.freq_hz = 1000; // Replaced when a note plays
+            config.clk_cfg = LEDC_USE_APB_CLK;
+            ledc_timer_config(&config);
+        }
+    }
+
+    for (uint8_t i = 0; i < numVoices; i++) {
+        pinMode(pwmPins[i], OUTPUT);
+        digitalWrite(pwmPins[i], LOW);
+    }
 }
 
-void ESP32_HwPWM::setFrequency(uint8_t instrument, double frequency)
+// Stops the voice's channel and hands its pin back to the GPIO, which holds it low. The channel
+// may go to another pin next, which would otherwise drive this one as well.
+void ESP32_HwPWM::releaseChannel(uint8_t instrument)
 {
-    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) return;
-    
-    // Clamp frequency to valid range (10Hz - 20kHz)
-    if (frequency < 10.0) frequency = 10.0;
-    if (frequency > 20000.0) frequency = 20000.0;
-    
-    // Only update if frequency changed significantly (>0.5Hz difference for better precision)
-    if (abs(lastFrequency[instrument] - frequency) > 0.5) {
-        // Use ledcChangeFrequency for much faster frequency updates (no full reconfiguration)
-        ledcChangeFrequency(m_ledcChannels[instrument], frequency, LEDC_RESOLUTION);
-        lastFrequency[instrument] = frequency;
-    }
-    
-    // Set duty cycle - this is fast and always needs to be done to ensure output is active
-    ledcWrite(m_ledcChannels[instrument], DUTY_CYCLE_50_PERCENT);
-    m_activeInstruments.set(instrument);
+    const LedcBinding& applied = m_appliedBinding[instrument];
+    if (!applied.placed()) return;
+    ledc_stop(static_cast<ledc_mode_t>(applied.mode), static_cast<ledc_channel_t>(applied.channel), 0);
+    pinMatrixOutDetach(pwmPins[instrument], false, false);
+    m_appliedBinding[instrument] = {};
 }
 
-void ESP32_HwPWM::stopChannel(uint8_t instrument)
+// Plans every voice onto the LEDC and writes only what changed. Timers are retuned before
+// channels are bound to them so a voice never starts at the old frequency.
+void ESP32_HwPWM::syncLedc()
 {
-    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) return;
-    
-    // Set duty cycle to 0 to stop PWM output - this is very fast
-    ledcWrite(m_ledcChannels[instrument], 0);
-    m_activeInstruments.reset(instrument);
+    m_allocator.plan(m_targetFrequency);
+
+    // A voice left without a timer would be silent while counted as sounding, free it so the
+    // distributor hands its next note to a voice that can play it
+    for (uint8_t i = 0; i < numVoices; i++) {
+        if (m_targetFrequency[i] != 0 && !m_allocator.binding(i).placed()) clearVoice(i);
+    }
+
+    // Timers keep their resolution while the divider fits so the channels' duty stays valid
+    bool resized[Ledc::NUM_MODES][Ledc::TIMERS_PER_MODE] = {};
+    for (uint8_t mode = 0; mode < Ledc::NUM_MODES; mode++) {
+        for (uint8_t timer = 0; timer < Ledc::TIMERS_PER_MODE; timer++) {
+            const auto& planned = m_allocator.timer(mode, timer);
+            if (planned.users == 0 || planned.frequencyQ16 == m_appliedFrequency[mode][timer]) continue;
+
+            Ledc::TimerSetting& setting = m_appliedTimer[mode][timer];
+            const uint32_t divider = Ledc::divider(planned.frequencyQ16, setting.resolution);
+            if (divider != 0) {
+                setting.divider = divider;
+            } else {
+                setting = Ledc::timerSetting(planned.frequencyQ16);
+                resized[mode][timer] = true;
+            }
+            ledc_timer_set(static_cast<ledc_mode_t>(mode), static_cast<ledc_timer_t>(timer),
+                           setting.divider, setting.resolution, LEDC_APB_CLK);
+            m_appliedFrequency[mode][timer] = planned.frequencyQ16;
+        }
+    }
+
+    // Channels are let go first, one may be handed straight on to another voice below
+    for (uint8_t i = 0; i < numVoices; i++) {
+        const LedcBinding& planned = m_allocator.binding(i);
+        const LedcBinding& applied = m_appliedBinding[i];
+        if (applied.placed() && (planned.mode != applied.mode || planned.channel != applied.channel)) releaseChannel(i);
+    }
+
+    for (uint8_t i = 0; i < numVoices; i++) {
+        const LedcBinding& planned = m_allocator.binding(i);
+        LedcBinding& applied = m_appliedBinding[i];
+        if (!planned.placed()) continue;
+
+        const ledc_mode_t mode = static_cast<ledc_mode_t>(planned.mode);
+        const ledc_channel_t channel = static_cast<ledc_channel_t>(planned.channel);
+        const uint32_t duty = 1UL << (m_appliedTimer[planned.mode][planned.timer].resolution - 1); // 50%
+
+        if (!applied.placed()) {
+            ledc_channel_config_t config = {};
+            config.gpio_num = pwmPins[i];
+            config.speed_mode = mode;
+            config.channel = channel;
+            config.intr_type = LEDC_INTR_DISABLE;
+            config.timer_sel = static_cast<ledc_timer_t>(planned.timer);
+            config.duty = duty;
+            config.hpoint = 0;
+            ledc_channel_config(&config);
+        } else if (planned.timer != applied.timer || resized[planned.mode][planned.timer]) {
+            ledc_bind_channel_timer(mode, channel, static_cast<ledc_timer_t>(planned.timer));
+            ledc_set_duty(mode, channel, duty);
+            ledc_update_duty(mode, channel);
+        }
+        applied = planned;
+    }
 }
 
 void ESP32_HwPWM::reset(uint8_t instrument)
@@ -87,63 +149,70 @@ void ESP32_HwPWM::resetAll()
 
 void ESP32_HwPWM::playNote(uint8_t instrument, uint8_t note, uint8_t velocity,  uint8_t channel)
 {
-    // Early bounds checking for performance
-    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS || note >= 128) return;
+    // Early bounds checking for performance, voices without a pin can't sound
+    if (instrument >= numVoices || note >= 128) return;
 
-    const double baseFreq = NoteTables::noteFrequency[note];
-    
-    // Store note information
-    m_activeNotes[instrument] = (MSB_BITMASK | note);
-    m_noteFrequency[instrument] = baseFreq;
-    m_noteStartTime[instrument] = millis(); // Record when note started for timeout tracking
-    
-    // Calculate final frequency with pitch bend applied
-    m_activeFrequency[instrument] = NoteTables::applyPitchBend(baseFreq, m_pitchBend[channel]);
-    
     // Increment active note count only if this instrument wasn't already active
     if (!m_activeInstruments.test(instrument)) {
         m_numActiveNotes++;
     }
 
-    setFrequency(instrument, m_activeFrequency[instrument]);
+    // Store note information
+    m_activeNotes[instrument] = (MSB_BITMASK | note);
+    m_activeInstruments.set(instrument);
+    m_noteStartTime[instrument] = millis(); // Record when note started for timeout tracking
+    
+    // The hardware keeps the waveform running on its own so legato needs nothing extra here
+    m_modulation.startVoice(instrument, channel, Tuning::active().periods[note]);
+    m_targetFrequency[instrument] = modulatedFrequency(instrument);
+
+    // Notes of a batch are planned together so they can share timers
+    if (!isBatching()) syncLedc();
 }
 
 void ESP32_HwPWM::stopNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel)
 {
     if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) return;
-    
-    // Check if this instrument is playing the specified note (optimized bit operation)
-        // Clear note information
-        m_activeNotes[instrument] = 0;
-        m_noteFrequency[instrument] = 0;
-        m_activeFrequency[instrument] = 0;
-        m_lastDistributor[instrument] = nullptr; // Clear distributor tracking
-        m_lastChannel[instrument] = NONE; // Clear channel tracking
-        m_noteStartTime[instrument] = 0;
-        
-        // Decrement active note count only if channel was actually active
-        if (m_activeInstruments.test(instrument)) {
-            m_numActiveNotes--;
-        }
-        
-        // Stop the LedC channel (fast duty cycle set to 0)
-        stopChannel(instrument);
+    clearVoice(instrument);
+
+    // Frees the voice's channel and, if nobody else uses it, its timer
+    if (!isBatching()) syncLedc();
+}
+
+// Forgets the voice's note, the next syncLedc() lets go of its channel
+void ESP32_HwPWM::clearVoice(uint8_t instrument)
+{
+    // Decrement active note count only if channel was actually active
+    if (m_activeInstruments.test(instrument)) {
+        m_numActiveNotes--;
+    }
+
+    // Clear note information
+    m_activeNotes[instrument] = 0;
+    m_activeInstruments.reset(instrument);
+    m_targetFrequency[instrument] = 0;
+    m_modulation.stopVoice(instrument);
+    releaseVoiceOwner(instrument); // Clear distributor tracking
+    m_noteStartTime[instrument] = 0;
+}
+
+void ESP32_HwPWM::publishBatch()
+{
+    syncLedc();
 }
 
 void ESP32_HwPWM::stopAll(){
     std::fill_n(m_pitchBend, Midi::NUM_CH, Midi::CTRL_CENTER);
     m_numActiveNotes = 0;
     m_activeNotes = {};
-    m_noteFrequency = {};
-    m_activeFrequency = {};
-    m_lastDistributor.fill(nullptr); // Clear all distributor tracking
-    m_lastChannel.fill(NONE); // Clear all channel tracking
+    m_activeInstruments.reset();
+    m_targetFrequency = {};
+    m_modulation.reset();
+    releaseAllVoiceOwners(); // Clear all distributor tracking
     m_noteStartTime.fill(0); // Clear all start times
 
     // Stop all LedC channels
-    for(uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++){
-        stopChannel(i);
-    }
+    syncLedc();
 }
 
 // Tick() and togglePin() functions removed - LedC handles PWM generation in hardware
@@ -163,24 +232,52 @@ bool ESP32_HwPWM::isNoteActive(uint8_t instrument, uint8_t note)
     return ((m_activeNotes[instrument] & 0x7F) == note && m_activeNotes[instrument] != 0);
 }
 
+// Voices past the wired pins are never offered to the distributors
+bool ESP32_HwPWM::canPlayNote(uint8_t instrument, uint8_t note)
+{
+    return instrument < numVoices && InstrumentControllerBase::canPlayNote(instrument, note);
+}
+
 void ESP32_HwPWM::setPitchBend(uint8_t channel, uint16_t bend){
     m_pitchBend[channel] = bend; 
-    
-    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++){
-        if(m_lastChannel[i] == channel){
-            if(m_activeNotes[i] == 0) continue; // Skip if no active note
-            // Mask off the MSB flag bit to get the actual note value (0-127)
-            uint8_t note = m_activeNotes[i] & (~MSB_BITMASK);
-
-            m_noteFrequency[i] = NoteTables::noteFrequency[note];
-
-            uint16_t newFrequency = NoteTables::applyPitchBend(m_noteFrequency[i], bend);
-            if (abs(m_activeFrequency[i] - newFrequency) > 0.75) {
-                m_activeFrequency[i] = newFrequency;
-                setFrequency(i, newFrequency);
-            }
-        }
+    m_modulation.setPitchBend(channel, bend, m_pitchBendRange[channel]);
+    applyModulation();
+}
+
+void ESP32_HwPWM::setControlChange(uint8_t channel, uint8_t controller, uint8_t value)
+{
+    m_modulation.controlChange(channel, controller, value);
+}
+
+// The voice's note under the active tuning moved by its current modulation, in Hz Q16
+uint32_t ESP32_HwPWM::modulatedFrequency(uint8_t instrument) const
+{
+    const uint8_t note = m_activeNotes[instrument] & (~MSB_BITMASK);
+    return NoteTables::scaleByExp2(Tuning::active().frequencies[note], m_modulation.pitchOffset(instrument));
+}
+
+// Moves every modulated voice to its new frequency, voices on a shared timer that still agree
+// retune it in one write
+void ESP32_HwPWM::applyModulation()
+{
+    bool moved = false;
+    const auto& voices = m_modulation.activeVoices();
+    for (uint8_t i = 0; i < numVoices; i++){
+        if (!voices.test(i)) continue;
+        const uint32_t frequency = modulatedFrequency(i);
+        if (frequency == m_targetFrequency[i]) continue;
+        m_targetFrequency[i] = frequency;
+        moved = true;
     }
+
+    // Skip the peripheral writes when nothing moved
+    if (moved && !isBatching()) syncLedc();
+}
+
+void ESP32_HwPWM::periodic()
+{
+    if (m_modulation.update(micros())) applyModulation();
+    InstrumentControllerBase::periodic();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Instruments/InstrumentControllerBase.h"
+#include "Instruments/Components/Modulation.h"
+#include "Instruments/Components/LedcAllocator.h"
 #include "Config.h"
 #include <cstdint>
 #include <array>
@@ -11,10 +13,12 @@
  * Provides PWM functionality for ESP32 microcontrollers
  * 
  * Channel Mapping Strategy:
- * - Uses LEDC channels 0, 2, 4, 6, 8, 10, 12, 14 (even channels only)
- * - This ensures each channel uses a unique timer (8 timers total)
- * - Prevents timer sharing which causes frequency interference
- * - Maximum 8 simultaneous instruments supported
+ * - Uses all 16 LEDC channels across both speed modes, up to 16 instruments
+ * - Voices playing the same frequency share one of the 8 timers, so up to 8 different
+ *   frequencies sound at once. See LedcAllocator for how timers are handed out.
+ * - A note that can't get a timer is dropped and its voice left free, so the distributors
+ *   never count a silent voice as sounding. Only voices with a pin are offered to them.
+ * - Timers and channels are reassigned on note changes, the pin follows its voice's channel
  */
 class ESP32_HwPWM : public InstrumentControllerBase {
 public:
@@ -24,29 +28,30 @@ private:
     static std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_activeNotes;
     static uint8_t m_numActiveNotes;
 
-    // Instrument attributes for tracking active notes
-    static std::array<double, HardwareConfig::MAX_NUM_INSTRUMENTS> lastFrequency; // Last set frequency for caching
-    static std::array<double, HardwareConfig::MAX_NUM_INSTRUMENTS> m_noteFrequency;  // Base note frequency
-    static std::array<double, HardwareConfig::MAX_NUM_INSTRUMENTS> m_activeFrequency; // Note played with bend
+    // Frequency each voice should sound in Hz Q16 with its modulation applied, 0 is silent
+    static std::array<uint32_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_targetFrequency;
 
-    // LedC channel management (moved from header due to Config dependency)
-    static std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_ledcChannels;
-    
+    // Vibrato, pitch bend and glide computed at control rate
+    static ModulationEngine m_modulation;
+
+    // Where each voice should be and where the LEDC has it. syncLedc() writes the difference.
+    static LedcAllocator<HardwareConfig::MAX_NUM_INSTRUMENTS> m_allocator;
+    static std::array<LedcAllocator<HardwareConfig::MAX_NUM_INSTRUMENTS>::Binding, HardwareConfig::MAX_NUM_INSTRUMENTS> m_appliedBinding;
+    static std::array<std::array<Ledc::TimerSetting, Ledc::TIMERS_PER_MODE>, Ledc::NUM_MODES> m_appliedTimer;
+    static std::array<std::array<uint32_t, Ledc::TIMERS_PER_MODE>, Ledc::NUM_MODES> m_appliedFrequency;
 
-    void initializeLedcChannel(uint8_t instrument, uint8_t pin);
-    inline void setFrequency(uint8_t instrument, double frequency);
-    inline void stopChannel(uint8_t instrument);
+    void initializeLedc();
+    void releaseChannel(uint8_t instrument);
+    void clearVoice(uint8_t instrument);
+    void syncLedc();
+    uint32_t modulatedFrequency(uint8_t instrument) const;
+    void applyModulation();
 
     //Local MIDI Device Attributes
     uint8_t m_program = 0;
     uint8_t m_channelPressure = 0;
     uint16_t m_pitchBend[Midi::NUM_CH];
 
-    // LedC configuration constants
-    static constexpr uint8_t LEDC_RESOLUTION = 12; // 12-bit resolution (0-4095)
-    static constexpr uint32_t LEDC_BASE_FREQ = 80000000; // 80MHz base frequency
-    static constexpr uint16_t DUTY_CYCLE_50_PERCENT = (1 << (LEDC_RESOLUTION - 1)); // 50% duty cycle
-
 public: 
     ESP32_HwPWM();
     void reset(uint8_t instrument) override;
@@ -56,11 +61,18 @@ public:
     void stopAll() override;
 
     void setPitchBend(uint8_t channel, uint16_t value) override;
+    void setControlChange(uint8_t channel, uint8_t controller, uint8_t value) override;
 
     Instrument getInstrumentType() const override { return Instrument::HW_PWM; }
     uint8_t getNumActiveNotes(uint8_t instrument) override;
     bool isNoteActive(uint8_t instrument, uint8_t note) override;
+    bool canPlayNote(uint8_t instrument, uint8_t note) override;
+
+    void periodic() override;
     
     //Timeout tracking functions
     void checkInstrumentTimeouts() override;
+
+protected:
+    void publishBatch() override;
 };
\ No newline at end of file
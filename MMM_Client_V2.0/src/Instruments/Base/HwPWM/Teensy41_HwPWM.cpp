@@ -5,18 +5,43 @@
 #include "Instruments/InstrumentControllerBase.h"
 #include "Instruments/Components/NoteTable.h"
 #include "Arduino.h"
-#include <cmath>
+
+using namespace Teensy41PwmMap;
 
 // Define constants for PWM configuration
 constexpr uint8_t pwmPins[] = {CFG_PINS_INSTRUMENT_PWM};
 constexpr uint8_t numPwmPins = sizeof(pwmPins) / sizeof(pwmPins[0]);
+static_assert(pinsHavePwm(pwmPins), "CFG_PINS_INSTRUMENT_PWM has a pin without FlexPWM or QuadTimer output");
+static_assert(pinsIndependent(pwmPins), "CFG_PINS_INSTRUMENT_PWM has pins sharing a FlexPWM submodule or QuadTimer channel, they can't play different notes");
 
 // Static member definitions - properly scoped as class members
 std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_HwPWM::m_activeNotes = {};
 uint8_t Teensy41_HwPWM::m_numActiveNotes = 0;
-// std::array<double, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_HwPWM::lastFrequency = {};
-std::array<double, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_HwPWM::m_noteFrequency = {};
-std::array<double, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_HwPWM::m_activeFrequency = {};
+std::array<uint32_t, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_HwPWM::m_activeFrequency = {};
+std::array<Period, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_HwPWM::m_appliedPeriod = {};
+ModulationEngine Teensy41_HwPWM::m_modulation;
+
+namespace {
+IMXRT_FLEXPWM_t& flexPwmModule(uint8_t module)
+{
+    switch (module) {
+    case 1: return IMXRT_FLEXPWM1;
+    case 2: return IMXRT_FLEXPWM2;
+    case 3: return IMXRT_FLEXPWM3;
+    default: return IMXRT_FLEXPWM4;
+    }
+}
+
+IMXRT_TMR_t& quadTimerModule(uint8_t module)
+{
+    switch (module) {
+    case 1: return IMXRT_TMR1;
+    case 2: return IMXRT_TMR2;
+    case 3: return IMXRT_TMR3;
+    default: return IMXRT_TMR4;
+    }
+}
+}
 
 Teensy41_HwPWM::Teensy41_HwPWM() : InstrumentControllerBase()
 {
@@ -30,46 +55,123 @@ Teensy41_HwPWM::Teensy41_HwPWM() : InstrumentControllerBase()
     // Initialize default values
     std::fill_n(m_pitchBend, Midi::NUM_CH, Midi::CTRL_CENTER);
     m_noteStartTime.fill(0); // No notes started initially
+
+    // Notes only write FlexPWM and QuadTimer registers, compensated ones can start from the event timer
+    setInterruptFiring(true);
 }
 
 void Teensy41_HwPWM::initializePwmPin(uint8_t instrument, uint8_t pin)
 {
-    // Configure PWM pin
+    // The core routes the pin to its counter and sets the counter up
     pinMode(pin, OUTPUT);
-    analogWriteResolution(PWM_RESOLUTION); // Set PWM resolution to 8-bit
+    analogWriteResolution(PWM_RESOLUTION);
     analogWriteFrequency(pin, 1000.0); // Start with 1kHz, will be changed when notes play
     analogWrite(pin, 0); // Start with output off
+
+    // QuadTimers are run in toggle mode instead, the counter restarts at each compare and
+    // COMP1 reloads from CMPLD1 there so a new half period starts cleanly
+    const Resource timer = resource(pin);
+    if (timer.timer == Timer::QuadTimer) {
+        IMXRT_TMR_CH_t& channel = quadTimerModule(timer.module).CH[timer.submodule];
+        channel.CTRL = 0;
+        channel.LOAD = 0;
+        channel.CNTR = 0;
+        channel.CSCTRL = TMR_CSCTRL_CL1(1);
+        channel.SCTRL = TMR_SCTRL_OEN | TMR_SCTRL_FORCE; // Held low until a note starts
+    }
 }
 
-void Teensy41_HwPWM::setFrequency(uint8_t instrument, double frequency)
+// Starts a stopped voice or retunes a sounding one, frequency in Hz Q16
+void Teensy41_HwPWM::setFrequency(uint8_t instrument, uint32_t frequencyQ16)
 {
-    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) return;
-    
-    // Clamp frequency to valid range (10Hz - 20kHz)
-    if (frequency < 10.0) frequency = 10.0;
-    if (frequency > 20000.0) frequency = 20000.0;
-    
-    // // Only update if frequency changed significantly (>0.5Hz difference for better precision)
-    // if (abs(lastFrequency[instrument] - frequency) > 0.5) {
-    //     // Use analogWriteFrequency to set the PWM frequency for this pin
-    //     analogWriteFrequency(pwmPins[instrument], frequency);
-    //     lastFrequency[instrument] = frequency;
-    // }
-    
-    // Set the PWM frequency for this pin
-    analogWriteFrequency(pwmPins[instrument], frequency);
-    
-    // Set duty cycle - 50% for square wave audio output
-    analogWrite(pwmPins[instrument], DUTY_CYCLE_50_PERCENT);
+    if (instrument >= numPwmPins) return;
+
+    const bool restart = (m_activeFrequency[instrument] == 0);
+    m_activeFrequency[instrument] = frequencyQ16;
+
+    if (resource(pwmPins[instrument]).timer == Timer::FlexPwm) {
+        writeFlexPwm(instrument, flexPwmPeriod(F_BUS_ACTUAL, frequencyQ16), true);
+    } else {
+        writeQuadTimer(instrument, frequencyQ16, restart);
+    }
     m_activeInstruments.set(instrument);
 }
 
+// Period and prescaler are buffered and loaded together at the next reload once LDOK is set,
+// the cycle in progress finishes at the old pitch. LDOK is cleared first so a reload between
+// the writes can't take half of them.
+void Teensy41_HwPWM::writeFlexPwm(uint8_t instrument, const Period& period, bool sounding)
+{
+    if (sounding && period.prescale == m_appliedPeriod[instrument].prescale
+                 && period.counts == m_appliedPeriod[instrument].counts) return;
+    if (period.counts == 0) return;
+
+    const Resource timer = resource(pwmPins[instrument]);
+    IMXRT_FLEXPWM_t& pwm = flexPwmModule(timer.module);
+    const uint16_t mask = 1 << timer.submodule;
+    const uint16_t modulo = period.counts - 1;
+    const uint16_t high = sounding ? period.counts / 2 : 0; // 50% duty cycle or off
+
+    pwm.MCTRL |= FLEXPWM_MCTRL_CLDOK(mask);
+    pwm.SM[timer.submodule].CTRL = FLEXPWM_SMCTRL_FULL | FLEXPWM_SMCTRL_PRSC(period.prescale);
+    pwm.SM[timer.submodule].VAL1 = modulo;
+    switch (timer.output) {
+    case X:
+        pwm.SM[timer.submodule].VAL0 = modulo - high;
+        break;
+    case A:
+        pwm.SM[timer.submodule].VAL2 = 0;
+        pwm.SM[timer.submodule].VAL3 = high;
+        break;
+    case B:
+        pwm.SM[timer.submodule].VAL4 = 0;
+        pwm.SM[timer.submodule].VAL5 = high;
+        break;
+    }
+    pwm.MCTRL |= FLEXPWM_MCTRL_LDOK(mask);
+
+    m_appliedPeriod[instrument] = sounding ? period : Period{0, 0};
+}
+
+// The half period is loaded into COMP1 at the next compare. The prescaler isn't buffered, it is
+// only changed when a note starts or a bend leaves the room it was picked with.
+void Teensy41_HwPWM::writeQuadTimer(uint8_t instrument, uint32_t frequencyQ16, bool restart)
+{
+    const Resource timer = resource(pwmPins[instrument]);
+    IMXRT_TMR_CH_t& channel = quadTimerModule(timer.module).CH[timer.submodule];
+    const Period applied = m_appliedPeriod[instrument];
+
+    Period period = restart ? Period{0, 0} : quadTimerPeriod(F_BUS_ACTUAL, frequencyQ16, applied.prescale, false);
+    if (period.counts != 0) {
+        if (period.counts != applied.counts) channel.CMPLD1 = period.counts - 1;
+    } else {
+        const uint8_t prescale = quadTimerPrescale(F_BUS_ACTUAL, frequencyQ16);
+        period = quadTimerPeriod(F_BUS_ACTUAL, frequencyQ16, prescale, true);
+        channel.CTRL = 0;
+        channel.CNTR = 0;
+        channel.COMP1 = period.counts - 1;
+        channel.CMPLD1 = period.counts - 1;
+        channel.SCTRL = TMR_SCTRL_OEN;
+        channel.CTRL = TMR_CTRL_CM(1) | TMR_CTRL_PCS(8 + prescale) | TMR_CTRL_LENGTH | TMR_CTRL_OUTMODE(3);
+    }
+    m_appliedPeriod[instrument] = period;
+}
+
 void Teensy41_HwPWM::stopChannel(uint8_t instrument)
 {
-    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) return;
-    
-    // Set duty cycle to 0 to stop PWM output
-    analogWrite(pwmPins[instrument], 0);
+    if (instrument >= numPwmPins) return;
+
+    // FlexPWM outputs go to 0% duty at the end of the cycle, QuadTimers stop and are forced low
+    const Resource timer = resource(pwmPins[instrument]);
+    if (timer.timer == Timer::FlexPwm) {
+        if (m_appliedPeriod[instrument].counts != 0) writeFlexPwm(instrument, m_appliedPeriod[instrument], false);
+    } else {
+        IMXRT_TMR_CH_t& channel = quadTimerModule(timer.module).CH[timer.submodule];
+        channel.CTRL = 0;
+        channel.SCTRL = TMR_SCTRL_OEN | TMR_SCTRL_FORCE;
+        m_appliedPeriod[instrument] = {0, 0};
+    }
+    m_activeFrequency[instrument] = 0;
     m_activeInstruments.reset(instrument);
 }
 
@@ -85,25 +187,22 @@ void Teensy41_HwPWM::resetAll()
 
 void Teensy41_HwPWM::playNote(uint8_t instrument, uint8_t note, uint8_t velocity,  uint8_t channel)
 {
-    // Early bounds checking for performance
-    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS || note >= 128) return;
+    // Early bounds checking for performance, voices without a pin can't sound
+    if (instrument >= numPwmPins || note >= 128) return;
 
-    const double baseFreq = NoteTables::noteFrequency[note];
-    
     // Store note information
     m_activeNotes[instrument] = (MSB_BITMASK | note);
-    m_noteFrequency[instrument] = baseFreq;
     m_noteStartTime[instrument] = millis(); // Record when note started for timeout tracking
     
-    // Calculate final frequency with pitch bend applied
-    m_activeFrequency[instrument] = NoteTables::applyPitchBend(baseFreq, m_pitchBend[channel]);
+    // The hardware keeps the waveform running on its own so legato needs nothing extra here
+    m_modulation.startVoice(instrument, channel, Tuning::active().periods[note]);
     
     // Increment active note count only if this instrument wasn't already active
     if (!m_activeInstruments.test(instrument)) {
         m_numActiveNotes++;
     }
 
-    setFrequency(instrument, m_activeFrequency[instrument]);
+    applyModulation(instrument);
 }
 
 void Teensy41_HwPWM::stopNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel)
@@ -112,10 +211,8 @@ void Teensy41_HwPWM::stopNote(uint8_t instrument, uint8_t note, uint8_t velocity
     
     // Clear note information
     m_activeNotes[instrument] = 0;
-    m_noteFrequency[instrument] = 0;
-    m_activeFrequency[instrument] = 0;
-    m_lastDistributor[instrument] = nullptr; // Clear distributor tracking
-    m_lastChannel[instrument] = NONE; // Clear channel tracking
+    m_modulation.stopVoice(instrument);
+    releaseVoiceOwner(instrument); // Clear distributor tracking
     m_noteStartTime[instrument] = 0;
     
     // Decrement active note count only if channel was actually active
@@ -131,10 +228,8 @@ void Teensy41_HwPWM::stopAll(){
     std::fill_n(m_pitchBend, Midi::NUM_CH, Midi::CTRL_CENTER);
     m_numActiveNotes = 0;
     m_activeNotes = {};
-    m_noteFrequency = {};
-    m_activeFrequency = {};
-    m_lastDistributor.fill(nullptr); // Clear all distributor tracking
-    m_lastChannel.fill(NONE); // Clear all channel tracking
+    m_modulation.reset();
+    releaseAllVoiceOwners(); // Clear all distributor tracking
     m_noteStartTime.fill(0); // Clear all start times
 
     // Stop all PWM channels
@@ -158,24 +253,47 @@ bool Teensy41_HwPWM::isNoteActive(uint8_t instrument, uint8_t note)
     return ((m_activeNotes[instrument] & 0x7F) == note && m_activeNotes[instrument] != 0);
 }
 
+// Only voices with a pin are offered to the distributors
+bool Teensy41_HwPWM::canPlayNote(uint8_t instrument, uint8_t note)
+{
+    return instrument < numPwmPins && InstrumentControllerBase::canPlayNote(instrument, note);
+}
+
 void Teensy41_HwPWM::setPitchBend(uint8_t channel, uint16_t bend){
     m_pitchBend[channel] = bend; 
-    
+    m_modulation.setPitchBend(channel, bend, m_pitchBendRange[channel]);
+
+    const auto& voices = m_modulation.activeVoices();
     for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++){
-        if(m_lastChannel[i] == channel){
-            if(m_activeNotes[i] == 0) continue; // Skip if no active note
-            // Mask off the MSB flag bit to get the actual note value (0-127)
-            uint8_t note = m_activeNotes[i] & (~MSB_BITMASK);
-
-            m_noteFrequency[i] = NoteTables::noteFrequency[note];
-
-            uint16_t newFrequency = NoteTables::applyPitchBend(m_noteFrequency[i], bend);
-            if (abs(m_activeFrequency[i] - newFrequency) > 0.75) {
-                m_activeFrequency[i] = newFrequency;
-                setFrequency(i, newFrequency);
-            }
+        if (voices.test(i)) applyModulation(i);
+    }
+}
+
+void Teensy41_HwPWM::setControlChange(uint8_t channel, uint8_t controller, uint8_t value)
+{
+    m_modulation.controlChange(channel, controller, value);
+}
+
+// Sets the output to the voice's note under the active tuning moved by its current modulation
+void Teensy41_HwPWM::applyModulation(uint8_t instrument)
+{
+    const uint8_t note = m_activeNotes[instrument] & (~MSB_BITMASK);
+    const uint32_t frequencyQ16 = NoteTables::scaleByExp2(Tuning::active().frequencies[note], m_modulation.pitchOffset(instrument));
+
+    // Skip the peripheral write when nothing moved
+    if (frequencyQ16 == m_activeFrequency[instrument]) return;
+    setFrequency(instrument, frequencyQ16);
+}
+
+void Teensy41_HwPWM::periodic()
+{
+    if (m_modulation.update(micros())) {
+        const auto& voices = m_modulation.activeVoices();
+        for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++){
+            if (voices.test(i)) applyModulation(i);
         }
     }
+    InstrumentControllerBase::periodic();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
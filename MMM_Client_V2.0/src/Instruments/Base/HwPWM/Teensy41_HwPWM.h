@@ -1,17 +1,21 @@
 #pragma once
 
 #include "Instruments/InstrumentControllerBase.h"
+#include "Instruments/Components/Modulation.h"
+#include "Instruments/Components/Teensy41PwmMap.h"
 #include "Config.h"
 #include <cstdint>
 #include <array>
 
 /**
- * Teensy 4.1-specific PWM implementation using analogWrite with PWM frequency control
+ * Teensy 4.1-specific PWM implementation on the FlexPWM and QuadTimer counters
  * Provides PWM functionality for Teensy 4.1 microcontrollers
  * 
- * Teensy 4.1 has multiple FlexPWM modules, each with multiple channels
- * Uses analogWriteFrequency() to set per-pin frequencies
- * Maximum 15 PWM pins available on Teensy 4.1
+ * Every pin needs a counter of its own, pins sharing a FlexPWM submodule or QuadTimer channel
+ * are refused at build time (see Teensy41PwmMap). analogWrite() sets the pins up, after that
+ * the period registers are written directly and only when they change. Pitch changes land at
+ * the end of the cycle in progress so bends don't glitch.
+ * Up to 22 PWM pins available on Teensy 4.1
  */
 class Teensy41_HwPWM : public InstrumentControllerBase {
 public:
@@ -21,22 +25,27 @@ private:
     static std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_activeNotes;
     static uint8_t m_numActiveNotes;
 
-    // Instrument attributes for tracking active notes
-    // static std::array<double, HardwareConfig::MAX_NUM_INSTRUMENTS> lastFrequency; // Last set frequency for caching
-    static std::array<double, HardwareConfig::MAX_NUM_INSTRUMENTS> m_noteFrequency;  // Base note frequency
-    static std::array<double, HardwareConfig::MAX_NUM_INSTRUMENTS> m_activeFrequency; // Note played with bend
+    // Note played with bend in Hz Q16, 0 while stopped
+    static std::array<uint32_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_activeFrequency;
+    // Last period written to each counter, rewrites are skipped when a change rounds to the same
+    static std::array<Teensy41PwmMap::Period, HardwareConfig::MAX_NUM_INSTRUMENTS> m_appliedPeriod;
+
+    // Vibrato, pitch bend and glide computed at control rate
+    static ModulationEngine m_modulation;
 
     void initializePwmPin(uint8_t instrument, uint8_t pin);
-    inline void setFrequency(uint8_t instrument, double frequency);
-    inline void stopChannel(uint8_t instrument);
+    void setFrequency(uint8_t instrument, uint32_t frequencyQ16);
+    void writeFlexPwm(uint8_t instrument, const Teensy41PwmMap::Period& period, bool sounding);
+    void writeQuadTimer(uint8_t instrument, uint32_t frequencyQ16, bool restart);
+    void stopChannel(uint8_t instrument);
+    void applyModulation(uint8_t instrument);
 
     //Local MIDI Device Attributes
     uint8_t m_program = 0;
     uint8_t m_channelPressure = 0;
 
     // PWM configuration constants
-    static constexpr uint8_t PWM_RESOLUTION = 8; // 8-bit resolution (0-255)
-    static constexpr uint8_t DUTY_CYCLE_50_PERCENT = 128; // 50% duty cycle
+    static constexpr uint8_t PWM_RESOLUTION = 8; // 8-bit resolution (0-255), only used to set the pins up
 
 public: 
     Teensy41_HwPWM();
@@ -47,10 +56,14 @@ public:
     void stopAll() override;
 
     void setPitchBend(uint8_t channel, uint16_t value) override;
+    void setControlChange(uint8_t channel, uint8_t controller, uint8_t value) override;
 
     Instrument getInstrumentType() const override { return Instrument::HW_PWM; }
     uint8_t getNumActiveNotes(uint8_t instrument) override;
     bool isNoteActive(uint8_t instrument, uint8_t note) override;
+    bool canPlayNote(uint8_t instrument, uint8_t note) override;
+
+    void periodic() override;
     
     //Timeout tracking functions
     void checkInstrumentTimeouts() override;
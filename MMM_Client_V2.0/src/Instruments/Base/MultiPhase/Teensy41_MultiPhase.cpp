@@ -8,13 +8,6 @@
 #include "Distributors/Distributor.h"
 #include <bitset>
 
-namespace {
-struct InterruptLock {
-    InterruptLock() { noInterrupts(); }
-    ~InterruptLock() { interrupts(); }
-};
-}
-
 constexpr uint8_t pwmPins[] = {CFG_PINS_INSTRUMENT_PWM};
 constexpr uint8_t numPwmPins = sizeof(pwmPins) / sizeof(pwmPins[0]);
 constexpr uint8_t wavetable[CFG_MULTIPHASE_WAVE_TABLE_STEPS][CFG_MULTIPHASE_WAVE_TABLE_OUTPUTS] = CFG_MULTIPHASE_WAVE_TABLE;
@@ -26,9 +19,10 @@ std::array<uint16_t, CFG_NUM_INSTRUMENTS> Teensy41_MultiPhase::m_notePeriod = {}
 std::array<uint16_t, CFG_NUM_INSTRUMENTS> Teensy41_MultiPhase::m_activePeriod =  {};
 std::array<uint16_t, CFG_NUM_INSTRUMENTS> Teensy41_MultiPhase::m_currentTick = {};
 std::array<uint8_t, CFG_NUM_INSTRUMENTS> Teensy41_MultiPhase::m_currentState = {};
-std::array<uint16_t, CFG_NUM_INSTRUMENTS> Teensy41_MultiPhase::m_vibratoPhase = {};
-std::array<uint8_t,CFG_NUM_INSTRUMENTS> Teensy41_MultiPhase::m_vibratoDepth = {};
-std::array<uint8_t,CFG_NUM_INSTRUMENTS> Teensy41_MultiPhase::m_vibratoRate = {}; //slow default rate
+std::array<uint16_t, CFG_NUM_INSTRUMENTS> Teensy41_MultiPhase::m_stagedPeriod = {};
+std::bitset<CFG_NUM_INSTRUMENTS> Teensy41_MultiPhase::m_stagedVoices = 0;
+VoiceMailbox<Teensy41_MultiPhase::VoiceUpdate, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_MultiPhase::m_updates;
+ModulationEngine Teensy41_MultiPhase::m_modulation;
 
 Teensy41_MultiPhase::Teensy41_MultiPhase() : InstrumentControllerBase()
 {
@@ -61,83 +55,94 @@ void Teensy41_MultiPhase::resetAll()
 
 void Teensy41_MultiPhase::playNote(uint8_t instrument, uint8_t note, uint8_t velocity,  uint8_t channel)
 {
-    InterruptLock lock;
-
     // Only increment counter if this instrument wasn't already playing a note
     bool wasActive = (m_activeNotes[instrument] != 0);
     
     m_activeInstruments.set(instrument);
     m_activeNotes[instrument] = (MSB_BITMASK | note);
-    m_notePeriod[instrument] = NoteTables::NOTE_TICKS_DOUBLE[note];
-
     #ifdef PWM_NOTES_DOUBLE
-        m_activePeriod[instrument] = NoteTables::applyPitchBendToNoteDouble(note, m_pitchBend[channel]);
+        m_notePeriod[instrument] = Tuning::active().ticksDouble[note];
     #else
-        m_activePeriod[instrument] = NoteTables::applyPitchBendToNote(note, m_pitchBend[channel]);
+        m_notePeriod[instrument] = Tuning::active().ticks[note];
     #endif
+    if (m_modulation.startVoice(instrument, channel, m_notePeriod[instrument]) && !m_stagedVoices.test(instrument)) {
+        // Legato keeps the waveform running, only its period moves
+        stageUpdate(instrument, m_modulation.targetPeriod(instrument), false);
+        m_updates.commit(1UL << instrument);
+    } else {
+        m_stagedPeriod[instrument] = m_modulation.targetPeriod(instrument);
+        m_stagedVoices.set(instrument);
+    }
 
     m_noteStartTime[instrument] = millis(); // Record when note started for timeout tracking
 
-    if(m_lastDistributor[instrument] != nullptr){
-            //m_vibratoDepth[instrument] = distributor->getVibratoEnabled() ? m_modulationWheel[channel] : 0;
-            //m_vibratoRate[instrument] = m_vibratoDepth[instrument] >> 3; // Set vibrato rate from modulation wheel
-    }
-
     if (!wasActive) {
         m_numActiveNotes++;
     }
-    digitalWrite(pwmPins[instrument], HIGH); // Start pin HIGH to begin waveform
+    if (!isBatching()) publishBatch();
     return;
 }
 
 void Teensy41_MultiPhase::stopNote(uint8_t instrument, uint8_t note, uint8_t velocity,  uint8_t channel)
 {
-    InterruptLock lock;
-
     // Only decrement if there was actually an active note
     bool wasActive = (m_activeNotes[instrument] != 0);
     
     m_activeInstruments.reset(instrument);
-    m_lastDistributor[instrument] = nullptr;
-    m_lastChannel[instrument] = NONE;
+    releaseVoiceOwner(instrument); // Clear distributor tracking
     m_noteStartTime[instrument] = 0;
     m_activeNotes[instrument] = 0;
     m_notePeriod[instrument] = 0;
-    m_activePeriod[instrument] = 0;
-    m_currentTick[instrument] = 0;  // Reset tick counter to prevent residual state
-    m_vibratoPhase[instrument] = 0;  // Reset vibrato phase to prevent carryover
-    m_vibratoDepth[instrument] = 0;  // Reset vibrato depth to prevent carryover
-    //m_currentState[instrument] = 0;  // Reset state f wavetable
-
-    for(uint8_t output=0; output < CFG_MULTIPHASE_WAVE_TABLE_OUTPUTS+1; output++){
-        digitalWrite(pwmPins[instrument + output], LOW);
-    }
+    m_modulation.stopVoice(instrument);
+    m_stagedPeriod[instrument] = 0;
+    m_stagedVoices.set(instrument);
     
     if (wasActive && m_numActiveNotes > 0) {
         m_numActiveNotes--;
     }
+    if (!isBatching()) publishBatch();
     return;
 }
 
-void Teensy41_MultiPhase::stopAll(){
-    InterruptLock lock;
+// Hands every staged voice to the tick in one commit so notes published together start in phase
+void Teensy41_MultiPhase::publishBatch()
+{
+    uint32_t published = 0;
+    for (uint8_t i = 0; i < CFG_NUM_INSTRUMENTS; i++) {
+        if (!m_stagedVoices.test(i)) continue;
+        stageUpdate(i, m_stagedPeriod[i], true);
+        published |= (1UL << i);
+    }
+    m_stagedVoices.reset();
+    m_updates.commit(published);
+}
 
+void Teensy41_MultiPhase::stopAll(){
     std::fill_n(m_pitchBend, Midi::NUM_CH, Midi::CTRL_CENTER);
     m_numActiveNotes = 0;
-    m_lastDistributor.fill(nullptr);
-    m_lastChannel.fill(NONE);
+    releaseAllVoiceOwners(); // Clear all distributor tracking
     m_noteStartTime.fill(0);
     m_activeNotes = {};
     m_notePeriod = {};
-    m_activePeriod = {};
-    m_currentTick = {};
-    //m_currentState = {};
-    m_vibratoPhase = {};
-    m_vibratoDepth = {};
-
-    for(uint8_t i = 0; i < numPwmPins; i++){
-        digitalWrite(pwmPins[i], LOW);
+    m_stagedPeriod = {};
+    m_stagedVoices.reset();
+    m_modulation.reset();
+
+    // The tick silences every voice and drives its outputs low on its next pass
+    for (uint8_t i = 0; i < CFG_NUM_INSTRUMENTS; i++) {
+        stageUpdate(i, 0, true);
     }
+    m_updates.commit((CFG_NUM_INSTRUMENTS < 32) ? (1UL << CFG_NUM_INSTRUMENTS) - 1 : 0xFFFFFFFF);
+}
+
+// Fills the voice's m_updates slot for the caller to commit. A restart the tick hasn't taken
+// yet is kept when a pitch change lands on top of it.
+void Teensy41_MultiPhase::stageUpdate(uint8_t instrument, uint16_t period, bool restart)
+{
+    bool pending;
+    VoiceUpdate& update = m_updates.open(instrument, pending);
+    update.restart = restart || (pending && update.restart);
+    update.period = period;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -150,6 +155,8 @@ it's crucial that any computations here be kept to a minimum!
 */
 void Teensy41_MultiPhase::tick()
 {
+    collectUpdates();
+
     // Go through every Instrument
     for (int i = 0; i < CFG_NUM_INSTRUMENTS; i++) {
         // Early exit if no notes are active - check inside loop like original
@@ -157,24 +164,8 @@ void Teensy41_MultiPhase::tick()
         
         //If note active increase tick until period reset and toggle pin
         if (m_activePeriod[i] > 0){
-            // Apply vibrato if enabled (modulation wheel > 0)
-            uint16_t targetPeriod = m_activePeriod[i];
-            
-            #ifdef VIBRATO_ENABLED
-            // Only apply vibrato if depth is non-zero AND the note period is valid
-            if (m_vibratoDepth[i] > 0) {
-                // Optimized vibrato: update phase less frequently
-                if ((m_currentTick[i] & 0x07) == 0) {  // Bit mask check is faster than modulo
-                    m_vibratoPhase[i] = NoteTables::updateVibratoPhase(m_vibratoPhase[i], m_vibratoRate[i]);
-                }
-                
-                // Calculate vibrato offset and apply to period
-                int16_t vibratoOffset = NoteTables::calculateVibratoOffset(m_vibratoPhase[i], m_vibratoDepth[i]);
-                targetPeriod = NoteTables::applyVibratoToPeriod(m_activePeriod[i], vibratoOffset);
-            }
-            #endif
-            
-            if (m_currentTick[i] >= targetPeriod) {
+            // Vibrato and bends are already folded into the period at control rate
+            if (m_currentTick[i] >= m_activePeriod[i]) {
                 updatePhase(i);
                 m_currentTick[i] = 0;
             } else {
@@ -185,6 +176,30 @@ void Teensy41_MultiPhase::tick()
 }
 
 
+// Applies what control code committed to m_updates since the last pass
+void Teensy41_MultiPhase::collectUpdates()
+{
+    uint32_t updates = m_updates.take();
+    while (updates) {
+        const uint8_t i = __builtin_ctz(updates);
+        updates &= updates - 1;
+        const VoiceUpdate& update = m_updates.slot(i);
+
+        m_activePeriod[i] = update.period;
+        if (!update.restart) continue;
+
+        m_currentTick[i] = 0;
+        if (m_activePeriod[i] > 0) {
+            digitalWrite(pwmPins[i], HIGH); // Start pin HIGH to begin waveform
+            continue;
+        }
+
+        for(uint8_t output=0; output < CFG_MULTIPHASE_WAVE_TABLE_OUTPUTS+1; output++){
+            digitalWrite(pwmPins[i + output], LOW);
+        }
+    }
+}
+
 #ifdef ARDUINO_ARCH_ESP32
 void ICACHE_RAM_ATTR Teensy41_MultiPhase::updatePhase(uint8_t instrument)
 #else
@@ -216,44 +231,38 @@ bool Teensy41_MultiPhase::isNoteActive(uint8_t instrument, uint8_t note)
 }
 
 void Teensy41_MultiPhase::setPitchBend(uint8_t channel, uint16_t bend){
-    InterruptLock lock;
-
     m_pitchBend[channel] = bend; 
-    for (uint8_t i = 0; i < CFG_NUM_INSTRUMENTS; i++){
-        if(m_lastChannel[i] == channel){
-            if(m_notePeriod[i] == 0) continue;
-            // Mask off the MSB flag bit to get the actual note value (0-127)
-            uint8_t note = m_activeNotes[i] & (~MSB_BITMASK);
-            
-            #ifdef PWM_NOTES_DOUBLE
-                m_activePeriod[i] = NoteTables::applyPitchBendToNoteDouble(note, bend);
-            #else
-                m_activePeriod[i] = NoteTables::applyPitchBendToNote(note, bend);
-            #endif
+    m_modulation.setPitchBend(channel, bend, m_pitchBendRange[channel]);
+    applyModulation();
+}
+
+void Teensy41_MultiPhase::setControlChange(uint8_t channel, uint8_t controller, uint8_t value)
+{
+    m_modulation.controlChange(channel, controller, value);
+}
+
+// Hands the modulated periods to the tick. Voices waiting to be published take theirs on publish.
+void Teensy41_MultiPhase::applyModulation()
+{
+    uint32_t modulated = 0;
+    const auto& voices = m_modulation.activeVoices();
+    for (uint8_t i = 0; i < CFG_NUM_INSTRUMENTS; i++) {
+        if (!voices.test(i)) continue;
+        if (m_stagedVoices.test(i)) {
+            m_stagedPeriod[i] = m_modulation.targetPeriod(i);
+        } else {
+            stageUpdate(i, m_modulation.targetPeriod(i), false);
+            modulated |= (1UL << i);
         }
     }
+    m_updates.commit(modulated);
 }
 
-// void Teensy41_MultiPhase::setModulationWheel(uint8_t channel, uint8_t value)
-// {
-//     #ifdef VIBRATO_ENABLED
-//         // Map modulation wheel (0-127) to vibrato depth (0-127)
-//         // The depth will determine how much pitch variation occurs
-        
-//         // Check each instrument's last distributor to see if vibrato is enabled
-//         m_modulationWheel[channel] = value;
-//         for (uint8_t i = 0; i < CFG_NUM_INSTRUMENTS; i++){
-//             if(m_lastChannel[i] == channel){
-//                 if(m_notePeriod[i] == 0) continue;
-//                 if(m_lastDistributor[i] == nullptr) continue;
-//                 Distributor* distributor = static_cast<Distributor*>(m_lastDistributor[i]);
-
-//                 m_vibratoDepth[i] = distributor->getVibratoEnabled() ? value : 0;
-//                 m_vibratoRate[i] = value >> 3; // Higher modulation wheel = faster vibrato
-//             }
-//         }
-//     #endif
-// }
+void Teensy41_MultiPhase::periodic()
+{
+    if (m_modulation.update(micros())) applyModulation();
+    InstrumentControllerBase::periodic();
+}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Timeout Tracking Functions
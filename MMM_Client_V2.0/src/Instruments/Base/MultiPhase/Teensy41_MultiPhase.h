@@ -3,7 +3,10 @@
 #include "Constants.h"
 #include "Config.h"
 #include "Instruments/InstrumentControllerBase.h"
+#include "Instruments/Components/Modulation.h"
+#include "Instruments/Components/VoiceMailbox.h"
 #include <cstdint>
+#include <bitset>
 using std::int8_t;
 
 #ifndef INSTRUMENT_TYPE
@@ -22,14 +25,26 @@ protected:
 
     //Instrument Attributes
     static std::array<uint16_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_notePeriod;  //Base Note
+    //Written only by the tick, control code hands changes over through m_updates
     static std::array<uint16_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_activePeriod;//Note Played
     static std::array<uint16_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_currentTick; //Timeing
     static std::array<uint8_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_currentState; //Step in Wave Table
 
-    //Vibrato Attributes
-    static std::array<uint16_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_vibratoPhase; //Vibrato phase counter
-    static std::array<uint8_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_vibratoDepth;   //Vibrato depth (controlled by modulation wheel)
-    static std::array<uint8_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_vibratoRate;    //Vibrato rate (speed of oscillation)
+    //Voice changes waiting to be published to the tick, see publishBatch()
+    static std::array<uint16_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_stagedPeriod; //0 stops the voice
+    static std::bitset<HardwareConfig::MAX_NUM_INSTRUMENTS> m_stagedVoices;
+
+    //Periods on their way to the tick, which applies them at the start of its next pass
+    struct VoiceUpdate {
+        uint16_t period;     //0 stops the voice
+        bool restart;        //Start the wave table over from this tick, else only the pitch moves
+    };
+    static VoiceMailbox<VoiceUpdate,HardwareConfig::MAX_NUM_INSTRUMENTS> m_updates;
+    static void stageUpdate(uint8_t instrument, uint16_t period, bool restart);
+    static void collectUpdates();
+
+    //Vibrato, pitch bend and other modulation computed at control rate
+    static ModulationEngine m_modulation;
 
 
 public: 
@@ -41,12 +56,19 @@ public:
     void stopAll() override;
 
     void setPitchBend(uint8_t channel, uint16_t value) override;
+    void setControlChange(uint8_t channel, uint8_t controller, uint8_t value) override;
 
     Instrument getInstrumentType() const override { return Instrument::SW_PWM; }
     uint8_t getNumActiveNotes(uint8_t instrument) override;
     bool isNoteActive(uint8_t instrument, uint8_t note) override;
 
+    void periodic() override;
+
     //Timeout tracking functions
     void checkInstrumentTimeouts() override;
 
+protected:
+    void publishBatch() override;
+    static void applyModulation();
+
 };
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #if defined(CFG_INSTRUMENT_HWPWM)
     #include "Instruments/Base/HwPWM/HwPWM.h"
+#elif defined(CFG_INSTRUMENT_TONEPWM)
+    #include "Instruments/Base/TonePWM/TonePWM.h"
 #elif defined(CFG_INSTRUMENT_SWPWM)
     #include "Instruments/Base/SwPWM/SwPWM.h"
 #else
@@ -44,20 +44,28 @@ it's crucial that any computations here be kept to a minimum!
 
 void ICACHE_RAM_ATTR ESP32_StepSw::tick()
 {
-    // Go through every Instrument
-    for (int i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
-        if(m_numActiveNotes == 0)return;
-
-        //If note active increase tick until period reset and toggle pin
-        if (m_activePeriod[i] > 0){
-            if (m_currentTick[i] >= m_activePeriod[i]) {
-                togglePin(i);
-
-                m_currentTick[i] = 0;
-                continue;
-            }
-            m_currentTick[i]++;
+    // Take the note changes committed since the last pass before stepping the voices
+    {
+        GpioBatch batch;
+        collectUpdates(batch);
+        batch.commit();
+    }
+
+    // Only sounding voices are visited, lowest first
+    uint32_t voices = m_activeMask;
+    while (voices) {
+        const uint8_t i = __builtin_ctz(voices);
+        voices &= voices - 1;
+
+        //Increase tick until period reset and toggle pin
+        Voice& voice = m_voices[i];
+        if (voice.tick >= voice.period) {
+            togglePin(i);
+
+            voice.tick = 0;
+            continue;
         }
+        voice.tick++;
     }
 }
 
@@ -76,8 +84,8 @@ void ICACHE_RAM_ATTR ESP32_StepSw::togglePin(uint8_t instrument)
     }
 
     //Pulse the step pin.
-    ESP32_SwPWM::m_currentState.flip(instrument);
-    digitalWrite(pwmPins[instrument], m_currentState[instrument]);
+    ESP32_SwPWM::m_voices[instrument].state = !m_voices[instrument].state;
+    digitalWrite(pwmPins[instrument], m_voices[instrument].state);
 }
 
 #endif // PLATFORM_ESP32 && CFG_INSTRUMENT_STEPSWSHIFT && CFG_COMPONENT_PWM && CFG_COMPONENT_SHIFTREGISTER
\ No newline at end of file
@@ -1,6 +1,6 @@
 #include "Config.h"
 
-#if defined(PLATFORM_ESP32) && (defined(CFG_INSTRUMENT_SWPWM) || defined(CFG_INSTRUMENT_STEPSW) || defined(CFG_INSTRUMENT_STEPSWSHIFT)) && defined(CFG_COMPONENT_PWM)
+#if defined(PLATFORM_ESP32) && (defined(CFG_INSTRUMENT_SWPWM) || defined(CFG_INSTRUMENT_STEPSW) || defined(CFG_INSTRUMENT_STEPSWSHIFT) || defined(CFG_INSTRUMENT_TONEPWM)) && defined(CFG_COMPONENT_PWM)
 
 #include "Instruments/Base/SwPWM/ESP32_SwPWM.h"
 #include "Instruments/Components/InterruptTimer.h"
@@ -10,45 +10,104 @@
 #include <bitset>
 
 namespace {
+// Note changes reach the tick through m_commands and m_updates, this is only held to rearm the
+// deadline timer. That happens on the core running the tick, the profiler has its own sequence
+// count. Nesting depth lets callers share one critical section.
+volatile uint8_t lockDepth = 0;
+
 struct InterruptLock {
-    InterruptLock() { noInterrupts(); }
-    ~InterruptLock() { interrupts(); }
+    InterruptLock() { noInterrupts(); lockDepth++; }
+    ~InterruptLock() { if (--lockDepth == 0) interrupts(); }
 };
 }
 
 // Define constants for PWM configuration
 constexpr uint8_t pwmPins[] = {CFG_PINS_INSTRUMENT_PWM};
 constexpr uint8_t numPwmPins = sizeof(pwmPins) / sizeof(pwmPins[0]);
+static_assert(Gpio::pinsValid(pwmPins), "CFG_PINS_INSTRUMENT_PWM has a pin without a GPIO output bank");
+constexpr auto pwmBits = Gpio::mapPins(pwmPins);
+static_assert(HardwareConfig::MAX_NUM_INSTRUMENTS <= 32, "The active voice mask is 32 bits");
 
 // Define static member variables
 std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_SwPWM::m_activeNotes = {};
 uint8_t ESP32_SwPWM::m_numActiveNotes = 0;
-std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_SwPWM::m_modulationWheel = {};
 std::array<uint16_t, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_SwPWM::m_notePeriod = {};
-std::array<uint16_t, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_SwPWM::m_activePeriod =  {};
-std::array<uint16_t, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_SwPWM::m_currentTick = {};
-std::bitset<HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_SwPWM::m_currentState = 0;
-std::array<uint16_t, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_SwPWM::m_vibratoPhase = {};
-std::array<uint8_t,HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_SwPWM::m_vibratoDepth = {};
-std::array<uint8_t,HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_SwPWM::m_vibratoRate = {}; //slow default rate
-
-ESP32_SwPWM::ESP32_SwPWM() : InstrumentControllerBase()
+DRAM_ATTR std::array<ESP32_SwPWM::Voice, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_SwPWM::m_voices = {};
+uint32_t ESP32_SwPWM::m_activeMask = 0;
+uint32_t ESP32_SwPWM::m_tickVoices = 0;
+std::array<uint16_t, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_SwPWM::m_stagedPeriod = {};
+std::bitset<HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_SwPWM::m_stagedVoices = 0;
+DRAM_ATTR VoiceMailbox<ESP32_SwPWM::VoiceUpdate, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_SwPWM::m_updates;
+ModulationEngine ESP32_SwPWM::m_modulation;
+#ifdef CFG_ISR_PROFILING
+IsrProfiler ESP32_SwPWM::m_isrProfiler;
+#endif
+#ifdef CFG_SWPWM_DEADLINE_SCHEDULER
+DeadlineScheduler ESP32_SwPWM::m_deadlines;
+#endif
+#ifdef CFG_SWPWM_DDS
+std::array<uint32_t, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_SwPWM::m_noteIncrement = {};
+#endif
+#ifdef CFG_REALTIME_CORE
+Utility::SpscQueue<ESP32_SwPWM::ToneCommand, 128> ESP32_SwPWM::m_commands;
+volatile bool ESP32_SwPWM::m_wakePending = false;
+bool ESP32_SwPWM::m_resyncPending = false;
+std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_SwPWM::m_noteChannel = {};
+std::array<std::array<uint8_t, sizeof(ESP32_SwPWM::RESYNC_CONTROLLERS)>, Midi::NUM_CH> ESP32_SwPWM::m_controlValues = [] {
+    std::array<std::array<uint8_t, sizeof(RESYNC_CONTROLLERS)>, Midi::NUM_CH> values;
+    for (auto& channel : values) channel.fill(CONTROL_UNSET);
+    return values;
+}();
+#endif
+
+ESP32_SwPWM::ESP32_SwPWM() : ESP32_SwPWM((HardwareConfig::MAX_NUM_INSTRUMENTS < 32) ? (1UL << HardwareConfig::MAX_NUM_INSTRUMENTS) - 1 : 0xFFFFFFFF)
+{
+}
+
+ESP32_SwPWM::ESP32_SwPWM(uint32_t tickVoices) : InstrumentControllerBase()
 {
+    m_tickVoices = tickVoices;
+
     //Setup pins
     for(uint8_t i=0; i < numPwmPins; i++){
+        if (!(tickVoices & (1UL << i))) continue;
         pinMode(pwmPins[i], OUTPUT);
+        m_voices[i].pin = pwmBits[i];
     }
 
     delay(500); // Wait a half second for safety
 
+#ifdef CFG_REALTIME_CORE
+    // The timer interrupt is serviced by the core that allocates it
+    RealtimeCore::start(startTimer, serviceRealtime);
+#else
+    startTimer();
+#endif
+
+    //Initalize Default values
+    std::fill_n(m_pitchBend, Midi::NUM_CH, Midi::CTRL_CENTER);
+
+    // Notes are only staged for the tick, compensated ones can start from the event timer
+    setInterruptFiring(true);
+}
+
+void ESP32_SwPWM::startTimer()
+{
+    // Nothing for the tick to play, the interrupt would only cost time
+    if (m_tickVoices == 0) return;
+
     // Setup timer hardware and register the base tick callback. If a
     // specialized subclass (like StepSwPWM) wants to take ownership it can
     // call InterruptTimer::setCallback() to replace this handler.
+#ifdef CFG_SWPWM_DEADLINE_SCHEDULER
+    InterruptTimer::initializeOneShot(deadlineTick);
+#else
     InterruptTimer::initialize(CFG_TIMER_RESOLUTION_US, nullptr);
     InterruptTimer::setCallback(tick);
-
-    //Initalize Default values
-    std::fill_n(m_pitchBend, Midi::NUM_CH, Midi::CTRL_CENTER);
+    #ifdef CFG_ISR_PROFILING
+        m_isrProfiler.setNominalInterval(CFG_TIMER_RESOLUTION_US);
+    #endif
+#endif
 }
 
 void ESP32_SwPWM::reset(uint8_t instrument)
@@ -63,79 +122,243 @@ void ESP32_SwPWM::resetAll()
 
 void ESP32_SwPWM::playNote(uint8_t instrument, uint8_t note, uint8_t velocity,  uint8_t channel)
 {
-    InterruptLock lock;
-
     // Only increment counter if this instrument wasn't already playing a note
     bool wasActive = (m_activeNotes[instrument] != 0);
     
     m_activeInstruments.set(instrument);
     m_activeNotes[instrument] = (MSB_BITMASK | note);
-    m_notePeriod[instrument] = NoteTables::NOTE_TICKS_DOUBLE[note];
-
-    #ifdef PWM_NOTES_DOUBLE
-        m_activePeriod[instrument] = NoteTables::applyPitchBendToNoteDouble(note, m_pitchBend[channel]);
-    #else
-        m_activePeriod[instrument] = NoteTables::applyPitchBendToNote(note, m_pitchBend[channel]);
+    #ifdef CFG_REALTIME_CORE
+        m_noteChannel[instrument] = channel;
     #endif
+    submit(startCommand(instrument, note, channel));
 
     m_noteStartTime[instrument] = millis(); // Record when note started for timeout tracking
 
-    if(m_lastDistributor[instrument] != nullptr){
-    m_vibratoDepth[instrument] = Device::Vibrato ? m_modulationWheel[channel] : 0;
-    m_vibratoRate[instrument] = m_vibratoDepth[instrument] >> 3; // Set vibrato rate from modulation wheel
-    }
-
     if (!wasActive) {
         m_numActiveNotes++;
     }
+    if (!isBatching()) publishBatch();
     return;
 }
 
-void ESP32_SwPWM::stopNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel)
+// The tone engine's view of a note, also replayed by resync()
+ESP32_SwPWM::ToneCommand ESP32_SwPWM::startCommand(uint8_t instrument, uint8_t note, uint8_t channel)
 {
-    InterruptLock lock;
+    ToneCommand command = {ToneCommand::Op::Start, instrument, channel};
+    #if defined(CFG_SWPWM_DEADLINE_SCHEDULER)
+        // The deadline engine times edges to the microsecond so it skips the truncation to ticks
+        #ifdef PWM_NOTES_DOUBLE
+            command.period = Tuning::active().periods[note] / 2;
+        #else
+            command.period = Tuning::active().periods[note];
+        #endif
+    #elif defined(PWM_NOTES_DOUBLE)
+        command.period = Tuning::active().ticksDouble[note];
+    #else
+        command.period = Tuning::active().ticks[note];
+    #endif
+    #ifdef CFG_SWPWM_DDS
+        #ifdef PWM_NOTES_DOUBLE
+            command.increment = NoteTables::noteIncrement(Tuning::active().frequencies[note], CFG_TIMER_RESOLUTION_US * 2);
+        #else
+            command.increment = NoteTables::noteIncrement(Tuning::active().frequencies[note], CFG_TIMER_RESOLUTION_US);
+        #endif
+    #endif
+    return command;
+}
 
+void ESP32_SwPWM::stopNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel)
+{
     // Only decrement if there was actually an active note
     bool wasActive = (m_activeNotes[instrument] != 0);
     
     m_activeInstruments.reset(instrument);
-    m_lastDistributor[instrument] = nullptr;
-    m_lastChannel[instrument] = NONE;
+    releaseVoiceOwner(instrument); // Clear distributor tracking
     m_noteStartTime[instrument] = 0;
     m_activeNotes[instrument] = 0;
-    m_notePeriod[instrument] = 0;
-    m_activePeriod[instrument] = 0;
-    m_currentTick[instrument] = 0;  // Reset tick counter to prevent residual state
-    m_vibratoPhase[instrument] = 0;  // Reset vibrato phase to prevent carryover
-    m_vibratoDepth[instrument] = 0;  // Reset vibrato depth to prevent carryover
-    m_currentState.reset(instrument);  // Reset pin state bit
-    digitalWrite(pwmPins[instrument], 0);
+    submit({ToneCommand::Op::Stop, instrument});
     
     if (wasActive && m_numActiveNotes > 0) {
         m_numActiveNotes--;
     }
+    if (!isBatching()) publishBatch();
     return;
 }
 
-void ESP32_SwPWM::stopAll(){
-    InterruptLock lock;
+void ESP32_SwPWM::publishBatch()
+{
+    submit({ToneCommand::Op::Publish});
+}
 
+void ESP32_SwPWM::stopAll(){
     std::fill_n(m_pitchBend, Midi::NUM_CH, Midi::CTRL_CENTER);
     m_numActiveNotes = 0;
-    m_lastDistributor.fill(nullptr);
-    m_lastChannel.fill(NONE);
+    releaseAllVoiceOwners(); // Clear all distributor tracking
     m_noteStartTime.fill(0);
     m_activeNotes = {};
-    m_notePeriod = {};
-    m_activePeriod = {};
-    m_currentTick = {};
-    m_currentState.reset();
-    m_vibratoPhase = {};
-    m_vibratoDepth = {};
-
-    for(uint8_t i = 0; i < numPwmPins; i++){
-        digitalWrite(pwmPins[i], LOW);
+    submit({ToneCommand::Op::StopAll});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//Tone Engine
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ESP32_SwPWM::submit(const ToneCommand& command)
+{
+#ifdef CFG_REALTIME_CORE
+    // A full queue is never waited on, the realtime core may be stalled. The command is dropped
+    // with everything after it and periodic() replays the state instead, see resync().
+    // The wake is left to periodic() since this can run with interrupts masked.
+    if (m_resyncPending) return;
+    if (!m_commands.push(command)) {
+        m_resyncPending = true;
+        return;
+    }
+    m_wakePending = true;
+#else
+    execute(command);
+#endif
+}
+
+// Runs on the main loop, or with CFG_REALTIME_CORE on the realtime core
+// between ticks, so only the tick can interrupt it and that never masks
+void ESP32_SwPWM::execute(const ToneCommand& command)
+{
+    const uint8_t instrument = command.instrument;
+
+    switch (command.op) {
+    case ToneCommand::Op::Start:
+        m_notePeriod[instrument] = command.period;
+        #ifdef CFG_SWPWM_DDS
+            m_noteIncrement[instrument] = command.increment;
+        #endif
+        if (m_modulation.startVoice(instrument, command.channel, m_notePeriod[instrument]) && !m_stagedVoices.test(instrument)) {
+            // Legato keeps the waveform running, only its period moves
+            stageUpdate(instrument, m_modulation.targetPeriod(instrument), false);
+            m_updates.commit(1UL << instrument);
+            wakeTick();
+        } else {
+            m_stagedPeriod[instrument] = m_modulation.targetPeriod(instrument);
+            m_stagedVoices.set(instrument);
+        }
+        break;
+
+    case ToneCommand::Op::Stop:
+        m_notePeriod[instrument] = 0;
+        m_modulation.stopVoice(instrument);
+        m_stagedPeriod[instrument] = 0;
+        m_stagedVoices.set(instrument);
+        break;
+
+    case ToneCommand::Op::Publish: {
+        // Hands every staged voice to the tick in one commit. Each restarts its waveform from the
+        // same tick, so the notes of a chord published together stay in phase.
+        uint32_t published = 0;
+        for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+            if (!m_stagedVoices.test(i)) continue;
+            stageUpdate(i, m_stagedPeriod[i], true);
+            published |= (1UL << i);
+        }
+        m_stagedVoices.reset();
+        if (published == 0) break;
+        m_updates.commit(published);
+        wakeTick();
+        break;
+    }
+
+    case ToneCommand::Op::StopAll:
+        m_notePeriod = {};
+        m_stagedPeriod = {};
+        m_stagedVoices.reset();
+        m_modulation.reset();
+
+        // The tick silences every voice and drives its pin low on its next pass
+        for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+            stageUpdate(i, 0, true);
+        }
+        m_updates.commit((HardwareConfig::MAX_NUM_INSTRUMENTS < 32) ? (1UL << HardwareConfig::MAX_NUM_INSTRUMENTS) - 1 : 0xFFFFFFFF);
+        wakeTick();
+        break;
+
+    case ToneCommand::Op::PitchBend:
+        m_modulation.setPitchBend(command.channel, command.bend, command.bendRange);
+        applyModulation();
+        break;
+
+    case ToneCommand::Op::ControlChange:
+        m_modulation.controlChange(command.channel, command.controller, command.value);
+        break;
+    }
+}
+
+#ifdef CFG_REALTIME_CORE
+// Runs on the main loop after commands were dropped. Starts the realtime core over from silence
+// and replays the modulation controllers, bends and sounding notes. If the queue fills again
+// partway the resync stays pending and the next pass starts over, nothing is published before
+// the final Publish so no voice sounds from a partial replay.
+void ESP32_SwPWM::resync()
+{
+    if (!m_commands.empty()) return;
+    if (!m_commands.push({ToneCommand::Op::StopAll})) return;
+    m_wakePending = true;
+
+    for (uint8_t channel = 0; channel < Midi::NUM_CH; channel++) {
+        for (uint8_t i = 0; i < sizeof(RESYNC_CONTROLLERS); i++) {
+            if (m_controlValues[channel][i] == CONTROL_UNSET) continue;
+            ToneCommand command = {ToneCommand::Op::ControlChange};
+            command.channel = channel;
+            command.controller = RESYNC_CONTROLLERS[i];
+            command.value = m_controlValues[channel][i];
+            if (!m_commands.push(command)) return;
+        }
+        if (m_pitchBend[channel] != Midi::CTRL_CENTER) {
+            ToneCommand command = {ToneCommand::Op::PitchBend};
+            command.channel = channel;
+            command.bend = m_pitchBend[channel];
+            command.bendRange = m_pitchBendRange[channel];
+            if (!m_commands.push(command)) return;
+        }
     }
+
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+        if (m_activeNotes[i] == 0) continue;
+        if (!m_commands.push(startCommand(i, m_activeNotes[i] & ~MSB_BITMASK, m_noteChannel[i]))) return;
+    }
+    if (!m_commands.push({ToneCommand::Op::Publish})) return;
+    m_resyncPending = false;
+}
+
+// Runs on the realtime core, applies what the other core submitted and steps the modulation
+void ESP32_SwPWM::serviceRealtime()
+{
+    ToneCommand command;
+    while (m_commands.pop(command)) execute(command);
+    if (m_modulation.update(micros())) applyModulation();
+}
+#endif
+
+// Fills the voice's m_updates slot for the caller to commit. A restart the tick hasn't taken
+// yet is kept when a pitch change lands on top of it.
+void ESP32_SwPWM::stageUpdate(uint8_t instrument, uint16_t period, bool restart)
+{
+    bool pending;
+    VoiceUpdate& update = m_updates.open(instrument, pending);
+    update.restart = restart || (pending && update.restart);
+    update.period = period;
+#ifdef CFG_SWPWM_DDS
+    update.increment = (period == 0) ? 0
+        : NoteTables::scaleByExp2(m_noteIncrement[instrument], m_modulation.pitchOffset(instrument));
+#endif
+}
+
+// The polling ticks take updates every pass. The deadline timer may be asleep until a later
+// edge, so it is brought forward, rewriting the timer is the one step done with the tick held off.
+void ESP32_SwPWM::wakeTick()
+{
+#ifdef CFG_SWPWM_DEADLINE_SCHEDULER
+    InterruptLock lock;
+    InterruptTimer::scheduleOnce(0);
+#endif
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -148,51 +371,123 @@ it's crucial that any computations here be kept to a minimum!
 */
 void ICACHE_RAM_ATTR ESP32_SwPWM::tick()
 {
-    // Go through every Instrument
-    for (int i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
-        // Early exit if no notes are active - check inside loop like original
-        if(m_numActiveNotes == 0) return;
-        
-        //If note active increase tick until period reset and toggle pin
-        if (m_activePeriod[i] > 0){
-            // Apply vibrato if enabled (modulation wheel > 0)
-            uint16_t targetPeriod = m_activePeriod[i];
-            
-            #ifdef VIBRATO_ENABLED
-            // Only apply vibrato if depth is non-zero AND the note period is valid
-            if (m_vibratoDepth[i] > 0) {
-                // Optimized vibrato: update phase less frequently
-                if ((m_currentTick[i] & 0x07) == 0) {  // Bit mask check is faster than modulo
-                    m_vibratoPhase[i] = NoteTables::updateVibratoPhase(m_vibratoPhase[i], m_vibratoRate[i]);
-                }
-                
-                // Calculate vibrato offset and apply to period
-                int16_t vibratoOffset = NoteTables::calculateVibratoOffset(m_vibratoPhase[i], m_vibratoDepth[i]);
-                targetPeriod = NoteTables::applyVibratoToPeriod(m_activePeriod[i], vibratoOffset);
-            }
-            #endif
-            
-            if (m_currentTick[i] >= targetPeriod) {
-                togglePin(i);
-                m_currentTick[i] = 0;
-            } else {
-                m_currentTick[i]++;
-            }
+#ifdef CFG_ISR_PROFILING
+    const uint32_t startCycles = IsrProfiler::cycles();
+    m_isrProfiler.recordEntry(startCycles);
+#endif
+    GpioBatch batch;
+    collectUpdates(batch);
+
+    // Only sounding voices are visited, lowest first
+    uint32_t voices = m_activeMask;
+    while (voices) {
+        const uint8_t i = __builtin_ctz(voices);
+        voices &= voices - 1;
+        Voice& voice = m_voices[i];
+#ifdef CFG_SWPWM_DDS
+        // A carry out of the accumulator is the toggle, frequency is exact over time and the
+        // rounding to whole ticks only shows as a tick of jitter
+        const uint32_t phase = voice.phase + voice.increment;
+        if (phase < voice.phase) togglePin(voice, batch);
+        voice.phase = phase;
+#else
+        // Vibrato and bends are already folded into the period at control rate
+        if (voice.tick >= voice.period) {
+            togglePin(voice, batch);
+            voice.tick = 0;
+        } else {
+            voice.tick++;
         }
+#endif
     }
+    batch.commit();
+#ifdef CFG_ISR_PROFILING
+    m_isrProfiler.record(__builtin_popcount(m_activeMask), IsrProfiler::cycles() - startCycles);
+#endif
 }
 
+#ifdef CFG_SWPWM_DEADLINE_SCHEDULER
+/*
+Runs only when the earliest voice edge is due. Work scales with the edge rate instead of the
+tick rate, and each edge lands on its own microsecond rather than the next tick.
+*/
+void ICACHE_RAM_ATTR ESP32_SwPWM::deadlineTick()
+{
+#ifdef CFG_ISR_PROFILING
+    const uint32_t startCycles = IsrProfiler::cycles();
+#endif
+    GpioBatch batch;
+    collectUpdates(batch);
+    const uint32_t now = micros();
+
+    // Serve every voice that is due, each edge is timed from the last one so lateness doesn't build up
+    while (!m_deadlines.empty() && static_cast<int32_t>(m_deadlines.topDeadline() - now) <= 0) {
+        Voice& voice = m_voices[m_deadlines.top()];
+        togglePin(voice, batch);
+        m_deadlines.rescheduleTop(m_deadlines.topDeadline() + voice.period);
+    }
+    batch.commit();
+    armNextDeadline();
+#ifdef CFG_ISR_PROFILING
+    m_isrProfiler.record(__builtin_popcount(m_activeMask), IsrProfiler::cycles() - startCycles);
+#endif
+}
+
+void ICACHE_RAM_ATTR ESP32_SwPWM::armNextDeadline()
+{
+    if (m_deadlines.empty()) return;
+    const int32_t wait = static_cast<int32_t>(m_deadlines.topDeadline() - micros());
+    InterruptTimer::scheduleOnce(wait > 0 ? wait : 0);
+}
+#endif
+
+
+// Applies what control code committed to m_updates since the last pass, called first by every tick
+void ICACHE_RAM_ATTR ESP32_SwPWM::collectUpdates(GpioBatch& batch)
+{
+    uint32_t updates = m_updates.take();
+    if (updates == 0) return;
+#ifdef CFG_SWPWM_DEADLINE_SCHEDULER
+    const uint32_t now = micros();
+#endif
+    while (updates) {
+        const uint8_t i = __builtin_ctz(updates);
+        updates &= updates - 1;
+        const VoiceUpdate& update = m_updates.slot(i);
+        Voice& voice = m_voices[i];
+
+        voice.period = update.period;
+        updateActiveMask(i);
+    #ifdef CFG_SWPWM_DDS
+        voice.increment = update.increment;
+    #endif
+        if (!update.restart) continue;
+
+        voice.tick = 0;
+        voice.state = false;
+    #ifdef CFG_SWPWM_DDS
+        voice.phase = 0;
+    #endif
+    #ifdef CFG_SWPWM_DEADLINE_SCHEDULER
+        if (voice.period > 0) {
+            m_deadlines.set(i, now + voice.period);
+        } else {
+            m_deadlines.remove(i);
+        }
+    #endif
+        batch.write(voice.pin, false);
+    }
+}
 
 #ifdef ARDUINO_ARCH_ESP32
-void ICACHE_RAM_ATTR ESP32_SwPWM::togglePin(uint8_t instrument)
+void ICACHE_RAM_ATTR ESP32_SwPWM::togglePin(Voice& voice, GpioBatch& batch)
 #else
-void ESP32_SwPWM::togglePin(uint8_t instrument)
+void ESP32_SwPWM::togglePin(Voice& voice, GpioBatch& batch)
 #endif
 {
-    //Pulse the control pin
-    m_currentState.flip(instrument);
-    digitalWrite(pwmPins[instrument], m_currentState[instrument]);
-        
+    //Pulse the control pin, written with the rest of the pass by batch.commit()
+    voice.state = !voice.state;
+    batch.write(voice.pin, voice.state);
 }
 // #pragma GCC pop_options (Legacy)
 
@@ -212,50 +507,84 @@ bool ESP32_SwPWM::isNoteActive(uint8_t instrument, uint8_t note)
 }
 
 void ESP32_SwPWM::setPitchBend(uint8_t channel, uint16_t bend){
-    InterruptLock lock;
-
     m_pitchBend[channel] = bend; 
-    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++){
-        if(m_lastChannel[i] == channel){
-            if(m_notePeriod[i] == 0) continue;
-            // Mask off the MSB flag bit to get the actual note value (0-127)
-            uint8_t note = m_activeNotes[i] & (~MSB_BITMASK);
-            
-            #ifdef PWM_NOTES_DOUBLE
-                m_activePeriod[i] = NoteTables::applyPitchBendToNoteDouble(note, bend);
-            #else
-                m_activePeriod[i] = NoteTables::applyPitchBendToNote(note, bend);
-            #endif
+    ToneCommand command = {ToneCommand::Op::PitchBend};
+    command.channel = channel;
+    command.bend = bend;
+    command.bendRange = m_pitchBendRange[channel];
+    submit(command);
+}
+
+void ESP32_SwPWM::setControlChange(uint8_t channel, uint8_t controller, uint8_t value)
+{
+    #ifdef CFG_REALTIME_CORE
+        for (uint8_t i = 0; i < sizeof(RESYNC_CONTROLLERS); i++) {
+            if (RESYNC_CONTROLLERS[i] == controller) m_controlValues[channel & 0x0F][i] = value;
+        }
+    #endif
+    ToneCommand command = {ToneCommand::Op::ControlChange};
+    command.channel = channel;
+    command.controller = controller;
+    command.value = value;
+    submit(command);
+}
+
+// Hands the modulated periods to the tick. Voices waiting to be published take theirs on publish.
+void ESP32_SwPWM::applyModulation()
+{
+    uint32_t modulated = 0;
+    const auto& voices = m_modulation.activeVoices();
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+        if (!voices.test(i)) continue;
+        if (m_stagedVoices.test(i)) {
+            m_stagedPeriod[i] = m_modulation.targetPeriod(i);
+        } else {
+            stageUpdate(i, m_modulation.targetPeriod(i), false);
+            modulated |= (1UL << i);
         }
     }
+    if (modulated == 0) return;
+    m_updates.commit(modulated);
+    wakeTick();
 }
 
-void ESP32_SwPWM::setControlChange(uint8_t channel, uint8_t controller, uint8_t value)
+void ICACHE_RAM_ATTR ESP32_SwPWM::updateActiveMask(uint8_t instrument)
 {
-    InterruptLock lock;
+    if (m_voices[instrument].period > 0) {
+        m_activeMask |= (1UL << instrument);
+    } else {
+        m_activeMask &= ~(1UL << instrument);
+    }
+}
 
-        // Map modulation wheel (0-127) to vibrato depth (0-127)
-        // The depth will determine how much pitch variation occurs
-    switch(controller) {
-
-        case MidiCC::ModulationWheel:
-            #ifndef CFG_VIBRATO_ENABLED
-                return;
-            #endif
-            
-            m_modulationWheel[channel] = value;
-            for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++){
-                if(m_lastChannel[i] == channel){
-                    if(m_notePeriod[i] == 0) continue;
-                    if(m_lastDistributor[i] == nullptr) continue;
-                    m_vibratoDepth[i] = value;
-                    m_vibratoRate[i] = value >> 3; // Higher modulation wheel = faster vibrato
-                }
-            }
-            break;
+void ESP32_SwPWM::periodic()
+{
+#ifdef CFG_REALTIME_CORE
+    // Modulation steps on the realtime core, only wake it for what was submitted here
+    if (m_resyncPending) resync();
+    if (m_wakePending) {
+        m_wakePending = false;
+        RealtimeCore::wake();
     }
+#else
+    if (m_modulation.update(micros())) applyModulation();
+#endif
+    InstrumentControllerBase::periodic();
 }
 
+#ifdef CFG_ISR_PROFILING
+IsrProfile ESP32_SwPWM::getIsrProfile(uint8_t numVoices) const
+{
+    return m_isrProfiler.get(numVoices);
+}
+
+IsrJitter ESP32_SwPWM::getIsrJitter() const
+{
+    return m_isrProfiler.jitter();
+}
+#endif
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Timeout Tracking Functions
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -9,33 +9,53 @@
 #include "Instruments/Components/InterruptTimer.h"
 
 namespace {
+// Note changes reach the tick through m_updates, this is only held to rearm the deadline timer.
+// Nesting depth lets callers share one critical section.
+volatile uint8_t lockDepth = 0;
+
 struct InterruptLock {
-    InterruptLock() { noInterrupts(); }
-    ~InterruptLock() { interrupts(); }
+    InterruptLock() { noInterrupts(); lockDepth++; }
+    ~InterruptLock() { if (--lockDepth == 0) interrupts(); }
 };
 }
 
 // Define constants for PWM configuration
 constexpr uint8_t pwmPins[] = {CFG_PINS_INSTRUMENT_PWM};
 constexpr uint8_t numPwmPins = sizeof(pwmPins) / sizeof(pwmPins[0]);
+static_assert(Gpio::pinsValid(pwmPins), "CFG_PINS_INSTRUMENT_PWM has a pin without a GPIO output bank");
+constexpr auto pwmBits = Gpio::mapPins(pwmPins);
+static_assert(HardwareConfig::MAX_NUM_INSTRUMENTS <= 32, "The active voice mask is 32 bits");
 
 // Define static member variables
 std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_SwPWM::m_activeNotes = {};
 uint8_t Teensy41_SwPWM::m_numActiveNotes = 0;
-std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_SwPWM::m_modulationWheel = {};
 std::array<uint16_t, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_SwPWM::m_notePeriod = {};
-std::array<uint16_t, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_SwPWM::m_activePeriod =  {};
-std::array<uint16_t, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_SwPWM::m_currentTick = {};
-std::bitset<HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_SwPWM::m_currentState = 0;
-std::array<uint16_t, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_SwPWM::m_vibratoPhase = {};
-std::array<uint8_t,HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_SwPWM::m_vibratoDepth = {};
-std::array<uint8_t,HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_SwPWM::m_vibratoRate = {}; //slow default rate
+std::array<Teensy41_SwPWM::Voice, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_SwPWM::m_voices = {};
+uint32_t Teensy41_SwPWM::m_activeMask = 0;
+std::array<uint16_t, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_SwPWM::m_stagedPeriod = {};
+std::bitset<HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_SwPWM::m_stagedVoices = 0;
+VoiceMailbox<Teensy41_SwPWM::VoiceUpdate, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_SwPWM::m_updates;
+ModulationEngine Teensy41_SwPWM::m_modulation;
+#ifdef CFG_ISR_PROFILING
+IsrProfiler Teensy41_SwPWM::m_isrProfiler;
+#endif
+#ifdef CFG_SWPWM_DEADLINE_SCHEDULER
+DeadlineScheduler Teensy41_SwPWM::m_deadlines;
+#endif
+#ifdef CFG_SWPWM_DDS
+std::array<uint32_t, HardwareConfig::MAX_NUM_INSTRUMENTS> Teensy41_SwPWM::m_noteIncrement = {};
+#endif
+#ifdef CFG_SWPWM_SIMD
+std::array<uint32_t, (HardwareConfig::MAX_NUM_INSTRUMENTS + 1) / 2> Teensy41_SwPWM::m_laneTicks = {};
+std::array<uint32_t, (HardwareConfig::MAX_NUM_INSTRUMENTS + 1) / 2> Teensy41_SwPWM::m_lanePeriods = {};
+#endif
 
 Teensy41_SwPWM::Teensy41_SwPWM() : InstrumentControllerBase()
 {
     //Setup pins
     for(uint8_t i=0; i < numPwmPins; i++){
         pinMode(pwmPins[i], OUTPUT);
+        m_voices[i].pin = pwmBits[i];
     }
 
     delay(500); // Wait a half second for safety
@@ -44,12 +64,22 @@ Teensy41_SwPWM::Teensy41_SwPWM() : InstrumentControllerBase()
     // specialized subclass (like Teensy41_StepSwPWM) wants to take
     // ownership it can call InterruptTimer::setCallback() to replace this
     // handler.
+#ifdef CFG_SWPWM_DEADLINE_SCHEDULER
+    InterruptTimer::initializeOneShot(deadlineTick);
+#else
     InterruptTimer::initialize(CFG_TIMER_RESOLUTION_US, nullptr);
     InterruptTimer::setCallback(Tick);
+    #ifdef CFG_ISR_PROFILING
+        m_isrProfiler.setNominalInterval(CFG_TIMER_RESOLUTION_US);
+    #endif
+#endif
 
 
     //Initialize Default values
     std::fill_n(m_pitchBend, Midi::NUM_CH, Midi::CTRL_CENTER);
+
+    // Notes are only staged for the tick, compensated ones can start from the event timer
+    setInterruptFiring(true);
 }
 
 void Teensy41_SwPWM::reset(uint8_t instrument)
@@ -64,77 +94,127 @@ void Teensy41_SwPWM::resetAll()
 
 void Teensy41_SwPWM::playNote(uint8_t instrument, uint8_t note, uint8_t velocity,  uint8_t channel)
 {
-    InterruptLock lock;
-
     // Only increment counter if this instrument wasn't already playing a note
     bool wasActive = (m_activeNotes[instrument] != 0);
     
     m_activeInstruments.set(instrument);
     m_activeNotes[instrument] = (MSB_BITMASK | note);
-    m_notePeriod[instrument] = NoteTables::NOTE_TICKS_DOUBLE[note];
-
-    #ifdef PWM_NOTES_DOUBLE
-        m_activePeriod[instrument] = NoteTables::applyPitchBendToNoteDouble(note, m_pitchBend[channel]);
+    #if defined(CFG_SWPWM_DEADLINE_SCHEDULER)
+        // The deadline engine times edges to the microsecond so it skips the truncation to ticks
+        #ifdef PWM_NOTES_DOUBLE
+            m_notePeriod[instrument] = Tuning::active().periods[note] / 2;
+        #else
+            m_notePeriod[instrument] = Tuning::active().periods[note];
+        #endif
+    #elif defined(PWM_NOTES_DOUBLE)
+        m_notePeriod[instrument] = Tuning::active().ticksDouble[note];
     #else
-        m_activePeriod[instrument] = NoteTables::applyPitchBendToNote(note, m_pitchBend[channel]);
+        m_notePeriod[instrument] = Tuning::active().ticks[note];
+    #endif
+    #ifdef CFG_SWPWM_DDS
+        #ifdef PWM_NOTES_DOUBLE
+            m_noteIncrement[instrument] = NoteTables::noteIncrement(Tuning::active().frequencies[note], CFG_TIMER_RESOLUTION_US * 2);
+        #else
+            m_noteIncrement[instrument] = NoteTables::noteIncrement(Tuning::active().frequencies[note], CFG_TIMER_RESOLUTION_US);
+        #endif
     #endif
+    if (m_modulation.startVoice(instrument, channel, m_notePeriod[instrument]) && !m_stagedVoices.test(instrument)) {
+        // Legato keeps the waveform running, only its period moves
+        stageUpdate(instrument, m_modulation.targetPeriod(instrument), false);
+        m_updates.commit(1UL << instrument);
+        wakeTick();
+    } else {
+        m_stagedPeriod[instrument] = m_modulation.targetPeriod(instrument);
+        m_stagedVoices.set(instrument);
+    }
 
     m_noteStartTime[instrument] = millis(); // Record when note started for timeout tracking
 
-    m_vibratoDepth[instrument] = Device::Vibrato ? m_modulationWheel[channel] : 0;
-    m_vibratoRate[instrument] = m_vibratoDepth[instrument] >> 3; // Set vibrato rate from modulation wheel
-
     if (!wasActive) {
         m_numActiveNotes++;
     }
+    if (!isBatching()) publishBatch();
     return;
 }
 
 void Teensy41_SwPWM::stopNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel)
 {
-    InterruptLock lock;
-
     // Only decrement if there was actually an active note
     bool wasActive = (m_activeNotes[instrument] != 0);
     
     m_activeInstruments.reset(instrument);
-    m_lastDistributor[instrument] = nullptr;
-    m_lastChannel[instrument] = NONE;
+    releaseVoiceOwner(instrument); // Clear distributor tracking
     m_noteStartTime[instrument] = 0;
     m_activeNotes[instrument] = 0;
     m_notePeriod[instrument] = 0;
-    m_activePeriod[instrument] = 0;
-    m_currentTick[instrument] = 0;  // Reset tick counter to prevent residual state
-    m_vibratoPhase[instrument] = 0;  // Reset vibrato phase to prevent carryover
-    m_vibratoDepth[instrument] = 0;  // Reset vibrato depth to prevent carryover
-    m_currentState.reset(instrument);  // Reset pin state bit
-    digitalWriteFast(pwmPins[instrument], 0);
+    m_modulation.stopVoice(instrument);
+    m_stagedPeriod[instrument] = 0;
+    m_stagedVoices.set(instrument);
     
     if (wasActive && m_numActiveNotes > 0) {
         m_numActiveNotes--;
     }
+    if (!isBatching()) publishBatch();
     return;
 }
 
-void Teensy41_SwPWM::stopAll(){
-    InterruptLock lock;
+// Hands every staged voice to the tick in one commit. Each restarts its waveform from the same
+// tick, so the notes of a chord published together stay in phase.
+void Teensy41_SwPWM::publishBatch()
+{
+    uint32_t published = 0;
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+        if (!m_stagedVoices.test(i)) continue;
+        stageUpdate(i, m_stagedPeriod[i], true);
+        published |= (1UL << i);
+    }
+    m_stagedVoices.reset();
+    if (published == 0) return;
+    m_updates.commit(published);
+    wakeTick();
+}
 
+void Teensy41_SwPWM::stopAll(){
     std::fill_n(m_pitchBend, Midi::NUM_CH, Midi::CTRL_CENTER);
     m_numActiveNotes = 0;
-    m_lastDistributor.fill(nullptr);
-    m_lastChannel.fill(NONE);
+    releaseAllVoiceOwners(); // Clear all distributor tracking
     m_noteStartTime.fill(0);
     m_activeNotes = {};
     m_notePeriod = {};
-    m_activePeriod = {};
-    m_currentTick = {};
-    m_currentState.reset();
-    m_vibratoPhase = {};
-    m_vibratoDepth = {};
-
-    for(uint8_t i = 0; i < numPwmPins; i++){
-        digitalWriteFast(pwmPins[i], LOW);
+    m_stagedPeriod = {};
+    m_stagedVoices.reset();
+    m_modulation.reset();
+
+    // The tick silences every voice and drives its pin low on its next pass
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+        stageUpdate(i, 0, true);
     }
+    m_updates.commit((HardwareConfig::MAX_NUM_INSTRUMENTS < 32) ? (1UL << HardwareConfig::MAX_NUM_INSTRUMENTS) - 1 : 0xFFFFFFFF);
+    wakeTick();
+}
+
+// Fills the voice's m_updates slot for the caller to commit. A restart the tick hasn't taken
+// yet is kept when a pitch change lands on top of it.
+void Teensy41_SwPWM::stageUpdate(uint8_t instrument, uint16_t period, bool restart)
+{
+    bool pending;
+    VoiceUpdate& update = m_updates.open(instrument, pending);
+    update.restart = restart || (pending && update.restart);
+    update.period = period;
+#ifdef CFG_SWPWM_DDS
+    update.increment = (period == 0) ? 0
+        : NoteTables::scaleByExp2(m_noteIncrement[instrument], m_modulation.pitchOffset(instrument));
+#endif
+}
+
+// The polling ticks take updates every pass. The deadline timer may be asleep until a later
+// edge, so it is brought forward, rewriting the timer is the one step done with the tick held off.
+void Teensy41_SwPWM::wakeTick()
+{
+#ifdef CFG_SWPWM_DEADLINE_SCHEDULER
+    InterruptLock lock;
+    InterruptTimer::scheduleOnce(0);
+#endif
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -145,47 +225,137 @@ void Teensy41_SwPWM::stopAll(){
 Called by the timer interrupt at the specified resolution.  Because this is called extremely often,
 it's crucial that any computations here be kept to a minimum!
 */
-void Teensy41_SwPWM::Tick()
+void FASTRUN Teensy41_SwPWM::Tick()
+{
+#ifdef CFG_ISR_PROFILING
+    const uint32_t startCycles = IsrProfiler::cycles();
+    m_isrProfiler.recordEntry(startCycles);
+#endif
+    GpioBatch batch;
+    collectUpdates(batch);
+
+#ifdef CFG_SWPWM_SIMD
+    // Both voices of a pair advance in one step, pairs with neither voice sounding are skipped.
+    // A silent voice in a sounding pair has period 0 so it comes due every tick, its edges are masked.
+    const uint32_t active = m_activeMask;
+    uint32_t pairs = (active | (active >> 1)) & 0x55555555;
+    while (pairs) {
+        const uint8_t i = __builtin_ctz(pairs);
+        pairs &= pairs - 1;
+        const uint32_t due = TickKernel::advancePair(m_laneTicks[i / 2], m_lanePeriods[i / 2]) & (active >> i);
+        if (due & 0x1) togglePin(m_voices[i], batch);
+        if (due & 0x2) togglePin(m_voices[i + 1], batch);
+    }
+#else
+    // Only sounding voices are visited, lowest first
+    uint32_t voices = m_activeMask;
+    while (voices) {
+        const uint8_t i = __builtin_ctz(voices);
+        voices &= voices - 1;
+        Voice& voice = m_voices[i];
+#ifdef CFG_SWPWM_DDS
+        // A carry out of the accumulator is the toggle, frequency is exact over time and the
+        // rounding to whole ticks only shows as a tick of jitter
+        const uint32_t phase = voice.phase + voice.increment;
+        if (phase < voice.phase) togglePin(voice, batch);
+        voice.phase = phase;
+#else
+        // Vibrato and bends are already folded into the period at control rate
+        if (voice.tick >= voice.period) {
+            togglePin(voice, batch);
+            voice.tick = 0;
+        } else {
+            voice.tick++;
+        }
+#endif
+    }
+#endif
+    batch.commit();
+#ifdef CFG_ISR_PROFILING
+    m_isrProfiler.record(__builtin_popcount(m_activeMask), IsrProfiler::cycles() - startCycles);
+#endif
+}
+
+#ifdef CFG_SWPWM_DEADLINE_SCHEDULER
+/*
+Runs only when the earliest voice edge is due. Work scales with the edge rate instead of the
+tick rate, and each edge lands on its own microsecond rather than the next tick.
+*/
+void FASTRUN Teensy41_SwPWM::deadlineTick()
 {
-    // Go through every Instrument
-    for (int i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
-        // Early exit if no notes are active - check inside loop like original
-        if(m_numActiveNotes == 0) return;
-        
-        //If note active increase tick until period reset and toggle pin
-        if (m_activePeriod[i] > 0){
-            // Apply vibrato if enabled (modulation wheel > 0)
-            uint16_t targetPeriod = m_activePeriod[i];
-            
-            #ifdef VIBRATO_ENABLED
-            // Only apply vibrato if depth is non-zero AND the note period is valid
-            if (m_vibratoDepth[i] > 0) {
-                // Optimized vibrato: update phase less frequently
-                if ((m_currentTick[i] & 0x07) == 0) {  // Bit mask check is faster than modulo
-                    m_vibratoPhase[i] = NoteTables::updateVibratoPhase(m_vibratoPhase[i], m_vibratoRate[i]);
-                }
-                
-                // Calculate vibrato offset and apply to period
-                int16_t vibratoOffset = NoteTables::calculateVibratoOffset(m_vibratoPhase[i], m_vibratoDepth[i]);
-                targetPeriod = NoteTables::applyVibratoToPeriod(m_activePeriod[i], vibratoOffset);
-            }
-            #endif
-            
-            if (m_currentTick[i] >= targetPeriod) {
-                togglePin(i);
-                m_currentTick[i] = 0;
-            } else {
-                m_currentTick[i]++;
-            }
+#ifdef CFG_ISR_PROFILING
+    const uint32_t startCycles = IsrProfiler::cycles();
+#endif
+    GpioBatch batch;
+    collectUpdates(batch);
+    const uint32_t now = micros();
+
+    // Serve every voice that is due, each edge is timed from the last one so lateness doesn't build up
+    while (!m_deadlines.empty() && static_cast<int32_t>(m_deadlines.topDeadline() - now) <= 0) {
+        Voice& voice = m_voices[m_deadlines.top()];
+        togglePin(voice, batch);
+        m_deadlines.rescheduleTop(m_deadlines.topDeadline() + voice.period);
+    }
+    batch.commit();
+    armNextDeadline();
+#ifdef CFG_ISR_PROFILING
+    m_isrProfiler.record(__builtin_popcount(m_activeMask), IsrProfiler::cycles() - startCycles);
+#endif
+}
+
+void FASTRUN Teensy41_SwPWM::armNextDeadline()
+{
+    if (m_deadlines.empty()) return;
+    const int32_t wait = static_cast<int32_t>(m_deadlines.topDeadline() - micros());
+    InterruptTimer::scheduleOnce(wait > 0 ? wait : 0);
+}
+#endif
+
+// Applies what control code committed to m_updates since the last pass, called first by every tick
+void FASTRUN Teensy41_SwPWM::collectUpdates(GpioBatch& batch)
+{
+    uint32_t updates = m_updates.take();
+    if (updates == 0) return;
+#ifdef CFG_SWPWM_DEADLINE_SCHEDULER
+    const uint32_t now = micros();
+#endif
+    while (updates) {
+        const uint8_t i = __builtin_ctz(updates);
+        updates &= updates - 1;
+        const VoiceUpdate& update = m_updates.slot(i);
+        Voice& voice = m_voices[i];
+
+        voice.period = update.period;
+        updateActiveMask(i);
+    #ifdef CFG_SWPWM_DDS
+        voice.increment = update.increment;
+    #endif
+        if (!update.restart) continue;
+
+        voice.tick = 0;
+        voice.state = false;
+    #ifdef CFG_SWPWM_SIMD
+        TickKernel::setLane(m_laneTicks[i / 2], i, 0);
+    #endif
+    #ifdef CFG_SWPWM_DDS
+        voice.phase = 0;
+    #endif
+    #ifdef CFG_SWPWM_DEADLINE_SCHEDULER
+        if (voice.period > 0) {
+            m_deadlines.set(i, now + voice.period);
+        } else {
+            m_deadlines.remove(i);
         }
+    #endif
+        batch.write(voice.pin, false);
     }
 }
 
-void Teensy41_SwPWM::togglePin(uint8_t instrument)
+void FASTRUN Teensy41_SwPWM::togglePin(Voice& voice, GpioBatch& batch)
 {
-    //Pulse the control pin
-    m_currentState.flip(instrument);
-    digitalWriteFast(pwmPins[instrument], m_currentState[instrument]);
+    //Pulse the control pin, written with the rest of the pass by batch.commit()
+    voice.state = !voice.state;
+    batch.write(voice.pin, voice.state);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -204,50 +374,67 @@ bool Teensy41_SwPWM::isNoteActive(uint8_t instrument, uint8_t note)
 }
 
 void Teensy41_SwPWM::setPitchBend(uint8_t channel, uint16_t bend){
-    InterruptLock lock;
-
     m_pitchBend[channel] = bend; 
-    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++){
-        if(m_lastChannel[i] == channel){
-            if(m_notePeriod[i] == 0) continue;
-            // Mask off the MSB flag bit to get the actual note value (0-127)
-            uint8_t note = m_activeNotes[i] & (~MSB_BITMASK);
-            
-            #ifdef PWM_NOTES_DOUBLE
-                m_activePeriod[i] = NoteTables::applyPitchBendToNoteDouble(note, bend);
-            #else
-                m_activePeriod[i] = NoteTables::applyPitchBendToNote(note, bend);
-            #endif
-        }
-    }
+    m_modulation.setPitchBend(channel, bend, m_pitchBendRange[channel]);
+    applyModulation();
 }
 
 void Teensy41_SwPWM::setControlChange(uint8_t channel, uint8_t controller, uint8_t value)
 {
-    InterruptLock lock;
+    m_modulation.controlChange(channel, controller, value);
+}
 
-        // Map modulation wheel (0-127) to vibrato depth (0-127)
-        // The depth will determine how much pitch variation occurs
-    switch(controller) {
-
-        case MidiCC::ModulationWheel:
-            #ifndef CFG_VIBRATO_ENABLED
-                return;
-            #endif
-            
-            m_modulationWheel[channel] = value;
-            for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++){
-                if(m_lastChannel[i] == channel){
-                    if(m_notePeriod[i] == 0) continue;
-                    if(m_lastDistributor[i] == nullptr) continue;
-                    m_vibratoDepth[i] = value;
-                    m_vibratoRate[i] = value >> 3; // Higher modulation wheel = faster vibrato
-                }
-            }
-            break;
+// Hands the modulated periods to the tick. Voices waiting to be published take theirs on publish.
+void Teensy41_SwPWM::applyModulation()
+{
+    uint32_t modulated = 0;
+    const auto& voices = m_modulation.activeVoices();
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+        if (!voices.test(i)) continue;
+        if (m_stagedVoices.test(i)) {
+            m_stagedPeriod[i] = m_modulation.targetPeriod(i);
+        } else {
+            stageUpdate(i, m_modulation.targetPeriod(i), false);
+            modulated |= (1UL << i);
+        }
     }
+    if (modulated == 0) return;
+    m_updates.commit(modulated);
+    wakeTick();
 }
 
+void FASTRUN Teensy41_SwPWM::updateActiveMask(uint8_t instrument)
+{
+    if (m_voices[instrument].period > 0) {
+        m_activeMask |= (1UL << instrument);
+    } else {
+        m_activeMask &= ~(1UL << instrument);
+    }
+#ifdef CFG_SWPWM_SIMD
+    // Every period change passes through here, keep the kernel's copy in step
+    TickKernel::setLane(m_lanePeriods[instrument / 2], instrument, m_voices[instrument].period);
+#endif
+}
+
+void Teensy41_SwPWM::periodic()
+{
+    if (m_modulation.update(micros())) applyModulation();
+    InstrumentControllerBase::periodic();
+}
+
+#ifdef CFG_ISR_PROFILING
+IsrProfile Teensy41_SwPWM::getIsrProfile(uint8_t numVoices) const
+{
+    return m_isrProfiler.get(numVoices);
+}
+
+IsrJitter Teensy41_SwPWM::getIsrJitter() const
+{
+    return m_isrProfiler.jitter();
+}
+#endif
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Timeout Tracking Functions
 ////////////////////////////////////////////////////////////////////////////////////////////////////
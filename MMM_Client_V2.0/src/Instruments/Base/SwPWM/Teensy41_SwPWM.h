@@ -3,6 +3,23 @@
 #include "Constants.h"
 #include "Config.h"
 #include "Instruments/InstrumentControllerBase.h"
+#include "Instruments/Components/Modulation.h"
+#include "Instruments/Components/DeadlineScheduler.h"
+#include "Instruments/Components/GpioBatch.h"
+#include "Instruments/Components/IsrProfiler.h"
+#include "Instruments/Components/TickKernel.h"
+#include "Instruments/Components/VoiceMailbox.h"
+
+// Step instruments replace the polling tick callback, which the one-shot deadline timer can't serve
+#if defined(CFG_SWPWM_DEADLINE_SCHEDULER) && (defined(CFG_INSTRUMENT_STEPSW) || defined(CFG_INSTRUMENT_STEPSWSHIFT))
+    #error "CFG_SWPWM_DEADLINE_SCHEDULER only supports plain SwPWM instruments"
+#endif
+#if defined(CFG_SWPWM_DEADLINE_SCHEDULER) && defined(CFG_SWPWM_DDS)
+    #error "Choose one SwPWM engine, CFG_SWPWM_DEADLINE_SCHEDULER or CFG_SWPWM_DDS"
+#endif
+#if defined(CFG_SWPWM_SIMD) && (defined(CFG_SWPWM_DEADLINE_SCHEDULER) || defined(CFG_SWPWM_DDS))
+    #error "CFG_SWPWM_SIMD vectorizes the polling tick, it can't be combined with another SwPWM engine"
+#endif
 #include <cstdint>
 using std::int8_t;
 
@@ -14,23 +31,75 @@ using std::int8_t;
 class Teensy41_SwPWM : public InstrumentControllerBase{
 protected:
     static void Tick();
-    static void togglePin(uint8_t instrument);
 
     //[Instrument][ActiveNote] MSB is set if note is Active the 7 LSBs are the Notes Value 
     static std::array<uint8_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_activeNotes;
     static uint8_t m_numActiveNotes;
-    static std::array<uint8_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_modulationWheel;
 
     //Instrument Attributes
     static std::array<uint16_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_notePeriod;  //Base Note
-    static std::array<uint16_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_activePeriod;//Note Played
-    static std::array<uint16_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_currentTick; //Timing
-    static std::bitset<HardwareConfig::MAX_NUM_INSTRUMENTS> m_currentState; //IO
 
-    //Vibrato Attributes
-    static std::array<uint16_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_vibratoPhase; //Vibrato phase counter
-    static std::array<uint8_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_vibratoDepth;   //Vibrato depth (controlled by modulation wheel)
-    static std::array<uint8_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_vibratoRate;    //Vibrato rate (speed of oscillation)
+    //One record per voice holding only what the tick reads. Like all of .bss it lives in DTCM,
+    //the tick runs from ITCM. Control-only state stays in separate arrays. Only the tick writes
+    //these, control code hands changes over through m_updates.
+    struct alignas(16) Voice {
+        uint16_t period;     //Note played in ticks, microseconds with the deadline engine. 0 is silent
+        uint16_t tick;       //Timing
+        bool state;          //IO
+        Gpio::PinBit pin;
+    #ifdef CFG_SWPWM_DDS
+        uint32_t phase;      //Toggles each time it wraps
+        uint32_t increment;  //Note played, 0 is silent
+    #endif
+    };
+    static std::array<Voice,HardwareConfig::MAX_NUM_INSTRUMENTS> m_voices;
+    static void togglePin(Voice& voice, GpioBatch& batch);
+
+    //Voices with a period the tick serves, walked lowest bit first so idle slots cost nothing
+    static uint32_t m_activeMask;
+    static void updateActiveMask(uint8_t instrument);
+
+    //Voice changes waiting to be published to the tick, see publishBatch()
+    static std::array<uint16_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_stagedPeriod; //0 stops the voice
+    static std::bitset<HardwareConfig::MAX_NUM_INSTRUMENTS> m_stagedVoices;
+
+    //Parameters on their way to the tick, which applies them at the start of its next pass
+    struct VoiceUpdate {
+        uint16_t period;     //0 stops the voice
+        bool restart;        //Start the waveform over from this tick, else only the pitch moves
+    #ifdef CFG_SWPWM_DDS
+        uint32_t increment;
+    #endif
+    };
+    static VoiceMailbox<VoiceUpdate,HardwareConfig::MAX_NUM_INSTRUMENTS> m_updates;
+    static void stageUpdate(uint8_t instrument, uint16_t period, bool restart);
+    static void collectUpdates(GpioBatch& batch);
+    static void wakeTick();
+
+    //Vibrato, pitch bend and other modulation computed at control rate
+    static ModulationEngine m_modulation;
+
+#ifdef CFG_SWPWM_DEADLINE_SCHEDULER
+    //Next edge of every sounding voice, the timer sleeps until the earliest. Periods are in microseconds.
+    static DeadlineScheduler m_deadlines;
+    static void deadlineTick();
+    static void armNextDeadline();
+#endif
+
+#ifdef CFG_SWPWM_SIMD
+    //Tick counters and periods two voices per word for the DSP kernel, see TickKernel.h
+    static std::array<uint32_t,(HardwareConfig::MAX_NUM_INSTRUMENTS + 1) / 2> m_laneTicks;
+    static std::array<uint32_t,(HardwareConfig::MAX_NUM_INSTRUMENTS + 1) / 2> m_lanePeriods;
+#endif
+
+#ifdef CFG_ISR_PROFILING
+    static IsrProfiler m_isrProfiler;
+#endif
+
+#ifdef CFG_SWPWM_DDS
+    //Phase accumulator steps, a voice toggles each time its phase wraps so the fraction of a tick carries over
+    static std::array<uint32_t,HardwareConfig::MAX_NUM_INSTRUMENTS> m_noteIncrement;   //Base Note
+#endif
 
 public: 
     Teensy41_SwPWM();
@@ -47,7 +116,18 @@ public:
     uint8_t getNumActiveNotes(uint8_t instrument) override;
     bool isNoteActive(uint8_t instrument, uint8_t note) override;
 
+    void periodic() override;
+
+#ifdef CFG_ISR_PROFILING
+    IsrProfile getIsrProfile(uint8_t numVoices) const override;
+    IsrJitter getIsrJitter() const override;
+#endif
+
     //Timeout tracking functions
     void checkInstrumentTimeouts() override;
 
+protected:
+    void publishBatch() override;
+    static void applyModulation();
+
 };
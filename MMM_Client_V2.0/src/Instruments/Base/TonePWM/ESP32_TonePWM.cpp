@@ -0,0 +1,293 @@
+#include "Config.h"
+#if defined(PLATFORM_ESP32) && defined(CFG_INSTRUMENT_TONEPWM) && defined(CFG_COMPONENT_PWM)
+
+#include "Instruments/Base/TonePWM/ESP32_TonePWM.h"
+#include "Instruments/Components/NoteTable.h"
+#include "Arduino.h"
+#include "driver/rmt.h"
+#include "driver/mcpwm.h"
+#include "hal/mcpwm_ll.h"
+
+using ToneChannels::Engine;
+
+// Define constants for PWM configuration
+constexpr uint8_t pwmPins[] = {CFG_PINS_INSTRUMENT_PWM};
+constexpr uint8_t numPwmPins = sizeof(pwmPins) / sizeof(pwmPins[0]);
+static_assert(Gpio::pinsValid(pwmPins), "CFG_PINS_INSTRUMENT_PWM has a pin without a GPIO output bank");
+
+static_assert(CFG_TONEPWM_RMT_CHANNELS <= ToneChannels::RMT_NUM_CHANNELS, "CFG_TONEPWM_RMT_CHANNELS is more than the ESP32 has");
+static_assert(CFG_TONEPWM_MCPWM_TIMERS <= ToneChannels::MCPWM_NUM_UNITS * ToneChannels::MCPWM_TIMERS_PER_UNIT,
+              "CFG_TONEPWM_MCPWM_TIMERS is more than the ESP32 has");
+
+constexpr auto toneSlots = ToneChannels::allocate<HardwareConfig::MAX_NUM_INSTRUMENTS>(CFG_TONEPWM_RMT_CHANNELS, CFG_TONEPWM_MCPWM_TIMERS);
+
+// Voices without a peripheral, the only ones the inherited SwPWM tick plays
+constexpr uint32_t tickVoices() {
+    uint32_t voices = 0;
+    for (uint8_t i = 0; i < numPwmPins && i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+        if (toneSlots[i].engine == Engine::Software) voices |= (1UL << i);
+    }
+    return voices;
+}
+
+static mcpwm_dev_t* const mcpwmDevices[ToneChannels::MCPWM_NUM_UNITS] = {&MCPWM0, &MCPWM1};
+
+// Define static member variables
+const std::array<ToneChannels::Slot, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_TonePWM::m_slots = toneSlots;
+std::array<uint32_t, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_TonePWM::m_activeFrequency = {};
+std::array<uint16_t, HardwareConfig::MAX_NUM_INSTRUMENTS> ESP32_TonePWM::m_clockDivider = {};
+ModulationEngine ESP32_TonePWM::m_hardwareModulation;
+
+// The base sets up the pins and the tick for the software voices only
+ESP32_TonePWM::ESP32_TonePWM() : ESP32_SwPWM(tickVoices())
+{
+    for (uint8_t i = 0; i < numPwmPins && i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+        switch (m_slots[i].engine) {
+        case Engine::Rmt:
+            initializeRmt(i, pwmPins[i]);
+            break;
+        case Engine::Mcpwm:
+            initializeMcpwm(i, pwmPins[i]);
+            break;
+        case Engine::Software:
+            break;
+        }
+    }
+
+    // The RMT and MCPWM drivers take locks, compensated notes wait for the main loop
+    setInterruptFiring(false);
+}
+
+// Loops one item forever once started, the line idles low while stopped
+void ESP32_TonePWM::initializeRmt(uint8_t instrument, uint8_t pin)
+{
+    const rmt_channel_t channel = static_cast<rmt_channel_t>(m_slots[instrument].index);
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX(static_cast<gpio_num_t>(pin), channel);
+    config.clk_div = 1;
+    config.tx_config.loop_en = true;
+    config.tx_config.idle_output_en = true;
+    config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+    rmt_config(&config);
+}
+
+// The timer free runs from here on and notes only move its period. Period and compare are
+// shadowed until the counter wraps so a change never cuts a cycle short.
+void ESP32_TonePWM::initializeMcpwm(uint8_t instrument, uint8_t pin)
+{
+    const ToneChannels::Slot& slot = m_slots[instrument];
+    const mcpwm_unit_t unit = static_cast<mcpwm_unit_t>(slot.unit);
+    const mcpwm_timer_t timer = static_cast<mcpwm_timer_t>(slot.index);
+
+    mcpwm_gpio_init(unit, static_cast<mcpwm_io_signals_t>(MCPWM0A + slot.index * 2), pin);
+    mcpwm_group_set_resolution(unit, ToneChannels::MCPWM_GROUP_CLOCK_HZ);
+
+    mcpwm_config_t config = {};
+    config.frequency = 1000; // Replaced when a note plays
+    config.cmpr_a = 50;
+    config.cmpr_b = 0;
+    config.duty_mode = MCPWM_DUTY_MODE_0;
+    config.counter_mode = MCPWM_UP_COUNTER;
+    mcpwm_init(unit, timer, &config);
+
+    mcpwm_ll_timer_enable_update_period_on_tez(mcpwmDevices[slot.unit], slot.index, true);
+    mcpwm_ll_operator_enable_update_compare_on_tez(mcpwmDevices[slot.unit], slot.index, 0, true);
+    mcpwm_set_signal_low(unit, timer, MCPWM_OPR_A);
+}
+
+// Starts a stopped voice or retunes a sounding one, frequency in Hz Q16. False if the
+// peripheral can't count that low, the voice is then left stopped.
+bool ESP32_TonePWM::setFrequency(uint8_t instrument, uint32_t frequencyQ16)
+{
+    if (frequencyQ16 == m_activeFrequency[instrument]) return true;
+
+    const ToneChannels::Slot& slot = m_slots[instrument];
+    const bool restart = (m_activeFrequency[instrument] == 0);
+    bool written = false;
+    switch (slot.engine) {
+    case Engine::Rmt:
+        written = writeRmt(slot.index, frequencyQ16, m_clockDivider[instrument], restart);
+        break;
+    case Engine::Mcpwm:
+        written = writeMcpwm(slot.unit, slot.index, frequencyQ16, m_clockDivider[instrument], restart);
+        break;
+    case Engine::Software:
+        break;
+    }
+
+    if (written) {
+        m_activeFrequency[instrument] = frequencyQ16;
+    } else if (!restart) {
+        stopChannel(instrument);
+    }
+    return written;
+}
+
+bool ESP32_TonePWM::writeRmt(uint8_t channel, uint32_t frequencyQ16, uint16_t& divider, bool restart)
+{
+    // Keep the divider while the period still fits it, a new divider moves the whole waveform
+    ToneChannels::RmtPeriod period = restart ? ToneChannels::RmtPeriod{0, 0, 0}
+                                             : ToneChannels::rmtPeriod(frequencyQ16, divider);
+    if (period.divider == 0) {
+        divider = ToneChannels::rmtDivider(frequencyQ16, CLOCK_HEADROOM);
+        period = ToneChannels::rmtPeriod(frequencyQ16, divider);
+        if (period.divider == 0) return false;
+        rmt_set_clk_div(static_cast<rmt_channel_t>(channel), period.divider);
+    }
+
+    // The channel reads its memory fresh on every loop, so a sounding voice picks up the new
+    // durations at the end of the current period
+    rmt_item32_t items[2] = {};
+    items[0].level0 = 1;
+    items[0].duration0 = period.high;
+    items[0].level1 = 0;
+    items[0].duration1 = period.low;
+    rmt_fill_tx_items(static_cast<rmt_channel_t>(channel), items, 2, 0);
+
+    if (restart) rmt_tx_start(static_cast<rmt_channel_t>(channel), true);
+    return true;
+}
+
+bool ESP32_TonePWM::writeMcpwm(uint8_t unit, uint8_t timer, uint32_t frequencyQ16, uint16_t& prescale, bool restart)
+{
+    mcpwm_dev_t* const device = mcpwmDevices[unit];
+
+    // The prescaler isn't shadowed, it is only changed when the voice starts or leaves its headroom
+    ToneChannels::McpwmPeriod period = restart ? ToneChannels::McpwmPeriod{0, 0}
+                                               : ToneChannels::mcpwmPeriod(frequencyQ16, prescale);
+    if (period.prescale == 0) {
+        prescale = ToneChannels::mcpwmPrescale(frequencyQ16, CLOCK_HEADROOM);
+        period = ToneChannels::mcpwmPeriod(frequencyQ16, prescale);
+        if (period.prescale == 0) return false;
+        mcpwm_ll_timer_set_clock_prescale(device, timer, period.prescale);
+    }
+
+    mcpwm_ll_timer_set_peak(device, timer, period.ticks, false);
+    mcpwm_ll_operator_set_compare_value(device, timer, 0, period.ticks / 2);
+
+    if (restart) {
+        mcpwm_set_duty_type(static_cast<mcpwm_unit_t>(unit), static_cast<mcpwm_timer_t>(timer), MCPWM_OPR_A, MCPWM_DUTY_MODE_0);
+    }
+    return true;
+}
+
+void ESP32_TonePWM::stopChannel(uint8_t instrument)
+{
+    const ToneChannels::Slot& slot = m_slots[instrument];
+    switch (slot.engine) {
+    case Engine::Rmt:
+        rmt_tx_stop(static_cast<rmt_channel_t>(slot.index));
+        break;
+    case Engine::Mcpwm:
+        mcpwm_set_signal_low(static_cast<mcpwm_unit_t>(slot.unit), static_cast<mcpwm_timer_t>(slot.index), MCPWM_OPR_A);
+        break;
+    case Engine::Software:
+        break;
+    }
+    m_activeFrequency[instrument] = 0;
+}
+
+// The voice's note under the active tuning moved by its current modulation, in Hz Q16
+uint32_t ESP32_TonePWM::modulatedFrequency(uint8_t instrument)
+{
+    const uint8_t note = m_activeNotes[instrument] & (~MSB_BITMASK);
+    return NoteTables::scaleByExp2(Tuning::active().frequencies[note], m_hardwareModulation.pitchOffset(instrument));
+}
+
+void ESP32_TonePWM::playNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel)
+{
+    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS || note >= 128) return;
+    if (!isHardware(instrument)) {
+        ESP32_SwPWM::playNote(instrument, note, velocity, channel);
+        return;
+    }
+
+    // Only increment counter if this instrument wasn't already playing a note
+    bool wasActive = (m_activeNotes[instrument] != 0);
+
+    m_activeInstruments.set(instrument);
+    m_activeNotes[instrument] = (MSB_BITMASK | note);
+    m_noteStartTime[instrument] = millis(); // Record when note started for timeout tracking
+    if (!wasActive) {
+        m_numActiveNotes++;
+    }
+
+    // The hardware keeps the waveform running on its own so legato needs nothing extra here.
+    // Glides are measured between microsecond periods, the truncated tick tables would start them off pitch.
+    m_hardwareModulation.startVoice(instrument, channel, Tuning::active().periods[note]);
+    if (!setFrequency(instrument, modulatedFrequency(instrument))) {
+        // Out of the peripheral's range, free the voice so the distributor doesn't count it as sounding
+        stopNote(instrument, note, velocity, channel);
+        return;
+    }
+    if (!isBatching()) publishBatch();
+}
+
+void ESP32_TonePWM::stopNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel)
+{
+    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) return;
+    if (!isHardware(instrument)) {
+        ESP32_SwPWM::stopNote(instrument, note, velocity, channel);
+        return;
+    }
+
+    // Only decrement if there was actually an active note
+    bool wasActive = (m_activeNotes[instrument] != 0);
+
+    m_activeInstruments.reset(instrument);
+    releaseVoiceOwner(instrument); // Clear distributor tracking
+    m_noteStartTime[instrument] = 0;
+    m_activeNotes[instrument] = 0;
+    m_hardwareModulation.stopVoice(instrument);
+    stopChannel(instrument);
+
+    if (wasActive && m_numActiveNotes > 0) {
+        m_numActiveNotes--;
+    }
+    if (!isBatching()) publishBatch();
+}
+
+// The base clears the bookkeeping and silences the tick's voices, the peripherals stop here
+void ESP32_TonePWM::stopAll(){
+    ESP32_SwPWM::stopAll();
+    m_activeInstruments.reset();
+    m_hardwareModulation.reset();
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+        if (isHardware(i)) stopChannel(i);
+    }
+}
+
+bool ESP32_TonePWM::isNoteActive(uint8_t instrument, uint8_t note)
+{
+    //Mask lower 7bits and return true if the instrument is playing the respective note.
+    return ((m_activeNotes[instrument] & 0x7F) == note && m_activeNotes[instrument] != 0);
+}
+
+void ESP32_TonePWM::setPitchBend(uint8_t channel, uint16_t bend){
+    ESP32_SwPWM::setPitchBend(channel, bend);
+    m_hardwareModulation.setPitchBend(channel, bend, m_pitchBendRange[channel]);
+    retuneHardware();
+}
+
+void ESP32_TonePWM::setControlChange(uint8_t channel, uint8_t controller, uint8_t value)
+{
+    ESP32_SwPWM::setControlChange(channel, controller, value);
+    m_hardwareModulation.controlChange(channel, controller, value);
+}
+
+// Moves every modulated hardware voice to its current frequency. One that bends below what
+// its peripheral can count goes quiet and comes back when it is in range again.
+void ESP32_TonePWM::retuneHardware()
+{
+    const auto& voices = m_hardwareModulation.activeVoices();
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+        if (voices.test(i)) setFrequency(i, modulatedFrequency(i));
+    }
+}
+
+void ESP32_TonePWM::periodic()
+{
+    if (m_hardwareModulation.update(micros())) retuneHardware();
+    ESP32_SwPWM::periodic();
+}
+
+#endif // PLATFORM_ESP32 && CFG_INSTRUMENT_TONEPWM && CFG_COMPONENT_PWM
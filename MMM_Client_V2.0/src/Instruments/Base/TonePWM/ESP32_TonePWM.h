@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Constants.h"
+#include "Config.h"
+#include "Instruments/Base/SwPWM/ESP32_SwPWM.h"
+#include "Instruments/Components/Modulation.h"
+#include "Instruments/Components/ToneChannels.h"
+#include <array>
+#include <cstdint>
+
+#ifndef INSTRUMENT_TYPE
+    #define INSTRUMENT_TYPE ESP32_TonePWM
+#endif
+
+/**
+ * Square waves from the ESP32's RMT and MCPWM peripherals, one voice per RMT channel or MCPWM
+ * timer. Periods are set in peripheral clock cycles so pitch is exact to a fraction of a cent
+ * and nothing runs on the CPU between note changes.
+ *
+ * Voices are assigned at build time, RMT channels first (CFG_TONEPWM_RMT_CHANNELS), then MCPWM
+ * timers (CFG_TONEPWM_MCPWM_TIMERS). Voices past those are played by the SwPWM tick this
+ * inherits, which is only started when a voice needs it. The tick is handed half periods so
+ * those voices sound at the same pitch as the peripherals.
+ */
+class ESP32_TonePWM : public ESP32_SwPWM {
+public:
+    static constexpr Instrument Type = Instrument::HW_PWM;
+private:
+    //Peripheral behind each voice, fixed at build time
+    static const std::array<ToneChannels::Slot, HardwareConfig::MAX_NUM_INSTRUMENTS> m_slots;
+
+    //Frequency each hardware voice is set to in Hz Q16, 0 is stopped
+    static std::array<uint32_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_activeFrequency;
+    //Clock division chosen when the voice started, bends inside its headroom only move the period
+    static std::array<uint16_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_clockDivider;
+
+    //Vibrato, pitch bend and glide of the hardware voices, the tick's voices use the base engine
+    static ModulationEngine m_hardwareModulation;
+
+    static bool isHardware(uint8_t instrument) { return m_slots[instrument].engine != ToneChannels::Engine::Software; }
+
+    void initializeRmt(uint8_t instrument, uint8_t pin);
+    void initializeMcpwm(uint8_t instrument, uint8_t pin);
+    static bool setFrequency(uint8_t instrument, uint32_t frequencyQ16);
+    static bool writeRmt(uint8_t channel, uint32_t frequencyQ16, uint16_t& divider, bool restart);
+    static bool writeMcpwm(uint8_t unit, uint8_t timer, uint32_t frequencyQ16, uint16_t& prescale, bool restart);
+    static void stopChannel(uint8_t instrument);
+    static uint32_t modulatedFrequency(uint8_t instrument);
+    static void retuneHardware();
+
+    //Room left below a note's start for bends before the clock division is changed, two octaves
+    static constexpr uint8_t CLOCK_HEADROOM = 4;
+
+public:
+    ESP32_TonePWM();
+    void playNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) override;
+    void stopNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) override;
+    void stopAll() override;
+
+    void setPitchBend(uint8_t channel, uint16_t value) override;
+    void setControlChange(uint8_t channel, uint8_t controller, uint8_t value) override;
+
+    Instrument getInstrumentType() const override { return Instrument::HW_PWM; }
+    bool isNoteActive(uint8_t instrument, uint8_t note) override;
+
+    void periodic() override;
+};
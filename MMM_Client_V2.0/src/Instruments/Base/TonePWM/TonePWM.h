@@ -0,0 +1,13 @@
+#pragma once
+
+#ifndef INSTRUMENT_TYPE
+    #define INSTRUMENT_TYPE TonePWM
+#endif
+
+// Platform-specific includes, only the ESP32 has the RMT and MCPWM peripherals
+#if defined(PLATFORM_ESP32) || defined(ARDUINO_ARCH_ESP32)
+    #include "Instruments/Base/TonePWM/ESP32_TonePWM.h"
+    #define TonePWM ESP32_TonePWM
+#else
+    #error "CFG_INSTRUMENT_TONEPWM needs an ESP32, use CFG_INSTRUMENT_HWPWM on other boards"
+#endif
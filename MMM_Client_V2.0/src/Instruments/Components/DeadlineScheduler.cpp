@@ -0,0 +1,70 @@
+#include "DeadlineScheduler.h"
+
+static_assert(HardwareConfig::MAX_NUM_INSTRUMENTS < NONE, "Deadline heap index is 8 bits");
+
+void DeadlineScheduler::place(uint8_t index, uint8_t voice) {
+    m_heap[index] = voice;
+    m_position[voice] = index;
+}
+
+void DeadlineScheduler::siftUp(uint8_t index) {
+    const uint8_t voice = m_heap[index];
+    while (index > 0) {
+        uint8_t parent = (index - 1) / 2;
+        if (!before(voice, m_heap[parent])) break;
+        place(index, m_heap[parent]);
+        index = parent;
+    }
+    place(index, voice);
+}
+
+void DeadlineScheduler::siftDown(uint8_t index) {
+    const uint8_t voice = m_heap[index];
+    while (true) {
+        uint16_t child = 2 * index + 1;
+        if (child >= m_size) break;
+        if (child + 1 < m_size && before(m_heap[child + 1], m_heap[child])) child++;
+        if (!before(m_heap[child], voice)) break;
+        place(index, m_heap[child]);
+        index = child;
+    }
+    place(index, voice);
+}
+
+void DeadlineScheduler::set(uint8_t voice, uint32_t deadlineUs) {
+    if (voice >= HardwareConfig::MAX_NUM_INSTRUMENTS) return;
+    m_deadline[voice] = deadlineUs;
+
+    if (!contains(voice)) {
+        place(m_size++, voice);
+        siftUp(m_position[voice]);
+        return;
+    }
+    // Moved either way, only one of these does anything
+    siftUp(m_position[voice]);
+    siftDown(m_position[voice]);
+}
+
+void DeadlineScheduler::remove(uint8_t voice) {
+    if (voice >= HardwareConfig::MAX_NUM_INSTRUMENTS || !contains(voice)) return;
+    const uint8_t index = m_position[voice];
+    m_position[voice] = NONE;
+
+    const uint8_t last = m_heap[--m_size];
+    if (index == m_size) return;
+
+    // Fill the hole with the last voice and restore the order around it
+    place(index, last);
+    siftUp(index);
+    siftDown(m_position[last]);
+}
+
+void DeadlineScheduler::clear() {
+    for (uint8_t i = 0; i < m_size; i++) m_position[m_heap[i]] = NONE;
+    m_size = 0;
+}
+
+void DeadlineScheduler::rescheduleTop(uint32_t deadlineUs) {
+    m_deadline[m_heap[0]] = deadlineUs;
+    siftDown(0);
+}
@@ -0,0 +1,43 @@
+/*
+ * DeadlineScheduler.h
+ * Fixed size min-heap of the next output edge of each voice
+ */
+#pragma once
+
+#include "Config.h"
+#include "Constants.h"
+#include <array>
+#include <cstdint>
+
+class DeadlineScheduler {
+public:
+    // Adds the voice or moves its deadline if it is already scheduled
+    void set(uint8_t voice, uint32_t deadlineUs);
+    void remove(uint8_t voice);
+    void clear();
+
+    bool empty() const { return m_size == 0; }
+    bool contains(uint8_t voice) const { return m_position[voice] != NONE; }
+
+    // Voice with the earliest deadline and that deadline
+    uint8_t top() const { return m_heap[0]; }
+    uint32_t topDeadline() const { return m_deadline[m_heap[0]]; }
+    // Moves the earliest voice to a later deadline, cheaper than set() for the voice just served
+    void rescheduleTop(uint32_t deadlineUs);
+
+private:
+    // Wrap safe ordering of micros() times
+    bool before(uint8_t a, uint8_t b) const { return static_cast<int32_t>(m_deadline[a] - m_deadline[b]) < 0; }
+    void place(uint8_t index, uint8_t voice);
+    void siftUp(uint8_t index);
+    void siftDown(uint8_t index);
+
+    std::array<uint32_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_deadline = {};
+    std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_heap = {};     // Voices in heap order
+    std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_position = []{  // Heap index of each voice, NONE if unscheduled
+        std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> position{};
+        position.fill(NONE);
+        return position;
+    }();
+    uint8_t m_size = 0;
+};
@@ -0,0 +1,75 @@
+#include "EventTimer.h"
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(PLATFORM_TEENSY41)
+#include <Arduino.h>
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "esp_spi_flash.h"
+#elif defined(PLATFORM_TEENSY41)
+#include <IntervalTimer.h>
+#endif
+
+// Set by the interrupt, cleared by takeExpired()
+static volatile bool s_expired = false;
+static void (* volatile s_handler)() = nullptr;
+
+#ifdef ARDUINO_ARCH_ESP32
+static hw_timer_t* s_hw_timer = nullptr;
+// IRAM keeps the interrupt running while flash is busy. The handler lives in flash, so it
+// is skipped then and the main loop serves the flag.
+void IRAM_ATTR EventTimer_trampoline() {
+    s_expired = true;
+    if (s_handler != nullptr && spi_flash_cache_enabled()) s_handler();
+}
+#elif defined(PLATFORM_TEENSY41)
+static IntervalTimer s_intervalTimer;
+void EventTimer_trampoline() {
+    // IntervalTimer only runs periodically, stopping it on the first expiry makes it one-shot
+    s_intervalTimer.end();
+    s_expired = true;
+    if (s_handler != nullptr) s_handler();
+}
+#endif
+
+void EventTimer::initialize() {
+#ifdef ARDUINO_ARCH_ESP32
+    // Timer 0 belongs to InterruptTimer
+    if (s_hw_timer == nullptr) {
+        s_hw_timer = timerBegin(1, 80, true);
+        timerAttachInterrupt(s_hw_timer, EventTimer_trampoline, true);
+    }
+#endif
+}
+
+void EventTimer::schedule(uint32_t microseconds) {
+#ifdef ARDUINO_ARCH_ESP32
+    // ESP32 limited to ~8us interrupts
+    if (microseconds < 8) {
+        microseconds = 8;
+    }
+
+    timerAlarmDisable(s_hw_timer);
+    timerWrite(s_hw_timer, 0);
+    timerAlarmWrite(s_hw_timer, microseconds, false);
+    timerAlarmEnable(s_hw_timer);
+
+#elif defined(PLATFORM_TEENSY41)
+    if (microseconds == 0) {
+        microseconds = 1;
+    }
+
+    s_intervalTimer.end();
+    s_intervalTimer.begin(EventTimer_trampoline, microseconds);
+#endif
+}
+
+void EventTimer::setHandler(void (*handler)()) {
+    s_handler = handler;
+}
+
+bool EventTimer::takeExpired() {
+    if (!s_expired) return false;
+    s_expired = false;
+    return true;
+}
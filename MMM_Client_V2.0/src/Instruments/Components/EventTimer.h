@@ -0,0 +1,23 @@
+/*
+ * EventTimer.h
+ * One-shot hardware timer used to flag the main loop, or run a handler, at a precise time
+ */
+#pragma once
+
+#include "Config.h"
+#include <cstdint>
+
+namespace EventTimer {
+    // Claim the timer hardware. Uses a different timer than InterruptTimer so both can run together.
+    void initialize();
+
+    // Raise the expired flag once after the delay, replacing any expiry already armed
+    void schedule(uint32_t microseconds);
+
+    // Called from the interrupt right after it raises the flag, nullptr for none. A handler which
+    // can't do the work yet leaves the flag raised for the main loop.
+    void setHandler(void (*handler)());
+
+    // Returns True once after the timer expires
+    bool takeExpired();
+};
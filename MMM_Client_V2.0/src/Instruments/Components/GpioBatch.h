@@ -0,0 +1,127 @@
+/*
+ * GpioBatch.h
+ * Collects the output changes of one ISR pass and writes each GPIO bank once
+ */
+#pragma once
+
+#include "Config.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(PLATFORM_ESP32)
+    #include "soc/gpio_reg.h"
+#elif defined(PLATFORM_TEENSY41)
+    #include <Arduino.h>
+#endif
+
+namespace Gpio {
+    // The bank whose set and clear registers drive a pin, and the pin's bit in them
+    struct PinBit {
+        uint8_t bank;
+        uint32_t mask;
+    };
+
+#if defined(PLATFORM_ESP32)
+    // GPIO 0-31 are driven by OUT_W1TS/W1TC and 32-39 by OUT1_W1TS/W1TC
+    constexpr uint8_t NUM_BANKS = 2;
+    constexpr uint8_t NUM_PINS = 40;
+
+    constexpr PinBit pinBit(uint8_t pin) {
+        return {static_cast<uint8_t>(pin / 32), static_cast<uint32_t>(1UL << (pin % 32))};
+    }
+
+#elif defined(PLATFORM_TEENSY41)
+    // Digital pins 0-54 as {bank, bit}, the startup code routes them to the fast GPIO6-9 banks.
+    // Bank 0 is GPIO6 through bank 3 GPIO9.
+    constexpr uint8_t NUM_BANKS = 4;
+    constexpr std::array<std::array<uint8_t, 2>, 55> TEENSY41_PINS = {{
+        {0, 3},  {0, 2},  {3, 4},  {3, 5},  {3, 6},  {3, 8},  {1, 10}, {1, 17}, //0-7
+        {1, 16}, {1, 11}, {1, 0},  {1, 2},  {1, 1},  {1, 3},  {0, 18}, {0, 19}, //8-15
+        {0, 23}, {0, 22}, {0, 17}, {0, 16}, {0, 26}, {0, 27}, {0, 24}, {0, 25}, //16-23
+        {0, 12}, {0, 13}, {0, 30}, {0, 31}, {2, 18}, {3, 31}, {2, 23}, {2, 22}, //24-31
+        {1, 12}, {3, 7},  {1, 29}, {1, 28}, {1, 18}, {1, 19}, {0, 28}, {0, 29}, //32-39
+        {0, 20}, {0, 21}, {2, 15}, {2, 14}, {2, 13}, {2, 12}, {2, 17}, {2, 16}, //40-47
+        {3, 24}, {3, 27}, {3, 28}, {3, 22}, {3, 26}, {3, 25}, {3, 29}           //48-54
+    }};
+    constexpr uint8_t NUM_PINS = TEENSY41_PINS.size();
+
+    constexpr PinBit pinBit(uint8_t pin) {
+        return {TEENSY41_PINS[pin][0], static_cast<uint32_t>(1UL << TEENSY41_PINS[pin][1])};
+    }
+
+    // Cross check the bits against the core's own pin definitions when building for the board
+    #ifdef CORE_PIN54_BIT
+    namespace Detail {
+        constexpr uint8_t CORE_BITS[] = {
+            CORE_PIN0_BIT,  CORE_PIN1_BIT,  CORE_PIN2_BIT,  CORE_PIN3_BIT,  CORE_PIN4_BIT,  CORE_PIN5_BIT,
+            CORE_PIN6_BIT,  CORE_PIN7_BIT,  CORE_PIN8_BIT,  CORE_PIN9_BIT,  CORE_PIN10_BIT, CORE_PIN11_BIT,
+            CORE_PIN12_BIT, CORE_PIN13_BIT, CORE_PIN14_BIT, CORE_PIN15_BIT, CORE_PIN16_BIT, CORE_PIN17_BIT,
+            CORE_PIN18_BIT, CORE_PIN19_BIT, CORE_PIN20_BIT, CORE_PIN21_BIT, CORE_PIN22_BIT, CORE_PIN23_BIT,
+            CORE_PIN24_BIT, CORE_PIN25_BIT, CORE_PIN26_BIT, CORE_PIN27_BIT, CORE_PIN28_BIT, CORE_PIN29_BIT,
+            CORE_PIN30_BIT, CORE_PIN31_BIT, CORE_PIN32_BIT, CORE_PIN33_BIT, CORE_PIN34_BIT, CORE_PIN35_BIT,
+            CORE_PIN36_BIT, CORE_PIN37_BIT, CORE_PIN38_BIT, CORE_PIN39_BIT, CORE_PIN40_BIT, CORE_PIN41_BIT,
+            CORE_PIN42_BIT, CORE_PIN43_BIT, CORE_PIN44_BIT, CORE_PIN45_BIT, CORE_PIN46_BIT, CORE_PIN47_BIT,
+            CORE_PIN48_BIT, CORE_PIN49_BIT, CORE_PIN50_BIT, CORE_PIN51_BIT, CORE_PIN52_BIT, CORE_PIN53_BIT,
+            CORE_PIN54_BIT
+        };
+        constexpr bool matchesCore() {
+            for (uint8_t pin = 0; pin < NUM_PINS; ++pin) {
+                if (TEENSY41_PINS[pin][1] != CORE_BITS[pin]) return false;
+            }
+            return true;
+        }
+    }
+    static_assert(Detail::matchesCore(), "Teensy 4.1 GPIO bits disagree with the core's pin definitions");
+    #endif
+#endif
+
+    // Bank and bit of every pin in a list, resolved at compile time
+    template <size_t N>
+    constexpr std::array<PinBit, N> mapPins(const uint8_t (&pins)[N]) {
+        std::array<PinBit, N> bits{};
+        for (size_t i = 0; i < N; ++i) bits[i] = pinBit(pins[i]);
+        return bits;
+    }
+
+    template <size_t N>
+    constexpr bool pinsValid(const uint8_t (&pins)[N]) {
+        for (size_t i = 0; i < N; ++i) {
+            if (pins[i] >= NUM_PINS) return false;
+        }
+        return true;
+    }
+};
+
+// Pins written during a pass land in the set or clear mask of their bank. commit() then
+// drives them all with one write per register, so edges due on the same tick leave together.
+class GpioBatch {
+public:
+    void write(const Gpio::PinBit& bit, bool high) {
+        if (high) {
+            m_set[bit.bank] |= bit.mask;
+        } else {
+            m_clear[bit.bank] |= bit.mask;
+        }
+    }
+
+    void commit() {
+    #if defined(PLATFORM_ESP32)
+        if (m_set[0]) REG_WRITE(GPIO_OUT_W1TS_REG, m_set[0]);
+        if (m_clear[0]) REG_WRITE(GPIO_OUT_W1TC_REG, m_clear[0]);
+        if (m_set[1]) REG_WRITE(GPIO_OUT1_W1TS_REG, m_set[1]);
+        if (m_clear[1]) REG_WRITE(GPIO_OUT1_W1TC_REG, m_clear[1]);
+    #elif defined(PLATFORM_TEENSY41)
+        volatile uint32_t* const setRegisters[Gpio::NUM_BANKS] = {&GPIO6_DR_SET, &GPIO7_DR_SET, &GPIO8_DR_SET, &GPIO9_DR_SET};
+        volatile uint32_t* const clearRegisters[Gpio::NUM_BANKS] = {&GPIO6_DR_CLEAR, &GPIO7_DR_CLEAR, &GPIO8_DR_CLEAR, &GPIO9_DR_CLEAR};
+        for (uint8_t bank = 0; bank < Gpio::NUM_BANKS; ++bank) {
+            if (m_set[bank]) *setRegisters[bank] = m_set[bank];
+            if (m_clear[bank]) *clearRegisters[bank] = m_clear[bank];
+        }
+    #endif
+    }
+
+private:
+    std::array<uint32_t, Gpio::NUM_BANKS> m_set = {};
+    std::array<uint32_t, Gpio::NUM_BANKS> m_clear = {};
+};
@@ -22,6 +22,14 @@ static hw_timer_t* s_hw_timer = nullptr;
 void IRAM_ATTR InterruptTimer_trampoline() {
     if (s_callback) s_callback();
 }
+#elif defined(PLATFORM_TEENSY41)
+static IntervalTimer s_intervalTimer;
+static bool s_oneShot = false;
+void InterruptTimer_trampoline() {
+    // IntervalTimer only runs periodically, stopping it on the first expiry makes it one-shot
+    if (s_oneShot) s_intervalTimer.end();
+    if (s_callback) s_callback();
+}
 #else
 // AVR trampoline
 void InterruptTimer_trampoline() {
@@ -54,8 +62,8 @@ void InterruptTimer::initialize(uint32_t microseconds, void (*isr)()) {
 
 #elif defined(PLATFORM_TEENSY41)
     // Teensy IntervalTimer uses microseconds directly
-    static IntervalTimer s_intervalTimer;
     // If already attached, end it first
+    s_oneShot = false;
     s_intervalTimer.end();
     s_intervalTimer.begin(InterruptTimer_trampoline, microseconds);
 #endif
@@ -63,4 +71,41 @@ void InterruptTimer::initialize(uint32_t microseconds, void (*isr)()) {
 
 void InterruptTimer::setCallback(void (*isr)()) {
     s_callback = isr;
-}
\ No newline at end of file
+}
+
+void InterruptTimer::initializeOneShot(void (*isr)()) {
+    s_callback = isr;
+
+#ifdef ARDUINO_ARCH_ESP32
+    if (s_hw_timer == nullptr) {
+        s_hw_timer = timerBegin(0, 80, true);
+        timerAttachInterrupt(s_hw_timer, InterruptTimer_trampoline, true);
+    }
+    timerAlarmDisable(s_hw_timer);
+#elif defined(PLATFORM_TEENSY41)
+    s_oneShot = true;
+    s_intervalTimer.end();
+#endif
+}
+
+void InterruptTimer::scheduleOnce(uint32_t microseconds) {
+#ifdef ARDUINO_ARCH_ESP32
+    // ESP32 limited to ~8us interrupts
+    if (microseconds < 8) {
+        microseconds = 8;
+    }
+
+    timerAlarmDisable(s_hw_timer);
+    timerWrite(s_hw_timer, 0);
+    timerAlarmWrite(s_hw_timer, microseconds, false);
+    timerAlarmEnable(s_hw_timer);
+
+#elif defined(PLATFORM_TEENSY41)
+    if (microseconds == 0) {
+        microseconds = 1;
+    }
+
+    s_intervalTimer.end();
+    s_intervalTimer.begin(InterruptTimer_trampoline, microseconds);
+#endif
+}
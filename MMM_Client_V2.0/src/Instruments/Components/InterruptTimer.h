@@ -18,4 +18,12 @@ namespace InterruptTimer {
 
     // Replace the currently registered periodic callback.
     void setCallback(void (*isr)());
+
+    // Use the timer one-shot instead, for engines that sleep until their next
+    // event. The callback runs once per scheduleOnce().
+    void initializeOneShot(void (*isr)());
+
+    // Run the callback once after the delay, replacing any expiry already armed.
+    // Safe to call from within the callback to arm the next event.
+    void scheduleOnce(uint32_t microseconds);
 };
\ No newline at end of file
@@ -0,0 +1,129 @@
+/*
+ * IsrProfiler.h
+ * Cycle counts of an interrupt handler, grouped by the number of voices it served
+ */
+#pragma once
+
+#include "Config.h"
+#include "Constants.h"
+#include <Arduino.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+class IsrProfiler {
+public:
+    // Free running CPU cycle counter. Teensy's startup code enables the DWT counter.
+    static inline __attribute__((always_inline)) uint32_t cycles() {
+    #if defined(PLATFORM_ESP32)
+        return ESP.getCycleCount();
+    #elif defined(PLATFORM_TEENSY41)
+        return ARM_DWT_CYCCNT;
+    #else
+        return 0;
+    #endif
+    }
+
+    static uint32_t cyclesPerUs() {
+    #if defined(PLATFORM_ESP32)
+        return ESP.getCpuFreqMHz();
+    #elif defined(PLATFORM_TEENSY41)
+        return F_CPU_ACTUAL / 1000000;
+    #else
+        return 1;
+    #endif
+    }
+
+    // Period the timer is programmed for, entries are binned by how far they stray from it
+    void setNominalInterval(uint32_t microseconds) {
+        m_cyclesPerUs = cyclesPerUs();
+        m_nominalCycles = microseconds * m_cyclesPerUs;
+        m_lastEntry = 0;
+    }
+
+    // Called first thing in a periodic interrupt with its cycles() reading
+    inline __attribute__((always_inline)) void recordEntry(uint32_t now) {
+        const uint32_t last = m_lastEntry;
+        m_lastEntry = now;
+        if (last == 0 || m_nominalCycles == 0) return;
+
+        const uint32_t interval = now - last;
+        const uint32_t deviation = (interval > m_nominalCycles) ? interval - m_nominalCycles : m_nominalCycles - interval;
+        const uint32_t bin = deviation / m_cyclesPerUs;
+        beginWrite();
+        m_jitter.bins[(bin < IsrJitter::NUM_BINS) ? bin : IsrJitter::NUM_BINS - 1]++;
+        endWrite();
+    }
+
+    // Called from the interrupt, inlined so nothing runs from flash
+    inline __attribute__((always_inline)) void record(uint8_t voices, uint32_t cycles) {
+        if (voices > HardwareConfig::MAX_NUM_INSTRUMENTS) return;
+        Bucket& bucket = m_buckets[voices];
+        beginWrite();
+        if (bucket.samples == 0 || cycles < bucket.minCycles) bucket.minCycles = cycles;
+        if (cycles > bucket.maxCycles) bucket.maxCycles = cycles;
+        bucket.totalCycles += cycles;
+        bucket.samples++;
+        endWrite();
+    }
+
+    // Safe from any core or task, the copy is retried if the interrupt wrote during it
+    IsrProfile get(uint8_t voices) const {
+        IsrProfile profile;
+        if (voices > HardwareConfig::MAX_NUM_INSTRUMENTS) return profile;
+        Bucket bucket;
+        read([&] { bucket = m_buckets[voices]; });
+        if (bucket.samples == 0) return profile;
+        profile.samples = bucket.samples;
+        profile.minCycles = bucket.minCycles;
+        profile.meanCycles = static_cast<uint32_t>(bucket.totalCycles / bucket.samples);
+        profile.maxCycles = bucket.maxCycles;
+        return profile;
+    }
+
+    // Safe from any core or task, the copy is retried if the interrupt wrote during it
+    IsrJitter jitter() const {
+        IsrJitter copy;
+        read([&] { copy = m_jitter; });
+        return copy;
+    }
+
+private:
+    // Sequence lock, odd while the interrupt is writing. Masking interrupts only holds off the
+    // calling core, so a reader on the other core checks the count instead and copies again.
+    inline __attribute__((always_inline)) void beginWrite() {
+        m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    inline __attribute__((always_inline)) void endWrite() {
+        m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    template <typename Copy>
+    void read(Copy copy) const {
+        uint32_t before;
+        uint32_t after;
+        do {
+            before = m_sequence.load(std::memory_order_acquire);
+            copy();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+    }
+
+    struct Bucket {
+        uint32_t samples = 0;
+        uint32_t minCycles = 0;
+        uint32_t maxCycles = 0;
+        uint64_t totalCycles = 0;
+    };
+    // Index is the number of voices sounding during the call, 0 is the idle cost
+    std::array<Bucket, HardwareConfig::MAX_NUM_INSTRUMENTS + 1> m_buckets = {};
+
+    IsrJitter m_jitter = {};
+    uint32_t m_nominalCycles = 0; // 0 until setNominalInterval(), one-shot timers have no period
+    uint32_t m_cyclesPerUs = 1;
+    uint32_t m_lastEntry = 0;
+    std::atomic<uint32_t> m_sequence{0};
+};
@@ -0,0 +1,53 @@
+#include "LatencyScheduler.h"
+
+static_assert(CFG_LATENCY_QUEUE_SIZE <= 255, "Latency queue index is 8 bits");
+
+bool LatencyScheduler::before(const Event& a, const Event& b) {
+    int32_t time = static_cast<int32_t>(a.fireAtUs - b.fireAtUs);
+    if (time != 0) return time < 0;
+    return static_cast<int16_t>(a.sequence - b.sequence) < 0;
+}
+
+bool LatencyScheduler::push(Event event) {
+    if (m_size >= m_heap.size()) return false;
+    event.sequence = m_nextSequence++;
+
+    // Sift up
+    uint8_t index = m_size++;
+    while (index > 0) {
+        uint8_t parent = (index - 1) / 2;
+        if (!before(event, m_heap[parent])) break;
+        m_heap[index] = m_heap[parent];
+        index = parent;
+    }
+    m_heap[index] = event;
+    return true;
+}
+
+void LatencyScheduler::pop() {
+    if (m_size == 0) return;
+    const Event last = m_heap[--m_size];
+
+    // Sift the last event down from the root
+    uint8_t index = 0;
+    while (true) {
+        uint16_t child = 2 * index + 1;
+        if (child >= m_size) break;
+        if (child + 1 < m_size && before(m_heap[child + 1], m_heap[child])) child++;
+        if (!before(m_heap[child], last)) break;
+        m_heap[index] = m_heap[child];
+        index = child;
+    }
+    m_heap[index] = last;
+}
+
+const LatencyScheduler::Event* LatencyScheduler::findLatest(uint8_t instrument, uint8_t note) const {
+    const Event* latest = nullptr;
+    for (uint8_t i = 0; i < m_size; i++) {
+        const Event& event = m_heap[i];
+        if (event.instrument != instrument) continue;
+        if (note != NONE && event.note != note) continue;
+        if (latest == nullptr || before(*latest, event)) latest = &event;
+    }
+    return latest;
+}
@@ -0,0 +1,43 @@
+/*
+ * LatencyScheduler.h
+ * Fixed size min-heap of note changes waiting for their output time
+ */
+#pragma once
+
+#include "Config.h"
+#include "Constants.h"
+#include <array>
+#include <cstdint>
+
+class LatencyScheduler {
+public:
+    struct Event {
+        uint32_t fireAtUs;  // micros() time the output changes
+        uint16_t sequence;  // Keeps events due at the same time in the order they were scheduled
+        uint8_t instrument;
+        uint8_t note;
+        uint8_t velocity;
+        uint8_t channel;
+        uint8_t claim;      // Voice claim count of the instrument when scheduled
+        bool noteOn;
+    };
+
+    // Adds an event, returns False if the queue is full
+    bool push(Event event);
+    void pop();
+    void clear() { m_size = 0; }
+
+    bool empty() const { return m_size == 0; }
+    const Event& top() const { return m_heap[0]; }
+
+    // Most recently scheduled event for the instrument and note (NONE matches any note), nullptr if none
+    const Event* findLatest(uint8_t instrument, uint8_t note) const;
+
+private:
+    // Wrap safe ordering on time then sequence
+    static bool before(const Event& a, const Event& b);
+
+    std::array<Event, CFG_LATENCY_QUEUE_SIZE> m_heap;
+    uint8_t m_size = 0;
+    uint16_t m_nextSequence = 0;
+};
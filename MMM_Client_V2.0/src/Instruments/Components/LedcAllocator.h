@@ -0,0 +1,270 @@
+/*
+ * LedcAllocator.h
+ * Shares the ESP32's LEDC timers between voices and works out their clock dividers
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// The LEDC has two speed modes, each with 4 timers and 8 channels. A channel drives one pin at
+// the frequency of the timer it is bound to, so voices playing the same frequency can share a
+// timer and 16 voices fit in 16 channels. There are only 8 timers, so only 8 different
+// frequencies can sound at once.
+//
+// Frequencies are Hz in Q16 like Tuning::Tables::frequencies, all math is integer.
+namespace Ledc {
+    constexpr uint8_t NUM_MODES = 2;
+    constexpr uint8_t TIMERS_PER_MODE = 4;
+    constexpr uint8_t CHANNELS_PER_MODE = 8;
+    constexpr uint8_t NONE = 0xFF;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Timer clock, 80MHz APB through a divider with 8 fractional bits, then 2^resolution counts
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+
+    constexpr uint32_t CLOCK_HZ = 80000000;
+    constexpr uint32_t MIN_DIVIDER = 1 << 8;          //1.0
+    constexpr uint32_t MAX_DIVIDER = (1 << 18) - 1;   //1023.996
+    constexpr uint8_t MAX_RESOLUTION = 20;
+
+    struct TimerSetting {
+        uint32_t divider;    //Q10.8, 0 if the frequency is out of range
+        uint8_t resolution;  //Counter bits, the channel duty for a square wave is half of 2^resolution
+    };
+
+    // Divider for a frequency at a resolution, 0 if it doesn't fit the register
+    constexpr uint32_t divider(uint32_t frequencyQ16, uint8_t resolution) {
+        if (frequencyQ16 == 0 || resolution == 0 || resolution > MAX_RESOLUTION) return 0;
+        const uint64_t scaled = static_cast<uint64_t>(frequencyQ16) << resolution;
+        const uint64_t value = ((static_cast<uint64_t>(CLOCK_HZ) << 24) + scaled / 2) / scaled;
+        return (value < MIN_DIVIDER || value > MAX_DIVIDER) ? 0 : static_cast<uint32_t>(value);
+    }
+
+    // Resolution leaving the divider near 2^13, a step of 0.2 cents with five octaves either side
+    // before the resolution has to change
+    constexpr TimerSetting timerSetting(uint32_t frequencyQ16) {
+        if (frequencyQ16 == 0) return {0, 0};
+        const uint64_t unscaled = ((static_cast<uint64_t>(CLOCK_HZ) << 24) + frequencyQ16 / 2) / frequencyQ16;
+        uint8_t resolution = 1;
+        while (resolution < MAX_RESOLUTION && (unscaled >> resolution) >= (1 << 14)) resolution++;
+        return {divider(frequencyQ16, resolution), resolution};
+    }
+
+    constexpr uint32_t frequencyQ16(const TimerSetting& setting) {
+        const uint64_t counts = static_cast<uint64_t>(setting.divider) << setting.resolution;
+        return (counts == 0) ? 0 : static_cast<uint32_t>(((static_cast<uint64_t>(CLOCK_HZ) << 24) + counts / 2) / counts);
+    }
+}
+
+// Decides which timer and channel each voice uses, the instrument programs the LEDC from it.
+// A timer keeps the frequency most of its voices ask for, the rest move to a timer already at
+// their frequency or a free one. A sounding voice that finds neither stays on its timer, a new
+// note that finds neither is left unplaced and the instrument drops it.
+template <uint8_t N>
+class LedcAllocator {
+    static_assert(N <= Ledc::NUM_MODES * Ledc::CHANNELS_PER_MODE, "The LEDC has 16 channels");
+
+public:
+    struct Binding {
+        uint8_t mode = Ledc::NONE;
+        uint8_t channel = Ledc::NONE;
+        uint8_t timer = Ledc::NONE;
+        bool placed() const { return channel != Ledc::NONE; }
+    };
+
+    struct Timer {
+        uint32_t frequencyQ16 = 0;
+        uint8_t users = 0;
+    };
+
+    // Assigns every voice to the frequency it asks for, 0 silences it. Voices keep their
+    // channel and timer wherever they can so running waveforms aren't disturbed.
+    void plan(const std::array<uint32_t, N>& targets) {
+        for (uint8_t voice = 0; voice < N; voice++) {
+            if (targets[voice] == 0 && m_voices[voice].placed()) unbind(voice);
+        }
+
+        std::array<bool, N> dissenting = {};
+        for (uint8_t mode = 0; mode < Ledc::NUM_MODES; mode++) {
+            for (uint8_t timer = 0; timer < Ledc::TIMERS_PER_MODE; timer++) {
+                if (m_timers[mode][timer].users > 0) settleTimer(mode, timer, targets, dissenting);
+            }
+        }
+
+        mergeTimers();
+
+        for (uint8_t voice = 0; voice < N; voice++) {
+            if (targets[voice] == 0) continue;
+            if (!m_voices[voice].placed() || dissenting[voice]) place(voice, targets[voice]);
+        }
+    }
+
+    const Binding& binding(uint8_t voice) const { return m_voices[voice]; }
+    const Timer& timer(uint8_t mode, uint8_t timer) const { return m_timers[mode][timer]; }
+
+    void reset() {
+        m_voices = {};
+        m_timers = {};
+        m_channelVoice = {};
+        for (auto& channels : m_channelVoice) channels.fill(Ledc::NONE);
+    }
+
+    LedcAllocator() { reset(); }
+
+private:
+    std::array<Binding, N> m_voices = {};
+    std::array<std::array<Timer, Ledc::TIMERS_PER_MODE>, Ledc::NUM_MODES> m_timers = {};
+    std::array<std::array<uint8_t, Ledc::CHANNELS_PER_MODE>, Ledc::NUM_MODES> m_channelVoice = {};
+
+    void unbind(uint8_t voice) {
+        Binding& binding = m_voices[voice];
+        m_timers[binding.mode][binding.timer].users--;
+        m_channelVoice[binding.mode][binding.channel] = Ledc::NONE;
+        binding = {};
+    }
+
+    // The timer takes the frequency most of its voices want, ties go to the lowest voice
+    void settleTimer(uint8_t mode, uint8_t timer, const std::array<uint32_t, N>& targets, std::array<bool, N>& dissenting) {
+        uint32_t best = 0;
+        uint8_t bestCount = 0;
+        for (uint8_t voice = 0; voice < N; voice++) {
+            if (!onTimer(voice, mode, timer)) continue;
+            uint8_t count = 0;
+            for (uint8_t other = 0; other < N; other++) {
+                if (onTimer(other, mode, timer) && targets[other] == targets[voice]) count++;
+            }
+            if (count > bestCount) {
+                best = targets[voice];
+                bestCount = count;
+            }
+        }
+        m_timers[mode][timer].frequencyQ16 = best;
+        for (uint8_t voice = 0; voice < N; voice++) {
+            if (onTimer(voice, mode, timer) && targets[voice] != best) dissenting[voice] = true;
+        }
+    }
+
+    // Voices bent onto a frequency another timer already plays join that timer, freeing theirs
+    void mergeTimers() {
+        for (uint8_t mode = 0; mode < Ledc::NUM_MODES; mode++) {
+            for (uint8_t from = 1; from < Ledc::TIMERS_PER_MODE; from++) {
+                Timer& source = m_timers[mode][from];
+                if (source.users == 0) continue;
+                for (uint8_t into = 0; into < from; into++) {
+                    Timer& target = m_timers[mode][into];
+                    if (target.users == 0 || target.frequencyQ16 != source.frequencyQ16) continue;
+                    for (Binding& binding : m_voices) {
+                        if (binding.placed() && binding.mode == mode && binding.timer == from) binding.timer = into;
+                    }
+                    target.users += source.users;
+                    source.users = 0;
+                    break;
+                }
+            }
+        }
+    }
+
+    // The same across modes costs each moved voice a new channel and a pin reroute, so it is
+    // only done when a voice is left without a timer. Returns true if a timer was freed.
+    bool mergeAcrossModes() {
+        for (uint8_t mode = 0; mode < Ledc::NUM_MODES; mode++) {
+            const uint8_t other = mode ^ 1;
+            for (uint8_t from = 0; from < Ledc::TIMERS_PER_MODE; from++) {
+                Timer& source = m_timers[mode][from];
+                if (source.users == 0 || source.users > freeChannels(other)) continue;
+                for (uint8_t into = 0; into < Ledc::TIMERS_PER_MODE; into++) {
+                    Timer& target = m_timers[other][into];
+                    if (target.users == 0 || target.frequencyQ16 != source.frequencyQ16) continue;
+                    for (uint8_t voice = 0; voice < N; voice++) {
+                        Binding& binding = m_voices[voice];
+                        if (!binding.placed() || binding.mode != mode || binding.timer != from) continue;
+                        m_channelVoice[mode][binding.channel] = Ledc::NONE;
+                        binding.mode = other;
+                        binding.channel = freeChannel(other);
+                        binding.timer = into;
+                        m_channelVoice[other][binding.channel] = voice;
+                    }
+                    target.users += source.users;
+                    source.users = 0;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool onTimer(uint8_t voice, uint8_t mode, uint8_t timer) const {
+        const Binding& binding = m_voices[voice];
+        return binding.placed() && binding.mode == mode && binding.timer == timer;
+    }
+
+    // Moves a voice onto a timer at its frequency. Staying in the mode of the channel it holds
+    // only rebinds the channel, changing mode moves the pin to a new channel.
+    void place(uint8_t voice, uint32_t frequencyQ16) {
+        uint8_t mode, timer;
+        if (!findTimer(frequencyQ16, ownMode(voice), mode, timer)) {
+            if (!mergeAcrossModes() || !findTimer(frequencyQ16, ownMode(voice), mode, timer)) return;
+        }
+        const Binding current = m_voices[voice];
+
+        if (current.placed()) {
+            m_timers[current.mode][current.timer].users--;
+            if (current.mode != mode) m_channelVoice[current.mode][current.channel] = Ledc::NONE;
+        }
+
+        Binding& binding = m_voices[voice];
+        if (!current.placed() || current.mode != mode) {
+            binding.mode = mode;
+            binding.channel = freeChannel(mode);
+            m_channelVoice[mode][binding.channel] = voice;
+        }
+        binding.timer = timer;
+        m_timers[mode][timer].frequencyQ16 = frequencyQ16;
+        m_timers[mode][timer].users++;
+    }
+
+    // A timer already at the frequency is best, then a free timer. The voice's own mode comes
+    // first, the other mode only if it has a channel to spare.
+    bool findTimer(uint32_t frequencyQ16, uint8_t ownMode, uint8_t& mode, uint8_t& timer) const {
+        const uint8_t first = (ownMode != Ledc::NONE) ? ownMode : emptierMode();
+        const uint8_t order[Ledc::NUM_MODES] = {first, static_cast<uint8_t>(first ^ 1)};
+
+        for (bool shared : {true, false}) {
+            for (uint8_t candidate : order) {
+                if (candidate != ownMode && freeChannel(candidate) == Ledc::NONE) continue;
+                for (uint8_t t = 0; t < Ledc::TIMERS_PER_MODE; t++) {
+                    const Timer& state = m_timers[candidate][t];
+                    const bool fits = shared ? (state.users > 0 && state.frequencyQ16 == frequencyQ16)
+                                             : (state.users == 0);
+                    if (!fits) continue;
+                    mode = candidate;
+                    timer = t;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    uint8_t freeChannel(uint8_t mode) const {
+        for (uint8_t channel = 0; channel < Ledc::CHANNELS_PER_MODE; channel++) {
+            if (m_channelVoice[mode][channel] == Ledc::NONE) return channel;
+        }
+        return Ledc::NONE;
+    }
+
+    uint8_t ownMode(uint8_t voice) const {
+        return m_voices[voice].placed() ? m_voices[voice].mode : Ledc::NONE;
+    }
+
+    uint8_t freeChannels(uint8_t mode) const {
+        uint8_t count = 0;
+        for (uint8_t voice : m_channelVoice[mode]) count += (voice == Ledc::NONE);
+        return count;
+    }
+
+    uint8_t emptierMode() const {
+        return (freeChannels(1) > freeChannels(0)) ? 1 : 0;
+    }
+};
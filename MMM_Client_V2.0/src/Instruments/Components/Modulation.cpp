@@ -0,0 +1,191 @@
+#include "Modulation.h"
+#include "NoteTable.h"
+#include "Device.h"
+
+namespace {
+
+// sin(x) by Taylor series, only used to build the table at compile time
+constexpr double constexprSin(double x) {
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 12; ++n) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr std::array<int16_t, 256> makeSineTable() {
+    std::array<int16_t, 256> table{};
+    for (int i = 0; i < 256; ++i) {
+        // Reduce to -pi..pi where the series converges quickly
+        const double x = 3.14159265358979324 * ((i < 128) ? i : i - 256) / 128.0;
+        table[i] = static_cast<int16_t>(constexprSin(x) * 32767.0);
+    }
+    return table;
+}
+
+constexpr auto SINE_TABLE = makeSineTable();
+
+// LFO value from -32767 to 32767. Every shape starts at 0 so a new note begins on pitch.
+int32_t lfoValue(LfoShape shape, uint32_t phase)
+{
+    const uint16_t position = static_cast<uint16_t>(phase >> 16);
+    switch (shape) {
+        case LfoShape::Sine:
+            return SINE_TABLE[position >> 8];
+        case LfoShape::Square:
+            return (position < 0x8000) ? 32767 : -32767;
+        case LfoShape::SawUp:
+            return static_cast<int32_t>(static_cast<uint16_t>(position + 0x8000)) - 32768;
+        case LfoShape::SawDown:
+            return 32768 - static_cast<int32_t>(static_cast<uint16_t>(position + 0x8000));
+        case LfoShape::Triangle:
+        default: {
+            const uint16_t shifted = position + 0x4000;
+            return (shifted < 0x8000) ? static_cast<int32_t>(shifted) * 2 - 32767
+                                      : 98303 - static_cast<int32_t>(shifted) * 2;
+        }
+    }
+}
+
+}
+
+void ModulationEngine::setPitchBend(uint8_t channel, uint16_t bend, uint16_t rangeCents)
+{
+    channel &= 0x0F;
+    m_bendOctaves[channel] = NoteTables::pitchBendToOctaves(bend, rangeCents);
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; ++i) {
+        if (m_activeVoices.test(i) && m_channel[i] == channel) computeTarget(i);
+    }
+}
+
+bool ModulationEngine::controlChange(uint8_t channel, uint8_t controller, uint8_t value)
+{
+    channel &= 0x0F;
+    switch (controller) {
+        case MidiCC::ModulationWheel:
+            // Modulation wheel sets the vibrato depth of the channel
+            #ifdef CFG_VIBRATO_ENABLED
+                m_lfos[channel].depth = Device::Vibrato ? static_cast<uint32_t>(value) * CFG_VIBRATO_DEPTH_CENTS / 127 : 0;
+            #endif
+            return true;
+        case MidiCC::SoundControl7:
+            // Vibrato rate, 64 is the default and every 32 steps doubles or halves it
+            m_lfos[channel].rateCentiHz = NoteTables::scaleByExp2(CFG_VIBRATO_RATE_CENTIHZ, (static_cast<int32_t>(value) - 64) * 2048);
+            return true;
+        case MidiCC::PortamentoTime:
+            // Quadratic so the short times most playing uses get most of the controller's travel
+            m_glideTimeMs[channel] = static_cast<uint32_t>(value) * value * CFG_PORTAMENTO_MAX_MS / (127 * 127);
+            return true;
+        case MidiCC::Portamento:
+            m_portamento[channel] = (value >= 64);
+            return true;
+        case MidiCC::Legato:
+            m_legato[channel] = (value >= 64);
+            return true;
+    }
+    return false;
+}
+
+bool ModulationEngine::startVoice(uint8_t voice, uint8_t channel, uint16_t basePeriod)
+{
+    if (voice >= HardwareConfig::MAX_NUM_INSTRUMENTS) return false;
+    channel &= 0x0F;
+    const bool sounding = m_activeVoices.test(voice);
+    const bool legato = sounding && m_legato.test(channel);
+
+    // Start from the pitch the voice was at, moved into the new note's frame.
+    // A longer period is a lower pitch so the old pitch sits log2(new/old) above the new note.
+    const bool glide = m_portamento.test(channel) && m_glideTimeMs[channel] != 0
+        && m_basePeriod[voice] != 0 && basePeriod != 0
+        && (sounding || !m_legato.test(channel));
+    if (glide) {
+        m_glideOctaves[voice] += NoteTables::log2Q16(basePeriod) - NoteTables::log2Q16(m_basePeriod[voice]);
+        m_glideStartOctaves[voice] = m_glideOctaves[voice];
+        m_glideTimeUs[voice] = static_cast<uint32_t>(m_glideTimeMs[channel]) * 1000;
+        m_glideRemainingUs[voice] = m_glideTimeUs[voice];
+    } else {
+        m_glideOctaves[voice] = 0;
+        m_glideRemainingUs[voice] = 0;
+    }
+
+    m_channel[voice] = channel;
+    m_basePeriod[voice] = basePeriod;
+    if (!legato) m_lfoPhase[voice] = 0;
+    m_activeVoices.set(voice);
+    computeTarget(voice);
+    return legato;
+}
+
+void ModulationEngine::stopVoice(uint8_t voice)
+{
+    if (voice >= HardwareConfig::MAX_NUM_INSTRUMENTS) return;
+    m_activeVoices.reset(voice);
+    m_target[voice] = 0;
+}
+
+void ModulationEngine::reset()
+{
+    m_activeVoices.reset();
+    m_target = {};
+    m_pitchOffset = {};
+    m_bendOctaves = {};
+    m_basePeriod = {};
+    m_glideOctaves = {};
+    m_glideRemainingUs = {};
+}
+
+bool ModulationEngine::update(uint32_t nowUs)
+{
+    const uint32_t elapsedUs = nowUs - m_lastUpdateUs;
+    if (elapsedUs < CFG_MODULATION_INTERVAL_US) return false;
+    m_lastUpdateUs = nowUs;
+    if (m_activeVoices.none()) return false;
+
+    // Don't jump through several cycles after a long stall
+    const uint32_t stepUs = (elapsedUs > 50000) ? 50000 : elapsedUs;
+
+    bool changed = false;
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; ++i) {
+        if (!m_activeVoices.test(i)) continue;
+        bool moving = false;
+
+        if (m_glideRemainingUs[i] != 0) {
+            // Scaled from the start of the glide so rounding never accumulates
+            m_glideRemainingUs[i] = (stepUs >= m_glideRemainingUs[i]) ? 0 : m_glideRemainingUs[i] - stepUs;
+            m_glideOctaves[i] = static_cast<int32_t>(static_cast<int64_t>(m_glideStartOctaves[i]) * m_glideRemainingUs[i] / m_glideTimeUs[i]);
+            moving = true;
+        }
+
+        const Lfo& lfo = m_lfos[m_channel[i]];
+        if (lfo.depth != 0 && lfo.destination != ModDestination::None) {
+            // 2^32 phase steps per cycle, rate is in hundredths of a hertz
+            m_lfoPhase[i] += static_cast<uint32_t>((static_cast<uint64_t>(lfo.rateCentiHz) * stepUs << 32) / 100000000ULL);
+            moving = true;
+        }
+
+        if (moving) {
+            computeTarget(i);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void ModulationEngine::computeTarget(uint8_t voice)
+{
+    int32_t octaves = m_bendOctaves[m_channel[voice]] + m_glideOctaves[voice];
+
+    const Lfo& lfo = m_lfos[m_channel[voice]];
+    if (lfo.depth != 0 && lfo.destination == ModDestination::Pitch) {
+        // cents * 65536 / (1200 * 32767) rounds to 1/600
+        octaves += static_cast<int32_t>(lfo.depth) * lfoValue(lfo.shape, m_lfoPhase[voice]) / 600;
+    }
+
+    m_pitchOffset[voice] = octaves;
+
+    // Raising the pitch shortens the period
+    const uint32_t period = NoteTables::scaleByExp2(m_basePeriod[voice], -octaves);
+    m_target[voice] = (period == 0) ? 1 : (period > UINT16_MAX) ? UINT16_MAX : static_cast<uint16_t>(period);
+}
@@ -0,0 +1,85 @@
+/*
+ * Modulation.h
+ * Control rate modulation of voice periods (LFOs, pitch bend and glide), run outside the tick ISR
+ */
+#pragma once
+
+#include "Constants.h"
+#include "Config.h"
+#include <array>
+#include <bitset>
+#include <cstdint>
+
+enum class LfoShape : uint8_t
+{
+    Triangle = 0,
+    Sine,
+    Square,
+    SawUp,
+    SawDown
+};
+
+// What an LFO modulates
+enum class ModDestination : uint8_t
+{
+    None = 0,
+    Pitch           // Depth in cents
+};
+
+class ModulationEngine {
+public:
+    struct Lfo {
+        LfoShape shape = LfoShape::Triangle;
+        ModDestination destination = ModDestination::Pitch;
+        uint16_t rateCentiHz = CFG_VIBRATO_RATE_CENTIHZ; // Hundredths of a hertz
+        uint16_t depth = 0;                              // Peak deviation in the destination's units
+    };
+
+    // Each channel has one LFO shared by the voices it plays
+    Lfo& lfo(uint8_t channel) { return m_lfos[channel & 0x0F]; }
+    void setPitchBend(uint8_t channel, uint16_t bend, uint16_t rangeCents);
+    // Vibrato (CC1, CC76) and glide (CC5, CC65, CC68) controllers. Returns false for any other controller.
+    bool controlChange(uint8_t channel, uint8_t controller, uint8_t value);
+
+    // Voices follow their channel's modulation around the period of their note. With portamento
+    // on the voice glides there from the pitch it last played. Returns true for a legato
+    // retrigger, where the instrument should keep the waveform running instead of restarting it.
+    bool startVoice(uint8_t voice, uint8_t channel, uint16_t basePeriod);
+    void stopVoice(uint8_t voice);
+    // Stops every voice and centers the pitch bends, LFO and glide settings are kept
+    void reset();
+
+    // Advances the LFOs and recomputes every voice once per control interval.
+    // Returns true when the targets changed and should be published.
+    bool update(uint32_t nowUs);
+
+    // Period a voice should play at, recomputed for the voice's current modulation
+    uint16_t targetPeriod(uint8_t voice) const { return m_target[voice]; }
+    // The same modulation as Q16 octaves from the note, for instruments that work in frequency
+    int32_t pitchOffset(uint8_t voice) const { return m_pitchOffset[voice]; }
+    const std::bitset<HardwareConfig::MAX_NUM_INSTRUMENTS>& activeVoices() const { return m_activeVoices; }
+
+private:
+    void computeTarget(uint8_t voice);
+
+    std::array<Lfo, Midi::NUM_CH> m_lfos = {};
+    std::array<int32_t, Midi::NUM_CH> m_bendOctaves = {}; // Q16 octaves, positive raises pitch
+    std::array<uint16_t, Midi::NUM_CH> m_glideTimeMs = {};
+    std::bitset<Midi::NUM_CH> m_portamento;
+    std::bitset<Midi::NUM_CH> m_legato;             // Only glide between overlapping notes
+
+    std::bitset<HardwareConfig::MAX_NUM_INSTRUMENTS> m_activeVoices;
+    std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_channel = {};
+    std::array<uint16_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_basePeriod = {};
+    std::array<uint16_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_target = {};
+    std::array<int32_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_pitchOffset = {};
+    std::array<uint32_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_lfoPhase = {}; // Full cycle is 2^32
+
+    // Distance left to glide in Q16 octaves, covered linearly in pitch over the glide time
+    std::array<int32_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_glideOctaves = {};
+    std::array<int32_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_glideStartOctaves = {};
+    std::array<uint32_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_glideTimeUs = {};
+    std::array<uint32_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_glideRemainingUs = {};
+
+    uint32_t m_lastUpdateUs = 0;
+};
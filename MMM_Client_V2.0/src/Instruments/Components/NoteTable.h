@@ -5,13 +5,15 @@
 #include <cmath>
 #include <cstdint>
 #include "Config.h"
+#include "TuningTable.h"
 
 namespace NoteTables {
     ////////////////////////////////////////////////////////////////////////////////////////////////////
     //Timer Constants
     ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    // The frequency of notes in hz
+    // The frequency of notes in hz under equal temperament. These compile-time tables seed
+    // the runtime tuning, instruments look notes up through Tuning::active() instead.
     constexpr std::array<double, 128> noteFrequency = {
         8.175799, 8.661957, 9.177024, 9.722718, 10.300861, 10.913383, 11.562325, 12.249857, 12.978272, 13.750000, 14.567617, 15.433853, //C-1 - B-1
         16.351598, 17.323914, 18.354048, 19.445436, 20.601722, 21.826765, 23.124651, 24.499715, 25.956544, 27.500000, 29.135235, 30.867706, //C0 - B0
@@ -67,34 +69,109 @@ namespace NoteTables {
     // the math multiply the RESOLUTION by 2 here.
     constexpr auto NOTE_TICKS_DOUBLE = compute_divided_ticks(CFG_TIMER_RESOLUTION_US*2);
     
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Pitch Bend
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // e^x by Taylor series, only used to build tables at compile time
+    constexpr double constexprExp(double x) {
+        double term = 1.0;
+        double sum = 1.0;
+        for (int n = 1; n < 24; ++n) {
+            term *= x / n;
+            sum += term;
+        }
+        return sum;
+    }
+
+    // 2^(i/256) in Q16 over one octave, interpolating between entries keeps the error
+    // well under a cent so bends need no floating point math at runtime.
+    constexpr std::array<uint32_t, 257> makeExp2Table() {
+        std::array<uint32_t, 257> table{};
+        for (int i = 0; i <= 256; ++i) {
+            table[i] = static_cast<uint32_t>(constexprExp(0.69314718055994531 * i / 256.0) * 65536.0 + 0.5);
+        }
+        return table;
+    }
+
+    constexpr auto EXP2_Q16 = makeExp2Table();
+
+    // 2^(fraction/65536) in Q16 for a fraction of an octave (0-65535)
+    constexpr uint32_t exp2FractionQ16(uint32_t fraction) {
+        const uint32_t index = fraction >> 8;
+        const uint32_t weight = fraction & 0xFF;
+        return EXP2_Q16[index] + (((EXP2_Q16[index + 1] - EXP2_Q16[index]) * weight + 0x80) >> 8);
+    }
+
+    // Octaves (Q16) a pitch bend moves a note. rangeCents is the bend at full deflection (RPN 0).
+    constexpr int32_t pitchBendToOctaves(uint16_t pitchBend, uint16_t rangeCents) {
+        // 65536 / (0x2000 * 1200 cents) reduces to 1/150
+        return (static_cast<int32_t>(pitchBend) - 0x2000) * static_cast<int32_t>(rangeCents) / 150;
+    }
+
+    // Returns value * 2^(octaves/65536), rounded and clamped to uint32_t
+    constexpr uint32_t scaleByExp2(uint32_t value, int32_t octavesQ16) {
+        const uint32_t fraction = static_cast<uint32_t>(octavesQ16) & 0xFFFF;
+        const int32_t whole = (octavesQ16 - static_cast<int32_t>(fraction)) / 65536;
+        const uint64_t scaled = static_cast<uint64_t>(value) * exp2FractionQ16(fraction); // Q16
+
+        const int32_t shift = 16 - whole;
+        if (shift >= 64) return 0;
+        if (shift <= 0) {
+            if (-shift >= 32 || (scaled >> (32 + shift)) != 0) return UINT32_MAX;
+            return static_cast<uint32_t>(scaled << -shift);
+        }
+        const uint64_t result = (scaled + (1ULL << (shift - 1))) >> shift;
+        return (result > UINT32_MAX) ? UINT32_MAX : static_cast<uint32_t>(result);
+    }
+
+    // Phase step per timer tick for a 32 bit accumulator that wraps once per toggle interval.
+    // tickUs is the timer resolution, doubled when notes toggle twice per period.
+    constexpr uint32_t noteIncrement(uint32_t frequencyQ16, uint32_t tickUs) {
+        const uint64_t increment = ((static_cast<uint64_t>(frequencyQ16) * tickUs << 16) + 500000) / 1000000;
+        return (increment > UINT32_MAX) ? UINT32_MAX : static_cast<uint32_t>(increment);
+    }
+
+    // log2(value) in Q16, the inverse of scaleByExp2. value must not be 0.
+    constexpr int32_t log2Q16(uint32_t value) {
+        int32_t whole = 31;
+        while ((value & 0x80000000UL) == 0) { value <<= 1; --whole; }
+        const uint32_t mantissa = value >> 15; // Q16, 1.0 to just under 2.0
+
+        // Find the table interval holding the mantissa then interpolate within it
+        uint32_t low = 0, high = 256;
+        while (high - low > 1) {
+            const uint32_t middle = (low + high) / 2;
+            if (EXP2_Q16[middle] <= mantissa) low = middle; else high = middle;
+        }
+        const uint32_t span = EXP2_Q16[high] - EXP2_Q16[low];
+        const uint32_t weight = (((mantissa - EXP2_Q16[low]) << 8) + span / 2) / span;
+        return whole * 65536 + static_cast<int32_t>((low << 8) + weight);
+    }
+
     // Apply pitch bend to frequency
-    constexpr float applyPitchBend(float baseFrequency, uint16_t pitchBend) {
-        // Pitch bend range: 0x0000 to 0x3FFF (center: 0x2000)
-        // ±2 semitones range
-        float bendSemitones = ((int16_t)pitchBend - 0x2000) * 2.0f / 0x2000;
-        return baseFrequency * std::pow(2.0f, bendSemitones / 12.0f);
+    inline float applyPitchBend(float baseFrequency, uint16_t pitchBend, uint16_t rangeCents = CFG_PITCH_BEND_RANGE_CENTS) {
+        const int32_t octaves = pitchBendToOctaves(pitchBend, rangeCents);
+        const uint32_t fraction = static_cast<uint32_t>(octaves) & 0xFFFF;
+        const int32_t whole = (octaves - static_cast<int32_t>(fraction)) / 65536;
+        return std::ldexp(baseFrequency * (exp2FractionQ16(fraction) / 65536.0f), whole);
     }
 
-    constexpr uint32_t applyPitchBendToPeriod(uint32_t basePeriodTicks, uint16_t pitchBend) {
-        // Convert base period to frequency, apply pitch bend multiplier, then back to period
-        // Use floating point in constexpr for clarity; cast back to integer ticks
-        float baseFreq = 1000000.0f / static_cast<float>(basePeriodTicks * CFG_TIMER_RESOLUTION_US);
-        float bentFreq = applyPitchBend(baseFreq, pitchBend);
-        float bentPeriodMicros = 1000000.0f / bentFreq;
-        // Convert microsecond period to ticks using HardwareConfig::CFG_TIMER_RESOLUTION
-        uint32_t ticks = static_cast<uint32_t>(bentPeriodMicros / static_cast<float>(CFG_TIMER_RESOLUTION_US));
+    // Bending up shortens the period
+    constexpr uint32_t applyPitchBendToPeriod(uint32_t basePeriodTicks, uint16_t pitchBend, uint16_t rangeCents = CFG_PITCH_BEND_RANGE_CENTS) {
+        const uint32_t ticks = scaleByExp2(basePeriodTicks, -pitchBendToOctaves(pitchBend, rangeCents));
         return ticks > 0 ? ticks : 1;
     }
 
-    // Returns adjusted period ticks given a base period in ticks and a pitch bend value
-    constexpr uint32_t applyPitchBendToNote(uint32_t baseNote, uint16_t pitchBend) {
-        uint32_t basePeriodTicks = NOTE_TICKS[baseNote];
-        return applyPitchBendToPeriod(basePeriodTicks, pitchBend);
+    // Returns adjusted period ticks for a note under the active tuning and a pitch bend value
+    inline uint32_t applyPitchBendToNote(uint32_t baseNote, uint16_t pitchBend, uint16_t rangeCents = CFG_PITCH_BEND_RANGE_CENTS) {
+        uint32_t basePeriodTicks = Tuning::active().ticks[baseNote];
+        return applyPitchBendToPeriod(basePeriodTicks, pitchBend, rangeCents);
     }
-        // Returns adjusted period ticks given a base period in ticks and a pitch bend value
-    constexpr uint32_t applyPitchBendToNoteDouble(uint32_t baseNote, uint16_t pitchBend) {
-        uint32_t basePeriodTicks = NOTE_TICKS_DOUBLE[baseNote];
-        return applyPitchBendToPeriod(basePeriodTicks, pitchBend);
+    // Returns adjusted half rate period ticks for a note under the active tuning and a pitch bend value
+    inline uint32_t applyPitchBendToNoteDouble(uint32_t baseNote, uint16_t pitchBend, uint16_t rangeCents = CFG_PITCH_BEND_RANGE_CENTS) {
+        uint32_t basePeriodTicks = Tuning::active().ticksDouble[baseNote];
+        return applyPitchBendToPeriod(basePeriodTicks, pitchBend, rangeCents);
     }
     
     // Note validation
@@ -108,61 +185,4 @@ namespace NoteTables {
         if (note > maxNote) return maxNote;
         return note;
     }
-
-    ////////////////////////////////////////////////////////////////////////////////////////////////////
-    // Vibrato Utility Functions
-    ////////////////////////////////////////////////////////////////////////////////////////////////////
-    
-    // Update vibrato phase counter (call periodically during tick)
-    // Returns new phase value after increment and wrap-around
-    inline uint16_t updateVibratoPhase(uint16_t currentPhase, uint8_t rate) {
-        currentPhase += rate;
-        if (currentPhase >= 36000) {
-            currentPhase -= 36000;
-        }
-        return currentPhase;
-    }
-    
-    // Calculate vibrato offset using optimized triangle wave
-    // phase: 0-35999 (full cycle)
-    // depth: 0-127 (modulation wheel value)
-    // Returns: offset value to apply to period
-    inline int16_t calculateVibratoOffset(uint16_t phase, uint8_t depth) {
-        if (depth == 0) return 0;
-        
-        int16_t vibratoOffset;
-        
-        // Optimized triangle wave using bit shifts where possible
-        if (phase < 18000) {
-            // Rising from -127 to +127
-            vibratoOffset = ((int32_t)phase * 254 / 18000) - 127;
-        } else {
-            // Falling from +127 to -127  
-            vibratoOffset = 127 - ((int32_t)(phase - 18000) * 254 / 18000);
-        }
-        
-        // Apply depth scaling using bit shift (>> 7 is divide by 128)
-        vibratoOffset = (vibratoOffset * depth) >> 7;
-        
-        return vibratoOffset;
-    }
-    
-    // Apply vibrato to a period value
-    // activePeriod: base period in ticks
-    // vibratoOffset: offset value from calculateVibratoOffset
-    // Returns: adjusted period with vibrato applied, clamped to safe range
-    inline uint16_t applyVibratoToPeriod(uint16_t activePeriod, int16_t vibratoOffset) {
-        // Apply vibrato offset - use bit shift for division
-        int32_t periodAdjustment = ((int32_t)activePeriod * vibratoOffset) >> 10;  // >> 10 is divide by 1024
-        uint16_t targetPeriod = activePeriod - periodAdjustment;
-        
-        // Clamp period with single comparison when possible
-        if (targetPeriod < 10) {
-            targetPeriod = 10;
-        } else if (targetPeriod > 65000) {
-            targetPeriod = 65000;
-        }
-        
-        return targetPeriod;
-    }
 }
\ No newline at end of file
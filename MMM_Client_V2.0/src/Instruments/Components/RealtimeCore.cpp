@@ -0,0 +1,45 @@
+#include "RealtimeCore.h"
+
+#if defined(PLATFORM_ESP32) && defined(CFG_REALTIME_CORE)
+
+#include <Arduino.h>
+#include <atomic>
+
+namespace {
+// Above loop() and the Arduino tasks, below the IDF timer and Wi-Fi tasks
+constexpr UBaseType_t TASK_PRIORITY = configMAX_PRIORITIES - 5;
+constexpr uint32_t TASK_STACK = 4096;
+// Longest wait between services, keeps modulation running with no commands arriving
+constexpr TickType_t SERVICE_TICKS = (pdMS_TO_TICKS(CFG_MODULATION_INTERVAL_US / 1000) > 0)
+    ? pdMS_TO_TICKS(CFG_MODULATION_INTERVAL_US / 1000) : 1;
+
+TaskHandle_t s_task = nullptr;
+void (*s_setup)() = nullptr;
+void (*s_service)() = nullptr;
+std::atomic<bool> s_ready{false};
+
+void realtimeTask(void*) {
+    if (s_setup) s_setup();
+    s_ready.store(true);
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, SERVICE_TICKS);
+        if (s_service) s_service();
+    }
+}
+}
+
+void RealtimeCore::start(void (*setup)(), void (*service)()) {
+    if (s_task != nullptr) return;
+    s_setup = setup;
+    s_service = service;
+
+    xTaskCreatePinnedToCore(realtimeTask, "tone", TASK_STACK, nullptr, TASK_PRIORITY, &s_task, CFG_REALTIME_CORE);
+    while (!s_ready.load()) delay(1);
+}
+
+void RealtimeCore::wake() {
+    if (s_task != nullptr) xTaskNotifyGive(s_task);
+}
+
+#endif
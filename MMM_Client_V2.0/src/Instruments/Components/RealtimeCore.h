@@ -0,0 +1,27 @@
+/*
+ * RealtimeCore.h
+ * Runs tone generation on its own ESP32 core, away from networking, storage and LEDs
+ */
+#pragma once
+
+#include "Config.h"
+#include <cstdint>
+
+#if defined(PLATFORM_ESP32) && defined(CFG_REALTIME_CORE)
+
+// loop() must run on the other core or nothing is gained, see ARDUINO_RUNNING_CORE
+#if defined(ARDUINO_RUNNING_CORE) && (ARDUINO_RUNNING_CORE == CFG_REALTIME_CORE)
+    #error "CFG_REALTIME_CORE must differ from ARDUINO_RUNNING_CORE"
+#endif
+
+namespace RealtimeCore {
+    // Starts a task pinned to CFG_REALTIME_CORE and returns once setup has run there. Interrupts
+    // allocated by setup, the tone timer, are then serviced by that core. service runs each
+    // time the task is woken and at least every CFG_MODULATION_INTERVAL_US otherwise.
+    void start(void (*setup)(), void (*service)());
+
+    // Wakes the task early, for work handed over from the other core
+    void wake();
+};
+
+#endif
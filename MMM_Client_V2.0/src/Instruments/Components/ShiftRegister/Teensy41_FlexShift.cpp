@@ -1,5 +1,259 @@
+/*
+ * Teensy41_FlexShift.cpp
+ *
+ * FlexIO-based shift register implementation, bit-banging when the pins have no FlexIO
+ */
 #include "Config.h"
+#if defined(PLATFORM_TEENSY41) && defined(CFG_COMPONENT_SHIFTREGISTER)
 
-#if defined(PLATFORM_TEENSY41) && defined(CFG_SHIFTREGISTER_TYPE)
+#include "Teensy41_FlexShift.h"
+#include "Arduino.h"
+#include <array>
 
-#endif // PLATFORM_TEENSY41 && SHIFTREG_USE_FLEXIO && COMPONENT_SHIFTREG_74HC595
\ No newline at end of file
+namespace {
+    constexpr uint8_t NO_MODULE = 0xFF;
+
+    struct FlexIOModule {
+        IMXRT_FLEXIO_t* regs;
+        volatile uint32_t* gate;
+        uint32_t gateOn;
+        volatile uint32_t* clockSelect;  //Register holding the 2 bit root clock select
+        uint8_t selectShift;
+        volatile uint32_t* clockDivide;  //Register holding the 3 bit pre and post dividers
+        uint8_t predShift;
+        uint8_t podfShift;
+        uint8_t mux;                     //IOMUX alternate routing the module to its pins
+    };
+
+    // FlexIO2 and FlexIO3 share a root clock
+    const FlexIOModule MODULES[] = {
+        {&IMXRT_FLEXIO1_S, &CCM_CCGR5, CCM_CCGR5_FLEXIO1(CCM_CCGR_ON), &CCM_CDCDR, 7, &CCM_CDCDR, 12, 9, 4},
+        {&IMXRT_FLEXIO2_S, &CCM_CCGR3, CCM_CCGR3_FLEXIO2(CCM_CCGR_ON), &CCM_CSCMR2, 19, &CCM_CS1CDR, 9, 25, 4},
+        {&IMXRT_FLEXIO3_S, &CCM_CCGR7, CCM_CCGR7_FLEXIO3(CCM_CCGR_ON), &CCM_CSCMR2, 19, &CCM_CS1CDR, 9, 25, 9},
+    };
+
+    struct FlexIOPin {
+        uint8_t pin;
+        uint8_t module;     //Index into MODULES
+        uint8_t flexioPin;  //FlexIO pin number inside the module
+    };
+
+    // Teensy 4.1 pins with a FlexIO output, pins on both FlexIO2 and FlexIO3 use FlexIO2
+    constexpr FlexIOPin PINS[] = {
+        {2, 0, 4}, {3, 0, 5}, {4, 0, 6}, {5, 0, 8}, {33, 0, 7},
+        {49, 0, 13}, {50, 0, 14}, {52, 0, 12}, {54, 0, 15},
+        {6, 1, 10}, {7, 1, 17}, {8, 1, 16}, {9, 1, 11}, {10, 1, 0}, {11, 1, 2}, {12, 1, 1},
+        {13, 1, 3}, {32, 1, 12}, {34, 1, 29}, {35, 1, 28}, {36, 1, 18}, {37, 1, 19},
+        {14, 2, 2}, {15, 2, 3}, {16, 2, 7}, {17, 2, 6}, {18, 2, 1}, {19, 2, 0}, {20, 2, 10},
+        {21, 2, 11}, {22, 2, 8}, {23, 2, 9}, {26, 2, 14}, {27, 2, 15}, {38, 2, 12}, {39, 2, 13},
+        {40, 2, 4}, {41, 2, 5},
+    };
+
+    FlexIOPin flexioPin(uint8_t pin) {
+        for (const FlexIOPin& entry : PINS) {
+            if (entry.pin == pin) return entry;
+        }
+        return {pin, NO_MODULE, 0};
+    }
+
+    // Shifters and timers already taken on each module, a chain takes one shifter and two timers
+    std::array<uint8_t, 3> s_shiftersUsed = {};
+    std::array<uint8_t, 3> s_timersUsed = {};
+
+    // Root clock of a module in Hz. PLL3 through the dividers is kept as found, any other source
+    // is set back to the reset default of 480MHz / 2 / 8
+    uint32_t clockHz(const FlexIOModule& module) {
+        constexpr uint32_t PLL3_HZ = 480000000;
+        constexpr uint32_t PLL3 = 3;
+
+        if (((*module.clockSelect >> module.selectShift) & 3) != PLL3) {
+            *module.gate &= ~module.gateOn;
+            *module.clockSelect = (*module.clockSelect & ~(3UL << module.selectShift)) | (PLL3 << module.selectShift);
+            *module.clockDivide = (*module.clockDivide & ~((7UL << module.predShift) | (7UL << module.podfShift)))
+                | (1UL << module.predShift) | (7UL << module.podfShift);
+        }
+        *module.gate |= module.gateOn;
+
+        const uint32_t pred = ((*module.clockDivide >> module.predShift) & 7) + 1;
+        const uint32_t podf = ((*module.clockDivide >> module.podfShift) & 7) + 1;
+        return PLL3_HZ / pred / podf;
+    }
+}
+
+/**
+ * Initialize shift register pins and state
+ */
+template<size_t numOutputs>
+void Teensy41_FlexShift<numOutputs>::init() {
+    if (this->m_initialized) return;
+
+    // Setup pins
+    pinMode(this->m_PIN_SER, OUTPUT);
+    pinMode(this->m_PIN_CLK, OUTPUT);
+    pinMode(this->m_PIN_LD, OUTPUT);
+    if (this->m_PIN_EN.has_value()) pinMode(this->m_PIN_EN.value(), OUTPUT);
+    if (this->m_PIN_RST.has_value()) pinMode(this->m_PIN_RST.value(), OUTPUT);
+
+    if (this->m_PIN_RST.has_value()) digitalWriteFast(this->m_PIN_RST.value(), HIGH);
+
+    // Hand Data, Clock and Load to FlexIO, else update() bit-bangs them
+    initializeFlexIO();
+
+    // Initialize all outputs as disabled
+    this->m_outputEnabled.reset();
+    this->m_update = true;  // Force initial update
+
+    this->m_initialized = true;
+
+    // Update hardware to reflect initial state
+    update();
+}
+
+/**
+ * Set up a shifter to send the chain and two timers for the clock and load lines.
+ * Returns false, leaving the pins as GPIO, if the pins aren't on one FlexIO module
+ * or the module has no shifter and timers left.
+ *
+ * Timer 0 runs while the shifter buffer is full and gives two edges per output. The shifter
+ * moves data on the falling edge so it is steady on the rising edge the 74HC595 samples.
+ * Timer 1 follows timer 0 on and off and holds Load low for the transfer, its rising edge
+ * comes half a clock after the last bit and latches the outputs.
+ */
+template<size_t numOutputs>
+bool Teensy41_FlexShift<numOutputs>::initializeFlexIO() {
+    const FlexIOPin ser = flexioPin(this->m_PIN_SER);
+    const FlexIOPin clk = flexioPin(this->m_PIN_CLK);
+    const FlexIOPin ld = flexioPin(this->m_PIN_LD);
+    if (ser.module == NO_MODULE || clk.module != ser.module || ld.module != ser.module) return false;
+
+    const uint8_t index = ser.module;
+    const FlexIOModule& module = MODULES[index];
+    const uint32_t hz = clockHz(module);
+    IMXRT_FLEXIO_t& flexio = *module.regs;
+
+    const uint8_t numShifters = flexio.PARAM & 0xFF;
+    const uint8_t numTimers = (flexio.PARAM >> 8) & 0xFF;
+    if (s_shiftersUsed[index] + 1 > numShifters || s_timersUsed[index] + 2 > numTimers) return false;
+    const uint8_t shifter = s_shiftersUsed[index]++;
+    const uint8_t timer = s_timersUsed[index];
+    s_timersUsed[index] += 2;
+
+    // Each clock phase lasts at least the hold time, like the delays in Teensy41_SwShift
+    uint64_t phase = (static_cast<uint64_t>(CFG_SHIFTREGISTER_DATA_HOLDTIME_NS) * hz + 999999999) / 1000000000;
+    if (phase < 1) phase = 1;
+    if (phase > 256) phase = 256;
+
+    flexio.SHIFTCFG[shifter] = 0;
+    flexio.SHIFTCTL[shifter] = FLEXIO_SHIFTCTL_TIMSEL(timer) | FLEXIO_SHIFTCTL_TIMPOL
+        | FLEXIO_SHIFTCTL_PINCFG(3) | FLEXIO_SHIFTCTL_PINSEL(ser.flexioPin) | FLEXIO_SHIFTCTL_SMOD(2);
+
+    flexio.TIMCMP[timer] = ((numOutputs * 2 - 1) << 8) | (phase - 1);
+    flexio.TIMCFG[timer] = FLEXIO_TIMCFG_TIMOUT(1) | FLEXIO_TIMCFG_TIMDIS(2) | FLEXIO_TIMCFG_TIMENA(2)
+        | FLEXIO_TIMCFG_TSTOP(2) | FLEXIO_TIMCFG_TSTART;
+    flexio.TIMCTL[timer] = FLEXIO_TIMCTL_TRGSEL(4 * shifter + 1) | FLEXIO_TIMCTL_TRGPOL | FLEXIO_TIMCTL_TRGSRC
+        | FLEXIO_TIMCTL_PINCFG(3) | FLEXIO_TIMCTL_PINSEL(clk.flexioPin) | FLEXIO_TIMCTL_TIMOD(1);
+
+    flexio.TIMCMP[timer + 1] = 0xFFFF;
+    flexio.TIMCFG[timer + 1] = FLEXIO_TIMCFG_TIMOUT(0) | FLEXIO_TIMCFG_TIMDIS(1) | FLEXIO_TIMCFG_TIMENA(1);
+    flexio.TIMCTL[timer + 1] = FLEXIO_TIMCTL_PINCFG(3) | FLEXIO_TIMCTL_PINSEL(ld.flexioPin)
+        | FLEXIO_TIMCTL_PINPOL | FLEXIO_TIMCTL_TIMOD(3);
+
+    flexio.CTRL |= FLEXIO_CTRL_FLEXEN;
+
+    // Switch the pins over last so they go from idle GPIO to idle FlexIO outputs
+    *portConfigRegister(this->m_PIN_SER) = module.mux;
+    *portConfigRegister(this->m_PIN_CLK) = module.mux;
+    *portConfigRegister(this->m_PIN_LD) = module.mux;
+
+    m_buffer = &flexio.SHIFTBUFBIS[shifter];
+    return true;
+}
+
+/**
+ * Set output enable state for a specific instrument
+ */
+template<size_t numOutputs>
+void Teensy41_FlexShift<numOutputs>::setOutputEnabled(uint8_t instrument, bool enabled) {
+    if (instrument >= numOutputs) return;
+
+    // Only mark update if value actually changed
+    if (this->m_outputEnabled[instrument] != enabled) {
+        this->m_outputEnabled[instrument] = enabled;
+        this->m_update = true;
+    }
+}
+
+/**
+ * Get output enable state for a specific instrument
+ */
+template<size_t numOutputs>
+bool Teensy41_FlexShift<numOutputs>::getOutputEnabled(uint8_t instrument) {
+    if (instrument >= numOutputs) return false;
+    return this->m_outputEnabled[instrument];
+}
+
+/**
+ * Disable all outputs
+ */
+template<size_t numOutputs>
+void Teensy41_FlexShift<numOutputs>::disableAll() {
+    // Only mark update if we actually changed something
+    if (this->m_outputEnabled.any()) {
+        this->m_outputEnabled.reset();
+        this->m_update = true;
+    }
+}
+
+/**
+ * Update shift register hardware with current output enable states
+ * Only performs update if state has changed (update flag optimization)
+ *
+ * Same order as Teensy41_SwShift, the highest output is shifted first so output 0 ends up at
+ * Q0 of the first register. The shifter sends bit 0 first, so the outputs are written through
+ * the bit swapped buffer from the top. A write while a transfer is running is sent after it.
+ */
+template<size_t numOutputs>
+void Teensy41_FlexShift<numOutputs>::update() {
+    // Skip update if nothing has changed
+    if (!this->m_update) return;
+
+    if (m_buffer != nullptr) {
+        const uint32_t mask = (numOutputs == 32) ? 0xFFFFFFFF : ((1UL << numOutputs) - 1);
+        const uint32_t outputs = static_cast<uint32_t>(this->m_outputEnabled.to_ulong()) ^ (this->m_inverted ? mask : 0);
+        *m_buffer = outputs << (32 - numOutputs);
+    } else {
+        shiftOut();
+    }
+
+    // Clear update flag after successful update
+    this->m_update = false;
+}
+
+/**
+ * Bit-bang fallback, the same as Teensy41_SwShift
+ */
+template<size_t numOutputs>
+void Teensy41_FlexShift<numOutputs>::shiftOut() {
+    for (int32_t i = static_cast<int32_t>(numOutputs) - 1; i >= 0; i--) {
+        digitalWriteFast(this->m_PIN_SER, this->m_outputEnabled[i] ^ this->m_inverted);
+        delayNanoseconds(CFG_SHIFTREGISTER_DATA_HOLDTIME_NS);
+        digitalWriteFast(this->m_PIN_CLK, HIGH);
+        delayNanoseconds(CFG_SHIFTREGISTER_DATA_HOLDTIME_NS);
+        digitalWriteFast(this->m_PIN_CLK, LOW);
+        delayNanoseconds(CFG_SHIFTREGISTER_DATA_HOLDTIME_NS);
+    }
+
+    digitalWriteFast(this->m_PIN_LD, HIGH);
+    delayNanoseconds(CFG_SHIFTREGISTER_DATA_HOLDTIME_NS);
+    digitalWriteFast(this->m_PIN_LD, LOW);
+    digitalWriteFast(this->m_PIN_SER, LOW);
+}
+
+// Template instantiations for common sizes
+template class Teensy41_FlexShift<8>;
+template class Teensy41_FlexShift<12>;
+template class Teensy41_FlexShift<16>;
+template class Teensy41_FlexShift<24>;
+template class Teensy41_FlexShift<32>;
+
+#endif // PLATFORM_TEENSY41
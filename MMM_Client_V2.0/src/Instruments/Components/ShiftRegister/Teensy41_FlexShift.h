@@ -1,20 +1,24 @@
 /*
  * Teensy41_FlexShift.h
- * 
+ *
  * Teensy 4.x FlexIO-based shift register implementation
  * Uses hardware-accelerated FlexIO peripheral for fast, efficient shift register control
  * Optimized with dirty flag to avoid unnecessary hardware updates
- * 
+ *
+ * One FlexIO shifter clocks the whole chain out of its buffer and two FlexIO timers drive the
+ * serial clock and the load line, so update() is a single register write. Load idles high and
+ * is pulled low for the transfer, its rising edge latches the outputs like Teensy41_SwShift.
+ *
  * Hardware connections:
- *   Data:  Pin 17 (FlexIO1:4 / GPIO_B1_00)
- *   Clock: Pin 16 (FlexIO1:5 / GPIO_B1_01)
- *   Load:  Pin 15 (GPIO - handled via digitalWriteFast)
+ *   Data, Clock and Load must be pins of the same FlexIO module, e.g.
+ *   FlexIO1: 2, 3, 4, 5, 33
+ *   FlexIO2: 6-13, 32, 34-37
+ *   FlexIO3: 14-23, 26, 27, 38-41
+ *   Enable and Reset are plain GPIO. Pins without FlexIO fall back to bit-banging.
  */
 
 #pragma once
 
-#pragma once
-
 #include "Config.h"
 #include "IShiftRegister.h"
 #include <bitset>
@@ -23,6 +27,8 @@
 
 template<size_t numOutputs>
 class Teensy41_FlexShift : public IShiftRegister<numOutputs> {
+    static_assert(numOutputs <= 32, "A FlexIO shifter holds 32 outputs");
+
 public:
     Teensy41_FlexShift(uint8_t PIN_SER, uint8_t PIN_CLK, uint8_t PIN_LD, std::optional<uint8_t> PIN_EN, std::optional<uint8_t> PIN_RST):
         Teensy41_FlexShift::IShiftRegister(PIN_SER, PIN_CLK, PIN_LD, PIN_EN, PIN_RST) {}
@@ -31,4 +37,11 @@ public:
     bool getOutputEnabled(uint8_t instrument) override;
     void disableAll() override;
     void update() override;
-};
\ No newline at end of file
+
+private:
+    // Bit swapped buffer of the shifter driving the chain, nullptr when bit-banging
+    volatile uint32_t* m_buffer = nullptr;
+
+    bool initializeFlexIO();
+    void shiftOut();
+};
@@ -0,0 +1,151 @@
+/*
+ * Teensy41PwmMap.h
+ * Which FlexPWM submodule or QuadTimer channel drives each Teensy 4.1 PWM pin, and their periods
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// A FlexPWM submodule has one counter behind its A, B and X outputs and a QuadTimer channel has
+// one counter behind its pin, so two pins on the same counter can't play different notes. The
+// table follows the Teensy 4.1 core's pwm_pin_info. Frequencies are Hz in Q16 like
+// Tuning::Tables::frequencies, all math is integer.
+namespace Teensy41PwmMap {
+    enum class Timer : uint8_t { None, FlexPwm, QuadTimer };
+    enum Output : uint8_t { X = 0, A = 1, B = 2 };
+
+    struct Resource {
+        Timer timer;
+        uint8_t module;     //FlexPWM 1-4 or QuadTimer 1-4
+        uint8_t submodule;  //FlexPWM submodule or QuadTimer channel 0-3
+        uint8_t output;     //FlexPWM X, A or B
+    };
+
+    constexpr Resource NONE = {Timer::None, 0, 0, 0};
+    constexpr Resource flexPwm(uint8_t module, uint8_t submodule, uint8_t output) {
+        return {Timer::FlexPwm, module, submodule, output};
+    }
+    constexpr Resource quadTimer(uint8_t module, uint8_t channel) {
+        return {Timer::QuadTimer, module, channel, 0};
+    }
+
+    constexpr Resource PINS[] = {
+        flexPwm(1, 1, X),   // 0
+        flexPwm(1, 0, X),   // 1
+        flexPwm(4, 2, A),   // 2
+        flexPwm(4, 2, B),   // 3
+        flexPwm(2, 0, A),   // 4
+        flexPwm(2, 1, A),   // 5
+        flexPwm(2, 2, A),   // 6
+        flexPwm(1, 3, B),   // 7
+        flexPwm(1, 3, A),   // 8
+        flexPwm(2, 2, B),   // 9
+        quadTimer(1, 0),    // 10
+        quadTimer(1, 2),    // 11
+        quadTimer(1, 1),    // 12
+        quadTimer(2, 0),    // 13
+        quadTimer(3, 2),    // 14
+        quadTimer(3, 3),    // 15
+        NONE, NONE,         // 16-17
+        quadTimer(3, 1),    // 18
+        quadTimer(3, 0),    // 19
+        NONE, NONE,         // 20-21
+        flexPwm(4, 0, A),   // 22
+        flexPwm(4, 1, A),   // 23
+        flexPwm(1, 2, X),   // 24
+        flexPwm(1, 3, X),   // 25
+        NONE, NONE,         // 26-27
+        flexPwm(3, 1, B),   // 28
+        flexPwm(3, 1, A),   // 29
+        NONE, NONE, NONE,   // 30-32
+        flexPwm(2, 0, B),   // 33
+        NONE, NONE,         // 34-35
+        flexPwm(2, 3, A),   // 36
+        flexPwm(2, 3, B),   // 37
+        NONE, NONE, NONE, NONE, // 38-41
+        flexPwm(1, 1, B),   // 42
+        flexPwm(1, 1, A),   // 43
+        flexPwm(1, 0, B),   // 44
+        flexPwm(1, 0, A),   // 45
+        flexPwm(1, 2, B),   // 46
+        flexPwm(1, 2, A),   // 47
+        NONE, NONE, NONE,   // 48-50, the same submodules as 44, 47 and 46
+        flexPwm(3, 3, B),   // 51
+        NONE, NONE,         // 52-53, the same submodules as 42 and 43
+        flexPwm(3, 0, A),   // 54
+    };
+    constexpr uint8_t NUM_PINS = sizeof(PINS) / sizeof(PINS[0]);
+
+    constexpr Resource resource(uint8_t pin) {
+        return (pin < NUM_PINS) ? PINS[pin] : NONE;
+    }
+
+    constexpr bool sameCounter(const Resource& a, const Resource& b) {
+        return a.timer == b.timer && a.module == b.module && a.submodule == b.submodule;
+    }
+
+    template <size_t N>
+    constexpr bool pinsHavePwm(const uint8_t (&pins)[N]) {
+        for (size_t i = 0; i < N; i++) {
+            if (resource(pins[i]).timer == Timer::None) return false;
+        }
+        return true;
+    }
+
+    template <size_t N>
+    constexpr bool pinsIndependent(const uint8_t (&pins)[N]) {
+        for (size_t i = 0; i < N; i++) {
+            for (size_t j = i + 1; j < N; j++) {
+                if (sameCounter(resource(pins[i]), resource(pins[j]))) return false;
+            }
+        }
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Periods, both count the IP bus clock through a 2^n prescaler into a 16 bit register
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+
+    constexpr uint8_t MAX_PRESCALE = 7;
+
+    struct Period {
+        uint8_t prescale;   //Power of two the bus clock is divided by
+        uint16_t counts;    //FlexPWM counts per period, QuadTimer counts per half period. 0 if out of range
+    };
+
+    // Bus clock cycles in a period, or half of one, rounded
+    constexpr uint64_t busCycles(uint32_t busHz, uint32_t frequencyQ16, uint8_t shift) {
+        return (frequencyQ16 == 0) ? 0 : ((static_cast<uint64_t>(busHz) << (16 - shift)) + frequencyQ16 / 2) / frequencyQ16;
+    }
+
+    // Out of range is 0 counts, or with clamp the nearest the register holds like the Teensy core
+    constexpr Period scale(uint64_t cycles, uint8_t prescale, bool clamp) {
+        const uint64_t counts = (cycles + ((1ULL << prescale) >> 1)) >> prescale;
+        if (counts < 2) return {prescale, static_cast<uint16_t>(clamp ? 2 : 0)};
+        if (counts > 65535) return {prescale, static_cast<uint16_t>(clamp ? 65535 : 0)};
+        return {prescale, static_cast<uint16_t>(counts)};
+    }
+
+    // The FlexPWM prescaler is buffered with the period, so each change takes the finest one
+    constexpr Period flexPwmPeriod(uint32_t busHz, uint32_t frequencyQ16) {
+        const uint64_t cycles = busCycles(busHz, frequencyQ16, 0);
+        uint8_t prescale = 0;
+        while (prescale < MAX_PRESCALE && (cycles >> prescale) > 65535) prescale++;
+        return scale(cycles, prescale, true);
+    }
+
+    // The QuadTimer prescaler takes effect straight away, so it is picked when a note starts
+    // with room for bends two octaves down and then only the half period moves
+    constexpr uint8_t quadTimerPrescale(uint32_t busHz, uint32_t frequencyQ16) {
+        const uint64_t cycles = busCycles(busHz, frequencyQ16, 1) * 4;
+        uint8_t prescale = 0;
+        while (prescale < MAX_PRESCALE && (cycles >> prescale) > 65535) prescale++;
+        return prescale;
+    }
+
+    constexpr Period quadTimerPeriod(uint32_t busHz, uint32_t frequencyQ16, uint8_t prescale, bool clamp) {
+        return scale(busCycles(busHz, frequencyQ16, 1), prescale, clamp);
+    }
+}
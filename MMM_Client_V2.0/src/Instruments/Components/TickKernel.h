@@ -0,0 +1,57 @@
+/*
+ * TickKernel.h
+ * Software PWM tick counters advanced two voices at a time
+ */
+#pragma once
+
+#include <cstdint>
+
+// Counters are packed two per word, the even voice in the low half. A counter at or past its
+// period wraps to 0 and reports an edge, any other counts up, the same as the scalar tick.
+namespace TickKernel {
+    constexpr uint32_t LANE_ONE = 0x00010001;
+
+    // Returns the lanes due for an edge as bit 0 (low half) and bit 1 (high half)
+    inline __attribute__((always_inline)) uint32_t advancePairScalar(uint32_t& ticks, uint32_t periods) {
+        uint32_t due = 0;
+        uint32_t next = 0;
+        for (uint8_t lane = 0; lane < 2; lane++) {
+            const uint16_t tick = ticks >> (lane * 16);
+            const uint16_t period = periods >> (lane * 16);
+            if (tick >= period) {
+                due |= 1U << lane;
+            } else {
+                next |= static_cast<uint32_t>(tick + 1) << (lane * 16);
+            }
+        }
+        ticks = next;
+        return due;
+    }
+
+#if defined(__ARM_FEATURE_SIMD32)
+    // UADD16 counts both lanes up, USUB16 sets a GE flag per lane with tick >= period and SEL
+    // picks 0 or the count per lane from them. Kept in one asm block since UADD16 also writes GE.
+    inline __attribute__((always_inline)) uint32_t advancePair(uint32_t& ticks, uint32_t periods) {
+        uint32_t next;
+        uint32_t due;
+        asm ("uadd16 %[next], %[ticks], %[one]\n\t"
+             "usub16 %[due], %[ticks], %[periods]\n\t"
+             "sel %[next], %[zero], %[next]\n\t"
+             "sel %[due], %[one], %[zero]"
+             : [next] "=&r" (next), [due] "=&r" (due)
+             : [ticks] "r" (ticks), [periods] "r" (periods), [one] "r" (LANE_ONE), [zero] "r" (0)
+             : "cc");
+        ticks = next;
+        return (due | (due >> 15)) & 0x3;
+    }
+#else
+    inline __attribute__((always_inline)) uint32_t advancePair(uint32_t& ticks, uint32_t periods) {
+        return advancePairScalar(ticks, periods);
+    }
+#endif
+
+    inline void setLane(uint32_t& word, uint8_t voice, uint16_t value) {
+        const uint8_t shift = (voice & 1) * 16;
+        word = (word & ~(0xFFFFUL << shift)) | (static_cast<uint32_t>(value) << shift);
+    }
+};
@@ -0,0 +1,116 @@
+/*
+ * ToneChannels.h
+ * Assigns voices to ESP32 square wave peripherals and works out their period registers
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// RMT channels loop one item holding a high and a low duration, MCPWM timers count a period
+// with the compare at half of it. Both run without the CPU once started. Frequencies are Hz in
+// Q16 like Tuning::Tables::frequencies, all math is integer.
+namespace ToneChannels {
+    enum class Engine : uint8_t { Rmt, Mcpwm, Software };
+
+    struct Slot {
+        Engine engine;
+        uint8_t unit;    //MCPWM unit
+        uint8_t index;   //RMT channel or MCPWM timer
+    };
+
+    constexpr uint8_t RMT_NUM_CHANNELS = 8;
+    constexpr uint8_t MCPWM_NUM_UNITS = 2;
+    constexpr uint8_t MCPWM_TIMERS_PER_UNIT = 3;
+
+    // RMT channels are handed out from the highest down, other users of RMT such as the LED
+    // driver take them from 0 up. Voices past the hardware play from the software tick.
+    template <size_t N>
+    constexpr std::array<Slot, N> allocate(uint8_t rmtChannels, uint8_t mcpwmTimers) {
+        std::array<Slot, N> slots = {};
+        for (size_t voice = 0; voice < N; voice++) {
+            if (voice < rmtChannels) {
+                slots[voice] = {Engine::Rmt, 0, static_cast<uint8_t>(RMT_NUM_CHANNELS - 1 - voice)};
+            } else if (voice < static_cast<size_t>(rmtChannels) + mcpwmTimers) {
+                const uint8_t timer = static_cast<uint8_t>(voice - rmtChannels);
+                slots[voice] = {Engine::Mcpwm, static_cast<uint8_t>(timer / MCPWM_TIMERS_PER_UNIT),
+                                static_cast<uint8_t>(timer % MCPWM_TIMERS_PER_UNIT)};
+            } else {
+                slots[voice] = {Engine::Software, 0, 0};
+            }
+        }
+        return slots;
+    }
+
+    // Clock cycles in one period of a frequency, rounded
+    constexpr uint64_t cyclesPerPeriod(uint32_t clockHz, uint32_t frequencyQ16) {
+        return (frequencyQ16 == 0) ? 0 : ((static_cast<uint64_t>(clockHz) << 16) + frequencyQ16 / 2) / frequencyQ16;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // RMT, 80MHz APB clock through an 8 bit divider, each duration 15 bits
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+
+    constexpr uint32_t RMT_CLOCK_HZ = 80000000;
+    constexpr uint16_t RMT_MAX_DURATION = 32767;
+
+    struct RmtPeriod {
+        uint8_t divider;   //0 if the frequency is out of range
+        uint16_t high;
+        uint16_t low;
+    };
+
+    // Smallest divider that fits a period headroom times longer, so bends and vibrato below the
+    // note can be followed by rewriting the durations alone. A headroom of 4 covers two octaves.
+    constexpr uint8_t rmtDivider(uint32_t frequencyQ16, uint8_t headroom) {
+        const uint64_t cycles = cyclesPerPeriod(RMT_CLOCK_HZ, frequencyQ16) * headroom;
+        const uint64_t divider = (cycles + 2 * RMT_MAX_DURATION - 1) / (2 * RMT_MAX_DURATION);
+        return (divider == 0) ? 1 : (divider > 255) ? 255 : static_cast<uint8_t>(divider);
+    }
+
+    // Durations for a frequency at a divider, the odd count goes to the low half
+    constexpr RmtPeriod rmtPeriod(uint32_t frequencyQ16, uint8_t divider) {
+        if (divider == 0) return {0, 0, 0};
+        const uint64_t units = (cyclesPerPeriod(RMT_CLOCK_HZ, frequencyQ16) + divider / 2) / divider;
+        if (units < 2 || units > 2 * RMT_MAX_DURATION) return {0, 0, 0};
+        const uint16_t high = static_cast<uint16_t>(units / 2);
+        return {divider, high, static_cast<uint16_t>(units - high)};
+    }
+
+    constexpr uint32_t rmtFrequencyQ16(const RmtPeriod& period) {
+        const uint64_t cycles = static_cast<uint64_t>(period.divider) * (period.high + period.low);
+        return (cycles == 0) ? 0 : static_cast<uint32_t>(((static_cast<uint64_t>(RMT_CLOCK_HZ) << 16) + cycles / 2) / cycles);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // MCPWM, 160MHz divided to a 40MHz group clock then an 8 bit timer prescaler, 16 bit period
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // A third of a cent at the top note and still down to 2.4Hz, the driver default is 10MHz
+    constexpr uint32_t MCPWM_GROUP_CLOCK_HZ = 40000000;
+    constexpr uint32_t MCPWM_MAX_PERIOD = 65535;
+
+    struct McpwmPeriod {
+        uint16_t prescale;  //1 to 256, 0 if the frequency is out of range
+        uint16_t ticks;     //Timer counts per period, the compare sits at half
+    };
+
+    constexpr uint16_t mcpwmPrescale(uint32_t frequencyQ16, uint8_t headroom) {
+        const uint64_t cycles = cyclesPerPeriod(MCPWM_GROUP_CLOCK_HZ, frequencyQ16) * headroom;
+        const uint64_t prescale = (cycles + MCPWM_MAX_PERIOD - 1) / MCPWM_MAX_PERIOD;
+        return (prescale == 0) ? 1 : (prescale > 256) ? 256 : static_cast<uint16_t>(prescale);
+    }
+
+    constexpr McpwmPeriod mcpwmPeriod(uint32_t frequencyQ16, uint16_t prescale) {
+        if (prescale == 0) return {0, 0};
+        const uint64_t ticks = (cyclesPerPeriod(MCPWM_GROUP_CLOCK_HZ, frequencyQ16) + prescale / 2) / prescale;
+        if (ticks < 2 || ticks > MCPWM_MAX_PERIOD) return {0, 0};
+        return {prescale, static_cast<uint16_t>(ticks)};
+    }
+
+    constexpr uint32_t mcpwmFrequencyQ16(const McpwmPeriod& period) {
+        const uint64_t cycles = static_cast<uint64_t>(period.prescale) * period.ticks;
+        return (cycles == 0) ? 0 : static_cast<uint32_t>(((static_cast<uint64_t>(MCPWM_GROUP_CLOCK_HZ) << 16) + cycles / 2) / cycles);
+    }
+};
@@ -0,0 +1,149 @@
+#include "TuningTable.h"
+#include "NoteTable.h"
+
+namespace {
+
+// Offsets from equal temperament per pitch class in hundredths of a cent
+using PresetOffsets = std::array<int16_t, 12>;
+//                                                  C     C#     D     Eb     E     F     F#     G     G#     A     Bb     B
+constexpr PresetOffsets EQUAL_OFFSETS             = {0,     0,    0,     0,    0,    0,     0,    0,     0,    0,     0,    0};
+constexpr PresetOffsets PYTHAGOREAN_OFFSETS       = {0,  1369,  391,  -587,  782, -196,  1173,  196,  1564,  587,  -391,  978};
+constexpr PresetOffsets JUST_OFFSETS              = {0,  1173,  391,  1564,-1369, -196,  -978,  196,  1369,-1564,  1760,-1173};
+constexpr PresetOffsets MEANTONE_OFFSETS          = {0, -2395, -684,  1026,-1369,  342, -2053, -342, -2737,-1026,   684,-1711};
+constexpr PresetOffsets WERCKMEISTER_III_OFFSETS  = {0,  -978, -782,  -587, -978, -196, -1173, -391,  -782,-1173,  -391, -782};
+
+// Period of note 0 (8.1758Hz) in microseconds, Q12 fixed point
+constexpr uint32_t NOTE_0_PERIOD_Q12 = 500990795;
+
+// 2^(-k/12) in Q30, the period ratio of each semitone within an octave
+constexpr std::array<uint32_t, 12> SEMITONE_RATIO_Q30 = {
+    1073741824, 1013477326, 956595215, 902905651, 852229450, 804397487,
+    759250125, 716636690, 676414963, 638450708, 602617224, 568794918
+};
+
+// 2^(-i/192) in Q30, the period ratio in sixteenths of a semitone. Interpolating
+// between entries stays well under a hundredth of a cent.
+constexpr std::array<uint32_t, 17> FRACTION_RATIO_Q30 = {
+    1073741824, 1069872453, 1066017025, 1062175491, 1058347801, 1054533904,
+    1050733751, 1046947292, 1043174479, 1039415261, 1035669590, 1031937417,
+    1028218693, 1024513371, 1020821401, 1017142735, 1013477326
+};
+
+// Equal temperament tables are built at compile time from NoteTables
+constexpr Tuning::Tables makeDefaultTables()
+{
+    Tuning::Tables tables{};
+    for (int i = 0; i < 128; ++i) {
+        tables.periods[i] = NoteTables::NOTE_PERIODS[i];
+        tables.ticks[i] = NoteTables::NOTE_TICKS[i];
+        tables.ticksDouble[i] = NoteTables::NOTE_TICKS_DOUBLE[i];
+        tables.frequencies[i] = static_cast<uint32_t>(NoteTables::noteFrequency[i] * 65536.0 + 0.5);
+    }
+    return tables;
+}
+
+constexpr std::array<Tuning::Pitch, 128> makeEqualPitches()
+{
+    std::array<Tuning::Pitch, 128> pitches{};
+    for (uint32_t i = 0; i < 128; ++i) pitches[i] = i << Tuning::PITCH_FRACTION_BITS;
+    return pitches;
+}
+
+std::array<Tuning::Tables, 2> s_tables = {makeDefaultTables(), makeDefaultTables()};
+volatile uint8_t s_active = 0;
+
+// Staged pitch of every note, only read when building tables
+std::array<Tuning::Pitch, 128> s_pitches = makeEqualPitches();
+TuningPreset s_preset = TuningPreset::EqualTemperament;
+
+// Period of a pitch in microseconds, Q12 fixed point
+uint32_t pitchToPeriodQ12(Tuning::Pitch pitch)
+{
+    const uint32_t semitones = pitch >> Tuning::PITCH_FRACTION_BITS;
+    const uint32_t fraction = pitch & (Tuning::SEMITONE - 1);
+
+    // Linear interpolation between sixteenth semitone steps
+    const uint32_t step = fraction >> 10;
+    const uint32_t weight = fraction & 0x3FF;
+    const uint32_t fractionRatio = FRACTION_RATIO_Q30[step]
+        - static_cast<uint32_t>((static_cast<uint64_t>(FRACTION_RATIO_Q30[step] - FRACTION_RATIO_Q30[step + 1]) * weight) >> 10);
+
+    uint64_t period = (static_cast<uint64_t>(NOTE_0_PERIOD_Q12) * SEMITONE_RATIO_Q30[semitones % 12]) >> 30;
+    period = (period * fractionRatio) >> 30;
+    return static_cast<uint32_t>(period >> (semitones / 12));
+}
+
+uint16_t clampPeriod(uint32_t periodQ12)
+{
+    const uint32_t periodUs = (periodQ12 + (1UL << 11)) >> 12;
+    return (periodUs > UINT16_MAX) ? UINT16_MAX : static_cast<uint16_t>(periodUs);
+}
+
+}
+
+const Tuning::Tables& Tuning::active()
+{
+    return s_tables[s_active];
+}
+
+void Tuning::setNotePitch(uint8_t note, Pitch pitch)
+{
+    if (note > 127) return;
+    s_pitches[note] = (pitch > MAX_PITCH) ? MAX_PITCH : pitch;
+    s_preset = TuningPreset::Custom;
+}
+
+void Tuning::setPitchClassOffsets(const std::array<int32_t, 12>& offsets)
+{
+    for (uint8_t note = 0; note < 128; ++note) {
+        int32_t pitch = static_cast<int32_t>(note << PITCH_FRACTION_BITS) + offsets[note % 12];
+        if (pitch < 0) pitch = 0;
+        s_pitches[note] = (static_cast<Pitch>(pitch) > MAX_PITCH) ? MAX_PITCH : static_cast<Pitch>(pitch);
+    }
+    s_preset = TuningPreset::Custom;
+}
+
+// Builds the inactive tables from the staged pitches then swaps them in
+void Tuning::commit()
+{
+    const uint8_t next = s_active ^ 1;
+    Tables& tables = s_tables[next];
+
+    for (uint8_t note = 0; note < 128; ++note) {
+        const uint32_t periodQ12 = pitchToPeriodQ12(s_pitches[note]);
+        const uint16_t period = clampPeriod(periodQ12);
+        tables.periods[note] = period;
+        tables.ticks[note] = period / CFG_TIMER_RESOLUTION_US;
+        tables.ticksDouble[note] = period / (CFG_TIMER_RESOLUTION_US * 2);
+        tables.frequencies[note] = static_cast<uint32_t>((1000000ULL << 28) / periodQ12);
+    }
+
+    s_active = next;
+}
+
+bool Tuning::selectPreset(TuningPreset preset)
+{
+    const PresetOffsets* offsets = nullptr;
+    switch (preset) {
+        case TuningPreset::EqualTemperament:     offsets = &EQUAL_OFFSETS; break;
+        case TuningPreset::Pythagorean:          offsets = &PYTHAGOREAN_OFFSETS; break;
+        case TuningPreset::JustIntonation:       offsets = &JUST_OFFSETS; break;
+        case TuningPreset::QuarterCommaMeantone: offsets = &MEANTONE_OFFSETS; break;
+        case TuningPreset::WerckmeisterIII:      offsets = &WERCKMEISTER_III_OFFSETS; break;
+        default: return false;
+    }
+
+    std::array<int32_t, 12> pitchOffsets;
+    for (uint8_t i = 0; i < 12; ++i) {
+        pitchOffsets[i] = static_cast<int32_t>((*offsets)[i]) * static_cast<int32_t>(SEMITONE) / 10000;
+    }
+    setPitchClassOffsets(pitchOffsets);
+    commit();
+    s_preset = preset;
+    return true;
+}
+
+TuningPreset Tuning::getPreset()
+{
+    return s_preset;
+}
@@ -0,0 +1,41 @@
+/*
+ * TuningTable.h
+ * Runtime note tables that can be retuned with the MIDI Tuning Standard (MTS)
+ */
+#pragma once
+
+#include "Constants.h"
+#include <array>
+#include <cstdint>
+
+namespace Tuning {
+    // Pitch of a note in semitones above note 0 with a 14 bit fraction, as carried by MTS
+    using Pitch = uint32_t;
+    constexpr uint8_t PITCH_FRACTION_BITS = 14;
+    constexpr Pitch SEMITONE = 1UL << PITCH_FRACTION_BITS;
+    constexpr Pitch MAX_PITCH = (128UL << PITCH_FRACTION_BITS) - 1;
+
+    // Everything the instruments look up for a note under the active tuning
+    struct Tables {
+        std::array<uint16_t, 128> periods;     // Microseconds, clamped to uint16_t max
+        std::array<uint16_t, 128> ticks;       // Periods in timer ticks
+        std::array<uint16_t, 128> ticksDouble; // Periods in half rate timer ticks
+        std::array<uint32_t, 128> frequencies; // Hz in Q16 fixed point
+    };
+
+    // Tables currently used by the instruments. A retune builds the other buffer and
+    // swaps it in with a single write so readers never see a half built table.
+    const Tables& active();
+
+    inline double frequency(uint8_t note) { return active().frequencies[note & 0x7F] / 65536.0; }
+
+    // Retuning is staged, nothing reaches the instruments until commit()
+    void setNotePitch(uint8_t note, Pitch pitch);
+    // Offsets from equal temperament for each pitch class C to B, in Pitch units
+    void setPitchClassOffsets(const std::array<int32_t, 12>& offsets);
+    void commit();
+
+    // Loads and commits one of the built-in tunings
+    bool selectPreset(TuningPreset preset);
+    TuningPreset getPreset();
+};
@@ -0,0 +1,54 @@
+/*
+ * VoiceMailbox.h
+ * Hands voice parameters from control code to the tick interrupt without masking it
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// One slot per voice and a single commit word with a bit per voice. Control code writes slots
+// and sets their bits in one atomic step, the tick takes every set bit at once and reads those
+// slots, so voices committed together are applied on the same tick.
+//
+// A voice's bit is withdrawn while its slot is rewritten. A tick landing mid-write leaves that
+// voice for the next tick and neither side ever waits on the other. This relies on the tick
+// interrupting the control code on the same core, never running beside it on another.
+template <typename Params, uint8_t N>
+class VoiceMailbox {
+    static_assert(N <= 32, "The commit word is 32 bits");
+
+public:
+    // Control side. Withdraws the voice and returns its slot to write, pending is set if the
+    // slot still holds a change the tick hasn't taken, to be merged rather than overwritten.
+    Params& open(uint8_t voice, bool& pending) {
+        const uint32_t bit = 1UL << voice;
+        // Acquire keeps the caller's slot writes after the withdrawal, even from the compiler
+        const uint32_t withdrawn = m_committed.fetch_and(~bit, std::memory_order_acquire) & bit;
+        pending = ((withdrawn | m_opened) & bit) != 0;
+        m_opened |= bit;
+        return m_slots[voice];
+    }
+
+    // Control side, hands every opened voice in the mask to the tick together
+    void commit(uint32_t voices) {
+        m_opened &= ~voices;
+        m_committed.fetch_or(voices, std::memory_order_release);
+    }
+
+    // Tick side, the voices committed since the last take(). Their slots are read with slot().
+    inline __attribute__((always_inline)) uint32_t take() {
+        if (m_committed.load(std::memory_order_relaxed) == 0) return 0;
+        return m_committed.exchange(0, std::memory_order_acquire);
+    }
+
+    inline __attribute__((always_inline)) const Params& slot(uint8_t voice) const {
+        return m_slots[voice];
+    }
+
+private:
+    std::array<Params, N> m_slots = {};
+    std::atomic<uint32_t> m_committed{0};
+    uint32_t m_opened = 0; // Opened and not yet committed, only the control side uses it
+};
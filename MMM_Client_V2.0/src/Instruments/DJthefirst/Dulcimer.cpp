@@ -59,8 +59,7 @@ void Dulcimer::checkSolenoidTimeouts() {
                 m_noteStartTime[i] = 0;
                 
                 // Push Update
-                m_shiftReg1->update();
-                m_shiftReg2->update();
+                pushUpdate();
                 setInstrumentLedOff(i);
             }
         }
@@ -88,8 +87,7 @@ void Dulcimer::playNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint
     }
     
     // Push Update
-    m_shiftReg1->update();
-    m_shiftReg2->update();
+    pushUpdate();
     setInstrumentLedOn(notePos, channel, note, velocity);
 }
 
@@ -114,9 +112,21 @@ void Dulcimer::stopNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint
     m_numActiveNotes--;
 
     // Push Update
+    pushUpdate();
+    setInstrumentLedOff(notePos);
+}
+
+// Flush every change made during the batch with a single shift out
+void Dulcimer::publishBatch() {
+    m_shiftReg1->update();
+    m_shiftReg2->update();
+}
+
+// Shift register flushes are deferred while a batch is open
+void Dulcimer::pushUpdate() {
+    if (isBatching()) return;
     m_shiftReg1->update();
     m_shiftReg2->update();
-    setInstrumentLedOff(notePos);
 }
 
 void Dulcimer::reset(uint8_t instrument) {
@@ -134,6 +144,7 @@ void Dulcimer::resetAll() {
     // Clear all tracking
     m_noteStartTime.fill(0);
     m_numActiveNotes = 0;
+    releaseAllVoiceOwners();
     
     // Reset LEDs
     resetLEDs();
@@ -57,11 +57,19 @@ public:
 
     Instrument getInstrumentType() const override { return Instrument::ShiftRegister; }
     uint8_t getNumActiveNotes(uint8_t instrument) override;
+    uint8_t getMaxActiveNotes(uint8_t instrument) override { return NUM_OUTPUTS; }
+    bool canPlayNote(uint8_t instrument, uint8_t note) override {
+        return instrument < HardwareConfig::MAX_NUM_INSTRUMENTS && NOTE_TO_SHIFT_REG_OUTPUT[note & 0x7F] != 0;
+    }
     bool isNoteActive(uint8_t instrument, uint8_t note) override;
     
+protected:
+    void publishBatch() override;
+
 private:
     void setInstrumentLedOn(uint8_t instrument, uint8_t channel, uint8_t note, uint8_t velocity) override;
     void setInstrumentLedOff(uint8_t instrument) override;
     void checkSolenoidTimeouts();
     void togglePin(uint8_t instrument);
+    void pushUpdate();
 };
\ No newline at end of file
@@ -1,5 +1,34 @@
 #include "InstrumentControllerBase.h"
 #include "Config.h"
+#include <Arduino.h>
+
+#ifdef CFG_LATENCY_COMPENSATION
+#include "Components/LatencyScheduler.h"
+#include "Components/EventTimer.h"
+
+// Native test builds provide their own EventTimer
+#if !defined(PLATFORM_ESP32) && !defined(PLATFORM_TEENSY41) && !defined(PLATFORM_NATIVE)
+    #error "CFG_LATENCY_COMPENSATION needs the ESP32 or Teensy 4.1 one-shot timer"
+#endif
+
+namespace {
+// Used by the main loop, and by the event timer interrupt only while the loop is outside the controller
+LatencyScheduler scheduler;
+InstrumentControllerBase* interruptController = nullptr;
+}
+#endif
+
+InstrumentControllerBase::InstrumentControllerBase(){
+    std::fill_n(m_pitchBendRange, Midi::NUM_CH, CFG_PITCH_BEND_RANGE_CENTS);
+    rebuildWearOrder();
+
+    #ifdef CFG_LATENCY_COMPENSATION
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+        setInstrumentLatency(i, HardwareConfig::INSTRUMENT_LATENCY_US[i]);
+    }
+    EventTimer::initialize();
+    #endif
+}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 //Getters and Setters
@@ -11,6 +40,11 @@ void InstrumentControllerBase::setKeyPressure(uint8_t channel, uint8_t note, uin
 void InstrumentControllerBase::setPitchBend(uint8_t channel,uint16_t bend){
     // Default implementation does nothing - derived classes should override if needed
 }
+void InstrumentControllerBase::setPitchBendRange(uint8_t channel, uint16_t cents){
+    if (channel >= Midi::NUM_CH) return;
+    m_pitchBendRange[channel] = cents;
+    setPitchBend(channel, m_pitchBend[channel]);
+}
 void InstrumentControllerBase::setProgramChange(uint8_t channel, uint8_t value){
     // Default implementation does nothing - derived classes should override if needed
 }
@@ -25,6 +59,234 @@ void InstrumentControllerBase::setControlChange(uint8_t channel, uint8_t control
 //Distributor Tracking Functions
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+bool InstrumentControllerBase::canPlayNote(uint8_t instrument, uint8_t note){
+    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) return false;
+
+    const auto& range = HardwareConfig::INSTRUMENT_NOTE_RANGES[instrument];
+    if (range[1] == 0) return note >= CFG_MIN_NOTE && note <= CFG_MAX_NOTE;
+    return note >= range[0] && note <= range[1];
+}
+
+void InstrumentControllerBase::buildEligibility(){
+    for (uint8_t note = 0; note < 128; note++) {
+        uint32_t eligible = 0;
+        for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+            if (canPlayNote(i, note)) eligible |= (1UL << i);
+        }
+        m_eligibleInstruments[note] = eligible;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//Wear Tracking Functions
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Ties rotate, the instrument just used moves behind the others with its old count
+void InstrumentControllerBase::countActuation(uint8_t instrument){
+    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) return;
+    m_wear[instrument].actuations++;
+    m_wearChanged = true;
+
+    // Swap to the end of the group, which keeps the rest of the group in order
+    uint8_t group = m_wearGroup[instrument];
+    const uint8_t last = m_wearGroups[group].last;
+    const uint8_t displaced = m_wearOrder[last];
+    m_wearOrder[m_wearRank[instrument]] = displaced;
+    m_wearRank[displaced] = m_wearRank[instrument];
+    m_wearOrder[last] = instrument;
+    m_wearRank[instrument] = last;
+
+    // Leave the old group, then join the next one if it has the new count
+    if (m_wearGroups[group].first == last) {
+        m_freeWearGroups |= (1UL << group);
+    } else {
+        m_wearGroups[group].last = last - 1;
+    }
+    if (last + 1 < HardwareConfig::MAX_NUM_INSTRUMENTS
+        && m_wear[m_wearOrder[last + 1]].actuations == m_wear[instrument].actuations) {
+        group = m_wearGroup[m_wearOrder[last + 1]];
+        m_wearGroups[group].first = last;
+    } else {
+        group = __builtin_ctz(m_freeWearGroups);
+        m_freeWearGroups &= ~(1UL << group);
+        m_wearGroups[group] = {last, last};
+    }
+    m_wearGroup[instrument] = group;
+}
+
+void InstrumentControllerBase::countOnTime(uint8_t instrument){
+    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS || m_noteStartTime[instrument] == 0) return;
+
+    uint32_t elapsed = m_wearPendingMs[instrument] + (millis() - m_noteStartTime[instrument]);
+    m_wear[instrument].onTimeSeconds += elapsed / 1000;
+    m_wearPendingMs[instrument] = elapsed % 1000;
+    m_wearChanged = true;
+}
+
+void InstrumentControllerBase::setInstrumentWear(uint8_t instrument, const InstrumentWear& wear){
+    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) return;
+    m_wear[instrument] = wear;
+    rebuildWearOrder();
+}
+
+void InstrumentControllerBase::resetInstrumentWear(uint8_t instrument){
+    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) return;
+    m_wear[instrument] = {};
+    m_wearPendingMs[instrument] = 0;
+    m_wearChanged = true;
+    rebuildWearOrder();
+}
+
+// Insertion sort, only used when counters are loaded or reset
+void InstrumentControllerBase::rebuildWearOrder(){
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+        uint8_t pos = i;
+        while (pos > 0 && m_wear[m_wearOrder[pos - 1]].actuations > m_wear[i].actuations) {
+            m_wearOrder[pos] = m_wearOrder[pos - 1];
+            pos--;
+        }
+        m_wearOrder[pos] = i;
+    }
+    for (uint8_t rank = 0; rank < HardwareConfig::MAX_NUM_INSTRUMENTS; rank++) {
+        m_wearRank[m_wearOrder[rank]] = rank;
+    }
+
+    // One group per distinct count, the rest are free
+    uint8_t numGroups = 0;
+    for (uint8_t rank = 0; rank < HardwareConfig::MAX_NUM_INSTRUMENTS; rank++) {
+        const uint8_t instrument = m_wearOrder[rank];
+        if (rank == 0 || m_wear[m_wearOrder[rank - 1]].actuations != m_wear[instrument].actuations) {
+            m_wearGroups[numGroups++] = {rank, rank};
+        }
+        m_wearGroups[numGroups - 1].last = rank;
+        m_wearGroup[instrument] = numGroups - 1;
+    }
+    m_freeWearGroups = 0;
+    for (uint8_t group = numGroups; group < HardwareConfig::MAX_NUM_INSTRUMENTS; group++) {
+        m_freeWearGroups |= (1UL << group);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//Latency Compensation Functions
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef CFG_LATENCY_COMPENSATION
+
+void InstrumentControllerBase::setInstrumentLatency(uint8_t instrument, uint32_t latencyUs){
+    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) return;
+    m_instrumentLatencyUs[instrument] = latencyUs;
+    // Instruments slower than the lookahead cannot be fired early enough, they play straight away
+    m_outputDelayUs[instrument] = (latencyUs < HardwareConfig::LOOKAHEAD_US) ? HardwareConfig::LOOKAHEAD_US - latencyUs : 0;
+}
+
+bool InstrumentControllerBase::scheduleNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel, bool noteOn){
+    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) return false;
+
+    // Changes must reach an instrument in order, only skip the queue if nothing is waiting for it
+    if (m_outputDelayUs[instrument] == 0 && m_pendingOnsets[instrument] == 0 && m_pendingStops[instrument] == 0) return false;
+
+    LatencyScheduler::Event event = {};
+    event.fireAtUs = micros() + m_outputDelayUs[instrument];
+    event.instrument = instrument;
+    event.note = note;
+    event.velocity = velocity;
+    event.channel = channel;
+    event.claim = m_claimCount[instrument];
+    event.noteOn = noteOn;
+
+    const bool earliest = scheduler.empty() || static_cast<int32_t>(event.fireAtUs - scheduler.top().fireAtUs) < 0;
+    if (!scheduler.push(event)) return false; // Queue full, play it late rather than drop it
+
+    if (noteOn) {
+        m_pendingOnsets[instrument]++;
+    } else {
+        m_pendingStops[instrument]++;
+    }
+    if (earliest) EventTimer::schedule(m_outputDelayUs[instrument]);
+    return true;
+}
+
+// The interrupt runs on the core which set up the timer, the main loop's, so it never overlaps
+// a batch or LoopSection. It only has to check none is open.
+void InstrumentControllerBase::setInterruptFiring(bool enabled){
+    interruptController = enabled ? this : nullptr;
+    EventTimer::setHandler(enabled ? fireFromInterrupt : nullptr);
+}
+
+void InstrumentControllerBase::fireFromInterrupt(){
+    if (interruptController == nullptr) return;
+    // The loop is changing the instruments, the flag stays raised and its next pass sends the notes
+    if (interruptController->isBatching() || interruptController->m_loopDepth != 0) return;
+    interruptController->fireScheduledNotes();
+}
+
+void InstrumentControllerBase::cancelScheduledNotes(){
+    scheduler.clear();
+    m_pendingOnsets.fill(0);
+    m_pendingStops.fill(0);
+}
+
+// Sends every change which is due as one batch then arms the timer for the next
+void InstrumentControllerBase::fireScheduledNotes(){
+    // The flag is cleared before the queue is read, an expiry raised meanwhile is served below
+    if (!EventTimer::takeExpired()) return;
+
+    beginBatch();
+    while (!scheduler.empty()) {
+        int32_t wait = static_cast<int32_t>(scheduler.top().fireAtUs - micros());
+        if (wait > 0) {
+            EventTimer::schedule(wait);
+            break;
+        }
+        const LatencyScheduler::Event event = scheduler.top();
+        scheduler.pop();
+
+        if (event.noteOn) {
+            m_pendingOnsets[event.instrument]--;
+            playNote(event.instrument, event.note, event.velocity, event.channel);
+            continue;
+        }
+        m_pendingStops[event.instrument]--;
+
+        // A newer voice claimed the instrument after this stop was queued, keep its ownership record
+        VoiceOwner owner = m_voiceOwner[event.instrument];
+        const bool reclaimed = event.claim != m_claimCount[event.instrument];
+        if (reclaimed) m_voiceOwner[event.instrument] = {};
+        stopNote(event.instrument, event.note, event.velocity, event.channel);
+        if (reclaimed) m_voiceOwner[event.instrument] = owner;
+    }
+    commitBatch();
+}
+
+uint8_t InstrumentControllerBase::getNumBusyNotes(uint8_t instrument){
+    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) return 0;
+    if (m_pendingOnsets[instrument] == 0 && m_pendingStops[instrument] == 0) return getNumActiveNotes(instrument);
+
+    // A monophonic instrument ends up in the state of its last queued change
+    if (getMaxActiveNotes(instrument) <= 1) {
+        const LatencyScheduler::Event* latest = scheduler.findLatest(instrument, NONE);
+        if (latest != nullptr) return latest->noteOn ? 1 : 0;
+    }
+
+    int16_t busy = getNumActiveNotes(instrument) + m_pendingOnsets[instrument] - m_pendingStops[instrument];
+    return (busy > 0) ? busy : 0;
+}
+
+bool InstrumentControllerBase::isNoteBusy(uint8_t instrument, uint8_t note){
+    if (instrument >= HardwareConfig::MAX_NUM_INSTRUMENTS) return false;
+
+    if (m_pendingOnsets[instrument] != 0 || m_pendingStops[instrument] != 0) {
+        // Monophonic instruments replace their note, so any queued change decides
+        const uint8_t match = (getMaxActiveNotes(instrument) <= 1) ? NONE : note;
+        const LatencyScheduler::Event* latest = scheduler.findLatest(instrument, match);
+        if (latest != nullptr) return latest->noteOn && latest->note == note;
+    }
+    return isNoteActive(instrument, note);
+}
+
+#endif
+
 void InstrumentControllerBase::checkInstrumentTimeouts(){
     // Default implementation does nothing - derived classes should override if needed
 }
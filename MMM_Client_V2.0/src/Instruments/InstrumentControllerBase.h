@@ -1,8 +1,10 @@
 #pragma once
 
 #include "Constants.h"
+#include "Config.h"
 #include <cstdint>
 #include <array>
+#include <atomic>
 #include <bitset>
 
 // Forward declarations
@@ -15,13 +17,59 @@ public:
 
 protected:
     //Distributor Tracking Attributes
-    std::array<void*, NUM_Instruments> m_lastDistributor = {nullptr};
-    std::array<uint8_t, NUM_Instruments> m_lastChannel = {NONE};
+
+    // Owner of each instrument's voice. Read together by every distributor scan, so kept
+    // as one packed record per instrument. Start time stays in m_noteStartTime which the
+    // timeout scan reads on its own.
+    struct VoiceOwner {
+        uint8_t distributor = NONE; // Pool slot of the distributor that started the voice
+        uint8_t channel = NONE;
+        uint8_t note = 0;
+    };
+    std::array<VoiceOwner, NUM_Instruments> m_voiceOwner = {};
+    // The same ownership as one bitmask of instruments per distributor, for bulk queries
+    std::array<uint32_t, HardwareConfig::MAX_NUM_DISTRIBUTORS> m_ownedVoices = {};
     std::bitset<NUM_Instruments> m_activeInstruments = 0;
     std::array<uint32_t, NUM_Instruments> m_noteStartTime = {0}; // When each note started (for timeout and longest-playing tracking)
 
+    // Instruments able to play each note, one bit per instrument. Built once by buildEligibility().
+    std::array<uint32_t, 128> m_eligibleInstruments = {};
+
+    // Cumulative usage per instrument. m_wearOrder lists the instruments least used first,
+    // m_wearRank is each instrument's position. Instruments with equal counts form a group of
+    // consecutive ranks, so counting an actuation swaps the instrument to the end of its group
+    // and the order stays sorted in constant time.
+    struct WearGroup {
+        uint8_t first;
+        uint8_t last;
+    };
+    std::array<InstrumentWear, NUM_Instruments> m_wear = {};
+    static_assert(NUM_Instruments >= HardwareConfig::MAX_NUM_INSTRUMENTS, "m_wear is indexed by every instrument");
+    std::array<uint16_t, NUM_Instruments> m_wearPendingMs = {}; // On-time not yet rolled into whole seconds
+    std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_wearOrder = {};
+    std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_wearRank = {};
+    std::array<WearGroup, HardwareConfig::MAX_NUM_INSTRUMENTS> m_wearGroups = {};
+    std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS> m_wearGroup = {}; // Group of each instrument
+    uint32_t m_freeWearGroups = 0; // Bitmask of the unused entries of m_wearGroups
+    bool m_wearChanged = false;
+
+    uint8_t m_batchDepth = 0; // Open beginBatch() calls
+    uint8_t m_loopDepth = 0;  // Open LoopSections
+
+    #ifdef CFG_LATENCY_COMPENSATION
+    // Delay applied to each instrument's outputs so every onset lands LOOKAHEAD_US after the note arrived
+    std::array<uint32_t, NUM_Instruments> m_instrumentLatencyUs = {};
+    std::array<uint32_t, NUM_Instruments> m_outputDelayUs = {};
+    // Scheduled note changes not yet sent to the outputs
+    std::array<uint8_t, NUM_Instruments> m_pendingOnsets = {};
+    std::array<uint8_t, NUM_Instruments> m_pendingStops = {};
+    // Bumped on every claim so a late stop can tell a newer voice owns the instrument
+    std::array<uint8_t, NUM_Instruments> m_claimCount = {};
+    #endif
+
     //Local CC Effect Attributes
     uint16_t m_pitchBend[Midi::NUM_CH]; 
+    uint16_t m_pitchBendRange[Midi::NUM_CH]; // Cents at full deflection, set with RPN 0
     uint8_t m_program[Midi::NUM_CH];
     uint8_t m_channelPressure[Midi::NUM_CH];
     
@@ -31,21 +79,104 @@ public:
     virtual void resetAll() = 0;
     virtual void playNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) = 0;
     // Overloaded version with distributor tracking
-    void playNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel, void* distributor) {
+    void playNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel, uint8_t distributor) {
 
         // Set the distributor that sent this note
-        m_lastDistributor[instrument] = distributor;
-        m_lastChannel[instrument] = channel;
+        claimVoice(instrument, distributor, channel, note);
+        countActuation(instrument);
         
-        // Default implementation just calls the base method
-        playNote(instrument, note, velocity, channel);
+        // Play now unless the output is held back for latency compensation
+        if (!scheduleNote(instrument, note, velocity, channel, true)) playNote(instrument, note, velocity, channel);
     }
     virtual void stopNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) = 0;
+    // Stops a note started by a distributor, delayed by the same offset as its onset
+    void releaseNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) {
+        if (!scheduleNote(instrument, note, velocity, channel, false)) stopNote(instrument, note, velocity, channel);
+    }
     virtual void stopAll() = 0;
 
+    // Group several note changes so they reach the outputs together. Calls nest, the changes
+    // are published by the outermost commitBatch(). Every beginBatch() is paired with commitBatch().
+    // The fences keep the depth ordered with the changes for the event timer interrupt.
+    void beginBatch() {
+        m_batchDepth++;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+    void commitBatch() {
+        if (m_batchDepth == 0) return;
+        // Published before the depth drops so the interrupt can't send notes in the middle
+        if (m_batchDepth == 1) publishBatch();
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        m_batchDepth--;
+    }
+    bool isBatching() const { return m_batchDepth != 0; }
+
+    // Held by the main loop around controller calls made outside a batch, such as periodic().
+    // The event timer interrupt only sends notes itself while no batch or section is open.
+    class LoopSection {
+        InstrumentControllerBase& m_controller;
+    public:
+        explicit LoopSection(InstrumentControllerBase& controller) : m_controller(controller) {
+            m_controller.m_loopDepth++;
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        }
+        ~LoopSection() {
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            m_controller.m_loopDepth--;
+        }
+        LoopSection(const LoopSection&) = delete;
+        LoopSection& operator=(const LoopSection&) = delete;
+    };
+
     //Required Getters
     virtual uint8_t getNumActiveNotes(uint8_t instrument) = 0;
     virtual bool isNoteActive(uint8_t instrument, uint8_t note) = 0;
+
+    // Active notes as the distributors see them, counting scheduled changes as already made
+    #ifdef CFG_LATENCY_COMPENSATION
+    uint8_t getNumBusyNotes(uint8_t instrument);
+    bool isNoteBusy(uint8_t instrument, uint8_t note);
+    #else
+    uint8_t getNumBusyNotes(uint8_t instrument) { return getNumActiveNotes(instrument); }
+    bool isNoteBusy(uint8_t instrument, uint8_t note) { return isNoteActive(instrument, note); }
+    #endif
+
+    // Sends the held back note changes which are due. Drivers which enable interrupt firing get
+    // them straight from the event timer interrupt, unless the main loop is inside the controller.
+    // Every other driver, and any change the interrupt left, waits for this call from the main
+    // loop, so its accuracy is bounded by the loop latency: a pass of message handling plus
+    // periodic(), including the LED show().
+    #ifdef CFG_LATENCY_COMPENSATION
+    void fireScheduledNotes();
+    #else
+    void fireScheduledNotes() {}
+    #endif
+
+    // Time from output to audible onset, outputs of faster instruments are held back to match
+    #ifdef CFG_LATENCY_COMPENSATION
+    uint32_t getInstrumentLatency(uint8_t instrument) const { return m_instrumentLatencyUs[instrument % NUM_Instruments]; }
+    void setInstrumentLatency(uint8_t instrument, uint32_t latencyUs);
+    #else
+    uint32_t getInstrumentLatency(uint8_t instrument) const { return 0; }
+    void setInstrumentLatency(uint8_t instrument, uint32_t latencyUs) {}
+    #endif
+
+    // Timer interrupt cost with the given number of voices sounding, collected with CFG_ISR_PROFILING
+    virtual IsrProfile getIsrProfile(uint8_t numVoices) const { return {}; }
+    virtual IsrJitter getIsrJitter() const { return {}; }
+
+    // Returns True if the instrument can render the note. Defaults to the configured range,
+    // instruments with fixed note maps or speed limits override this.
+    virtual bool canPlayNote(uint8_t instrument, uint8_t note);
+
+    // Fills the eligibility table from canPlayNote. Call at boot, never from the note path.
+    void buildEligibility();
+
+    // Bitmask of the instruments able to play the note
+    uint32_t getEligibleInstruments(uint8_t note) const { return m_eligibleInstruments[note & 0x7F]; }
+
+    // Number of notes an instrument can sound at once (distributors steal or drop beyond this)
+    virtual uint8_t getMaxActiveNotes(uint8_t instrument) { return 1; }
     
     // Get the instrument type at runtime
     virtual Instrument getInstrumentType() const { return Instrument::None; };
@@ -60,32 +191,78 @@ public:
     virtual void setChannelPressure(uint8_t channel, uint8_t value);
     virtual void setControlChange(uint8_t channel, uint8_t controller, uint8_t value);
 
+    // Pitch bend sensitivity (RPN 0), re-applies the channel's current bend
+    void setPitchBendRange(uint8_t channel, uint16_t cents);
+    uint16_t getPitchBendRange(uint8_t channel) const { return m_pitchBendRange[channel & 0x0F]; }
+
     // Optional periodic update function
     virtual void periodic() {
         checkInstrumentTimeouts();
     }
 
-    // Return the last distributor (as a void* value) that sent a note to the
-    // given instrument. Use setLastDistributor to update/clear this value.
-    void* getLastDistributor(uint8_t instrument) {
-        if (instrument < NUM_Instruments) {
-            return m_lastDistributor[instrument];
-        }
-        return nullptr;
+    // Voice ownership queries. Distributors are identified by their pool slot.
+    uint8_t getOwner(uint8_t instrument) const {
+        return (instrument < NUM_Instruments) ? m_voiceOwner[instrument].distributor : NONE;
     }
 
-    uint8_t getLastChannel(uint8_t instrument) {
-        if (instrument < NUM_Instruments) {
-            return m_lastChannel[instrument];
-        }
-        return NONE;
+    uint8_t getOwnerChannel(uint8_t instrument) const {
+        return (instrument < NUM_Instruments) ? m_voiceOwner[instrument].channel : NONE;
     }
 
-    void setLastDistributor(uint8_t instrument, void* distributor, uint8_t channel) {
-        if (instrument < NUM_Instruments) {
-            m_lastDistributor[instrument] = distributor;
-            m_lastChannel[instrument] = channel;
+    uint8_t getOwnerNote(uint8_t instrument) const {
+        return (instrument < NUM_Instruments) ? m_voiceOwner[instrument].note : 0;
+    }
+
+    bool isOwnedBy(uint8_t instrument, uint8_t distributor, uint8_t channel) const {
+        if (instrument >= NUM_Instruments) return false;
+        return m_voiceOwner[instrument].distributor == distributor && m_voiceOwner[instrument].channel == channel;
+    }
+
+    // Bitmask of the instruments whose voice the distributor owns
+    uint32_t getOwnedVoices(uint8_t distributor) const {
+        return (distributor < HardwareConfig::MAX_NUM_DISTRIBUTORS) ? m_ownedVoices[distributor] : 0;
+    }
+
+    void claimVoice(uint8_t instrument, uint8_t distributor, uint8_t channel, uint8_t note) {
+        if (instrument >= NUM_Instruments) return;
+        releaseVoiceOwner(instrument);
+        #ifdef CFG_LATENCY_COMPENSATION
+        m_claimCount[instrument]++;
+        #endif
+        m_voiceOwner[instrument] = {distributor, channel, note};
+        if (distributor < HardwareConfig::MAX_NUM_DISTRIBUTORS) m_ownedVoices[distributor] |= (1UL << instrument);
+    }
+
+    void releaseVoiceOwner(uint8_t instrument) {
+        if (instrument >= NUM_Instruments) return;
+        uint8_t distributor = m_voiceOwner[instrument].distributor;
+        if (distributor != NONE) countOnTime(instrument);
+        if (distributor < HardwareConfig::MAX_NUM_DISTRIBUTORS) m_ownedVoices[distributor] &= ~(1UL << instrument);
+        m_voiceOwner[instrument] = {};
+    }
+
+    void releaseAllVoiceOwners() {
+        for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+            if (m_voiceOwner[i].distributor != NONE) countOnTime(i);
         }
+        m_voiceOwner.fill({});
+        m_ownedVoices.fill(0);
+        cancelScheduledNotes();
+    }
+
+    // Wear counters, only notes started through a distributor are counted
+    const InstrumentWear& getInstrumentWear(uint8_t instrument) const { return m_wear[instrument % NUM_Instruments]; }
+    void setInstrumentWear(uint8_t instrument, const InstrumentWear& wear);
+    void resetInstrumentWear(uint8_t instrument);
+
+    // Instruments ordered least used first
+    const std::array<uint8_t, HardwareConfig::MAX_NUM_INSTRUMENTS>& getWearOrder() const { return m_wearOrder; }
+
+    // Returns True once after the counters change, used to limit writes to local storage
+    bool takeWearChanged() {
+        bool changed = m_wearChanged;
+        m_wearChanged = false;
+        return changed;
     }
 
     uint32_t getNoteStartTime(uint8_t instrument) {
@@ -96,6 +273,34 @@ public:
     }
 
 protected:
+    InstrumentControllerBase();
+
+    // Applies every note change held back since the outermost beginBatch()
+    virtual void publishBatch() {}
+
+    void countActuation(uint8_t instrument);
+    void countOnTime(uint8_t instrument);
+    void rebuildWearOrder();
+
+    // Queues the note change for its compensated output time. Returns False if it should be made now.
+    #ifdef CFG_LATENCY_COMPENSATION
+    bool scheduleNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel, bool noteOn);
+    void cancelScheduledNotes();
+    #else
+    bool scheduleNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel, bool noteOn) { return false; }
+    void cancelScheduledNotes() {}
+    #endif
+
+    // Lets the event timer interrupt call playNote(), stopNote() and publishBatch(). Only for
+    // drivers where those just write registers or stage voices for their tick, without driver
+    // calls that lock or block. Set from the driver's constructor.
+    #ifdef CFG_LATENCY_COMPENSATION
+    void setInterruptFiring(bool enabled);
+    static void fireFromInterrupt(); // Event timer handler
+    #else
+    void setInterruptFiring(bool enabled) {}
+    #endif
+
     // LED Helper Functions (can be overridden by derived classes for custom behavior)
     // These provide default implementations that work for most instruments
     virtual void setupLEDs();
@@ -52,17 +52,31 @@ void MessageRouter::processMessages()
 {
     if (!m_networkManager) return;
 
+    // Notes changed during this pass are published to the outputs together,
+    // so a chord spread over several messages starts on the same tick. The batch
+    // opens with the first message so polling idle networks doesn't hold off the
+    // event timer interrupt.
+    bool batching = false;
+
     // Loop through each network individually
     const size_t numNetworks = m_networkManager->numberOfNetworks();
     for (size_t i = 0; i < numNetworks; ++i) {
         INetwork* const net = m_networkManager->getNetwork(i);
         if (!net) continue;
 
-        // Read message from this specific network
-        if (auto message = net->readMessage(); message.has_value()) {
+        // Drain what this network has buffered, bounded so one busy network can't stall the loop
+        for (uint8_t count = 0; count < CFG_MAX_MESSAGES_PER_PASS; ++count) {
+            auto message = net->readMessage();
+            if (!message.has_value()) break;
+            if (!batching) {
+                m_instrumentController->beginBatch();
+                batching = true;
+            }
             processMessage(*message, net);
         }
     }
+
+    if (batching) m_instrumentController->commitBatch();
 }
 
 // Process a single message from a specific network
@@ -19,6 +19,7 @@ MidiMsgHandler::MidiMsgHandler(DistributorManager& distributorManager,
     , m_sysExHandler(&sysExHandler)
     , m_instrumentController(&instrumentController)
 {
+    m_selectedRPN.fill(MidiRPN::Null);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -69,6 +70,19 @@ void MidiMsgHandler::processCC(const MidiMessage& message)
     uint8_t channel = message.channel();
     m_instrumentController->setControlChange(channel, message.CC_Control(), message.CC_Value());
     switch (message.CC_Control()) {
+        case(MidiCC::DamperPedal):
+        case(MidiCC::Sostenuto):
+            // Pedals hold notes inside the distributors that own them
+            if (m_distributorManager) m_distributorManager->distributeMessage(message);
+            break;
+        case(MidiCC::RPN_MSB):
+        case(MidiCC::RPN_LSB):
+        case(MidiCC::NRPN_MSB):
+        case(MidiCC::NRPN_LSB):
+        case(MidiCC::DataEntryMSB):
+        case(MidiCC::DataEntryLSB):
+            processParameterCC(channel, message.CC_Control(), message.CC_Value());
+            break;
         case(MidiCC::Mute):
             m_instrumentController->stopAll();
             break;
@@ -86,6 +100,38 @@ void MidiMsgHandler::processCC(const MidiMessage& message)
     }
 }
 
+// Tracks the selected registered parameter and applies Data Entry to it. Only pitch bend
+// sensitivity is supported, selecting an NRPN deselects the RPN.
+void MidiMsgHandler::processParameterCC(uint8_t channel, uint8_t controller, uint8_t value)
+{
+    uint16_t& rpn = m_selectedRPN[channel];
+    switch (controller) {
+        case(MidiCC::RPN_MSB):
+            rpn = (static_cast<uint16_t>(value) << 7) | (rpn & 0x7F);
+            return;
+        case(MidiCC::RPN_LSB):
+            rpn = (rpn & (0x7F << 7)) | value;
+            return;
+        case(MidiCC::NRPN_MSB):
+        case(MidiCC::NRPN_LSB):
+            rpn = MidiRPN::Null;
+            return;
+        default:
+            break;
+    }
+
+    if (rpn != MidiRPN::PitchBendSensitivity) return;
+
+    // Data Entry MSB sets whole semitones, the optional LSB adds cents
+    uint8_t cents = 0;
+    if (controller == MidiCC::DataEntryMSB) {
+        m_dataEntryMSB[channel] = value;
+    } else {
+        cents = (value < 100) ? value : 99;
+    }
+    m_instrumentController->setPitchBendRange(channel, m_dataEntryMSB[channel] * 100 + cents);
+}
+
 // Process System Common messages (SysEx, System Stop, System Reset)
 std::optional<MidiMessage> MidiMsgHandler::processSystemMessage(const MidiMessage& message)
 {
@@ -10,6 +10,7 @@
 #include "MidiMessage.h"
 #include "Constants.h"
 
+#include <array>
 #include <cstdint>
 #include <optional>
 #include <functional>
@@ -25,6 +26,10 @@ private:
     SysExMsgHandler* m_sysExHandler;
     InstrumentControllerBase* m_instrumentController;
 
+    // Parameter each channel's Data Entry controllers apply to
+    std::array<uint16_t, Midi::NUM_CH> m_selectedRPN;
+    std::array<uint8_t, Midi::NUM_CH> m_dataEntryMSB = {};
+
 public:
 
     MidiMsgHandler(DistributorManager& distributorManager,
@@ -36,6 +41,7 @@ public:
 private:
 
     void processCC(const MidiMessage& message);
+    void processParameterCC(uint8_t channel, uint8_t controller, uint8_t value);
     
     std::optional<MidiMessage> processSystemMessage(const MidiMessage& message);
 };
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "SysExMsgHandler.h"
 #include "Distributors/DistributorManager.h"
 #include "Instruments/InstrumentControllerBase.h"
+#include "Instruments/Components/TuningTable.h"
 #include "Utility/BitManipulation.h"
 #include <Arduino.h>
 #include <cstring>  // For memcpy and strncpy
@@ -25,6 +26,12 @@ SysExMsgHandler::SysExMsgHandler(DistributorManager& distributorManager,
 // Process a SysEx message and return optional response
 std::optional<MidiMessage> SysExMsgHandler::processSysExMessage(const MidiMessage& message)
 {
+    // MIDI Tuning Standard messages arrive as universal SysEx
+    if (message.sysExID() == Midi::UniversalNonRealTime || message.sysExID() == Midi::UniversalRealTime) {
+        handleTuningStandard(message);
+        return {};
+    }
+
     // Check MIDI ID
     if (message.sysExID() != SysEx::ID) return {};
     // Check Device ID or Global ID 0x00;
@@ -92,6 +99,14 @@ bool SysExMsgHandler::handleDeviceCommand(const MidiMessage& message, std::optio
             sysExSetDeviceBoolean(message);
             response.reset();
             return true;
+        case (SysEx::DeviceTuning):
+            if (message.length == 7) {
+                response = sysExGetDeviceTuning(message);
+                return true;
+            }
+            sysExSetDeviceTuning(message);
+            response.reset();
+            return true;
         case (SysEx::DeviceID):
             if (message.length == 7) {
                 response = sysExGetDeviceID(message);
@@ -181,6 +196,22 @@ bool SysExMsgHandler::handleDistributorCommand(const MidiMessage& message, std::
             sysExSetDistributorMinMaxNotes(message);
             response.reset();
             return true;
+        case (SysEx::DistributorStealPolicy):
+            if (message.length == 9) {
+                response = sysExGetDistributorStealPolicy(message);
+                return true;
+            }
+            sysExSetDistributorStealPolicy(message);
+            response.reset();
+            return true;
+        case (SysEx::DistributorVoiceSteals):
+            if (message.length == 9) {
+                response = sysExGetDistributorVoiceSteals(message);
+                return true;
+            }
+            sysExResetDistributorVoiceSteals(message);
+            response.reset();
+            return true;
         default:
             return false;
     }
@@ -208,11 +239,89 @@ bool SysExMsgHandler::handleInstrumentCommand(const MidiMessage& message, std::o
             sysExSetInstrumentNoteOff(message);
             response.reset();
             return true;
+        case (SysEx::GetInstrumentWear):
+            response = sysExGetInstrumentWear(message);
+            return true;
+        case (SysEx::ResetInstrumentWear):
+            sysExResetInstrumentWear(message);
+            response.reset();
+            return true;
+        case (SysEx::InstrumentLatency):
+            if (message.length == SYSEX_HeaderSize + 1) {
+                response = sysExGetInstrumentLatency(message);
+            } else {
+                sysExSetInstrumentLatency(message);
+                response.reset();
+            }
+            return true;
+        case (SysEx::GetInstrumentIsrProfile):
+            response = sysExGetInstrumentIsrProfile(message);
+            return true;
+        case (SysEx::GetInstrumentIsrJitter):
+            response = sysExGetInstrumentIsrJitter(message);
+            return true;
         default:
             return false;
     }
 }
 
+// Retunes notes from MIDI Tuning Standard messages. There is one tuning for the whole device so
+// tuning programs, banks and channel masks are ignored. Bulk dumps (408 bytes) don't fit in a packet.
+void SysExMsgHandler::handleTuningStandard(const MidiMessage& message)
+{
+    // buffer: F0 <7E|7F> <device> 08 <format> ...
+    if (message.length < 6 || message.buffer[3] != MidiTuning::SubID) return;
+    const uint8_t device = message.buffer[2];
+    if (device != Midi::AllCall && device != (Device::GetDeviceID() & 0x7F)) return;
+
+    const uint8_t format = message.buffer[4];
+    switch (format) {
+        case MidiTuning::SingleNote:
+        case MidiTuning::SingleNoteBank: {
+            const uint8_t countIndex = (format == MidiTuning::SingleNote) ? 6 : 7;
+            if (message.length <= countIndex) return;
+
+            uint8_t changes = message.buffer[countIndex];
+            const uint8_t* data = message.buffer.data() + countIndex + 1;
+            const uint8_t* end = message.buffer.data() + message.length - 1; // Before the F7
+            for (; changes > 0 && data + 4 <= end; --changes, data += 4) {
+                const uint32_t pitch = (static_cast<uint32_t>(data[1] & 0x7F) << 14)
+                    | (static_cast<uint32_t>(data[2] & 0x7F) << 7)
+                    | static_cast<uint32_t>(data[3] & 0x7F);
+                if (pitch == MidiTuning::NoChange) continue;
+                Tuning::setNotePitch(data[0] & 0x7F, pitch);
+            }
+            break;
+        }
+        case MidiTuning::ScaleOctave1Byte: {
+            if (message.length < 8 + 12 + 1) return;
+            std::array<int32_t, 12> offsets;
+            for (uint8_t i = 0; i < 12; i++) {
+                // 0x40 is equal temperament, 1 cent per step
+                const int32_t cents = static_cast<int32_t>(message.buffer[8 + i] & 0x7F) - 0x40;
+                offsets[i] = cents * static_cast<int32_t>(Tuning::SEMITONE) / 100;
+            }
+            Tuning::setPitchClassOffsets(offsets);
+            break;
+        }
+        case MidiTuning::ScaleOctave2Byte: {
+            if (message.length < 8 + 24 + 1) return;
+            std::array<int32_t, 12> offsets;
+            for (uint8_t i = 0; i < 12; i++) {
+                // 0x2000 is equal temperament, the 14 bit range spans +-100 cents
+                const int32_t value = (static_cast<int32_t>(message.buffer[8 + i * 2] & 0x7F) << 7)
+                    | static_cast<int32_t>(message.buffer[9 + i * 2] & 0x7F);
+                offsets[i] = (value - 0x2000) * static_cast<int32_t>(Tuning::SEMITONE) / 0x2000;
+            }
+            Tuning::setPitchClassOffsets(offsets);
+            break;
+        }
+        default:
+            return;
+    }
+    Tuning::commit();
+}
+
 // Set callback for device configuration changes
 void SysExMsgHandler::setDeviceChangedCallback(const std::function<void()>& callback)
 {
@@ -291,6 +400,13 @@ MidiMessage SysExMsgHandler::sysExGetDeviceBoolean(const MidiMessage& message)
     return MidiMessage(m_sourceId, m_destinationId, message.sysExCommand(), deviceBooleanBytes.data(), 2);
 }
 
+// Respond with the selected built-in tuning, Custom once retuned with MTS
+MidiMessage SysExMsgHandler::sysExGetDeviceTuning(const MidiMessage& message)
+{
+    uint8_t preset = static_cast<uint8_t>(Tuning::getPreset());
+    return MidiMessage(m_sourceId, m_destinationId, message.sysExCommand(), &preset, 1);
+}
+
 // Respond with Device ID (14-bit split into two 7-bit bytes)
 MidiMessage SysExMsgHandler::sysExGetDeviceID(const MidiMessage& message)
 {
@@ -380,7 +496,9 @@ void SysExMsgHandler::sysExSetDeviceBoolean(const MidiMessage& message)
                                 static_cast<uint16_t>(message.sysExCmdPayload()[1]);
     Device::Muted = ((deviceBoolValue & DEVICE_BOOL_MASK::MUTED) != 0);        // Bit 0
     Device::OmniMode = ((deviceBoolValue & DEVICE_BOOL_MASK::OMNIMODE) != 0);  // Bit 1
+    const bool damperPedal = Device::DamperPedal;
     Device::DamperPedal = ((deviceBoolValue & DEVICE_BOOL_MASK::DAMPER_PEDAL) != 0); // Bit 2
+    if (damperPedal && !Device::DamperPedal && m_distributorManager) m_distributorManager->releasePedals(); // Held notes would stick
     Device::Vibrato = ((deviceBoolValue & DEVICE_BOOL_MASK::VIBRATO) != 0); // Bit 3
     
     #ifdef CFG_EXTRA_LOCAL_STORAGE
@@ -390,6 +508,14 @@ void SysExMsgHandler::sysExSetDeviceBoolean(const MidiMessage& message)
     broadcastDeviceChanged();
 }
 
+// Select one of the built-in tunings
+void SysExMsgHandler::sysExSetDeviceTuning(const MidiMessage& message)
+{
+    if (message.length < SYSEX_HeaderSize + 2) return;
+    if (!Tuning::selectPreset(static_cast<TuningPreset>(message.sysExCmdPayload()[0]))) return;
+    broadcastDeviceChanged();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Distributor Management Commands (delegates to DistributorManager)
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -501,6 +627,26 @@ MidiMessage SysExMsgHandler::sysExGetDistributorNumPolyphonicNotes(const MidiMes
     return MidiMessage(m_sourceId, m_destinationId, message.sysExCommand(), &numNotes, 1);
 }
 
+// Respond with the requested Distributor Steal Policy
+MidiMessage SysExMsgHandler::sysExGetDistributorStealPolicy(const MidiMessage& message)
+{
+    uint8_t policy = static_cast<uint8_t>(m_distributorManager->getDistributorStealPolicy(message.sysExDistributorID()));
+    return MidiMessage(m_sourceId, m_destinationId, message.sysExCommand(), &policy, 1);
+}
+
+// Respond with the number of voices the requested Distributor has stolen (32-bit in 5 MIDI 7-bit bytes)
+MidiMessage SysExMsgHandler::sysExGetDistributorVoiceSteals(const MidiMessage& message)
+{
+    uint32_t steals = m_distributorManager->getDistributorVoiceSteals(message.sysExDistributorID());
+    uint8_t bytesToSend[5];
+    bytesToSend[0] = (steals >> 28) & 0x7F;
+    bytesToSend[1] = (steals >> 21) & 0x7F;
+    bytesToSend[2] = (steals >> 14) & 0x7F;
+    bytesToSend[3] = (steals >> 7) & 0x7F;
+    bytesToSend[4] = (steals >> 0) & 0x7F;
+    return MidiMessage(m_sourceId, m_destinationId, message.sysExCommand(), bytesToSend, 5);
+}
+
 // Set Distributor
 void SysExMsgHandler::sysExSetDistributor(const MidiMessage& message)
 {
@@ -554,6 +700,20 @@ void SysExMsgHandler::sysExSetDistributorMinMaxNotes(const MidiMessage& message)
                                                    message.sysExCmdPayload()[3]);
 }
 
+// Configure the designated Distributor's Steal Policy
+void SysExMsgHandler::sysExSetDistributorStealPolicy(const MidiMessage& message)
+{
+    if (message.length < SYSEX_HeaderSize + 4) return;
+    m_distributorManager->setDistributorStealPolicy(message.sysExDistributorID(),
+                                                   StealPolicy(message.sysExCmdPayload()[2]));
+}
+
+// Clear the designated Distributor's Voice Steal counter
+void SysExMsgHandler::sysExResetDistributorVoiceSteals(const MidiMessage& message)
+{
+    m_distributorManager->resetDistributorVoiceSteals(message.sysExDistributorID());
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Instrument Direct Methods
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -587,6 +747,111 @@ MidiMessage SysExMsgHandler::sysExGetInstrumentNumActiveNotes(const MidiMessage&
     return MidiMessage(m_sourceId, m_destinationId, message.sysExCommand(), &numActiveNotes, 1);
 }
 
+// Returns the instrument's actuation count followed by its on-time in seconds, 5 bytes each
+MidiMessage SysExMsgHandler::sysExGetInstrumentWear(const MidiMessage& message)
+{
+    InstrumentWear wear;
+    if (m_instrumentController && message.length >= SYSEX_HeaderSize + 1) {
+        const uint8_t instrumentId = message.sysExCmdPayload()[0];
+        if (instrumentId < NUM_Instruments) {
+            wear = m_instrumentController->getInstrumentWear(instrumentId);
+        }
+    }
+
+    uint8_t bytesToSend[10];
+    bytesToSend[0] = (wear.actuations >> 28) & 0x7F;
+    bytesToSend[1] = (wear.actuations >> 21) & 0x7F;
+    bytesToSend[2] = (wear.actuations >> 14) & 0x7F;
+    bytesToSend[3] = (wear.actuations >> 7) & 0x7F;
+    bytesToSend[4] = (wear.actuations >> 0) & 0x7F;
+    bytesToSend[5] = (wear.onTimeSeconds >> 28) & 0x7F;
+    bytesToSend[6] = (wear.onTimeSeconds >> 21) & 0x7F;
+    bytesToSend[7] = (wear.onTimeSeconds >> 14) & 0x7F;
+    bytesToSend[8] = (wear.onTimeSeconds >> 7) & 0x7F;
+    bytesToSend[9] = (wear.onTimeSeconds >> 0) & 0x7F;
+    return MidiMessage(m_sourceId, m_destinationId, message.sysExCommand(), bytesToSend, 10);
+}
+
+// Clears the instrument's wear counters, used after replacing worn hardware
+void SysExMsgHandler::sysExResetInstrumentWear(const MidiMessage& message)
+{
+    if (!m_instrumentController || message.length < SYSEX_HeaderSize + 1) return;
+
+    const uint8_t instrumentId = message.sysExCmdPayload()[0];
+    if (instrumentId >= NUM_Instruments) return;
+
+    m_instrumentController->resetInstrumentWear(instrumentId);
+}
+
+// Returns the instrument's output to onset latency in microseconds (3 bytes)
+MidiMessage SysExMsgHandler::sysExGetInstrumentLatency(const MidiMessage& message)
+{
+    uint32_t latencyUs = 0;
+    const uint8_t instrumentId = message.sysExCmdPayload()[0];
+    if (m_instrumentController && instrumentId < NUM_Instruments) {
+        latencyUs = m_instrumentController->getInstrumentLatency(instrumentId);
+    }
+
+    uint8_t bytesToSend[3];
+    bytesToSend[0] = (latencyUs >> 14) & 0x7F;
+    bytesToSend[1] = (latencyUs >> 7) & 0x7F;
+    bytesToSend[2] = (latencyUs >> 0) & 0x7F;
+    return MidiMessage(m_sourceId, m_destinationId, message.sysExCommand(), bytesToSend, 3);
+}
+
+// Calibrates the instrument's latency, only used with CFG_LATENCY_COMPENSATION
+void SysExMsgHandler::sysExSetInstrumentLatency(const MidiMessage& message)
+{
+    if (!m_instrumentController || message.length < SYSEX_HeaderSize + 4) return;
+
+    const uint8_t instrumentId = message.sysExCmdPayload()[0];
+    if (instrumentId >= NUM_Instruments) return;
+
+    uint32_t latencyUs = (static_cast<uint32_t>(message.sysExCmdPayload()[1] & 0x7F) << 14)
+        | (static_cast<uint32_t>(message.sysExCmdPayload()[2] & 0x7F) << 7)
+        | static_cast<uint32_t>(message.sysExCmdPayload()[3] & 0x7F);
+    m_instrumentController->setInstrumentLatency(instrumentId, latencyUs);
+}
+
+// Returns the timer interrupt's call count, min, mean and max cycles with the requested number
+// of voices sounding, 5 bytes each. All zero unless built with CFG_ISR_PROFILING.
+MidiMessage SysExMsgHandler::sysExGetInstrumentIsrProfile(const MidiMessage& message)
+{
+    IsrProfile profile;
+    if (m_instrumentController && message.length >= SYSEX_HeaderSize + 1) {
+        profile = m_instrumentController->getIsrProfile(message.sysExCmdPayload()[0]);
+    }
+
+    const uint32_t values[4] = {profile.samples, profile.minCycles, profile.meanCycles, profile.maxCycles};
+    uint8_t bytesToSend[20];
+    for (uint8_t i = 0; i < 4; i++) {
+        bytesToSend[i * 5 + 0] = (values[i] >> 28) & 0x7F;
+        bytesToSend[i * 5 + 1] = (values[i] >> 21) & 0x7F;
+        bytesToSend[i * 5 + 2] = (values[i] >> 14) & 0x7F;
+        bytesToSend[i * 5 + 3] = (values[i] >> 7) & 0x7F;
+        bytesToSend[i * 5 + 4] = (values[i] >> 0) & 0x7F;
+    }
+    return MidiMessage(m_sourceId, m_destinationId, message.sysExCommand(), bytesToSend, 20);
+}
+
+// Returns the timer interrupt jitter histogram, one count per microsecond bin, 5 bytes each.
+// All zero unless built with CFG_ISR_PROFILING.
+MidiMessage SysExMsgHandler::sysExGetInstrumentIsrJitter(const MidiMessage& message)
+{
+    IsrJitter jitter;
+    if (m_instrumentController) jitter = m_instrumentController->getIsrJitter();
+
+    uint8_t bytesToSend[IsrJitter::NUM_BINS * 5];
+    for (uint8_t i = 0; i < IsrJitter::NUM_BINS; i++) {
+        bytesToSend[i * 5 + 0] = (jitter.bins[i] >> 28) & 0x7F;
+        bytesToSend[i * 5 + 1] = (jitter.bins[i] >> 21) & 0x7F;
+        bytesToSend[i * 5 + 2] = (jitter.bins[i] >> 14) & 0x7F;
+        bytesToSend[i * 5 + 3] = (jitter.bins[i] >> 7) & 0x7F;
+        bytesToSend[i * 5 + 4] = (jitter.bins[i] >> 0) & 0x7F;
+    }
+    return MidiMessage(m_sourceId, m_destinationId, message.sysExCommand(), bytesToSend, sizeof(bytesToSend));
+}
+
 void SysExMsgHandler::sysExSetInstrumentNoteOn(const MidiMessage& message)
 {
     if (!m_instrumentController || message.length < SYSEX_HeaderSize + 4) return;
@@ -47,6 +47,7 @@ private:
     bool handleDeviceCommand(const MidiMessage& message, std::optional<MidiMessage>& response);
     bool handleDistributorCommand(const MidiMessage& message, std::optional<MidiMessage>& response);
     bool handleInstrumentCommand(const MidiMessage& message, std::optional<MidiMessage>& response);
+    void handleTuningStandard(const MidiMessage& message);
 
     // Device configuration commands
     MidiMessage sysExDeviceReady(const MidiMessage& message);
@@ -58,12 +59,14 @@ private:
     MidiMessage sysExGetDeviceID(const MidiMessage& message);
     MidiMessage sysExGetDeviceName(const MidiMessage& message);
     MidiMessage sysExGetDeviceBoolean(const MidiMessage& message);
+    MidiMessage sysExGetDeviceTuning(const MidiMessage& message);
     
     void sysExSetDeviceConstructWithDistributors(const MidiMessage& message);
     void sysExSetDeviceConstruct(const MidiMessage& message);
     void sysExSetDeviceID(const MidiMessage& message);
     void sysExSetDeviceName(const MidiMessage& message);
     void sysExSetDeviceBoolean(const MidiMessage& message);
+    void sysExSetDeviceTuning(const MidiMessage& message);
     
     // Distributor management commands (delegates to DistributorManager)
     MidiMessage sysExGetNumOfDistributors(const MidiMessage& message);
@@ -77,6 +80,8 @@ private:
     MidiMessage sysExGetDistributorBoolValues(const MidiMessage& message);
     MidiMessage sysExGetDistributorMinMaxNotes(const MidiMessage& message);
     MidiMessage sysExGetDistributorNumPolyphonicNotes(const MidiMessage& message);
+    MidiMessage sysExGetDistributorStealPolicy(const MidiMessage& message);
+    MidiMessage sysExGetDistributorVoiceSteals(const MidiMessage& message);
     
     void sysExSetDistributor(const MidiMessage& message);
     void sysExSetDistributorChannels(const MidiMessage& message);
@@ -85,12 +90,20 @@ private:
     void sysExSetDistributorBoolValues(const MidiMessage& message);
     void sysExSetDistributorMinMaxNotes(const MidiMessage& message);
     void sysExSetDistributorNumPolyphonicNotes(const MidiMessage& message);
+    void sysExSetDistributorStealPolicy(const MidiMessage& message);
+    void sysExResetDistributorVoiceSteals(const MidiMessage& message);
 
     void sysExResetAllInstruments(const MidiMessage& message);
     void sysExResetInstrument(const MidiMessage& message);
     MidiMessage sysExGetInstrumentNumActiveNotes(const MidiMessage& message);
     void sysExSetInstrumentNoteOn(const MidiMessage& message);
     void sysExSetInstrumentNoteOff(const MidiMessage& message);
+    MidiMessage sysExGetInstrumentWear(const MidiMessage& message);
+    void sysExResetInstrumentWear(const MidiMessage& message);
+    MidiMessage sysExGetInstrumentLatency(const MidiMessage& message);
+    void sysExSetInstrumentLatency(const MidiMessage& message);
+    MidiMessage sysExGetInstrumentIsrProfile(const MidiMessage& message);
+    MidiMessage sysExGetInstrumentIsrJitter(const MidiMessage& message);
     
     // Helper methods
     void broadcastDeviceChanged();
@@ -0,0 +1,48 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace Utility{
+
+    // Fixed size queue between exactly one producer and one consumer, which may run on different
+    // cores. Neither side blocks or locks: each index is written by one side only and published
+    // with release/acquire ordering so the slot contents are visible before the index moves.
+    // Holds N - 1 items, N must be a power of two.
+    template <typename T, size_t N>
+    class SpscQueue {
+        static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+    public:
+        // Producer side, false if the queue is full
+        bool push(const T& item) {
+            const size_t head = m_head.load(std::memory_order_relaxed);
+            const size_t next = (head + 1) & (N - 1);
+            if (next == m_tail.load(std::memory_order_acquire)) return false;
+            m_items[head] = item;
+            m_head.store(next, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side, false if the queue is empty
+        bool pop(T& item) {
+            const size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail == m_head.load(std::memory_order_acquire)) return false;
+            item = m_items[tail];
+            m_tail.store((tail + 1) & (N - 1), std::memory_order_release);
+            return true;
+        }
+
+        bool empty() const {
+            return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+        }
+
+    private:
+        std::array<T, N> m_items = {};
+        std::atomic<size_t> m_head{0}; // Next slot to write, owned by the producer
+        std::atomic<size_t> m_tail{0}; // Next slot to read, owned by the consumer
+    };
+
+}
@@ -38,6 +38,31 @@ std::unique_ptr<SysExMsgHandler> sysExHandler;
 std::unique_ptr<MidiMsgHandler> midiMsgHandler;
 std::unique_ptr<MessageRouter> messageRouter;
 
+#ifdef CFG_EXTRA_LOCAL_STORAGE
+// Instrument wear counters are only written every CFG_WEAR_SAVE_INTERVAL_MS to limit flash writes
+uint32_t lastWearSave = 0;
+
+void loadInstrumentWear() {
+  std::array<InstrumentWear, HardwareConfig::MAX_NUM_INSTRUMENTS> wear;
+  if (!LocalStorageFactory::getInstance().getInstrumentWear(wear.data(), wear.size())) return;
+  for (uint8_t i = 0; i < wear.size(); i++) {
+    instrumentController->setInstrumentWear(i, wear[i]);
+  }
+}
+
+void saveInstrumentWear() {
+  if (millis() - lastWearSave < CFG_WEAR_SAVE_INTERVAL_MS) return;
+  lastWearSave = millis();
+  if (!instrumentController->takeWearChanged()) return;
+
+  std::array<InstrumentWear, HardwareConfig::MAX_NUM_INSTRUMENTS> wear;
+  for (uint8_t i = 0; i < wear.size(); i++) {
+    wear[i] = instrumentController->getInstrumentWear(i);
+  }
+  LocalStorageFactory::getInstance().setInstrumentWear(wear.data(), wear.size());
+}
+#endif
+
 
 void setup() {
 
@@ -70,23 +95,24 @@ void setup() {
     if (distributorManager) {
       LocalStorageFactory::getInstance().initializeDeviceConfiguration(*distributorManager);
     }
+    if (instrumentController) {
+      loadInstrumentWear();
+    }
   #endif
 
 //=== Hardcode Distributor Configuration For Startup ===
 
   // //Distributor 1
-  // Distributor distributor1(instrumentController);
-  // distributor1.setChannels(0x0001); // 1
-  // distributor1.setInstruments(0x000000FF); // 1-8
-  // distributor1.setDistributionMethod(DistributionMethod::RoundRobinBalance);
-  // distributorManager->addDistributor(std::move(distributor1));
+  // distributorManager->addDistributor();
+  // distributorManager->setDistributorChannels(0, 0x0001); // 1
+  // distributorManager->setDistributorInstruments(0, 0x000000FF); // 1-8
+  // distributorManager->setDistributorMethod(0, DistributionMethod::RoundRobinBalance);
 
   // //Distributor 2
-  // Distributor distributor2(instrumentController);
-  // distributor2.setChannels(0x0002); // 2
-  // distributor2.setInstruments(0x000000FF); // 1-8
-  // distributor2.setDistributionMethod(DistributionMethod::StraightThrough);
-  // distributorManager->addDistributor(std::move(distributor2));
+  // distributorManager->addDistributor();
+  // distributorManager->setDistributorChannels(1, 0x0002); // 2
+  // distributorManager->setDistributorInstruments(1, 0x000000FF); // 1-8
+  // distributorManager->setDistributorMethod(1, DistributionMethod::StraightThrough);
 
   //===========================================
 
@@ -108,8 +134,17 @@ void loop() {
     messageRouter->processMessages();
   }
   
-  // Check for instrument timeouts
+  // Send latency compensated notes which are due and check for instrument timeouts.
+  // The section holds the event timer interrupt off the instruments while periodic() runs.
   if (instrumentController) {
+    instrumentController->fireScheduledNotes();
+    InstrumentControllerBase::LoopSection section(*instrumentController);
     instrumentController->periodic();
   }
+
+  #ifdef CFG_EXTRA_LOCAL_STORAGE
+    if (instrumentController) {
+      saveInstrumentWear();
+    }
+  #endif
 }
\ No newline at end of file
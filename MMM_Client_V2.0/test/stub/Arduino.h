@@ -0,0 +1,109 @@
+/*
+ * Arduino.h
+ * Host stand-in for the Arduino core, used by the native unit tests.
+ * Time only moves when a test advances NativeClock.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <string>
+
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define DRAM_ATTR
+#define FASTRUN
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+
+namespace NativeClock {
+    inline uint32_t nowUs = 0;
+    inline void advance(uint32_t us) { nowUs += us; }
+};
+
+inline uint32_t micros() { return NativeClock::nowUs; }
+inline uint32_t millis() { return NativeClock::nowUs / 1000; }
+inline void delay(uint32_t ms) { NativeClock::advance(ms * 1000); }
+inline void delayMicroseconds(uint32_t us) { NativeClock::advance(us); }
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+
+typedef std::string String;
+
+// Teensy 4.1 registers and core functions, for tests built as the board
+#ifdef __IMXRT1062__
+inline volatile uint32_t GPIO6_DR_SET, GPIO7_DR_SET, GPIO8_DR_SET, GPIO9_DR_SET;
+inline volatile uint32_t GPIO6_DR_CLEAR, GPIO7_DR_CLEAR, GPIO8_DR_CLEAR, GPIO9_DR_CLEAR;
+
+// The cycle counter reads the host's time stamp counter, its rate is the host's not the board's
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define ARM_DWT_CYCCNT (static_cast<uint32_t>(__rdtsc()))
+#else
+#include <chrono>
+#define ARM_DWT_CYCCNT (static_cast<uint32_t>(std::chrono::steady_clock::now().time_since_epoch().count()))
+#endif
+inline uint32_t F_CPU_ACTUAL = 600000000;
+
+inline void digitalWriteFast(uint8_t, uint8_t) {}
+
+// FlexPWM and QuadTimer modules, the fields Teensy41_HwPWM writes. Tests read them back.
+inline uint32_t F_BUS_ACTUAL = 150000000;
+
+inline void analogWriteResolution(uint8_t) {}
+inline void analogWriteFrequency(uint8_t, float) {}
+inline void analogWrite(uint8_t, int) {}
+
+struct IMXRT_FLEXPWM_SM_t {
+    volatile uint16_t CTRL, VAL0, VAL1, VAL2, VAL3, VAL4, VAL5;
+};
+struct IMXRT_FLEXPWM_t {
+    IMXRT_FLEXPWM_SM_t SM[4];
+    volatile uint16_t MCTRL;
+};
+struct IMXRT_TMR_CH_t {
+    volatile uint16_t COMP1, LOAD, CNTR, CTRL, SCTRL, CMPLD1, CSCTRL;
+};
+struct IMXRT_TMR_t {
+    IMXRT_TMR_CH_t CH[4];
+};
+inline IMXRT_FLEXPWM_t IMXRT_FLEXPWM1, IMXRT_FLEXPWM2, IMXRT_FLEXPWM3, IMXRT_FLEXPWM4;
+inline IMXRT_TMR_t IMXRT_TMR1, IMXRT_TMR2, IMXRT_TMR3, IMXRT_TMR4;
+
+#define FLEXPWM_MCTRL_LDOK(n)   (static_cast<uint16_t>(((n) & 0x0F) << 0))
+#define FLEXPWM_MCTRL_CLDOK(n)  (static_cast<uint16_t>(((n) & 0x0F) << 4))
+#define FLEXPWM_SMCTRL_FULL     (static_cast<uint16_t>(1 << 10))
+#define FLEXPWM_SMCTRL_PRSC(n)  (static_cast<uint16_t>(((n) & 0x07) << 4))
+#define TMR_CTRL_CM(n)          (static_cast<uint16_t>(((n) & 0x07) << 13))
+#define TMR_CTRL_PCS(n)         (static_cast<uint16_t>(((n) & 0x0F) << 9))
+#define TMR_CTRL_LENGTH         (static_cast<uint16_t>(1 << 5))
+#define TMR_CTRL_OUTMODE(n)     (static_cast<uint16_t>(((n) & 0x07) << 0))
+#define TMR_SCTRL_OEN           (static_cast<uint16_t>(1 << 0))
+#define TMR_SCTRL_FORCE         (static_cast<uint16_t>(1 << 2))
+#define TMR_CSCTRL_CL1(n)       (static_cast<uint16_t>(((n) & 0x03) << 0))
+#endif
+
+// ESP32 core functions, for tests built as the board
+#ifdef ARDUINO_ARCH_ESP32
+#include <chrono>
+
+struct NativeEsp {
+    // The cycle counter counts host nanoseconds at a nominal 240 MHz, its rate is the host's
+    uint32_t getCycleCount() const {
+        return static_cast<uint32_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+    uint32_t getCpuFreqMHz() const { return 240; }
+};
+inline NativeEsp ESP;
+#endif
@@ -0,0 +1,26 @@
+/*
+ * IntervalTimer.h
+ * Host stand-in for the Teensy IntervalTimer. Nothing fires on its own, tests run the
+ * callback with fire() as if the interval had elapsed.
+ */
+#pragma once
+
+#include <cstdint>
+
+class IntervalTimer {
+public:
+    bool begin(void (*callback)(), uint32_t microseconds) {
+        s_callback = callback;
+        s_intervalUs = microseconds;
+        return true;
+    }
+    void end() { s_callback = nullptr; }
+    void priority(uint8_t) {}
+
+    static void fire() { if (s_callback) s_callback(); }
+    static uint32_t interval() { return s_intervalUs; }
+
+private:
+    static inline void (*s_callback)() = nullptr;
+    static inline uint32_t s_intervalUs = 0;
+};
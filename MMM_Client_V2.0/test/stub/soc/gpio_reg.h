@@ -0,0 +1,22 @@
+/*
+ * gpio_reg.h
+ * Host stand-in for the ESP32 GPIO registers. Register writes are logged for the tests
+ * to inspect instead of reaching hardware.
+ */
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#define GPIO_OUT_W1TS_REG  0x3FF44008
+#define GPIO_OUT_W1TC_REG  0x3FF4400C
+#define GPIO_OUT1_W1TS_REG 0x3FF44014
+#define GPIO_OUT1_W1TC_REG 0x3FF44018
+
+namespace NativeRegisters {
+    inline std::vector<std::pair<uint32_t, uint32_t>> writes;
+    inline void write(uint32_t address, uint32_t value) { writes.emplace_back(address, value); }
+};
+
+#define REG_WRITE(reg, value) NativeRegisters::write((reg), (value))
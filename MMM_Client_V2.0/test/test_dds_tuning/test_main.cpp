@@ -0,0 +1,121 @@
+/*
+ * test_main.cpp
+ * Per note cents error of the SwPWM polling and phase accumulator (DDS) engines at
+ * CFG_TIMER_RESOLUTION_US, against equal temperament. Prints the table it checks.
+ */
+
+#include <unity.h>
+#include <cmath>
+#include <cstdio>
+#include "Instruments/Components/NoteTable.h"
+#include "Instruments/Components/TuningTable.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Engine Models
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr uint8_t FIRST_NOTE = 24;
+
+// Exact time between toggles, the SwPWM toggles once per period
+double idealToggleUs(uint8_t note)
+{
+    return 1000000.0 / (440.0 * std::pow(2.0, (note - 69) / 12.0));
+}
+
+// The polling tick toggles when its count reaches the period then restarts from 0
+double pollingToggleUs(uint8_t note)
+{
+    return (Tuning::active().ticks[note] + 1.0) * CFG_TIMER_RESOLUTION_US;
+}
+
+// The accumulator carries once every 2^32 / increment ticks on average
+double ddsToggleUs(uint8_t note)
+{
+    const uint32_t increment = NoteTables::noteIncrement(Tuning::active().frequencies[note], CFG_TIMER_RESOLUTION_US);
+    return 4294967296.0 * CFG_TIMER_RESOLUTION_US / increment;
+}
+
+// A longer time between toggles is a flatter note
+double centsSharp(double toggleUs, double idealUs)
+{
+    return 1200.0 * std::log2(idealUs / toggleUs);
+}
+
+void setUp(void)
+{
+    Tuning::selectPreset(TuningPreset::EqualTemperament);
+}
+
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_cents_error_per_note(void)
+{
+    char line[96];
+    snprintf(line, sizeof(line), "Cents error at %dus: note, polling, dds", static_cast<int>(CFG_TIMER_RESOLUTION_US));
+    TEST_MESSAGE(line);
+
+    double worstPolling = 0;
+    double worstDds = 0;
+    for (uint8_t note = FIRST_NOTE; note < 128; note++) {
+        const double ideal = idealToggleUs(note);
+        const double polling = centsSharp(pollingToggleUs(note), ideal);
+        const double dds = centsSharp(ddsToggleUs(note), ideal);
+        snprintf(line, sizeof(line), "%3u %9.3f %9.4f", note, polling, dds);
+        TEST_MESSAGE(line);
+
+        if (std::fabs(polling) > worstPolling) worstPolling = std::fabs(polling);
+        if (std::fabs(dds) > worstDds) worstDds = std::fabs(dds);
+    }
+    snprintf(line, sizeof(line), "Worst: polling %.3f cents, dds %.4f cents", worstPolling, worstDds);
+    TEST_MESSAGE(line);
+
+    // Long run pitch is exact to the Q16 table frequency
+    TEST_ASSERT_LESS_THAN_FLOAT(0.01, worstDds);
+    TEST_ASSERT_GREATER_THAN_FLOAT(100.0, worstPolling);
+}
+
+void test_dds_jitter_is_one_tick(void)
+{
+    // Toggles land on the tick before or after the exact time, never further out
+    for (uint8_t note = FIRST_NOTE; note < 128; note++) {
+        const uint32_t increment = NoteTables::noteIncrement(Tuning::active().frequencies[note], CFG_TIMER_RESOLUTION_US);
+        const uint32_t shortest = static_cast<uint32_t>(0x100000000ULL / increment);
+
+        uint32_t phase = 0;
+        uint32_t sinceToggle = 0;
+        bool first = true;
+        for (uint32_t tick = 0; tick < 100000; tick++) {
+            const uint32_t next = phase + increment;
+            sinceToggle++;
+            if (next < phase) {
+                if (!first) TEST_ASSERT_UINT32_WITHIN(1, shortest, sinceToggle);
+                first = false;
+                sinceToggle = 0;
+            }
+            phase = next;
+        }
+    }
+}
+
+void test_double_rate_increment(void)
+{
+    // Toggling twice a period takes the doubled tick, twice the increment
+    for (uint8_t note = FIRST_NOTE; note < 128; note++) {
+        const uint32_t frequency = Tuning::active().frequencies[note];
+        const uint32_t single = NoteTables::noteIncrement(frequency, CFG_TIMER_RESOLUTION_US);
+        TEST_ASSERT_UINT32_WITHIN(1, 2ULL * single, NoteTables::noteIncrement(frequency, CFG_TIMER_RESOLUTION_US * 2));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_cents_error_per_note);
+    RUN_TEST(test_dds_jitter_is_one_tick);
+    RUN_TEST(test_double_rate_increment);
+    return UNITY_END();
+}
@@ -0,0 +1,195 @@
+/*
+ * test_main.cpp
+ * DeadlineScheduler against a brute force reference, then a simulation of both SwPWM
+ * engines comparing every output edge with the ideal edge times of its voice.
+ */
+
+#include <unity.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "Instruments/Components/DeadlineScheduler.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr uint8_t VOICES = HardwareConfig::MAX_NUM_INSTRUMENTS;
+
+// Starts a second before micros() wraps so the simulations cross it
+constexpr uint32_t START_US = 0xFFF0BDC0;
+
+DeadlineScheduler scheduler;
+
+void report(const char* what, double value, const char* unit)
+{
+    char message[96];
+    snprintf(message, sizeof(message), "%s %.1f %s", what, value, unit);
+    TEST_MESSAGE(message);
+}
+
+// Edge intervals in microseconds, the periods of notes 33 to 69 every 6 semitones and of note 116
+constexpr uint16_t EDGE_US[] = {18182, 12856, 9091, 6428, 4545, 3214, 2273, 150};
+constexpr uint8_t SIM_VOICES = sizeof(EDGE_US) / sizeof(EDGE_US[0]);
+constexpr uint32_t SIM_US = 2000000;
+
+struct EdgeStats {
+    uint32_t interrupts = 0;
+    uint32_t voiceVisits = 0;
+    uint32_t edges = 0;
+    int32_t worstUs = 0;
+    int64_t totalUs = 0;
+
+    // Edge n of a voice is ideally n intervals after the start
+    void record(uint8_t voice, uint32_t edge, uint32_t atUs) {
+        const int32_t error = static_cast<int32_t>(atUs - (START_US + edge * EDGE_US[voice]));
+        const int32_t magnitude = error < 0 ? -error : error;
+        if (magnitude > worstUs) worstUs = magnitude;
+        totalUs += magnitude;
+        edges++;
+    }
+};
+
+void setUp(void)
+{
+    scheduler.clear();
+}
+
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_heap_matches_reference(void)
+{
+    // Reference keeps the deadlines in a flat array and scans for the earliest
+    std::array<bool, VOICES> scheduled = {};
+    std::array<uint32_t, VOICES> deadlines = {};
+    uint32_t now = START_US;
+
+    srand(39);
+    for (uint32_t step = 0; step < 200000; step++) {
+        const uint8_t voice = rand() % VOICES;
+        switch (rand() % 8) {
+            case 0:
+                scheduler.remove(voice);
+                scheduled[voice] = false;
+                break;
+            case 1:
+                if (rand() % 64 == 0) {
+                    scheduler.clear();
+                    scheduled = {};
+                }
+                break;
+            case 2:
+            case 3:
+                if (!scheduler.empty()) {
+                    const uint8_t top = scheduler.top();
+                    deadlines[top] = scheduler.topDeadline() + 1 + rand() % 5000;
+                    scheduler.rescheduleTop(deadlines[top]);
+                }
+                break;
+            default:
+                deadlines[voice] = now + rand() % 20000;
+                scheduler.set(voice, deadlines[voice]);
+                scheduled[voice] = true;
+                break;
+        }
+        now += rand() % 50;
+
+        // Same membership and the same earliest deadline, ties may pick either voice
+        bool any = false;
+        uint32_t earliest = 0;
+        for (uint8_t i = 0; i < VOICES; i++) {
+            TEST_ASSERT_EQUAL(scheduled[i], scheduler.contains(i));
+            if (scheduled[i] && (!any || static_cast<int32_t>(deadlines[i] - earliest) < 0)) {
+                earliest = deadlines[i];
+                any = true;
+            }
+        }
+        TEST_ASSERT_EQUAL(any, !scheduler.empty());
+        if (any) {
+            TEST_ASSERT_EQUAL_UINT32(earliest, scheduler.topDeadline());
+            TEST_ASSERT_EQUAL_UINT32(earliest, deadlines[scheduler.top()]);
+        }
+    }
+}
+
+void test_deadline_engine_against_polling(void)
+{
+    // Polling: every 8us tick visits every voice, which toggles once its tick count passes
+    // the period in whole ticks, the same arithmetic as the SwPWM polling tick.
+    EdgeStats polling;
+    {
+        std::array<uint16_t, SIM_VOICES> ticks = {};
+        std::array<uint32_t, SIM_VOICES> edges = {};
+        for (uint32_t now = START_US; now - START_US < SIM_US; now += CFG_TIMER_RESOLUTION_US) {
+            polling.interrupts++;
+            for (uint8_t i = 0; i < SIM_VOICES; i++) {
+                polling.voiceVisits++;
+                if (ticks[i] >= EDGE_US[i] / CFG_TIMER_RESOLUTION_US) {
+                    polling.record(i, ++edges[i], now);
+                    ticks[i] = 0;
+                } else {
+                    ticks[i]++;
+                }
+            }
+        }
+    }
+
+    // Deadline: the one-shot timer fires for the earliest edge. The model adds 2us of
+    // interrupt entry and 1us per edge served, and an interrupt can't start inside the last.
+    EdgeStats deadline;
+    {
+        constexpr uint32_t ENTRY_US = 2;
+        std::array<uint32_t, SIM_VOICES> edges = {};
+        for (uint8_t i = 0; i < SIM_VOICES; i++) scheduler.set(i, START_US + EDGE_US[i]);
+
+        uint32_t busyUntil = START_US;
+        while (static_cast<int32_t>(scheduler.topDeadline() - (START_US + SIM_US)) < 0) {
+            uint32_t now = scheduler.topDeadline();
+            if (static_cast<int32_t>(busyUntil - now) > 0) now = busyUntil;
+            now += ENTRY_US;
+            deadline.interrupts++;
+
+            // Served edges go out together when the batch commits at the end of the pass
+            std::vector<uint8_t> served;
+            while (static_cast<int32_t>(scheduler.topDeadline() - now) <= 0) {
+                const uint8_t voice = scheduler.top();
+                served.push_back(voice);
+                scheduler.rescheduleTop(scheduler.topDeadline() + EDGE_US[voice]);
+            }
+            busyUntil = now + static_cast<uint32_t>(served.size());
+            deadline.voiceVisits += served.size();
+            for (uint8_t voice : served) deadline.record(voice, ++edges[voice], busyUntil);
+        }
+    }
+
+    report("Polling interrupts", polling.interrupts, "");
+    report("Polling voice visits", polling.voiceVisits, "");
+    report("Polling worst edge error", polling.worstUs, "us");
+    report("Deadline interrupts", deadline.interrupts, "");
+    report("Deadline voice visits", deadline.voiceVisits, "");
+    report("Deadline mean edge error", static_cast<double>(deadline.totalUs) / deadline.edges, "us");
+    report("Deadline worst edge error", deadline.worstUs, "us");
+
+    // The deadline engine makes every ideal edge within a few microseconds
+    uint32_t idealEdges = 0;
+    for (uint16_t edgeUs : EDGE_US) idealEdges += SIM_US / edgeUs;
+    TEST_ASSERT_INT_WITHIN(SIM_VOICES, idealEdges, deadline.edges);
+    TEST_ASSERT_LESS_OR_EQUAL(10, deadline.worstUs);
+    TEST_ASSERT_LESS_THAN(polling.interrupts / 5, deadline.interrupts);
+
+    // Polling toggles up to a tick late every edge, so it falls behind over the run
+    TEST_ASSERT_LESS_THAN(idealEdges, polling.edges);
+    TEST_ASSERT_GREATER_THAN(1000, polling.worstUs);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_heap_matches_reference);
+    RUN_TEST(test_deadline_engine_against_polling);
+    return UNITY_END();
+}
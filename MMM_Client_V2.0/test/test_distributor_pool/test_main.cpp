@@ -0,0 +1,158 @@
+/*
+ * test_main.cpp
+ * Distributors run from the fixed pool: once the manager is built, neither the
+ * note path nor adding, removing or reconfiguring distributors touches the heap.
+ */
+
+#include <unity.h>
+#include <cstdlib>
+#include <new>
+#include "Distributors/DistributorManager.h"
+#include "Instruments/InstrumentControllerBase.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Heap Allocation Counter
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+    bool countingAllocations = false;
+    size_t allocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    if (countingAllocations) allocations++;
+    void* block = std::malloc(size ? size : 1);
+    if (block == nullptr) throw std::bad_alloc();
+    return block;
+}
+
+// Kept out of line, GCC otherwise pairs the inlined free() with the builtin operator new
+__attribute__((noinline)) void operator delete(void* block) noexcept { std::free(block); }
+void operator delete(void* block, std::size_t) noexcept { operator delete(block); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Monophonic Stand-in Instruments
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class FakeInstruments : public InstrumentControllerBase {
+    std::array<uint8_t, NUM_Instruments> m_notes = {};
+    std::array<bool, NUM_Instruments> m_sounding = {};
+
+public:
+    void reset(uint8_t instrument) override { m_sounding[instrument] = false; }
+    void resetAll() override { m_sounding = {}; }
+    void playNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) override {
+        m_notes[instrument] = note;
+        m_sounding[instrument] = true;
+    }
+    void stopNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) override {
+        if (m_notes[instrument] == note) m_sounding[instrument] = false;
+    }
+    void stopAll() override {
+        m_sounding = {};
+        releaseAllVoiceOwners();
+    }
+    uint8_t getNumActiveNotes(uint8_t instrument) override { return m_sounding[instrument] ? 1 : 0; }
+    bool isNoteActive(uint8_t instrument, uint8_t note) override { return m_sounding[instrument] && m_notes[instrument] == note; }
+};
+
+std::shared_ptr<DistributorManager> manager;
+
+MidiMessage channelMessage(uint8_t type, uint8_t channel, uint8_t data1, uint8_t data2)
+{
+    MidiMessage message;
+    message.buffer[0] = type | (channel & 0x0F);
+    message.buffer[1] = data1 & 0x7F;
+    message.buffer[2] = data2 & 0x7F;
+    message.length = 3;
+    return message;
+}
+
+void setUp(void)
+{
+    manager->removeAllDistributors();
+    allocations = 0;
+}
+
+void tearDown(void)
+{
+    countingAllocations = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_note_path_does_not_allocate(void)
+{
+    const DistributionMethod methods[] = {
+        DistributionMethod::StraightThrough, DistributionMethod::RoundRobin,
+        DistributionMethod::RoundRobinBalance, DistributionMethod::Ascending,
+        DistributionMethod::Descending, DistributionMethod::Stack, DistributionMethod::WearLevel
+    };
+    for (uint8_t id = 0; id < 7; id++) {
+        manager->addDistributor();
+        manager->setDistributorChannels(id, 1 << id);
+        manager->setDistributorInstruments(id, 0xFF);
+        manager->setDistributorMethod(id, methods[id]);
+    }
+    Device::DamperPedal = true;
+
+    countingAllocations = true;
+    srand(1);
+    for (uint32_t i = 0; i < 100000; i++) {
+        const uint8_t channel = rand() % 7;
+        switch (rand() % 8) {
+            case 0:
+                manager->distributeMessage(channelMessage(Midi::ControlChange, channel, MidiCC::DamperPedal, rand() % 128));
+                break;
+            case 1:
+                manager->distributeMessage(channelMessage(Midi::NoteOff, channel, rand() % 128, 0));
+                break;
+            default:
+                manager->distributeMessage(channelMessage(Midi::NoteOn, channel, rand() % 128, rand() % 128));
+                break;
+        }
+    }
+    countingAllocations = false;
+
+    Device::DamperPedal = false;
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+}
+
+void test_pool_changes_do_not_allocate(void)
+{
+    countingAllocations = true;
+    for (uint32_t round = 0; round < 1000; round++) {
+        while (manager->getDistributorCount() < HardwareConfig::MAX_NUM_DISTRIBUTORS) manager->addDistributor();
+        for (uint8_t id = 0; id < manager->getDistributorCount(); id++) {
+            manager->setDistributorMethod(id, static_cast<DistributionMethod>(id % 7));
+            manager->setDistributorChannels(id, 0xFFFF);
+            manager->setDistributorMinMaxNotes(id, 24, 96);
+            manager->distributeMessage(channelMessage(Midi::NoteOn, id, 60, 100));
+        }
+        manager->removeDistributor(round % HardwareConfig::MAX_NUM_DISTRIBUTORS);
+        manager->removeAllDistributors();
+    }
+    countingAllocations = false;
+
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+}
+
+void test_full_pool_rejects_another_distributor(void)
+{
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_DISTRIBUTORS + 2; i++) manager->addDistributor();
+    TEST_ASSERT_EQUAL(HardwareConfig::MAX_NUM_DISTRIBUTORS, manager->getDistributorCount());
+}
+
+int main(int argc, char** argv)
+{
+    manager = DistributorManager::getInstance(std::make_shared<FakeInstruments>());
+
+    UNITY_BEGIN();
+    RUN_TEST(test_note_path_does_not_allocate);
+    RUN_TEST(test_pool_changes_do_not_allocate);
+    RUN_TEST(test_full_pool_rejects_another_distributor);
+    return UNITY_END();
+}
@@ -0,0 +1,227 @@
+/*
+ * test_main.cpp
+ * Per note eligibility: the masks built from canPlayNote, notes routed only to instruments
+ * that can play them, and octave folding of notes no pooled instrument can play.
+ */
+
+#include <unity.h>
+#include "Distributors/DistributorManager.h"
+#include "Instruments/InstrumentControllerBase.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stand-in Instruments With Mixed Ranges
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Instruments 0-3 low, 4-5 middle, 6 high, 7 can't play anything
+constexpr uint8_t RANGES[8][2] = {{36, 59}, {36, 59}, {36, 59}, {36, 59}, {60, 83}, {60, 83}, {80, 96}, {1, 0}};
+
+class FakeInstruments : public InstrumentControllerBase {
+    std::array<uint8_t, NUM_Instruments> m_notes = {};
+    std::array<bool, NUM_Instruments> m_sounding = {};
+
+public:
+    void reset(uint8_t instrument) override { m_sounding[instrument] = false; }
+    void resetAll() override { stopAll(); }
+    void playNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) override {
+        m_notes[instrument] = note;
+        m_sounding[instrument] = true;
+    }
+    void stopNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) override {
+        if (!m_sounding[instrument] || m_notes[instrument] != note) return;
+        m_sounding[instrument] = false;
+        releaseVoiceOwner(instrument);
+    }
+    void stopAll() override {
+        m_sounding = {};
+        releaseAllVoiceOwners();
+    }
+    uint8_t getNumActiveNotes(uint8_t instrument) override { return m_sounding[instrument] ? 1 : 0; }
+    bool isNoteActive(uint8_t instrument, uint8_t note) override { return m_sounding[instrument] && m_notes[instrument] == note; }
+    bool canPlayNote(uint8_t instrument, uint8_t note) override {
+        return instrument < 8 && note >= RANGES[instrument][0] && note <= RANGES[instrument][1];
+    }
+
+    // Instrument sounding the note, NONE if none is
+    uint8_t soundingOn(uint8_t note) const {
+        for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+            if (m_sounding[i] && m_notes[i] == note) return i;
+        }
+        return NONE;
+    }
+    uint8_t numSounding() const {
+        uint8_t count = 0;
+        for (bool sounding : m_sounding) count += sounding;
+        return count;
+    }
+};
+
+std::shared_ptr<FakeInstruments> instruments;
+std::shared_ptr<DistributorManager> manager;
+
+MidiMessage channelMessage(uint8_t type, uint8_t channel, uint8_t data1, uint8_t data2)
+{
+    MidiMessage message;
+    message.buffer[0] = type | (channel & 0x0F);
+    message.buffer[1] = data1 & 0x7F;
+    message.buffer[2] = data2 & 0x7F;
+    message.length = 3;
+    return message;
+}
+
+void noteOn(uint8_t note) { manager->distributeMessage(channelMessage(Midi::NoteOn, 0, note, 100)); }
+void noteOff(uint8_t note) { manager->distributeMessage(channelMessage(Midi::NoteOff, 0, note, 0)); }
+
+// One distributor on channel 0 over the given instruments
+void addDistributor(uint32_t pool, DistributionMethod method, bool fold)
+{
+    manager->addDistributor();
+    manager->setDistributorChannels(0, 0x1);
+    manager->setDistributorInstruments(0, pool);
+    manager->setDistributorMethod(0, method);
+    uint16_t bools = DISTRIBUTOR_BOOL_MASK::NOTEOVERWRITE;
+    if (fold) bools |= DISTRIBUTOR_BOOL_MASK::OCTAVEFOLD;
+    manager->setDistributorBoolValues(0, bools);
+}
+
+void setUp(void)
+{
+    manager->removeAllDistributors();
+}
+
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_masks_follow_can_play_note(void)
+{
+    for (uint8_t note = 0; note < 128; note++) {
+        uint32_t expected = 0;
+        for (uint8_t i = 0; i < 8; i++) {
+            if (instruments->canPlayNote(i, note)) expected |= 1UL << i;
+        }
+        TEST_ASSERT_EQUAL_HEX32(expected, instruments->getEligibleInstruments(note));
+    }
+    TEST_ASSERT_EQUAL_HEX32(0x0F, instruments->getEligibleInstruments(40));
+    TEST_ASSERT_EQUAL_HEX32(0x30, instruments->getEligibleInstruments(72));
+    TEST_ASSERT_EQUAL_HEX32(0x40, instruments->getEligibleInstruments(90));
+    TEST_ASSERT_EQUAL_HEX32(0, instruments->getEligibleInstruments(20));
+    TEST_ASSERT_EQUAL_HEX32(instruments->getEligibleInstruments(20), instruments->getEligibleInstruments(20 + 128));
+}
+
+void test_notes_go_to_instruments_that_can_play_them(void)
+{
+    // Ascending would take instrument 0 first, only the instruments in range are candidates
+    addDistributor(0xFF, DistributionMethod::Ascending, false);
+    noteOn(90);
+    TEST_ASSERT_EQUAL_UINT8(6, instruments->soundingOn(90));
+    noteOn(70);
+    TEST_ASSERT_EQUAL_UINT8(4, instruments->soundingOn(70));
+    noteOn(72);
+    TEST_ASSERT_EQUAL_UINT8(5, instruments->soundingOn(72));
+    noteOn(40);
+    TEST_ASSERT_EQUAL_UINT8(0, instruments->soundingOn(40));
+
+    // Both middle instruments are busy, a third middle note steals one of them
+    noteOn(74);
+    const uint8_t stolen = instruments->soundingOn(74);
+    TEST_ASSERT_TRUE(stolen == 4 || stolen == 5);
+    TEST_ASSERT_EQUAL_UINT8(4, instruments->numSounding());
+
+    // Out of every range and no folding, dropped
+    noteOn(20);
+    noteOn(110);
+    TEST_ASSERT_EQUAL_UINT8(4, instruments->numSounding());
+}
+
+void test_every_method_respects_eligibility(void)
+{
+    const DistributionMethod methods[] = {
+        DistributionMethod::RoundRobin, DistributionMethod::RoundRobinBalance, DistributionMethod::Ascending,
+        DistributionMethod::Descending, DistributionMethod::WearLevel
+    };
+    for (DistributionMethod method : methods) {
+        manager->removeAllDistributors();
+        addDistributor(0xFF, method, false);
+        for (uint8_t note = 30; note < 100; note++) {
+            noteOn(note);
+            const uint8_t instrument = instruments->soundingOn(note);
+            if (instrument != NONE) TEST_ASSERT_TRUE(instruments->canPlayNote(instrument, note));
+            TEST_ASSERT_EQUAL(instruments->getEligibleInstruments(note) != 0, instrument != NONE);
+            noteOff(note);
+        }
+    }
+}
+
+void test_octave_fold(void)
+{
+    // Only the low instruments in the pool, higher notes fold down into 36-59
+    addDistributor(0x0F, DistributionMethod::Ascending, true);
+    noteOn(72);
+    TEST_ASSERT_EQUAL_UINT8(0, instruments->soundingOn(48));
+    noteOn(95);
+    TEST_ASSERT_EQUAL_UINT8(1, instruments->soundingOn(59));
+    noteOn(24);
+    TEST_ASSERT_EQUAL_UINT8(2, instruments->soundingOn(36));
+
+    // The note off of the original note stops the folded voice
+    noteOff(72);
+    TEST_ASSERT_EQUAL_UINT8(NONE, instruments->soundingOn(48));
+    TEST_ASSERT_EQUAL_UINT8(2, instruments->numSounding());
+}
+
+void test_fold_prefers_the_lower_octave(void)
+{
+    // A pool of 0 (36-59) and 6 (80-96) leaves a gap at 60-79. From 68 to 71 both the
+    // octave below and the octave above are playable, the lower one wins
+    addDistributor(0x41, DistributionMethod::Ascending, true);
+    noteOn(70);
+    TEST_ASSERT_EQUAL_UINT8(0, instruments->soundingOn(58));
+    noteOff(70);
+
+    // Only the octave above is in reach
+    noteOn(72);
+    TEST_ASSERT_EQUAL_UINT8(6, instruments->soundingOn(84));
+    noteOff(72);
+
+    // One octave isn't enough, the search goes on to the next
+    noteOn(120);
+    TEST_ASSERT_EQUAL_UINT8(6, instruments->soundingOn(96));
+}
+
+void test_fold_with_no_playable_octave(void)
+{
+    // Instrument 7 plays nothing, every note is dropped even with folding on
+    addDistributor(0x80, DistributionMethod::Ascending, true);
+    for (uint8_t note = 0; note < 128; note++) noteOn(note);
+    TEST_ASSERT_EQUAL_UINT8(0, instruments->numSounding());
+}
+
+void test_fold_stays_inside_the_distributor_range(void)
+{
+    // Notes outside the distributor's own window are dropped before folding
+    addDistributor(0x0F, DistributionMethod::Ascending, true);
+    manager->setDistributorMinMaxNotes(0, 60, 80);
+    noteOn(50);
+    noteOn(90);
+    TEST_ASSERT_EQUAL_UINT8(0, instruments->numSounding());
+    noteOn(70);
+    TEST_ASSERT_EQUAL_UINT8(0, instruments->soundingOn(58));
+}
+
+int main(int argc, char** argv)
+{
+    instruments = std::make_shared<FakeInstruments>();
+    manager = DistributorManager::getInstance(instruments);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_masks_follow_can_play_note);
+    RUN_TEST(test_notes_go_to_instruments_that_can_play_them);
+    RUN_TEST(test_every_method_respects_eligibility);
+    RUN_TEST(test_octave_fold);
+    RUN_TEST(test_fold_prefers_the_lower_octave);
+    RUN_TEST(test_fold_with_no_playable_octave);
+    RUN_TEST(test_fold_stays_inside_the_distributor_range);
+    return UNITY_END();
+}
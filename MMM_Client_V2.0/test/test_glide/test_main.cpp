@@ -0,0 +1,171 @@
+/*
+ * test_main.cpp
+ * Glide simulation: the modulation engine is stepped at control rate and each voice's
+ * period is compared with an ideal glide that is linear in pitch and ends on time.
+ */
+
+#include <unity.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "Instruments/Components/Modulation.h"
+#include "Instruments/Components/NoteTable.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr uint8_t CHANNEL = 3;
+constexpr uint16_t LOW_PERIOD = NoteTables::NOTE_PERIODS[48];  // C3
+constexpr uint16_t HIGH_PERIOD = NoteTables::NOTE_PERIODS[72]; // C5
+
+ModulationEngine engine;
+uint32_t nowUs;
+
+double cents(double ratio)
+{
+    return std::fabs(1200.0 * std::log2(ratio));
+}
+
+void report(const char* what, double value, const char* unit)
+{
+    char message[96];
+    snprintf(message, sizeof(message), "%s %.4f %s", what, value, unit);
+    TEST_MESSAGE(message);
+}
+
+// Portamento on with the CC5 value giving the full glide time
+uint32_t enablePortamento()
+{
+    engine.controlChange(CHANNEL, MidiCC::Portamento, 127);
+    engine.controlChange(CHANNEL, MidiCC::PortamentoTime, 127);
+    return CFG_PORTAMENTO_MAX_MS * 1000UL;
+}
+
+void setUp(void)
+{
+    engine = ModulationEngine();
+    nowUs = 0;
+    engine.update(nowUs);
+}
+
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_log2_accuracy(void)
+{
+    // Every 16 bit value then random values over the rest of the range
+    double worst = 0;
+    srand(38);
+    for (uint32_t i = 1; i < 65536 + 100000; i++) {
+        const uint32_t value = (i < 65536) ? i : (static_cast<uint32_t>(rand()) << 1) | 1;
+        const double error = std::fabs(NoteTables::log2Q16(value) / 65536.0 - std::log2(static_cast<double>(value))) * 1200.0;
+        if (error > worst) worst = error;
+    }
+    report("log2Q16 worst error", worst, "cents");
+    TEST_ASSERT_LESS_THAN_FLOAT(0.05, worst);
+}
+
+void test_glide_follows_the_ideal_curve(void)
+{
+    const uint32_t glideUs = enablePortamento();
+    engine.startVoice(0, CHANNEL, LOW_PERIOD);
+    engine.startVoice(0, CHANNEL, HIGH_PERIOD);
+
+    // Starts on the old pitch
+    TEST_ASSERT_UINT16_WITHIN(1, LOW_PERIOD, engine.targetPeriod(0));
+
+    double worstCents = 0;
+    uint32_t arrivedUs = 0;
+    const double startOctaves = std::log2(static_cast<double>(LOW_PERIOD) / HIGH_PERIOD);
+    while (nowUs < glideUs + 10000) {
+        nowUs += CFG_MODULATION_INTERVAL_US;
+        engine.update(nowUs);
+
+        // Linear in pitch from two octaves below to the note
+        const double remaining = (nowUs >= glideUs) ? 0.0 : 1.0 - static_cast<double>(nowUs) / glideUs;
+        const double ideal = HIGH_PERIOD * std::exp2(startOctaves * remaining);
+        const double error = std::fabs(engine.targetPeriod(0) - ideal);
+        TEST_ASSERT_LESS_OR_EQUAL(1.0, error); // Periods are whole microseconds
+
+        const double offsetError = cents(std::exp2(engine.pitchOffset(0) / 65536.0 + startOctaves * remaining));
+        if (offsetError > worstCents) worstCents = offsetError;
+        if (arrivedUs == 0 && engine.targetPeriod(0) == HIGH_PERIOD && engine.pitchOffset(0) == 0) arrivedUs = nowUs;
+    }
+    report("Glide pitch worst error", worstCents, "cents");
+    TEST_ASSERT_LESS_THAN_FLOAT(0.1, worstCents);
+
+    // Lands on the note at the glide time, not before
+    TEST_ASSERT_EQUAL_UINT32(glideUs, arrivedUs);
+}
+
+void test_glide_time_curve(void)
+{
+    engine.controlChange(CHANNEL, MidiCC::Portamento, 127);
+    engine.controlChange(CHANNEL, MidiCC::PortamentoTime, 64);
+    engine.startVoice(0, CHANNEL, LOW_PERIOD);
+    engine.startVoice(0, CHANNEL, HIGH_PERIOD);
+
+    // 64 * 64 / (127 * 127) of the full time
+    const uint32_t glideUs = (64UL * 64 * CFG_PORTAMENTO_MAX_MS / (127 * 127)) * 1000;
+    for (nowUs = CFG_MODULATION_INTERVAL_US; nowUs < glideUs; nowUs += CFG_MODULATION_INTERVAL_US) {
+        engine.update(nowUs);
+        TEST_ASSERT_NOT_EQUAL(0, engine.pitchOffset(0));
+    }
+    engine.update(nowUs);
+    TEST_ASSERT_EQUAL_INT32(0, engine.pitchOffset(0));
+}
+
+void test_retrigger_mid_glide_starts_from_the_current_pitch(void)
+{
+    const uint32_t glideUs = enablePortamento();
+    engine.startVoice(0, CHANNEL, LOW_PERIOD);
+    engine.startVoice(0, CHANNEL, HIGH_PERIOD);
+    for (nowUs = CFG_MODULATION_INTERVAL_US; nowUs <= glideUs / 2; nowUs += CFG_MODULATION_INTERVAL_US) engine.update(nowUs);
+    const uint16_t midPeriod = engine.targetPeriod(0);
+
+    // Heading back down picks up where the voice is, one octave from either note
+    engine.startVoice(0, CHANNEL, LOW_PERIOD);
+    TEST_ASSERT_UINT16_WITHIN(1, midPeriod, engine.targetPeriod(0));
+    TEST_ASSERT_INT32_WITHIN(64, 65536, engine.pitchOffset(0));
+}
+
+void test_legato_only_glides_overlapping_notes(void)
+{
+    enablePortamento();
+    engine.controlChange(CHANNEL, MidiCC::Legato, 127);
+
+    // A detached note plays on pitch and restarts the waveform
+    TEST_ASSERT_FALSE(engine.startVoice(0, CHANNEL, LOW_PERIOD));
+    engine.stopVoice(0);
+    TEST_ASSERT_FALSE(engine.startVoice(0, CHANNEL, HIGH_PERIOD));
+    TEST_ASSERT_EQUAL_UINT16(HIGH_PERIOD, engine.targetPeriod(0));
+
+    // An overlapping note glides and keeps the waveform running
+    TEST_ASSERT_TRUE(engine.startVoice(0, CHANNEL, LOW_PERIOD));
+    TEST_ASSERT_UINT16_WITHIN(1, HIGH_PERIOD, engine.targetPeriod(0));
+}
+
+void test_no_glide_without_portamento(void)
+{
+    engine.controlChange(CHANNEL, MidiCC::PortamentoTime, 127);
+    engine.startVoice(0, CHANNEL, LOW_PERIOD);
+    engine.startVoice(0, CHANNEL, HIGH_PERIOD);
+    TEST_ASSERT_EQUAL_UINT16(HIGH_PERIOD, engine.targetPeriod(0));
+    TEST_ASSERT_FALSE(engine.update(CFG_MODULATION_INTERVAL_US));
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_log2_accuracy);
+    RUN_TEST(test_glide_follows_the_ideal_curve);
+    RUN_TEST(test_glide_time_curve);
+    RUN_TEST(test_retrigger_mid_glide_starts_from_the_current_pitch);
+    RUN_TEST(test_legato_only_glides_overlapping_notes);
+    RUN_TEST(test_no_glide_without_portamento);
+    return UNITY_END();
+}
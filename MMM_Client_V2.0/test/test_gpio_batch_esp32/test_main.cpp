@@ -0,0 +1,111 @@
+/*
+ * test_main.cpp
+ * GpioBatch built as the ESP32: pin to bank mapping and the one write per register commit.
+ * Register writes go to the log in test/stub/soc/gpio_reg.h.
+ */
+
+#define ARDUINO_ARCH_ESP32
+
+#include <unity.h>
+#include <cstdlib>
+#include "Instruments/Components/GpioBatch.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr uint8_t PINS[] = {2, 4, 18, 19, 21, 22, 23, 25, 26, 27, 32, 33};
+constexpr auto PIN_BITS = Gpio::mapPins(PINS);
+
+static_assert(Gpio::pinsValid(PINS), "Every test pin has an output bank");
+
+// Value written to the register at address, 0 when it wasn't written
+uint32_t written(uint32_t address)
+{
+    uint32_t value = 0;
+    for (const auto& write : NativeRegisters::writes) {
+        if (write.first == address) value = write.second;
+    }
+    return value;
+}
+
+void setUp(void)
+{
+    NativeRegisters::writes.clear();
+}
+
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_pin_banks(void)
+{
+    for (uint8_t pin = 0; pin < Gpio::NUM_PINS; pin++) {
+        const Gpio::PinBit bit = Gpio::pinBit(pin);
+        TEST_ASSERT_EQUAL_UINT8(pin < 32 ? 0 : 1, bit.bank);
+        TEST_ASSERT_EQUAL_HEX32(1UL << (pin % 32), bit.mask);
+    }
+}
+
+void test_map_pins(void)
+{
+    for (size_t i = 0; i < sizeof(PINS); i++) {
+        TEST_ASSERT_EQUAL_UINT8(Gpio::pinBit(PINS[i]).bank, PIN_BITS[i].bank);
+        TEST_ASSERT_EQUAL_HEX32(Gpio::pinBit(PINS[i]).mask, PIN_BITS[i].mask);
+    }
+
+    constexpr uint8_t outOfRange[] = {5, 40};
+    TEST_ASSERT_FALSE(Gpio::pinsValid(outOfRange));
+}
+
+void test_commit_writes_each_register_once(void)
+{
+    srand(41);
+    for (uint32_t pass = 0; pass < 10000; pass++) {
+        NativeRegisters::writes.clear();
+
+        // Any mix of pins going high and low in one pass
+        GpioBatch batch;
+        std::array<uint32_t, 2> set = {};
+        std::array<uint32_t, 2> clear = {};
+        for (size_t i = 0; i < sizeof(PINS); i++) {
+            switch (rand() % 3) {
+                case 0:
+                    batch.write(PIN_BITS[i], true);
+                    set[PIN_BITS[i].bank] |= PIN_BITS[i].mask;
+                    break;
+                case 1:
+                    batch.write(PIN_BITS[i], false);
+                    clear[PIN_BITS[i].bank] |= PIN_BITS[i].mask;
+                    break;
+            }
+        }
+        batch.commit();
+
+        const size_t expectedWrites = (set[0] != 0) + (clear[0] != 0) + (set[1] != 0) + (clear[1] != 0);
+        TEST_ASSERT_EQUAL_size_t(expectedWrites, NativeRegisters::writes.size());
+        TEST_ASSERT_EQUAL_HEX32(set[0], written(GPIO_OUT_W1TS_REG));
+        TEST_ASSERT_EQUAL_HEX32(clear[0], written(GPIO_OUT_W1TC_REG));
+        TEST_ASSERT_EQUAL_HEX32(set[1], written(GPIO_OUT1_W1TS_REG));
+        TEST_ASSERT_EQUAL_HEX32(clear[1], written(GPIO_OUT1_W1TC_REG));
+    }
+}
+
+void test_empty_batch_writes_nothing(void)
+{
+    GpioBatch batch;
+    batch.commit();
+    TEST_ASSERT_EQUAL_size_t(0, NativeRegisters::writes.size());
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pin_banks);
+    RUN_TEST(test_map_pins);
+    RUN_TEST(test_commit_writes_each_register_once);
+    RUN_TEST(test_empty_batch_writes_nothing);
+    return UNITY_END();
+}
@@ -0,0 +1,105 @@
+/*
+ * test_main.cpp
+ * GpioBatch built as the Teensy 4.1: the pin table and the DR_SET/DR_CLEAR commit.
+ * The GPIO6-9 registers are plain variables from test/stub/Arduino.h.
+ */
+
+#define __IMXRT1062__
+
+#include <unity.h>
+#include <cstdlib>
+#include "Instruments/Components/GpioBatch.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr uint8_t PINS[] = {0, 1, 2, 3, 6, 7, 9, 10, 13, 14, 29, 33, 41, 54};
+constexpr auto PIN_BITS = Gpio::mapPins(PINS);
+
+static_assert(Gpio::pinsValid(PINS), "Every test pin has an output bank");
+
+volatile uint32_t* const SET_REGISTERS[] = {&GPIO6_DR_SET, &GPIO7_DR_SET, &GPIO8_DR_SET, &GPIO9_DR_SET};
+volatile uint32_t* const CLEAR_REGISTERS[] = {&GPIO6_DR_CLEAR, &GPIO7_DR_CLEAR, &GPIO8_DR_CLEAR, &GPIO9_DR_CLEAR};
+
+void setUp(void)
+{
+    for (uint8_t bank = 0; bank < Gpio::NUM_BANKS; bank++) {
+        *SET_REGISTERS[bank] = 0;
+        *CLEAR_REGISTERS[bank] = 0;
+    }
+}
+
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_pins_have_distinct_bits(void)
+{
+    // Two pins on one bank bit would drive each other
+    std::array<uint32_t, Gpio::NUM_BANKS> used = {};
+    for (uint8_t pin = 0; pin < Gpio::NUM_PINS; pin++) {
+        const Gpio::PinBit bit = Gpio::pinBit(pin);
+        TEST_ASSERT_LESS_THAN(Gpio::NUM_BANKS, bit.bank);
+        TEST_ASSERT_EQUAL(1, __builtin_popcount(bit.mask));
+        TEST_ASSERT_EQUAL_HEX32(0, used[bit.bank] & bit.mask);
+        used[bit.bank] |= bit.mask;
+    }
+}
+
+void test_known_pins(void)
+{
+    // From the Teensy 4.1 schematic: pin 0 is GPIO6.3, pin 13 (LED) GPIO7.3, pin 2 GPIO9.4, pin 29 GPIO9.31
+    TEST_ASSERT_EQUAL_UINT8(0, Gpio::pinBit(0).bank);
+    TEST_ASSERT_EQUAL_HEX32(1UL << 3, Gpio::pinBit(0).mask);
+    TEST_ASSERT_EQUAL_UINT8(1, Gpio::pinBit(13).bank);
+    TEST_ASSERT_EQUAL_HEX32(1UL << 3, Gpio::pinBit(13).mask);
+    TEST_ASSERT_EQUAL_UINT8(3, Gpio::pinBit(2).bank);
+    TEST_ASSERT_EQUAL_HEX32(1UL << 4, Gpio::pinBit(2).mask);
+    TEST_ASSERT_EQUAL_UINT8(3, Gpio::pinBit(29).bank);
+    TEST_ASSERT_EQUAL_HEX32(1UL << 31, Gpio::pinBit(29).mask);
+
+    constexpr uint8_t outOfRange[] = {13, 55};
+    TEST_ASSERT_FALSE(Gpio::pinsValid(outOfRange));
+}
+
+void test_commit_writes_the_bank_masks(void)
+{
+    srand(41);
+    for (uint32_t pass = 0; pass < 10000; pass++) {
+        setUp();
+
+        GpioBatch batch;
+        std::array<uint32_t, Gpio::NUM_BANKS> set = {};
+        std::array<uint32_t, Gpio::NUM_BANKS> clear = {};
+        for (size_t i = 0; i < sizeof(PINS); i++) {
+            switch (rand() % 3) {
+                case 0:
+                    batch.write(PIN_BITS[i], true);
+                    set[PIN_BITS[i].bank] |= PIN_BITS[i].mask;
+                    break;
+                case 1:
+                    batch.write(PIN_BITS[i], false);
+                    clear[PIN_BITS[i].bank] |= PIN_BITS[i].mask;
+                    break;
+            }
+        }
+        batch.commit();
+
+        for (uint8_t bank = 0; bank < Gpio::NUM_BANKS; bank++) {
+            TEST_ASSERT_EQUAL_HEX32(set[bank], *SET_REGISTERS[bank]);
+            TEST_ASSERT_EQUAL_HEX32(clear[bank], *CLEAR_REGISTERS[bank]);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pins_have_distinct_bits);
+    RUN_TEST(test_known_pins);
+    RUN_TEST(test_commit_writes_the_bank_masks);
+    return UNITY_END();
+}
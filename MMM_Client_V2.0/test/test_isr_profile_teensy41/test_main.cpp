@@ -0,0 +1,92 @@
+/*
+ * test_main.cpp
+ * Teensy41_SwPWM built for the host with CFG_ISR_PROFILING. The timer callback is run by
+ * hand with idle, sparse and full voice loads and the counts are read back through
+ * getIsrProfile(), the data SysEx 0x59 returns on a board.
+ *
+ * The cycle counter here is the host's time stamp counter, so the numbers only compare
+ * loads and revisions on this host. Board figures come from SysEx 0x59 on the board.
+ * To compare a change, run the suite on both revisions back to back and take the best
+ * of a few runs; single runs on a shared host move by a fifth or more.
+ */
+
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <IntervalTimer.h>
+#include "Instruments/Base/SwPWM/Teensy41_SwPWM.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr uint32_t TICKS = 200000;
+constexpr uint8_t LOADS[] = {0, 1, 2, 8, 16, HardwareConfig::MAX_NUM_INSTRUMENTS};
+
+Teensy41_SwPWM* controller;
+
+// Plays the first voices notes, each voice on its own pitch
+void sound(uint8_t voices)
+{
+    controller->stopAll();
+    for (uint8_t i = 0; i < voices; i++) controller->playNote(i, 36 + i, 100, 0);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_profile_by_load(void)
+{
+    char line[112];
+    snprintf(line, sizeof(line), "Host tick cost, %u instruments: voices, calls, min, mean, max (host TSC), mean ns",
+        static_cast<unsigned>(HardwareConfig::MAX_NUM_INSTRUMENTS));
+    TEST_MESSAGE(line);
+
+    for (uint8_t voices : LOADS) {
+        sound(voices);
+
+        // The first pass takes the published voices, count from the second
+        IntervalTimer::fire();
+        const uint32_t before = controller->getIsrProfile(voices).samples;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < TICKS; i++) IntervalTimer::fire();
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / TICKS;
+
+        const IsrProfile profile = controller->getIsrProfile(voices);
+        TEST_ASSERT_EQUAL_UINT32(TICKS, profile.samples - before);
+        TEST_ASSERT_LESS_OR_EQUAL(profile.meanCycles, profile.minCycles);
+        TEST_ASSERT_LESS_OR_EQUAL(profile.maxCycles, profile.meanCycles);
+
+        snprintf(line, sizeof(line), "%2u %8lu %6lu %6lu %8lu %6.1f", voices, static_cast<unsigned long>(profile.samples),
+            static_cast<unsigned long>(profile.minCycles), static_cast<unsigned long>(profile.meanCycles),
+            static_cast<unsigned long>(profile.maxCycles), ns);
+        TEST_MESSAGE(line);
+    }
+
+    // Silent voices are skipped, so an idle pass costs less than a full one
+    TEST_ASSERT_LESS_THAN(controller->getIsrProfile(HardwareConfig::MAX_NUM_INSTRUMENTS).meanCycles,
+        controller->getIsrProfile(0).meanCycles);
+}
+
+void test_unused_loads_are_empty(void)
+{
+    const IsrProfile profile = controller->getIsrProfile(3);
+    TEST_ASSERT_EQUAL_UINT32(0, profile.samples);
+    TEST_ASSERT_EQUAL_UINT32(0, controller->getIsrProfile(HardwareConfig::MAX_NUM_INSTRUMENTS + 1).samples);
+}
+
+int main(int argc, char** argv)
+{
+    static Teensy41_SwPWM instruments;
+    controller = &instruments;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_profile_by_load);
+    RUN_TEST(test_unused_loads_are_empty);
+    return UNITY_END();
+}
@@ -0,0 +1,317 @@
+/*
+ * test_main.cpp
+ * Latency compensation simulation: notes arriving at random times on instruments with
+ * different output latencies must all become audible LOOKAHEAD_US after they arrived.
+ * Sent from the main loop they may be up to one pass late, sent from the event timer
+ * interrupt they must be exact. Built by the native_latency env, latencies are 8000,
+ * 3000, 500 and 0us.
+ */
+
+#include <unity.h>
+#include <cstdlib>
+#include <vector>
+#include "Instruments/InstrumentControllerBase.h"
+#include "Instruments/Components/EventTimer.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Simulated Event Timer
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Main loop passes are this far apart, the only source of onset error on the loop path
+constexpr uint32_t LOOP_US = 25;
+
+namespace {
+    bool timerArmed = false;
+    uint32_t timerExpiresUs = 0;
+    bool timerExpired = false;
+    void (*timerHandler)() = nullptr;
+}
+
+void EventTimer::initialize() {}
+
+void EventTimer::schedule(uint32_t microseconds)
+{
+    timerArmed = true;
+    timerExpiresUs = micros() + microseconds;
+}
+
+void EventTimer::setHandler(void (*handler)())
+{
+    timerHandler = handler;
+}
+
+bool EventTimer::takeExpired()
+{
+    const bool expired = timerExpired;
+    timerExpired = false;
+    return expired;
+}
+
+// Moves the clock forward, running the interrupt at the exact time each expiry falls due
+void advanceClock(uint32_t us)
+{
+    const uint32_t endUs = NativeClock::nowUs + us;
+    while (timerArmed && static_cast<int32_t>(timerExpiresUs - endUs) <= 0) {
+        NativeClock::nowUs = timerExpiresUs;
+        timerArmed = false;
+        timerExpired = true;
+        if (timerHandler != nullptr) timerHandler();
+    }
+    NativeClock::nowUs = endUs;
+}
+
+// Something is still waiting for the timer or for the main loop to serve it
+bool timerPending()
+{
+    return timerArmed || timerExpired;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Recording Instruments
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Output {
+    uint32_t timeUs;
+    uint8_t instrument;
+    uint8_t note;
+    bool noteOn;
+};
+
+class RecordingInstruments : public InstrumentControllerBase {
+    std::array<uint8_t, NUM_Instruments> m_notes = {};
+    std::array<bool, NUM_Instruments> m_sounding = {};
+
+public:
+    using InstrumentControllerBase::playNote;
+    using InstrumentControllerBase::setInterruptFiring;
+    std::vector<Output> outputs;
+
+    void reset(uint8_t instrument) override { m_sounding[instrument] = false; }
+    void resetAll() override { m_sounding = {}; }
+    void playNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) override {
+        m_notes[instrument] = note;
+        m_sounding[instrument] = true;
+        outputs.push_back({micros(), instrument, note, true});
+    }
+    void stopNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) override {
+        if (m_notes[instrument] != note) return;
+        m_sounding[instrument] = false;
+        releaseVoiceOwner(instrument);
+        outputs.push_back({micros(), instrument, note, false});
+    }
+    void stopAll() override {
+        m_sounding = {};
+        releaseAllVoiceOwners();
+    }
+    uint8_t getNumActiveNotes(uint8_t instrument) override { return m_sounding[instrument] ? 1 : 0; }
+    bool isNoteActive(uint8_t instrument, uint8_t note) override { return m_sounding[instrument] && m_notes[instrument] == note; }
+};
+
+RecordingInstruments* instruments;
+
+// Advances the clock by one main loop pass and runs the loop's share of the work
+void loopPass()
+{
+    advanceClock(LOOP_US);
+    instruments->fireScheduledNotes();
+}
+
+// Plays random notes on every instrument for 10s, each held for 1 to 50ms. Checks they sound
+// in order and never early, returns the latest any was audible after arrival + LOOKAHEAD_US.
+uint32_t playRandomNotes()
+{
+    struct Arrival {
+        uint32_t timeUs;
+        uint8_t instrument;
+        uint8_t note;
+    };
+    std::array<std::vector<Arrival>, 4> arrivals;
+
+    srand(7);
+    std::array<uint32_t, 4> freeAtUs = {};
+    std::array<uint8_t, 4> sounding = {};
+    std::array<uint32_t, 4> releaseAtUs = {};
+    const uint32_t endUs = NativeClock::nowUs + 10000000;
+    while (NativeClock::nowUs < endUs) {
+        loopPass();
+        for (uint8_t i = 0; i < 4; i++) {
+            if (sounding[i] && static_cast<int32_t>(NativeClock::nowUs - releaseAtUs[i]) >= 0) {
+                instruments->releaseNote(i, sounding[i], 0, 0);
+                sounding[i] = 0;
+                freeAtUs[i] = NativeClock::nowUs + (rand() % 20000);
+            }
+            if (!sounding[i] && static_cast<int32_t>(NativeClock::nowUs - freeAtUs[i]) >= 0 && rand() % 8 == 0) {
+                sounding[i] = 24 + rand() % 72;
+                releaseAtUs[i] = NativeClock::nowUs + 1000 + rand() % 49000;
+                instruments->playNote(i, sounding[i], 100, 0, 0);
+                arrivals[i].push_back({NativeClock::nowUs, i, sounding[i]});
+            }
+        }
+    }
+    while (timerPending()) loopPass();
+
+    // Each instrument plays its notes in the order they arrived
+    std::array<size_t, 4> onsets = {};
+    uint32_t worstErrorUs = 0;
+    for (const Output& output : instruments->outputs) {
+        if (!output.noteOn) continue;
+        const Arrival& arrival = arrivals[output.instrument][onsets[output.instrument]++];
+        TEST_ASSERT_EQUAL_UINT8(arrival.note, output.note);
+
+        // Audible onset against the arrival time plus the lookahead
+        const uint32_t audibleUs = output.timeUs + HardwareConfig::INSTRUMENT_LATENCY_US[output.instrument];
+        const int32_t errorUs = static_cast<int32_t>(audibleUs - (arrival.timeUs + HardwareConfig::LOOKAHEAD_US));
+        TEST_ASSERT_GREATER_OR_EQUAL(0, errorUs);
+        if (static_cast<uint32_t>(errorUs) > worstErrorUs) worstErrorUs = errorUs;
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_size_t(arrivals[i].size(), onsets[i]);
+        TEST_ASSERT_GREATER_THAN(100, onsets[i]);
+    }
+    return worstErrorUs;
+}
+
+void setUp(void)
+{
+    instruments->setInterruptFiring(false);
+    instruments->stopAll();
+    instruments->outputs.clear();
+    timerArmed = false;
+    timerExpired = false;
+}
+
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_lookahead_covers_the_slowest_instrument(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(8000, HardwareConfig::LOOKAHEAD_US);
+}
+
+void test_onsets_line_up_across_instruments(void)
+{
+    // Sent from the main loop, up to one pass late
+    TEST_ASSERT_LESS_THAN(LOOP_US, playRandomNotes());
+}
+
+void test_interrupt_firing_is_exact(void)
+{
+    instruments->setInterruptFiring(true);
+    TEST_ASSERT_EQUAL_UINT32(0, playRandomNotes());
+}
+
+void test_changes_reach_an_instrument_in_order(void)
+{
+    // Instrument 3 has no latency but must still wait behind its queued changes
+    instruments->setInstrumentLatency(3, 8000);
+    instruments->playNote(3, 60, 100, 0, 0);
+    loopPass();
+    instruments->releaseNote(3, 60, 0, 0);
+    instruments->setInstrumentLatency(3, 0);
+    instruments->playNote(3, 62, 100, 0, 0);
+    while (timerPending()) loopPass();
+
+    TEST_ASSERT_EQUAL_size_t(3, instruments->outputs.size());
+    TEST_ASSERT_EQUAL_UINT8(60, instruments->outputs[0].note);
+    TEST_ASSERT_FALSE(instruments->outputs[1].noteOn);
+    TEST_ASSERT_EQUAL_UINT8(62, instruments->outputs[2].note);
+    TEST_ASSERT_TRUE(instruments->isNoteActive(3, 62));
+}
+
+void test_scheduled_changes_count_as_made(void)
+{
+    // Instrument 3 has no latency so its changes wait the whole lookahead
+    instruments->playNote(3, 60, 100, 0, 0);
+    TEST_ASSERT_FALSE(instruments->isNoteActive(3, 60));
+    TEST_ASSERT_TRUE(instruments->isNoteBusy(3, 60));
+    TEST_ASSERT_EQUAL_UINT8(1, instruments->getNumBusyNotes(3));
+
+    while (timerPending()) loopPass();
+    instruments->releaseNote(3, 60, 0, 0);
+    TEST_ASSERT_TRUE(instruments->isNoteActive(3, 60));
+    TEST_ASSERT_FALSE(instruments->isNoteBusy(3, 60));
+    TEST_ASSERT_EQUAL_UINT8(0, instruments->getNumBusyNotes(3));
+    while (timerPending()) loopPass();
+}
+
+void test_late_stop_keeps_the_newer_owner(void)
+{
+    instruments->playNote(1, 60, 100, 0, 0);
+    while (timerPending()) loopPass();
+
+    // Distributor 1 takes the instrument before distributor 0's stop goes out
+    instruments->releaseNote(1, 60, 0, 0);
+    instruments->playNote(1, 64, 100, 5, 1);
+    while (timerPending()) loopPass();
+
+    TEST_ASSERT_EQUAL_UINT8(1, instruments->getOwner(1));
+    TEST_ASSERT_EQUAL_UINT8(5, instruments->getOwnerChannel(1));
+    TEST_ASSERT_TRUE(instruments->isNoteActive(1, 64));
+}
+
+void test_nothing_is_sent_before_the_main_loop_runs(void)
+{
+    instruments->playNote(2, 60, 100, 0, 0);
+    advanceClock(HardwareConfig::LOOKAHEAD_US);
+    TEST_ASSERT_TRUE(instruments->outputs.empty());
+
+    instruments->fireScheduledNotes();
+    TEST_ASSERT_EQUAL_size_t(1, instruments->outputs.size());
+}
+
+void test_interrupt_leaves_a_batch_to_the_loop(void)
+{
+    instruments->setInterruptFiring(true);
+    instruments->playNote(2, 60, 100, 0, 0);
+
+    // The loop is inside a batch when the timer expires
+    instruments->beginBatch();
+    advanceClock(HardwareConfig::LOOKAHEAD_US);
+    TEST_ASSERT_TRUE(instruments->outputs.empty());
+    instruments->commitBatch();
+
+    instruments->fireScheduledNotes();
+    TEST_ASSERT_EQUAL_size_t(1, instruments->outputs.size());
+}
+
+void test_interrupt_leaves_a_loop_section_to_the_loop(void)
+{
+    instruments->setInterruptFiring(true);
+    instruments->playNote(2, 60, 100, 0, 0);
+    {
+        InstrumentControllerBase::LoopSection section(*instruments);
+        advanceClock(HardwareConfig::LOOKAHEAD_US);
+        TEST_ASSERT_TRUE(instruments->outputs.empty());
+    }
+
+    instruments->fireScheduledNotes();
+    TEST_ASSERT_EQUAL_size_t(1, instruments->outputs.size());
+
+    // Outside the section the next one goes out on time
+    const uint32_t stopAtUs = NativeClock::nowUs + HardwareConfig::LOOKAHEAD_US - HardwareConfig::INSTRUMENT_LATENCY_US[2];
+    instruments->releaseNote(2, 60, 0, 0);
+    advanceClock(HardwareConfig::LOOKAHEAD_US);
+    TEST_ASSERT_EQUAL_size_t(2, instruments->outputs.size());
+    TEST_ASSERT_EQUAL_UINT32(stopAtUs, instruments->outputs[1].timeUs);
+}
+
+int main(int argc, char** argv)
+{
+    static RecordingInstruments controller;
+    instruments = &controller;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_lookahead_covers_the_slowest_instrument);
+    RUN_TEST(test_onsets_line_up_across_instruments);
+    RUN_TEST(test_interrupt_firing_is_exact);
+    RUN_TEST(test_changes_reach_an_instrument_in_order);
+    RUN_TEST(test_scheduled_changes_count_as_made);
+    RUN_TEST(test_late_stop_keeps_the_newer_owner);
+    RUN_TEST(test_nothing_is_sent_before_the_main_loop_runs);
+    RUN_TEST(test_interrupt_leaves_a_batch_to_the_loop);
+    RUN_TEST(test_interrupt_leaves_a_loop_section_to_the_loop);
+    return UNITY_END();
+}
@@ -0,0 +1,293 @@
+/*
+ * test_main.cpp
+ * LedcAllocator: timer sharing, the ninth pitch, moves under modulation and the channel and
+ * timer bookkeeping under random plans. Ledc::timerSetting checked for every note.
+ */
+
+#include <unity.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "Instruments/Components/LedcAllocator.h"
+#include "Instruments/Components/TuningTable.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr uint8_t VOICES = 16;
+using Allocator = LedcAllocator<VOICES>;
+using Targets = std::array<uint32_t, VOICES>;
+
+Allocator allocator;
+
+uint32_t noteFrequency(uint8_t note)
+{
+    return Tuning::active().frequencies[note];
+}
+
+// A mode with both a timer and a channel free could still take a new pitch
+bool roomForAPitch()
+{
+    for (uint8_t mode = 0; mode < Ledc::NUM_MODES; mode++) {
+        bool freeTimer = false;
+        for (uint8_t timer = 0; timer < Ledc::TIMERS_PER_MODE; timer++) freeTimer |= allocator.timer(mode, timer).users == 0;
+        uint8_t channels = 0;
+        for (uint8_t voice = 0; voice < VOICES; voice++) {
+            channels += allocator.binding(voice).placed() && allocator.binding(voice).mode == mode;
+        }
+        if (freeTimer && channels < Ledc::CHANNELS_PER_MODE) return true;
+    }
+    return false;
+}
+
+uint8_t busyTimers()
+{
+    uint8_t count = 0;
+    for (uint8_t mode = 0; mode < Ledc::NUM_MODES; mode++)
+        for (uint8_t timer = 0; timer < Ledc::TIMERS_PER_MODE; timer++)
+            count += allocator.timer(mode, timer).users > 0;
+    return count;
+}
+
+// Every sounding voice has its own channel and a timer at its frequency, every timer counts
+// exactly the voices bound to it
+void checkConsistent(const Targets& targets)
+{
+    bool channelUsed[Ledc::NUM_MODES][Ledc::CHANNELS_PER_MODE] = {};
+    uint8_t users[Ledc::NUM_MODES][Ledc::TIMERS_PER_MODE] = {};
+
+    for (uint8_t voice = 0; voice < VOICES; voice++) {
+        const Allocator::Binding& binding = allocator.binding(voice);
+        if (targets[voice] == 0) TEST_ASSERT_FALSE(binding.placed());
+        if (!binding.placed()) continue;
+
+        TEST_ASSERT_LESS_THAN(Ledc::NUM_MODES, binding.mode);
+        TEST_ASSERT_LESS_THAN(Ledc::CHANNELS_PER_MODE, binding.channel);
+        TEST_ASSERT_LESS_THAN(Ledc::TIMERS_PER_MODE, binding.timer);
+        TEST_ASSERT_FALSE(channelUsed[binding.mode][binding.channel]);
+        channelUsed[binding.mode][binding.channel] = true;
+        users[binding.mode][binding.timer]++;
+    }
+
+    for (uint8_t mode = 0; mode < Ledc::NUM_MODES; mode++)
+        for (uint8_t timer = 0; timer < Ledc::TIMERS_PER_MODE; timer++)
+            TEST_ASSERT_EQUAL_UINT8(users[mode][timer], allocator.timer(mode, timer).users);
+}
+
+// Voices whose timer plays what they asked for
+uint8_t soundingAsAsked(const Targets& targets)
+{
+    uint8_t count = 0;
+    for (uint8_t voice = 0; voice < VOICES; voice++) {
+        const Allocator::Binding& binding = allocator.binding(voice);
+        if (binding.placed() && allocator.timer(binding.mode, binding.timer).frequencyQ16 == targets[voice]) count++;
+    }
+    return count;
+}
+
+void setUp(void)
+{
+    Tuning::selectPreset(TuningPreset::EqualTemperament);
+    allocator.reset();
+}
+
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_unison_shares_timers(void)
+{
+    // Sixteen voices on one pitch fill both modes' channels and use one timer in each
+    Targets targets;
+    targets.fill(noteFrequency(69));
+    allocator.plan(targets);
+    checkConsistent(targets);
+    TEST_ASSERT_EQUAL_UINT8(VOICES, soundingAsAsked(targets));
+    TEST_ASSERT_EQUAL_UINT8(2, busyTimers());
+}
+
+void test_eight_pitches_then_a_ninth(void)
+{
+    Targets targets = {};
+    for (uint8_t voice = 0; voice < 8; voice++) targets[voice] = noteFrequency(60 + voice);
+    allocator.plan(targets);
+    checkConsistent(targets);
+    TEST_ASSERT_EQUAL_UINT8(8, soundingAsAsked(targets));
+    TEST_ASSERT_EQUAL_UINT8(8, busyTimers());
+
+    // No timer left for a ninth pitch, it stays unplaced and the others are undisturbed
+    Allocator::Binding before[8];
+    for (uint8_t voice = 0; voice < 8; voice++) before[voice] = allocator.binding(voice);
+    targets[8] = noteFrequency(72);
+    allocator.plan(targets);
+    checkConsistent(targets);
+    TEST_ASSERT_FALSE(allocator.binding(8).placed());
+    for (uint8_t voice = 0; voice < 8; voice++) {
+        TEST_ASSERT_EQUAL_UINT8(before[voice].channel, allocator.binding(voice).channel);
+        TEST_ASSERT_EQUAL_UINT8(before[voice].timer, allocator.binding(voice).timer);
+    }
+
+    // A ninth voice on a pitch already sounding shares its timer
+    targets[8] = noteFrequency(63);
+    allocator.plan(targets);
+    checkConsistent(targets);
+    TEST_ASSERT_EQUAL_UINT8(9, soundingAsAsked(targets));
+
+    // Stopping a voice frees its timer for the new pitch
+    targets[0] = 0;
+    targets[9] = noteFrequency(72);
+    allocator.plan(targets);
+    checkConsistent(targets);
+    TEST_ASSERT_FALSE(allocator.binding(0).placed());
+    TEST_ASSERT_TRUE(allocator.binding(9).placed());
+    TEST_ASSERT_EQUAL_UINT8(9, soundingAsAsked(targets));
+}
+
+void test_stopping_frees_the_timer(void)
+{
+    Targets targets = {};
+    targets[0] = noteFrequency(60);
+    targets[1] = noteFrequency(60);
+    allocator.plan(targets);
+    TEST_ASSERT_EQUAL_UINT8(1, busyTimers());
+
+    // The timer stays while one of its voices sounds
+    targets[0] = 0;
+    allocator.plan(targets);
+    checkConsistent(targets);
+    TEST_ASSERT_EQUAL_UINT8(1, busyTimers());
+
+    targets[1] = 0;
+    allocator.plan(targets);
+    checkConsistent(targets);
+    TEST_ASSERT_EQUAL_UINT8(0, busyTimers());
+}
+
+void test_bent_voice_moves_off_a_shared_timer(void)
+{
+    // Three voices share a timer, one is bent away and moves, the timer keeps the majority
+    Targets targets = {};
+    for (uint8_t voice = 0; voice < 3; voice++) targets[voice] = noteFrequency(60);
+    allocator.plan(targets);
+    const Allocator::Binding shared = allocator.binding(0);
+
+    targets[2] = noteFrequency(60) + 1000;
+    allocator.plan(targets);
+    checkConsistent(targets);
+    TEST_ASSERT_EQUAL_UINT8(3, soundingAsAsked(targets));
+    TEST_ASSERT_EQUAL_UINT8(shared.timer, allocator.binding(0).timer);
+    TEST_ASSERT_EQUAL_UINT8(shared.channel, allocator.binding(0).channel);
+    TEST_ASSERT_NOT_EQUAL(shared.timer, allocator.binding(2).timer);
+
+    // Bent back it joins the timer again and frees its own
+    targets[2] = noteFrequency(60);
+    allocator.plan(targets);
+    checkConsistent(targets);
+    TEST_ASSERT_EQUAL_UINT8(1, busyTimers());
+}
+
+void test_bend_keeps_a_lone_voice_in_place(void)
+{
+    // A voice alone on its timer retunes the timer instead of moving
+    Targets targets = {};
+    targets[4] = noteFrequency(50);
+    allocator.plan(targets);
+    const Allocator::Binding before = allocator.binding(4);
+
+    for (uint32_t step = 1; step < 50; step++) {
+        targets[4] = noteFrequency(50) + step * 997;
+        allocator.plan(targets);
+        checkConsistent(targets);
+        TEST_ASSERT_EQUAL_UINT8(before.mode, allocator.binding(4).mode);
+        TEST_ASSERT_EQUAL_UINT8(before.channel, allocator.binding(4).channel);
+        TEST_ASSERT_EQUAL_UINT8(before.timer, allocator.binding(4).timer);
+        TEST_ASSERT_EQUAL_UINT8(1, soundingAsAsked(targets));
+    }
+}
+
+void test_dissenter_without_a_timer_stays(void)
+{
+    // Eight pitches with two voices on one, one of the pair bent to a new pitch has nowhere
+    // to go and keeps sounding on its old timer
+    Targets targets = {};
+    for (uint8_t voice = 0; voice < 8; voice++) targets[voice] = noteFrequency(60 + voice);
+    targets[8] = noteFrequency(60);
+    allocator.plan(targets);
+    const Allocator::Binding before = allocator.binding(8);
+
+    targets[8] = noteFrequency(80);
+    allocator.plan(targets);
+    checkConsistent(targets);
+    TEST_ASSERT_TRUE(allocator.binding(8).placed());
+    TEST_ASSERT_EQUAL_UINT8(before.timer, allocator.binding(8).timer);
+    TEST_ASSERT_EQUAL_UINT8(8, soundingAsAsked(targets));
+}
+
+void test_random_plans(void)
+{
+    // Voices start, stop and bend at random, the bookkeeping stays consistent and no voice
+    // is left out while a mode has a timer and a channel for it. Voices already sounding
+    // aren't reshuffled between modes to make room, so a pitch can miss out with a timer free.
+    srand(48);
+    Targets targets = {};
+    uint32_t unplaced = 0;
+    for (uint32_t round = 0; round < 200000; round++) {
+        const uint8_t voice = rand() % VOICES;
+        switch (rand() % 4) {
+            case 0: targets[voice] = 0; break;
+            case 1: targets[voice] = noteFrequency(48 + rand() % 12); break;
+            case 2: if (targets[voice] != 0) targets[voice] += 500; break;
+            default: break;
+        }
+        allocator.plan(targets);
+        checkConsistent(targets);
+
+        for (uint8_t v = 0; v < VOICES; v++) {
+            if (targets[v] == 0 || allocator.binding(v).placed()) continue;
+            TEST_ASSERT_FALSE(roomForAPitch());
+            unplaced++;
+        }
+    }
+    char line[64];
+    snprintf(line, sizeof(line), "Unplaced voice plans: %lu", static_cast<unsigned long>(unplaced));
+    TEST_MESSAGE(line);
+}
+
+void test_timer_setting_every_note(void)
+{
+    double worst = 0;
+    for (uint8_t note = 0; note < 128; note++) {
+        const Ledc::TimerSetting setting = Ledc::timerSetting(noteFrequency(note));
+        TEST_ASSERT_NOT_EQUAL(0, setting.divider);
+        TEST_ASSERT_LESS_OR_EQUAL(Ledc::MAX_RESOLUTION, setting.resolution);
+
+        const double cents = std::fabs(1200.0 * std::log2(static_cast<double>(Ledc::frequencyQ16(setting)) / noteFrequency(note)));
+        if (cents > worst) worst = cents;
+    }
+    char line[64];
+    snprintf(line, sizeof(line), "LEDC worst note error %.4f cents", worst);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.25f, worst);
+
+    // Out of range and silent frequencies report divider 0
+    TEST_ASSERT_EQUAL_UINT32(0, Ledc::timerSetting(0).divider);
+    TEST_ASSERT_EQUAL_UINT32(0, Ledc::divider(noteFrequency(69), 0));
+    TEST_ASSERT_EQUAL_UINT32(0, Ledc::divider(noteFrequency(69), Ledc::MAX_RESOLUTION + 1));
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_unison_shares_timers);
+    RUN_TEST(test_eight_pitches_then_a_ninth);
+    RUN_TEST(test_stopping_frees_the_timer);
+    RUN_TEST(test_bent_voice_moves_off_a_shared_timer);
+    RUN_TEST(test_bend_keeps_a_lone_voice_in_place);
+    RUN_TEST(test_dissenter_without_a_timer_stays);
+    RUN_TEST(test_random_plans);
+    RUN_TEST(test_timer_setting_every_note);
+    return UNITY_END();
+}
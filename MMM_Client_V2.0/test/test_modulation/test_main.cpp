@@ -0,0 +1,213 @@
+/*
+ * test_main.cpp
+ * Modulation engine LFOs: stepped at control rate, a voice's pitch must swing by the LFO depth
+ * at the LFO rate, and its period must clamp to 1..UINT16_MAX instead of wrapping.
+ */
+
+#include <unity.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "Instruments/Components/Modulation.h"
+#include "Instruments/Components/NoteTable.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr uint8_t CHANNEL = 2;
+constexpr uint8_t VOICE = 1;
+constexpr uint16_t BASE_PERIOD = NoteTables::NOTE_PERIODS[69]; // A4
+
+ModulationEngine engine;
+uint32_t nowUs;
+
+// Q16 octaves to cents
+double cents(int32_t octavesQ16)
+{
+    return octavesQ16 * 1200.0 / 65536.0;
+}
+
+void report(const char* what, double value, const char* unit)
+{
+    char message[96];
+    snprintf(message, sizeof(message), "%s %.4f %s", what, value, unit);
+    TEST_MESSAGE(message);
+}
+
+void setVibrato(LfoShape shape, uint16_t depthCents)
+{
+    ModulationEngine::Lfo& lfo = engine.lfo(CHANNEL);
+    lfo.shape = shape;
+    lfo.depth = depthCents;
+}
+
+// Steps the engine for the given time at control rate, tracking the swing of the voice's pitch
+struct Swing {
+    int32_t highest = INT32_MIN;
+    int32_t lowest = INT32_MAX;
+    uint32_t firstRiseUs = 0; // Upward crossings of the note's own pitch
+    uint32_t lastRiseUs = 0;
+    uint32_t rises = 0;
+};
+
+Swing run(uint32_t durationUs)
+{
+    Swing swing;
+    int32_t previous = engine.pitchOffset(VOICE);
+    const uint32_t endUs = nowUs + durationUs;
+    while (nowUs < endUs) {
+        nowUs += CFG_MODULATION_INTERVAL_US;
+        engine.update(nowUs);
+        const int32_t offset = engine.pitchOffset(VOICE);
+        if (offset > swing.highest) swing.highest = offset;
+        if (offset < swing.lowest) swing.lowest = offset;
+        if (previous < 0 && offset >= 0) {
+            if (swing.rises == 0) swing.firstRiseUs = nowUs;
+            swing.lastRiseUs = nowUs;
+            swing.rises++;
+        }
+        previous = offset;
+    }
+    return swing;
+}
+
+// Time of one LFO cycle measured over the upward crossings
+double measuredCycleUs(const Swing& swing)
+{
+    return static_cast<double>(swing.lastRiseUs - swing.firstRiseUs) / (swing.rises - 1);
+}
+
+void setUp(void)
+{
+    engine = ModulationEngine();
+    nowUs = 0;
+    engine.update(nowUs);
+}
+
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_lfo_runs_at_its_rate(void)
+{
+    setVibrato(LfoShape::Triangle, 50);
+    engine.startVoice(VOICE, CHANNEL, BASE_PERIOD);
+    const Swing swing = run(2000000);
+
+    // 5.5Hz by default, each crossing lands on a control interval
+    const double expectedUs = 100000000.0 / CFG_VIBRATO_RATE_CENTIHZ;
+    report("cycle at the default rate", measuredCycleUs(swing), "us");
+    TEST_ASSERT_FLOAT_WITHIN(CFG_MODULATION_INTERVAL_US, expectedUs, measuredCycleUs(swing));
+}
+
+void test_rate_controller_doubles_and_halves(void)
+{
+    setVibrato(LfoShape::Sine, 50);
+    engine.startVoice(VOICE, CHANNEL, BASE_PERIOD);
+
+    // Every 32 steps of CC76 from 64 doubles or halves the rate
+    engine.controlChange(CHANNEL, MidiCC::SoundControl7, 96);
+    TEST_ASSERT_EQUAL_UINT16(CFG_VIBRATO_RATE_CENTIHZ * 2, engine.lfo(CHANNEL).rateCentiHz);
+    Swing swing = run(2000000);
+    TEST_ASSERT_FLOAT_WITHIN(CFG_MODULATION_INTERVAL_US, 50000000.0 / CFG_VIBRATO_RATE_CENTIHZ, measuredCycleUs(swing));
+
+    engine.controlChange(CHANNEL, MidiCC::SoundControl7, 32);
+    TEST_ASSERT_EQUAL_UINT16(CFG_VIBRATO_RATE_CENTIHZ / 2, engine.lfo(CHANNEL).rateCentiHz);
+    swing = run(4000000);
+    TEST_ASSERT_FLOAT_WITHIN(CFG_MODULATION_INTERVAL_US, 200000000.0 / CFG_VIBRATO_RATE_CENTIHZ, measuredCycleUs(swing));
+}
+
+void test_lfo_swings_by_its_depth(void)
+{
+    const LfoShape shapes[] = {LfoShape::Triangle, LfoShape::Sine, LfoShape::Square, LfoShape::SawUp, LfoShape::SawDown};
+    for (LfoShape shape : shapes) {
+        for (uint16_t depth : {10, 100, 1200}) {
+            setUp();
+            setVibrato(shape, depth);
+            engine.startVoice(VOICE, CHANNEL, BASE_PERIOD);
+            const Swing swing = run(1000000);
+
+            // A control step may land up to half a step of the steepest shape, the triangle, from a peak
+            const double stepCents = 4.0 * depth * CFG_VIBRATO_RATE_CENTIHZ / 100.0 * CFG_MODULATION_INTERVAL_US / 1000000.0;
+            const double tolerance = std::max(1.0, stepCents / 2);
+            TEST_ASSERT_FLOAT_WITHIN(tolerance, depth, cents(swing.highest));
+            TEST_ASSERT_FLOAT_WITHIN(tolerance, -static_cast<double>(depth), cents(swing.lowest));
+        }
+    }
+}
+
+void test_period_follows_the_offset(void)
+{
+    setVibrato(LfoShape::Sine, 100);
+    engine.startVoice(VOICE, CHANNEL, BASE_PERIOD);
+
+    double worst = 0;
+    for (uint32_t step = 0; step < 1000; step++) {
+        nowUs += CFG_MODULATION_INTERVAL_US;
+        engine.update(nowUs);
+        const double exact = BASE_PERIOD * std::pow(2.0, -engine.pitchOffset(VOICE) / 65536.0);
+        const double error = std::fabs(engine.targetPeriod(VOICE) - exact);
+        if (error > worst) worst = error;
+    }
+    report("worst period error", worst, "ticks");
+    TEST_ASSERT_LESS_THAN_FLOAT(1.0, worst);
+}
+
+void test_no_depth_leaves_the_note_alone(void)
+{
+    engine.startVoice(VOICE, CHANNEL, BASE_PERIOD);
+    TEST_ASSERT_FALSE(engine.update(nowUs + CFG_MODULATION_INTERVAL_US));
+    TEST_ASSERT_EQUAL_UINT16(BASE_PERIOD, engine.targetPeriod(VOICE));
+    TEST_ASSERT_EQUAL_INT32(0, engine.pitchOffset(VOICE));
+}
+
+void test_period_clamps_at_uint16_max(void)
+{
+    // An octave of vibrato under a long period would need up to twice UINT16_MAX
+    constexpr uint16_t longPeriod = 50000;
+    setVibrato(LfoShape::Triangle, 1200);
+    engine.startVoice(VOICE, CHANNEL, longPeriod);
+
+    uint16_t previous = engine.targetPeriod(VOICE);
+    bool clamped = false;
+    for (uint32_t step = 0; step < 400; step++) {
+        nowUs += CFG_MODULATION_INTERVAL_US;
+        engine.update(nowUs);
+        const uint16_t period = engine.targetPeriod(VOICE);
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32(longPeriod / 2 - 1, period);
+        if (period == UINT16_MAX) clamped = true;
+
+        // A wrapped value would show as a jump far below the previous period
+        TEST_ASSERT_TRUE(period + 10000 > previous);
+        previous = period;
+    }
+    TEST_ASSERT_TRUE(clamped);
+
+    // A bend down two octaves on top is held at the limit too
+    engine.setPitchBend(CHANNEL, 0, 2400);
+    TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, engine.targetPeriod(VOICE));
+}
+
+void test_period_never_reaches_zero(void)
+{
+    // Two octaves up from a period of 1 rounds to nothing, the voice keeps a period of 1
+    engine.startVoice(VOICE, CHANNEL, 1);
+    engine.setPitchBend(CHANNEL, 0x3FFF, 2400);
+    TEST_ASSERT_EQUAL_UINT16(1, engine.targetPeriod(VOICE));
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_lfo_runs_at_its_rate);
+    RUN_TEST(test_rate_controller_doubles_and_halves);
+    RUN_TEST(test_lfo_swings_by_its_depth);
+    RUN_TEST(test_period_follows_the_offset);
+    RUN_TEST(test_no_depth_leaves_the_note_alone);
+    RUN_TEST(test_period_clamps_at_uint16_max);
+    RUN_TEST(test_period_never_reaches_zero);
+    return UNITY_END();
+}
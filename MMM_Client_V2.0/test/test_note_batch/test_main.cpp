@@ -0,0 +1,199 @@
+/*
+ * test_main.cpp
+ * Note batches: changes made inside beginBatch()/commitBatch() are published once, by the
+ * outermost commit, however deeply the distributors nest their own batches inside a pass.
+ */
+
+#include <unity.h>
+#include "Device.h"
+#include "Distributors/DistributorManager.h"
+#include "Instruments/InstrumentControllerBase.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Staging Stand-in Instruments
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Stages note changes and only sounds them in publishBatch(), the way the tick drivers do
+class StagingInstruments : public InstrumentControllerBase {
+    std::array<uint8_t, NUM_Instruments> m_notes = {};
+    std::array<bool, NUM_Instruments> m_staged = {};
+    std::array<bool, NUM_Instruments> m_sounding = {};
+    uint32_t m_stagedChanges = 0;
+
+    void stage(uint8_t instrument, bool sounding) {
+        m_staged[instrument] = sounding;
+        m_stagedChanges++;
+        if (!isBatching()) publishBatch();
+    }
+
+public:
+    uint32_t publishes = 0;
+    uint32_t lastPublishChanges = 0; // Note changes the latest publish carried
+
+    void reset(uint8_t instrument) override { stage(instrument, false); }
+    void resetAll() override { stopAll(); }
+    void playNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) override {
+        m_notes[instrument] = note;
+        stage(instrument, true);
+    }
+    void stopNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) override {
+        if (!m_staged[instrument] || m_notes[instrument] != note) return;
+        releaseVoiceOwner(instrument);
+        stage(instrument, false);
+    }
+    void stopAll() override {
+        releaseAllVoiceOwners();
+        m_staged = {};
+        m_stagedChanges++;
+        if (!isBatching()) publishBatch();
+    }
+    uint8_t getNumActiveNotes(uint8_t instrument) override { return m_staged[instrument] ? 1 : 0; }
+    bool isNoteActive(uint8_t instrument, uint8_t note) override { return m_staged[instrument] && m_notes[instrument] == note; }
+
+    bool isSounding(uint8_t instrument) const { return m_sounding[instrument]; }
+
+protected:
+    void publishBatch() override {
+        m_sounding = m_staged;
+        lastPublishChanges = m_stagedChanges;
+        m_stagedChanges = 0;
+        publishes++;
+    }
+};
+
+std::shared_ptr<StagingInstruments> instruments;
+std::shared_ptr<DistributorManager> manager;
+
+MidiMessage channelMessage(uint8_t type, uint8_t channel, uint8_t data1, uint8_t data2)
+{
+    MidiMessage message;
+    message.buffer[0] = type | (channel & 0x0F);
+    message.buffer[1] = data1 & 0x7F;
+    message.buffer[2] = data2 & 0x7F;
+    message.length = 3;
+    return message;
+}
+
+// One distributor on channel 0 with every instrument
+void addDistributor()
+{
+    manager->addDistributor();
+    manager->setDistributorChannels(0, 0x1);
+    manager->setDistributorInstruments(0, 0xFF);
+    manager->setDistributorMethod(0, DistributionMethod::Ascending);
+}
+
+void setUp(void)
+{
+    manager->removeAllDistributors();
+    instruments->stopAll();
+    instruments->publishes = 0;
+    addDistributor();
+}
+
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_changes_outside_a_batch_publish_each(void)
+{
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 0, 60, 100));
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 0, 64, 100));
+    TEST_ASSERT_EQUAL_UINT32(2, instruments->publishes);
+    TEST_ASSERT_TRUE(instruments->isSounding(0));
+    TEST_ASSERT_TRUE(instruments->isSounding(1));
+}
+
+void test_a_pass_publishes_once(void)
+{
+    // A chord spread over three messages of one pass
+    instruments->beginBatch();
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 0, 60, 100));
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 0, 64, 100));
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 0, 67, 100));
+    TEST_ASSERT_EQUAL_UINT32(0, instruments->publishes);
+    TEST_ASSERT_FALSE(instruments->isSounding(0));
+    instruments->commitBatch();
+
+    TEST_ASSERT_EQUAL_UINT32(1, instruments->publishes);
+    TEST_ASSERT_EQUAL_UINT32(3, instruments->lastPublishChanges);
+    for (uint8_t i = 0; i < 3; i++) TEST_ASSERT_TRUE(instruments->isSounding(i));
+
+    // The next pass publishes again, once
+    instruments->beginBatch();
+    manager->distributeMessage(channelMessage(Midi::NoteOff, 0, 60, 0));
+    manager->distributeMessage(channelMessage(Midi::NoteOff, 0, 64, 0));
+    instruments->commitBatch();
+    TEST_ASSERT_EQUAL_UINT32(2, instruments->publishes);
+    TEST_ASSERT_EQUAL_UINT32(2, instruments->lastPublishChanges);
+}
+
+void test_nested_batches_flush_once(void)
+{
+    manager->distributeMessage(channelMessage(Midi::ControlChange, 0, MidiCC::DamperPedal, 127));
+    for (uint8_t note = 60; note < 64; note++) {
+        manager->distributeMessage(channelMessage(Midi::NoteOn, 0, note, 100));
+        manager->distributeMessage(channelMessage(Midi::NoteOff, 0, note, 0));
+    }
+    instruments->publishes = 0;
+
+    // Lifting the pedal opens the distributor's own batch inside the pass
+    instruments->beginBatch();
+    instruments->beginBatch();
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 0, 70, 100));
+    instruments->commitBatch();
+    manager->distributeMessage(channelMessage(Midi::ControlChange, 0, MidiCC::DamperPedal, 0));
+    TEST_ASSERT_EQUAL_UINT32(0, instruments->publishes);
+    TEST_ASSERT_TRUE(instruments->isBatching());
+    instruments->commitBatch();
+
+    TEST_ASSERT_FALSE(instruments->isBatching());
+    TEST_ASSERT_EQUAL_UINT32(1, instruments->publishes);
+    TEST_ASSERT_EQUAL_UINT32(5, instruments->lastPublishChanges);
+    for (uint8_t i = 0; i < 4; i++) TEST_ASSERT_FALSE(instruments->isSounding(i));
+    TEST_ASSERT_TRUE(instruments->isSounding(4));
+}
+
+void test_distributor_batches_on_their_own(void)
+{
+    for (uint8_t note = 60; note < 64; note++) {
+        manager->distributeMessage(channelMessage(Midi::NoteOn, 0, note, 100));
+    }
+    instruments->publishes = 0;
+
+    // Removing the distributor stops its four voices in one publish
+    manager->removeDistributor(0);
+    TEST_ASSERT_EQUAL_UINT32(1, instruments->publishes);
+    TEST_ASSERT_EQUAL_UINT32(4, instruments->lastPublishChanges);
+}
+
+void test_unpaired_commit_is_ignored(void)
+{
+    instruments->commitBatch();
+    TEST_ASSERT_EQUAL_UINT32(0, instruments->publishes);
+    TEST_ASSERT_FALSE(instruments->isBatching());
+
+    // The depth didn't wrap, the next batch still holds its changes back
+    instruments->beginBatch();
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 0, 60, 100));
+    TEST_ASSERT_EQUAL_UINT32(0, instruments->publishes);
+    instruments->commitBatch();
+    TEST_ASSERT_EQUAL_UINT32(1, instruments->publishes);
+}
+
+int main(int argc, char** argv)
+{
+    instruments = std::make_shared<StagingInstruments>();
+    manager = DistributorManager::getInstance(instruments);
+    Device::DamperPedal = true;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_changes_outside_a_batch_publish_each);
+    RUN_TEST(test_a_pass_publishes_once);
+    RUN_TEST(test_nested_batches_flush_once);
+    RUN_TEST(test_distributor_batches_on_their_own);
+    RUN_TEST(test_unpaired_commit_is_ignored);
+    return UNITY_END();
+}
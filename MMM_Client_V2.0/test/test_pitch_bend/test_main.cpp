@@ -0,0 +1,149 @@
+/*
+ * test_main.cpp
+ * Fixed point pitch bend against std::pow for every note and bend value, with a host
+ * timing of both paths. Times are host measurements and only compare the two methods.
+ */
+
+#include <unity.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include "Instruments/Components/NoteTable.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reference Pitch Math
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Bend ranges in cents, from a semitone to two octaves
+constexpr uint16_t RANGES[] = {100, 200, 1200, 2400};
+
+// Period ratio of a bend, the float math the lookup replaced
+double referenceRatio(uint16_t pitchBend, uint16_t rangeCents)
+{
+    return std::pow(2.0, -(static_cast<double>(pitchBend) - 0x2000) / 0x2000 * rangeCents / 1200.0);
+}
+
+double cents(double ratio)
+{
+    return std::fabs(1200.0 * std::log2(ratio));
+}
+
+void report(const char* what, double value, const char* unit)
+{
+    char message[96];
+    snprintf(message, sizeof(message), "%s %.4f %s", what, value, unit);
+    TEST_MESSAGE(message);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_exp2_table_interpolation(void)
+{
+    // Every fraction of an octave the table interpolates
+    double worst = 0;
+    for (uint32_t fraction = 0; fraction < 65536; fraction++) {
+        const double exact = std::pow(2.0, fraction / 65536.0);
+        const double error = cents(NoteTables::exp2FractionQ16(fraction) / 65536.0 / exact);
+        if (error > worst) worst = error;
+    }
+    report("exp2 table worst error", worst, "cents");
+    TEST_ASSERT_LESS_THAN_FLOAT(0.03, worst);
+}
+
+void test_bend_ratio_for_every_bend_value(void)
+{
+    // A large base keeps the result's rounding out of the measurement
+    constexpr uint32_t BASE = 1UL << 24;
+    double worst = 0;
+    for (uint16_t range : RANGES) {
+        for (uint16_t bend = 0; bend < 0x4000; bend++) {
+            const double ratio = NoteTables::applyPitchBendToPeriod(BASE, bend, range) / static_cast<double>(BASE);
+            const double error = cents(ratio / referenceRatio(bend, range));
+            if (error > worst) worst = error;
+        }
+    }
+    // Table error plus truncating the bend to Q16 octaves
+    report("Bend ratio worst error", worst, "cents");
+    TEST_ASSERT_LESS_THAN_FLOAT(0.04, worst);
+}
+
+void test_bent_periods_for_every_note(void)
+{
+    // Periods are whole microseconds, so allow the rounding on top of the ratio error
+    double worstExcessUs = 0;
+    for (uint8_t note = 0; note < 128; note++) {
+        const uint32_t period = NoteTables::NOTE_PERIODS[note];
+        for (uint16_t bend = 0; bend < 0x4000; bend++) {
+            const double exact = period * referenceRatio(bend, CFG_PITCH_BEND_RANGE_CENTS);
+            const double bent = NoteTables::applyPitchBendToPeriod(period, bend);
+            const double excess = std::fabs(bent - exact) - 0.5 - exact * (std::exp2(0.04 / 1200.0) - 1.0);
+            if (excess > worstExcessUs) worstExcessUs = excess;
+        }
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(0.0, worstExcessUs);
+}
+
+void test_float_bend_matches(void)
+{
+    double worst = 0;
+    for (uint16_t range : RANGES) {
+        for (uint16_t bend = 0; bend < 0x4000; bend += 7) {
+            const double bent = NoteTables::applyPitchBend(440.0f, bend, range);
+            const double error = cents(bent / (440.0 / referenceRatio(bend, range)));
+            if (error > worst) worst = error;
+        }
+    }
+    TEST_ASSERT_LESS_THAN_FLOAT(0.04, worst);
+}
+
+void test_center_and_extremes(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(1000, NoteTables::applyPitchBendToPeriod(1000, 0x2000));
+    // Full deflection over 2 semitones, 1000 * 2^(-/+1/6)
+    TEST_ASSERT_UINT32_WITHIN(1, 891, NoteTables::applyPitchBendToPeriod(1000, 0x3FFF, 200));
+    TEST_ASSERT_UINT32_WITHIN(1, 1122, NoteTables::applyPitchBendToPeriod(1000, 0, 200));
+    // Never bends to a zero period
+    TEST_ASSERT_EQUAL_UINT32(1, NoteTables::applyPitchBendToPeriod(1, 0x3FFF, 2400));
+}
+
+void test_benchmark(void)
+{
+    using Clock = std::chrono::steady_clock;
+    volatile uint32_t sink = 0;
+    constexpr uint32_t CALLS = 128 * 0x4000;
+
+    const auto tableStart = Clock::now();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        sink = sink + NoteTables::applyPitchBendToPeriod(NoteTables::NOTE_PERIODS[i & 0x7F], i >> 7);
+    }
+    const auto tableEnd = Clock::now();
+
+    // The float path this replaced: divide, pow, divide
+    for (uint32_t i = 0; i < CALLS; i++) {
+        const float bendFactor = (static_cast<float>(i >> 7) - 8192.0f) / 8192.0f * (CFG_PITCH_BEND_RANGE_CENTS / 1200.0f);
+        sink = sink + static_cast<uint32_t>(NoteTables::NOTE_PERIODS[i & 0x7F] / std::pow(2.0f, bendFactor));
+    }
+    const auto floatEnd = Clock::now();
+
+    const double tableNs = std::chrono::duration<double, std::nano>(tableEnd - tableStart).count() / CALLS;
+    const double floatNs = std::chrono::duration<double, std::nano>(floatEnd - tableEnd).count() / CALLS;
+    report("Host: table lookup", tableNs, "ns per bend");
+    report("Host: float pow", floatNs, "ns per bend");
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_exp2_table_interpolation);
+    RUN_TEST(test_bend_ratio_for_every_bend_value);
+    RUN_TEST(test_bent_periods_for_every_note);
+    RUN_TEST(test_float_bend_matches);
+    RUN_TEST(test_center_and_extremes);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,193 @@
+/*
+ * test_main.cpp
+ * ESP32_SwPWM built for the host with CFG_REALTIME_CORE. The loop never waits on a full
+ * command queue, it drops commands and periodic() rebuilds the realtime core from the voice
+ * bookkeeping instead. The realtime core's service and tick are run by hand, so a test
+ * decides exactly when the other core gets to drain the queue.
+ */
+
+#include <unity.h>
+#include "Instruments/Base/SwPWM/ESP32_SwPWM.h"
+#include "Instruments/Components/InterruptTimer.h"
+#include "Instruments/Components/RealtimeCore.h"
+#include "Instruments/Components/TuningTable.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stand-ins
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+void (*realtimeService)() = nullptr;
+uint32_t wakes = 0;
+}
+
+namespace RealtimeCore {
+    void start(void (*setup)(), void (*service)()) {
+        realtimeService = service;
+        setup();
+    }
+
+    void wake() { wakes++; }
+};
+
+namespace InterruptTimer {
+    void initialize(uint32_t, void (*)()) {}
+    void setCallback(void (*)()) {}
+    void initializeOneShot(void (*)()) {}
+    void scheduleOnce(uint32_t) {}
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr uint8_t NUM_VOICES = HardwareConfig::MAX_NUM_INSTRUMENTS;
+constexpr uint8_t BEND_CHANNEL = 1;
+
+// Opens up the realtime core's side of the controller
+class RealtimeSwPWM : public ESP32_SwPWM {
+public:
+    using ESP32_SwPWM::m_voices;
+    using ESP32_SwPWM::m_commands;
+    using ESP32_SwPWM::m_resyncPending;
+
+    // One pass of the realtime core: drain the commands, then a tick takes the published voices
+    static void runRealtimeCore() {
+        realtimeService();
+        tick();
+    }
+};
+
+RealtimeSwPWM* controller;
+
+uint16_t notePeriod(uint8_t note)
+{
+    return Tuning::active().ticks[note];
+}
+
+// Note on and off pairs until the queue has refused a command, the realtime core never drains
+uint32_t flood()
+{
+    uint32_t notes = 0;
+    while (!RealtimeSwPWM::m_resyncPending) {
+        const uint8_t voice = notes % NUM_VOICES;
+        controller->playNote(voice, 40 + voice, 100, 0);
+        controller->stopNote(voice, 40 + voice, 0, 0);
+        notes++;
+    }
+    return notes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A test may leave a resync pending, the realtime core drains first so it completes here
+void setUp(void)
+{
+    RealtimeSwPWM::runRealtimeCore();
+    controller->stopAll();
+    controller->setPitchBend(BEND_CHANNEL, Midi::CTRL_CENTER);
+    controller->periodic();
+    RealtimeSwPWM::runRealtimeCore();
+}
+
+void tearDown(void) {}
+
+void test_full_queue_sets_resync_instead_of_waiting(void)
+{
+    const uint32_t notes = flood();
+
+    // Each note is a start, a stop and two publishes, the queue holds 127
+    TEST_ASSERT_TRUE(RealtimeSwPWM::m_resyncPending);
+    TEST_ASSERT_EQUAL_UINT32(32, notes);
+
+    // Later commands are dropped without touching the queue, the bookkeeping still follows them
+    controller->playNote(2, 70, 100, 0);
+    TEST_ASSERT_TRUE(controller->isNoteActive(2, 70));
+    TEST_ASSERT_EQUAL_UINT8(1, controller->getNumActiveNotes(2));
+}
+
+void test_resync_waits_for_the_queue_to_drain(void)
+{
+    flood();
+    controller->playNote(0, 60, 100, 0);
+
+    // The realtime core hasn't caught up, replaying now could overflow again
+    controller->periodic();
+    TEST_ASSERT_TRUE(RealtimeSwPWM::m_resyncPending);
+    TEST_ASSERT_FALSE(RealtimeSwPWM::m_commands.empty());
+
+    RealtimeSwPWM::runRealtimeCore();
+    controller->periodic();
+    TEST_ASSERT_FALSE(RealtimeSwPWM::m_resyncPending);
+
+    RealtimeSwPWM::runRealtimeCore();
+    TEST_ASSERT_EQUAL_UINT16(notePeriod(60), RealtimeSwPWM::m_voices[0].period);
+}
+
+void test_resync_rebuilds_sounding_voices(void)
+{
+    // Voice 5 sounds before the flood and is stopped while commands are dropped
+    controller->playNote(5, 50, 100, 0);
+    RealtimeSwPWM::runRealtimeCore();
+    TEST_ASSERT_EQUAL_UINT16(notePeriod(50), RealtimeSwPWM::m_voices[5].period);
+
+    flood();
+    controller->setPitchBend(BEND_CHANNEL, 0x3FFF);
+    for (uint8_t voice = 0; voice < 4; voice++) {
+        controller->playNote(voice, 60 + voice, 100, (voice == 3) ? BEND_CHANNEL : 0);
+    }
+    controller->stopNote(5, 50, 0, 0);
+
+    const uint32_t wakesBefore = wakes;
+    RealtimeSwPWM::runRealtimeCore();
+    controller->periodic();
+    TEST_ASSERT_FALSE(RealtimeSwPWM::m_resyncPending);
+    TEST_ASSERT_GREATER_THAN(wakesBefore, wakes);
+    RealtimeSwPWM::runRealtimeCore();
+
+    for (uint8_t voice = 0; voice < 3; voice++) {
+        TEST_ASSERT_EQUAL_UINT16(notePeriod(60 + voice), RealtimeSwPWM::m_voices[voice].period);
+    }
+
+    // The bend is replayed ahead of the notes, so voice 3 starts bent up
+    const uint16_t unbent = notePeriod(63);
+    const uint16_t bent = RealtimeSwPWM::m_voices[3].period;
+    TEST_ASSERT_LESS_THAN(unbent, bent);
+    TEST_ASSERT_GREATER_THAN(unbent * 3 / 4, bent);
+
+    for (uint8_t voice = 4; voice < NUM_VOICES; voice++) {
+        TEST_ASSERT_EQUAL_UINT16(0, RealtimeSwPWM::m_voices[voice].period);
+    }
+}
+
+void test_commands_flow_again_after_resync(void)
+{
+    flood();
+    RealtimeSwPWM::runRealtimeCore();
+    controller->periodic();
+    RealtimeSwPWM::runRealtimeCore();
+    TEST_ASSERT_FALSE(RealtimeSwPWM::m_resyncPending);
+
+    controller->playNote(7, 72, 100, 0);
+    TEST_ASSERT_FALSE(RealtimeSwPWM::m_commands.empty());
+    RealtimeSwPWM::runRealtimeCore();
+    TEST_ASSERT_EQUAL_UINT16(notePeriod(72), RealtimeSwPWM::m_voices[7].period);
+
+    controller->stopNote(7, 72, 0, 0);
+    RealtimeSwPWM::runRealtimeCore();
+    TEST_ASSERT_EQUAL_UINT16(0, RealtimeSwPWM::m_voices[7].period);
+}
+
+int main(int argc, char** argv)
+{
+    controller = new RealtimeSwPWM();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_full_queue_sets_resync_instead_of_waiting);
+    RUN_TEST(test_resync_waits_for_the_queue_to_drain);
+    RUN_TEST(test_resync_rebuilds_sounding_voices);
+    RUN_TEST(test_commands_flow_again_after_resync);
+    return UNITY_END();
+}
@@ -0,0 +1,194 @@
+/*
+ * test_main.cpp
+ * Lock free handoffs between the loop and the tick: the command queue must refuse pushes when
+ * full and pops when empty and keep FIFO order across index wraparound, and the ISR profiler
+ * must never hand a reader a snapshot torn by a write on another core.
+ */
+
+#include <unity.h>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include "Utility/SpscQueue.h"
+#include "Instruments/Components/IsrProfiler.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr size_t QUEUE_SIZE = 8;
+
+struct Item {
+    uint32_t sequence;
+    uint32_t check; // ~sequence, catches a slot read before its write landed
+};
+
+Item itemFor(uint32_t sequence)
+{
+    return {sequence, ~sequence};
+}
+
+void report(const char* what, uint32_t value)
+{
+    char message[96];
+    snprintf(message, sizeof(message), "%s %u", what, static_cast<unsigned>(value));
+    TEST_MESSAGE(message);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void setUp() {}
+void tearDown() {}
+
+void test_empty_queue_refuses_pop()
+{
+    Utility::SpscQueue<Item, QUEUE_SIZE> queue;
+    Item item = itemFor(7);
+
+    TEST_ASSERT_TRUE(queue.empty());
+    TEST_ASSERT_FALSE(queue.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(7, item.sequence); // Untouched by the failed pop
+
+    TEST_ASSERT_TRUE(queue.push(itemFor(1)));
+    TEST_ASSERT_FALSE(queue.empty());
+    TEST_ASSERT_TRUE(queue.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(1, item.sequence);
+    TEST_ASSERT_TRUE(queue.empty());
+    TEST_ASSERT_FALSE(queue.pop(item));
+}
+
+void test_full_queue_refuses_push()
+{
+    Utility::SpscQueue<Item, QUEUE_SIZE> queue;
+
+    // One slot stays free to tell full from empty
+    for (uint32_t i = 0; i < QUEUE_SIZE - 1; i++) {
+        TEST_ASSERT_TRUE(queue.push(itemFor(i)));
+    }
+    TEST_ASSERT_FALSE(queue.push(itemFor(99)));
+
+    // A pop frees exactly one slot, the refused item never went in
+    Item item;
+    TEST_ASSERT_TRUE(queue.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(0, item.sequence);
+    TEST_ASSERT_TRUE(queue.push(itemFor(QUEUE_SIZE - 1)));
+    TEST_ASSERT_FALSE(queue.push(itemFor(99)));
+
+    for (uint32_t i = 1; i < QUEUE_SIZE; i++) {
+        TEST_ASSERT_TRUE(queue.pop(item));
+        TEST_ASSERT_EQUAL_UINT32(i, item.sequence);
+    }
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+void test_order_survives_wraparound()
+{
+    Utility::SpscQueue<Item, QUEUE_SIZE> queue;
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+    Item item;
+
+    // Uneven batches walk both indices around the ring many times at every offset
+    for (uint32_t round = 0; round < 100; round++) {
+        const uint32_t batch = 1 + round % (QUEUE_SIZE - 1);
+        for (uint32_t i = 0; i < batch; i++) {
+            TEST_ASSERT_TRUE(queue.push(itemFor(pushed++)));
+        }
+        for (uint32_t i = 0; i < batch; i++) {
+            TEST_ASSERT_TRUE(queue.pop(item));
+            TEST_ASSERT_EQUAL_UINT32(popped++, item.sequence);
+        }
+        TEST_ASSERT_TRUE(queue.empty());
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(10 * QUEUE_SIZE, pushed);
+}
+
+void test_order_across_threads()
+{
+    constexpr uint32_t COUNT = 200000;
+    Utility::SpscQueue<Item, QUEUE_SIZE> queue;
+    uint32_t refused = 0;
+
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < COUNT; i++) {
+            while (!queue.push(itemFor(i))) {
+                refused++;
+                std::this_thread::yield(); // The consumer may share the one host core
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t errors = 0;
+    Item item;
+    while (expected < COUNT) {
+        if (!queue.pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (item.sequence != expected || item.check != ~expected) errors++;
+        expected++;
+    }
+    producer.join();
+
+    report("pushes refused while full", refused);
+    TEST_ASSERT_EQUAL_UINT32(0, errors);
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+void test_profiler_snapshot_is_consistent()
+{
+    // Each write adds one sample to the bucket and one entry to a single jitter bin, so a
+    // snapshot taken mid-write shows a mean outside min..max or bins that disagree with samples
+    static IsrProfiler profiler;
+    constexpr uint8_t VOICES = 3;
+    constexpr uint32_t WRITES = 200000;
+    constexpr uint32_t NOMINAL_US = 10;
+    profiler.setNominalInterval(NOMINAL_US);
+    profiler.recordEntry(1);
+    std::atomic<bool> done{false};
+
+    std::thread writer([&] {
+        uint32_t now = 1;
+        for (uint32_t i = 0; i < WRITES; i++) {
+            now += NOMINAL_US + (i & 1);
+            profiler.recordEntry(now);
+            profiler.record(VOICES, 100 + (i % 1000));
+            if (i % 64 == 0) std::this_thread::yield();
+        }
+        done.store(true);
+    });
+
+    uint32_t reads = 0;
+    uint32_t errors = 0;
+    while (!done.load()) {
+        const IsrProfile profile = profiler.get(VOICES);
+        const IsrJitter jitter = profiler.jitter();
+        reads++;
+        std::this_thread::yield();
+        if (profile.samples == 0) continue;
+        if (profile.minCycles > profile.meanCycles || profile.meanCycles > profile.maxCycles) errors++;
+        if (profile.minCycles < 100 || profile.maxCycles > 1099) errors++;
+        uint32_t entries = 0;
+        for (uint8_t bin = 0; bin < IsrJitter::NUM_BINS; bin++) entries += jitter.bins[bin];
+        if (entries + 1 < profile.samples) errors++; // Entries are recorded before each sample
+    }
+    writer.join();
+
+    report("snapshots read during writes", reads);
+    TEST_ASSERT_EQUAL_UINT32(0, errors);
+    TEST_ASSERT_EQUAL_UINT32(WRITES, profiler.get(VOICES).samples);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_queue_refuses_pop);
+    RUN_TEST(test_full_queue_refuses_push);
+    RUN_TEST(test_order_survives_wraparound);
+    RUN_TEST(test_order_across_threads);
+    RUN_TEST(test_profiler_snapshot_is_consistent);
+    return UNITY_END();
+}
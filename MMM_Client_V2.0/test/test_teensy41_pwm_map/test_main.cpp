@@ -0,0 +1,257 @@
+/*
+ * test_main.cpp
+ * Teensy41PwmMap: the pin table against the Teensy 4.1 core's pwm_pin_info, the shared counter
+ * checks, and the FlexPWM and QuadTimer periods against equal temperament for every note.
+ * Teensy41_HwPWM is built with more voices than pins and must refuse the ones without a pin.
+ */
+
+#include <unity.h>
+#include <cmath>
+#include <cstdio>
+#include "Instruments/Components/Teensy41PwmMap.h"
+#include "Instruments/Components/TuningTable.h"
+#include "Instruments/Base/HwPWM/Teensy41_HwPWM.h"
+
+using namespace Teensy41PwmMap;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// F_BUS_ACTUAL with the core at its default 600MHz
+constexpr uint32_t BUS_HZ = 150000000;
+
+// The example pin sets, before and after user-049
+constexpr uint8_t OLD_EXAMPLE_PINS[] = {2, 3, 4, 5, 6, 8, 9, 10, 14, 18, 22, 28};
+constexpr uint8_t EXAMPLE_PINS[] = {2, 4, 5, 6, 8, 10, 14, 15, 18, 22, 23, 28};
+
+static_assert(pinsHavePwm(EXAMPLE_PINS) && pinsIndependent(EXAMPLE_PINS), "The example pins can play different notes");
+static_assert(!pinsIndependent(OLD_EXAMPLE_PINS), "2/3 and 6/9 share a FlexPWM submodule");
+
+// The pins the env builds Teensy41_HwPWM with, the voices past them have no counter
+constexpr uint8_t DRIVER_PINS[] = {CFG_PINS_INSTRUMENT_PWM};
+constexpr uint8_t WIRED_VOICES = sizeof(DRIVER_PINS);
+static_assert(WIRED_VOICES < HardwareConfig::MAX_NUM_INSTRUMENTS, "The env leaves some voices without a pin");
+
+Teensy41_HwPWM* controller;
+
+uint32_t toQ16(double hz)
+{
+    return static_cast<uint32_t>(std::lround(hz * 65536.0));
+}
+
+double centsSharp(double actualHz, uint32_t targetQ16)
+{
+    return 1200.0 * std::log2(actualHz * 65536.0 / targetQ16);
+}
+
+double flexPwmHz(const Period& period)
+{
+    return static_cast<double>(BUS_HZ) / (static_cast<double>(period.counts) * (1 << period.prescale));
+}
+
+// QuadTimer counts are a half period, the pin toggles at each compare
+double quadTimerHz(const Period& period)
+{
+    return static_cast<double>(BUS_HZ) / (2.0 * period.counts * (1 << period.prescale));
+}
+
+void setUp(void)
+{
+    Tuning::selectPreset(TuningPreset::EqualTemperament);
+}
+
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_pin_table(void)
+{
+    // Spot checks against pwm_pin_info
+    TEST_ASSERT_TRUE(resource(2).timer == Timer::FlexPwm);
+    TEST_ASSERT_EQUAL_UINT8(4, resource(2).module);
+    TEST_ASSERT_EQUAL_UINT8(2, resource(2).submodule);
+    TEST_ASSERT_EQUAL_UINT8(A, resource(2).output);
+    TEST_ASSERT_EQUAL_UINT8(X, resource(0).output);
+    TEST_ASSERT_EQUAL_UINT8(B, resource(28).output);
+    TEST_ASSERT_TRUE(resource(13).timer == Timer::QuadTimer);
+    TEST_ASSERT_EQUAL_UINT8(2, resource(13).module);
+    TEST_ASSERT_EQUAL_UINT8(0, resource(13).submodule);
+    TEST_ASSERT_EQUAL_UINT8(3, resource(54).module);
+
+    // Pins without PWM, and past the end of the table
+    for (uint8_t pin : {16, 17, 20, 21, 26, 27, 30, 31, 32, 34, 35, 38, 39, 40, 41, 48, 49, 50, 52, 53, 55, 255}) {
+        TEST_ASSERT_TRUE(resource(pin).timer == Timer::None);
+    }
+    TEST_ASSERT_EQUAL_UINT8(55, NUM_PINS);
+
+    // No two pins in the table drive the same output
+    for (uint8_t a = 0; a < NUM_PINS; a++) {
+        for (uint8_t b = a + 1; b < NUM_PINS; b++) {
+            if (resource(a).timer == Timer::None) continue;
+            TEST_ASSERT_FALSE(sameCounter(resource(a), resource(b)) && resource(a).output == resource(b).output);
+        }
+    }
+}
+
+void test_shared_counters(void)
+{
+    // A and B of one submodule, and X on the same counter
+    TEST_ASSERT_TRUE(sameCounter(resource(2), resource(3)));
+    TEST_ASSERT_TRUE(sameCounter(resource(6), resource(9)));
+    TEST_ASSERT_TRUE(sameCounter(resource(0), resource(43)));
+
+    // Same submodule number in another module, or another timer type, is independent
+    TEST_ASSERT_FALSE(sameCounter(resource(4), resource(22)));
+    TEST_ASSERT_FALSE(sameCounter(resource(10), resource(1)));
+    TEST_ASSERT_FALSE(sameCounter(resource(10), resource(12)));
+
+    constexpr uint8_t NO_PWM[] = {2, 16};
+    constexpr uint8_t SHARED[] = {0, 4, 43};
+    TEST_ASSERT_FALSE(pinsHavePwm(NO_PWM));
+    TEST_ASSERT_FALSE(pinsIndependent(SHARED));
+}
+
+void test_flexpwm_every_note(void)
+{
+    // Notes below 150MHz / 128 / 65535, about 17.9Hz, clamp at the longest period
+    double worst = 0;
+    for (uint8_t note = 0; note < 128; note++) {
+        const uint32_t frequency = Tuning::active().frequencies[note];
+        const Period period = flexPwmPeriod(BUS_HZ, frequency);
+        TEST_ASSERT_LESS_OR_EQUAL(MAX_PRESCALE, period.prescale);
+        if (frequency < toQ16(17.9)) {
+            TEST_ASSERT_EQUAL_UINT8(MAX_PRESCALE, period.prescale);
+            TEST_ASSERT_EQUAL_UINT16(65535, period.counts);
+            continue;
+        }
+
+        // The finest prescale, a coarser one would have fit in half the counts
+        if (period.prescale > 0) TEST_ASSERT_GREATER_THAN(32767, period.counts);
+
+        const double cents = std::fabs(centsSharp(flexPwmHz(period), frequency));
+        if (cents > worst) worst = cents;
+    }
+    char line[64];
+    snprintf(line, sizeof(line), "FlexPWM worst note error %.4f cents", worst);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.1f, worst);
+}
+
+void test_quadtimer_every_note(void)
+{
+    // Half periods reach down to 150MHz / 128 / 2 / 65535, about 8.94Hz
+    double worst = 0;
+    for (uint8_t note = 0; note < 128; note++) {
+        const uint32_t frequency = Tuning::active().frequencies[note];
+        const uint8_t prescale = quadTimerPrescale(BUS_HZ, frequency);
+        const Period period = quadTimerPeriod(BUS_HZ, frequency, prescale, false);
+        if (frequency < toQ16(8.95)) {
+            TEST_ASSERT_EQUAL_UINT16(0, period.counts);
+            continue;
+        }
+        TEST_ASSERT_NOT_EQUAL(0, period.counts);
+
+        const double cents = std::fabs(centsSharp(quadTimerHz(period), frequency));
+        if (cents > worst) worst = cents;
+    }
+    char line[64];
+    snprintf(line, sizeof(line), "QuadTimer worst note error %.4f cents", worst);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.25f, worst);
+}
+
+void test_quadtimer_headroom(void)
+{
+    // A bend down two octaves keeps the prescale the note started with, an octave up still
+    // has counts for a fine pitch
+    for (uint8_t note = 26; note < 128; note++) {
+        const uint32_t frequency = Tuning::active().frequencies[note];
+        const uint8_t prescale = quadTimerPrescale(BUS_HZ, frequency);
+        TEST_ASSERT_NOT_EQUAL(0, quadTimerPeriod(BUS_HZ, frequency / 4, prescale, false).counts);
+        if (prescale > 0) TEST_ASSERT_GREATER_OR_EQUAL(4096, quadTimerPeriod(BUS_HZ, frequency * 2, prescale, false).counts);
+    }
+}
+
+void test_range_limits(void)
+{
+    const Period flexLow = flexPwmPeriod(BUS_HZ, toQ16(17.9));
+    TEST_ASSERT_EQUAL_UINT8(MAX_PRESCALE, flexLow.prescale);
+    TEST_ASSERT_LESS_THAN(65535, flexLow.counts);
+    TEST_ASSERT_EQUAL_UINT16(65535, flexPwmPeriod(BUS_HZ, toQ16(17.8)).counts);
+
+    TEST_ASSERT_NOT_EQUAL(0, quadTimerPeriod(BUS_HZ, toQ16(8.95), MAX_PRESCALE, false).counts);
+    TEST_ASSERT_EQUAL_UINT16(0, quadTimerPeriod(BUS_HZ, toQ16(8.9), MAX_PRESCALE, false).counts);
+    TEST_ASSERT_EQUAL_UINT16(65535, quadTimerPeriod(BUS_HZ, toQ16(8.9), MAX_PRESCALE, true).counts);
+
+    // Too short a period, out of reach of Q16 at this bus clock, holds the shortest the
+    // counter can do when clamped
+    TEST_ASSERT_EQUAL_UINT16(0, scale(1, 0, false).counts);
+    TEST_ASSERT_EQUAL_UINT16(2, scale(1, 0, true).counts);
+    TEST_ASSERT_EQUAL_UINT16(2, scale(255, 7, false).counts);
+
+    // Silence is 0 cycles
+    TEST_ASSERT_EQUAL_UINT32(0, busCycles(BUS_HZ, 0, 0));
+}
+
+void test_period_rounding(void)
+{
+    // 440Hz is 340909.09 bus cycles, prescale 3 gives 42613.6 which rounds up
+    const uint32_t a4 = toQ16(440.0);
+    TEST_ASSERT_EQUAL(340909, busCycles(BUS_HZ, a4, 0));
+    const Period flex = flexPwmPeriod(BUS_HZ, a4);
+    TEST_ASSERT_EQUAL_UINT8(3, flex.prescale);
+    TEST_ASSERT_EQUAL_UINT16(42614, flex.counts);
+
+    // 170454.5 cycles per half period, four times that needs prescale 4 for 10653.4 counts
+    TEST_ASSERT_EQUAL(170455, busCycles(BUS_HZ, a4, 1));
+    TEST_ASSERT_EQUAL_UINT8(4, quadTimerPrescale(BUS_HZ, a4));
+    TEST_ASSERT_EQUAL_UINT16(10653, quadTimerPeriod(BUS_HZ, a4, 4, false).counts);
+}
+
+void test_unwired_voices_are_refused(void)
+{
+    constexpr uint8_t NOTE = 69;
+    controller->stopAll();
+    controller->buildEligibility();
+
+    // Distributors are only offered the voices with a pin
+    for (uint8_t voice = 0; voice < HardwareConfig::MAX_NUM_INSTRUMENTS; voice++) {
+        TEST_ASSERT_EQUAL(voice < WIRED_VOICES, controller->canPlayNote(voice, NOTE));
+    }
+    TEST_ASSERT_EQUAL_HEX32((1UL << WIRED_VOICES) - 1, controller->getEligibleInstruments(NOTE));
+
+    // A note sent to one anyway is dropped before the bookkeeping, nothing reports it sounding
+    for (uint8_t voice = WIRED_VOICES; voice < HardwareConfig::MAX_NUM_INSTRUMENTS; voice++) {
+        controller->playNote(voice, NOTE, 100, 0);
+        TEST_ASSERT_FALSE(controller->isNoteActive(voice, NOTE));
+        TEST_ASSERT_EQUAL_UINT8(0, controller->getNumActiveNotes(voice));
+        controller->stopNote(voice, NOTE, 0, 0);
+    }
+
+    // The wired voices still play
+    for (uint8_t voice = 0; voice < WIRED_VOICES; voice++) {
+        controller->playNote(voice, NOTE, 100, 0);
+        TEST_ASSERT_TRUE(controller->isNoteActive(voice, NOTE));
+        TEST_ASSERT_EQUAL_UINT8(1, controller->getNumActiveNotes(voice));
+    }
+    controller->stopAll();
+}
+
+int main(int argc, char** argv)
+{
+    controller = new Teensy41_HwPWM();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_pin_table);
+    RUN_TEST(test_shared_counters);
+    RUN_TEST(test_flexpwm_every_note);
+    RUN_TEST(test_quadtimer_every_note);
+    RUN_TEST(test_quadtimer_headroom);
+    RUN_TEST(test_range_limits);
+    RUN_TEST(test_period_rounding);
+    RUN_TEST(test_unwired_voices_are_refused);
+    return UNITY_END();
+}
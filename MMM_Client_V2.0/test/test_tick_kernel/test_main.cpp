@@ -0,0 +1,168 @@
+/*
+ * test_main.cpp
+ * TickKernel's paired counters against the scalar tick. The UADD16/USUB16/SEL sequence of
+ * the Cortex-M7 path is emulated instruction by instruction, GE flags included, so the
+ * asm is checked on the host without a board.
+ */
+
+#include <unity.h>
+#include <cstdlib>
+#include "Instruments/Components/TickKernel.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// ARM SIMD Emulation
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// One GE bit per byte, as the core keeps them; halfword ops set both bits of their lane
+uint8_t ge = 0;
+
+uint32_t uadd16(uint32_t a, uint32_t b)
+{
+    uint32_t result = 0;
+    ge = 0;
+    for (uint8_t lane = 0; lane < 2; lane++) {
+        const uint32_t sum = ((a >> (lane * 16)) & 0xFFFF) + ((b >> (lane * 16)) & 0xFFFF);
+        if (sum >= 0x10000) ge |= 0x3 << (lane * 2);
+        result |= (sum & 0xFFFF) << (lane * 16);
+    }
+    return result;
+}
+
+uint32_t usub16(uint32_t a, uint32_t b)
+{
+    uint32_t result = 0;
+    ge = 0;
+    for (uint8_t lane = 0; lane < 2; lane++) {
+        const int32_t difference = static_cast<int32_t>((a >> (lane * 16)) & 0xFFFF) - static_cast<int32_t>((b >> (lane * 16)) & 0xFFFF);
+        if (difference >= 0) ge |= 0x3 << (lane * 2);
+        result |= (static_cast<uint32_t>(difference) & 0xFFFF) << (lane * 16);
+    }
+    return result;
+}
+
+uint32_t sel(uint32_t n, uint32_t m)
+{
+    uint32_t result = 0;
+    for (uint8_t byte = 0; byte < 4; byte++) {
+        const uint32_t mask = 0xFFUL << (byte * 8);
+        result |= ((ge >> byte) & 1 ? n : m) & mask;
+    }
+    return result;
+}
+
+// The asm block of TickKernel::advancePair, line for line
+uint32_t advancePairSimd(uint32_t& ticks, uint32_t periods)
+{
+    uint32_t next = uadd16(ticks, TickKernel::LANE_ONE);
+    uint32_t due = usub16(ticks, periods);
+    next = sel(0, next);
+    due = sel(TickKernel::LANE_ONE, 0);
+    ticks = next;
+    return (due | (due >> 15)) & 0x3;
+}
+
+// Checks one state against the scalar tick
+void checkPair(uint32_t ticks, uint32_t periods)
+{
+    uint32_t scalarTicks = ticks;
+    uint32_t simdTicks = ticks;
+    uint32_t kernelTicks = ticks;
+    const uint32_t scalarDue = TickKernel::advancePairScalar(scalarTicks, periods);
+    TEST_ASSERT_EQUAL_HEX32(scalarDue, advancePairSimd(simdTicks, periods));
+    TEST_ASSERT_EQUAL_HEX32(scalarTicks, simdTicks);
+    TEST_ASSERT_EQUAL_HEX32(scalarDue, TickKernel::advancePair(kernelTicks, periods));
+    TEST_ASSERT_EQUAL_HEX32(scalarTicks, kernelTicks);
+}
+
+uint32_t pack(uint16_t low, uint16_t high)
+{
+    return low | (static_cast<uint32_t>(high) << 16);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_scalar_lane_rules(void)
+{
+    // Below the period counts up, at or past it wraps to 0 and reports the edge
+    uint32_t ticks = pack(4, 9);
+    TEST_ASSERT_EQUAL_HEX32(0x0, TickKernel::advancePairScalar(ticks, pack(9, 10)));
+    TEST_ASSERT_EQUAL_HEX32(pack(5, 10), ticks);
+
+    ticks = pack(9, 10);
+    TEST_ASSERT_EQUAL_HEX32(0x3, TickKernel::advancePairScalar(ticks, pack(9, 10)));
+    TEST_ASSERT_EQUAL_HEX32(0, ticks);
+
+    ticks = pack(3, 20);
+    TEST_ASSERT_EQUAL_HEX32(0x2, TickKernel::advancePairScalar(ticks, pack(8, 10)));
+    TEST_ASSERT_EQUAL_HEX32(pack(4, 0), ticks);
+}
+
+void test_edge_values(void)
+{
+    // Period 0 is a silent voice, the top count can't carry into the other lane
+    constexpr uint16_t VALUES[] = {0, 1, 2, 0x7FFF, 0x8000, 0x8001, 0xFFFE, 0xFFFF};
+    for (uint16_t lowTick : VALUES)
+        for (uint16_t highTick : VALUES)
+            for (uint16_t lowPeriod : VALUES)
+                for (uint16_t highPeriod : VALUES)
+                    checkPair(pack(lowTick, highTick), pack(lowPeriod, highPeriod));
+}
+
+void test_random_states(void)
+{
+    srand(44);
+    for (uint32_t i = 0; i < 2000000; i++) {
+        const uint32_t ticks = (static_cast<uint32_t>(rand()) << 16) ^ static_cast<uint32_t>(rand());
+        const uint32_t periods = (static_cast<uint32_t>(rand()) << 16) ^ static_cast<uint32_t>(rand());
+        checkPair(ticks, periods);
+    }
+}
+
+void test_running_voices(void)
+{
+    // Two voices run for many periods, the SIMD path emits the same edges on the same ticks
+    constexpr uint16_t PERIODS[][2] = {{0, 0}, {1, 2}, {2272, 1136}, {150, 18181}, {0, 473}};
+    for (const auto& pair : PERIODS) {
+        const uint32_t periods = pack(pair[0], pair[1]);
+        uint32_t scalarTicks = 0;
+        uint32_t simdTicks = 0;
+        uint32_t edges = 0;
+        for (uint32_t tick = 0; tick < 100000; tick++) {
+            const uint32_t due = TickKernel::advancePairScalar(scalarTicks, periods);
+            TEST_ASSERT_EQUAL_HEX32(due, advancePairSimd(simdTicks, periods));
+            TEST_ASSERT_EQUAL_HEX32(scalarTicks, simdTicks);
+            edges += __builtin_popcount(due);
+        }
+        // A lane with period p has an edge every p + 1 ticks, the same as the scalar tick
+        uint32_t expected = 0;
+        for (uint16_t period : pair) expected += 100000 / (period + 1);
+        TEST_ASSERT_UINT32_WITHIN(2, expected, edges);
+    }
+}
+
+void test_set_lane(void)
+{
+    uint32_t word = pack(0x1234, 0x5678);
+    TickKernel::setLane(word, 4, 0xAAAA);
+    TEST_ASSERT_EQUAL_HEX32(pack(0xAAAA, 0x5678), word);
+    TickKernel::setLane(word, 7, 0xFFFF);
+    TEST_ASSERT_EQUAL_HEX32(pack(0xAAAA, 0xFFFF), word);
+    TickKernel::setLane(word, 0, 0);
+    TEST_ASSERT_EQUAL_HEX32(pack(0, 0xFFFF), word);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_scalar_lane_rules);
+    RUN_TEST(test_edge_values);
+    RUN_TEST(test_random_states);
+    RUN_TEST(test_running_voices);
+    RUN_TEST(test_set_lane);
+    return UNITY_END();
+}
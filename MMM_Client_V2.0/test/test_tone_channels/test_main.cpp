@@ -0,0 +1,218 @@
+/*
+ * test_main.cpp
+ * ToneChannels: voice to peripheral assignment and the RMT and MCPWM period math, checked
+ * against equal temperament for every note and at the ends of each peripheral's range.
+ * Voices left to the SwPWM tick must sound at the same pitch as the peripheral voices.
+ */
+
+#include <unity.h>
+#include <cmath>
+#include <cstdio>
+#include "Config.h"
+#include "Instruments/Components/ToneChannels.h"
+#include "Instruments/Components/TuningTable.h"
+
+using namespace ToneChannels;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr uint8_t HEADROOM = 4;
+
+uint32_t toQ16(double hz)
+{
+    return static_cast<uint32_t>(std::lround(hz * 65536.0));
+}
+
+double centsSharp(uint32_t actualQ16, uint32_t targetQ16)
+{
+    return 1200.0 * std::log2(static_cast<double>(actualQ16) / targetQ16);
+}
+
+// Frequency of a SwPWM tick voice handed this period, in Hz Q16. Runs the tick's toggle rule
+// for one full cycle: the pin toggles on the pass its count reaches the period, then restarts.
+uint32_t tickFrequencyQ16(uint16_t period)
+{
+    uint16_t tick = 0;
+    uint32_t passes = 0;
+    for (uint8_t toggles = 0; toggles < 2; passes++) {
+        if (tick >= period) {
+            toggles++;
+            tick = 0;
+        } else {
+            tick++;
+        }
+    }
+    return toQ16(1000000.0 / (passes * CFG_TIMER_RESOLUTION_US));
+}
+
+void setUp(void)
+{
+    Tuning::selectPreset(TuningPreset::EqualTemperament);
+}
+
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_allocate(void)
+{
+    // Default build, 7 RMT channels with one left for the LEDs, then 6 MCPWM timers
+    constexpr auto slots = allocate<16>(7, 6);
+    for (uint8_t voice = 0; voice < 7; voice++) {
+        TEST_ASSERT_TRUE(slots[voice].engine == Engine::Rmt);
+        TEST_ASSERT_EQUAL_UINT8(RMT_NUM_CHANNELS - 1 - voice, slots[voice].index);
+    }
+    for (uint8_t voice = 7; voice < 13; voice++) {
+        TEST_ASSERT_TRUE(slots[voice].engine == Engine::Mcpwm);
+        TEST_ASSERT_EQUAL_UINT8((voice - 7) / MCPWM_TIMERS_PER_UNIT, slots[voice].unit);
+        TEST_ASSERT_EQUAL_UINT8((voice - 7) % MCPWM_TIMERS_PER_UNIT, slots[voice].index);
+    }
+    for (uint8_t voice = 13; voice < 16; voice++) {
+        TEST_ASSERT_TRUE(slots[voice].engine == Engine::Software);
+    }
+
+    // No peripherals leaves every voice to the tick
+    constexpr auto software = allocate<4>(0, 0);
+    for (const Slot& slot : software) TEST_ASSERT_TRUE(slot.engine == Engine::Software);
+}
+
+void test_rmt_every_note(void)
+{
+    double worst = 0;
+    for (uint8_t note = 0; note < 128; note++) {
+        const uint32_t frequency = Tuning::active().frequencies[note];
+        const RmtPeriod period = rmtPeriod(frequency, rmtDivider(frequency, HEADROOM));
+        TEST_ASSERT_NOT_EQUAL(0, period.divider);
+
+        // A square wave, the odd count goes low
+        TEST_ASSERT_TRUE(period.low == period.high || period.low == period.high + 1);
+        TEST_ASSERT_LESS_OR_EQUAL(RMT_MAX_DURATION, period.low);
+
+        const double cents = std::fabs(centsSharp(rmtFrequencyQ16(period), frequency));
+        if (cents > worst) worst = cents;
+    }
+    char line[64];
+    snprintf(line, sizeof(line), "RMT worst note error %.4f cents", worst);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.15f, worst);
+}
+
+void test_mcpwm_every_note(void)
+{
+    double worst = 0;
+    for (uint8_t note = 0; note < 128; note++) {
+        const uint32_t frequency = Tuning::active().frequencies[note];
+        const McpwmPeriod period = mcpwmPeriod(frequency, mcpwmPrescale(frequency, HEADROOM));
+        TEST_ASSERT_NOT_EQUAL(0, period.prescale);
+        TEST_ASSERT_LESS_OR_EQUAL(256, period.prescale);
+
+        const double cents = std::fabs(centsSharp(mcpwmFrequencyQ16(period), frequency));
+        if (cents > worst) worst = cents;
+    }
+    char line[64];
+    snprintf(line, sizeof(line), "MCPWM worst note error %.4f cents", worst);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.25f, worst);
+}
+
+void test_headroom_covers_two_octaves_down(void)
+{
+    // A bend or vibrato down to a quarter of the starting frequency keeps the clock division
+    for (uint8_t note = 24; note < 128; note++) {
+        const uint32_t frequency = Tuning::active().frequencies[note];
+        const uint8_t divider = rmtDivider(frequency, HEADROOM);
+        const uint16_t prescale = mcpwmPrescale(frequency, HEADROOM);
+        TEST_ASSERT_NOT_EQUAL(0, rmtPeriod(frequency / HEADROOM, divider).divider);
+        TEST_ASSERT_NOT_EQUAL(0, mcpwmPeriod(frequency / HEADROOM, prescale).prescale);
+
+        // An octave up still has enough counts for a fine pitch
+        TEST_ASSERT_GREATER_OR_EQUAL(100, rmtPeriod(frequency * 2, divider).high);
+    }
+}
+
+void test_range_limits(void)
+{
+    // RMT bottoms out at 80MHz / 255 / 65534, about 4.79Hz
+    TEST_ASSERT_NOT_EQUAL(0, rmtPeriod(toQ16(4.8), rmtDivider(toQ16(4.8), HEADROOM)).divider);
+    TEST_ASSERT_EQUAL_UINT8(0, rmtPeriod(toQ16(4.7), rmtDivider(toQ16(4.7), HEADROOM)).divider);
+
+    // MCPWM bottoms out at 40MHz / 256 / 65535, about 2.38Hz
+    TEST_ASSERT_NOT_EQUAL(0, mcpwmPeriod(toQ16(2.4), mcpwmPrescale(toQ16(2.4), HEADROOM)).prescale);
+    TEST_ASSERT_EQUAL_UINT16(0, mcpwmPeriod(toQ16(2.3), mcpwmPrescale(toQ16(2.3), HEADROOM)).prescale);
+
+    // A divider of 0 is the caller's out of range marker and stays out of range
+    TEST_ASSERT_EQUAL_UINT8(0, rmtPeriod(toQ16(440.0), 0).divider);
+    TEST_ASSERT_EQUAL_UINT16(0, mcpwmPeriod(toQ16(440.0), 0).prescale);
+    TEST_ASSERT_EQUAL_UINT32(0, cyclesPerPeriod(RMT_CLOCK_HZ, 0));
+}
+
+void test_period_rounding(void)
+{
+    // 440Hz is 181818.18 RMT cycles, four times that needs divider 12 for 15151.5 counts,
+    // which rounds up and splits evenly
+    const uint32_t a4 = toQ16(440.0);
+    TEST_ASSERT_EQUAL(181818, cyclesPerPeriod(RMT_CLOCK_HZ, a4));
+    TEST_ASSERT_EQUAL_UINT8(12, rmtDivider(a4, HEADROOM));
+    const RmtPeriod rmt = rmtPeriod(a4, 12);
+    TEST_ASSERT_EQUAL_UINT16(7576, rmt.high);
+    TEST_ASSERT_EQUAL_UINT16(7576, rmt.low);
+
+    // 441Hz, 181405.9 cycles, 15117 counts at the same divider, the odd one goes low
+    const RmtPeriod odd = rmtPeriod(toQ16(441.0), 12);
+    TEST_ASSERT_EQUAL_UINT16(7558, odd.high);
+    TEST_ASSERT_EQUAL_UINT16(7559, odd.low);
+
+    // 90909.09 MCPWM cycles, prescale 6 gives 15151.5 which rounds up
+    TEST_ASSERT_EQUAL_UINT16(6, mcpwmPrescale(a4, HEADROOM));
+    TEST_ASSERT_EQUAL_UINT16(15152, mcpwmPeriod(a4, 6).ticks);
+}
+
+void test_tick_voices_match_peripherals(void)
+{
+    // TonePWM hands the tick half periods (PWM_NOTES_DOUBLE, see ESP32_SwPWM.h). The tick only
+    // counts whole passes and each half cycle runs one pass long, so it may be flat by up to
+    // a pass per half cycle but never by an octave.
+    double worst = 0;
+    for (uint8_t note = 0; note < 128; note++) {
+        const Tuning::Tables& tables = Tuning::active();
+        const uint16_t half = tables.ticksDouble[note];
+        if (tables.periods[note] == UINT16_MAX || half < 2) continue; // Clamped or above the tick's range
+
+        const uint32_t frequency = tables.frequencies[note];
+        const uint32_t rmt = rmtFrequencyQ16(rmtPeriod(frequency, rmtDivider(frequency, HEADROOM)));
+        const uint32_t mcpwm = mcpwmFrequencyQ16(mcpwmPeriod(frequency, mcpwmPrescale(frequency, HEADROOM)));
+        const uint32_t tick = tickFrequencyQ16(half);
+
+        // The note's rounded period against a half cycle one pass longer than the table's
+        const double flatLimit = 1200.0 * std::log2((half + 1.0) * 2 * CFG_TIMER_RESOLUTION_US / (tables.periods[note] - 0.5)) + 0.5;
+        TEST_ASSERT_LESS_THAN_FLOAT(0.5f, centsSharp(tick, rmt));
+        TEST_ASSERT_GREATER_THAN_FLOAT(-flatLimit, centsSharp(tick, rmt));
+        TEST_ASSERT_GREATER_THAN_FLOAT(-flatLimit, centsSharp(tick, mcpwm));
+
+        const double cents = std::fabs(centsSharp(tick, rmt));
+        if (cents > worst) worst = cents;
+
+        // Whole periods toggle once a period and sound an octave below the peripherals
+        TEST_ASSERT_LESS_THAN_FLOAT(-1100.0f, centsSharp(tickFrequencyQ16(tables.ticks[note]), rmt));
+    }
+    char line[64];
+    snprintf(line, sizeof(line), "Tick voice worst error against RMT %.2f cents", worst);
+    TEST_MESSAGE(line);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_allocate);
+    RUN_TEST(test_rmt_every_note);
+    RUN_TEST(test_mcpwm_every_note);
+    RUN_TEST(test_headroom_covers_two_octaves_down);
+    RUN_TEST(test_range_limits);
+    RUN_TEST(test_period_rounding);
+    RUN_TEST(test_tick_voices_match_peripherals);
+    return UNITY_END();
+}
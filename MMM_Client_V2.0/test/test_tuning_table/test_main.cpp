@@ -0,0 +1,144 @@
+/*
+ * test_main.cpp
+ * Tables built by a retune against double precision pitch math: every note and a sweep
+ * of fractional MTS pitches must land within 0.006 cents.
+ */
+
+#include <unity.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "Instruments/Components/TuningTable.h"
+#include "Instruments/Components/NoteTable.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reference Pitch Math
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Frequency of an MTS pitch, note 69 is A440
+double referenceFrequency(Tuning::Pitch pitch)
+{
+    return 440.0 * std::pow(2.0, (pitch / static_cast<double>(Tuning::SEMITONE) - 69.0) / 12.0);
+}
+
+double centsBetween(double frequency, double reference)
+{
+    return std::fabs(1200.0 * std::log2(frequency / reference));
+}
+
+void report(const char* what, double worstCents)
+{
+    char message[96];
+    snprintf(message, sizeof(message), "%s worst error %.5f cents", what, worstCents);
+    TEST_MESSAGE(message);
+}
+
+void setUp(void)
+{
+    Tuning::selectPreset(TuningPreset::EqualTemperament);
+}
+
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_equal_temperament_frequencies(void)
+{
+    double worst = 0;
+    for (uint8_t note = 0; note < 128; note++) {
+        const double error = centsBetween(Tuning::frequency(note), referenceFrequency(note * Tuning::SEMITONE));
+        if (error > worst) worst = error;
+    }
+    report("Equal temperament", worst);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.006, worst);
+}
+
+void test_built_tables_match_the_compile_time_tables(void)
+{
+    // A rebuilt equal temperament may only differ from the hand written periods by rounding
+    for (uint8_t note = 0; note < 128; note++) {
+        const Tuning::Tables& tables = Tuning::active();
+        TEST_ASSERT_UINT16_WITHIN(1, NoteTables::NOTE_PERIODS[note], tables.periods[note]);
+        TEST_ASSERT_EQUAL_UINT16(tables.periods[note] / CFG_TIMER_RESOLUTION_US, tables.ticks[note]);
+        TEST_ASSERT_EQUAL_UINT16(tables.periods[note] / (CFG_TIMER_RESOLUTION_US * 2), tables.ticksDouble[note]);
+    }
+}
+
+void test_fractional_pitches(void)
+{
+    // Random MTS pitches across the whole range, 128 at a time
+    srand(35);
+    double worstFrequency = 0;
+    double worstPeriodUs = 0;
+    for (uint32_t round = 0; round < 200; round++) {
+        std::array<Tuning::Pitch, 128> pitches;
+        for (uint8_t note = 0; note < 128; note++) {
+            pitches[note] = static_cast<Tuning::Pitch>(rand()) % (Tuning::MAX_PITCH + 1);
+            Tuning::setNotePitch(note, pitches[note]);
+        }
+        Tuning::commit();
+
+        const Tuning::Tables& tables = Tuning::active();
+        for (uint8_t note = 0; note < 128; note++) {
+            const double reference = referenceFrequency(pitches[note]);
+            const double error = centsBetween(tables.frequencies[note] / 65536.0, reference);
+            if (error > worstFrequency) worstFrequency = error;
+
+            // Periods are whole microseconds, only check them below the uint16_t clamp
+            const double periodUs = 1000000.0 / reference;
+            if (periodUs < 65535.0) {
+                const double periodError = std::fabs(tables.periods[note] - periodUs);
+                if (periodError > worstPeriodUs) worstPeriodUs = periodError;
+            }
+        }
+    }
+    report("Fractional pitch", worstFrequency);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.006, worstFrequency);
+    // Rounding to whole microseconds plus the pitch error at the longest periods
+    TEST_ASSERT_LESS_THAN_FLOAT(0.75, worstPeriodUs);
+}
+
+void test_presets_apply_their_offsets(void)
+{
+    // Pythagorean fifth above C is 1.96 cents wide, the major third 7.82 cents wide
+    TEST_ASSERT_TRUE(Tuning::selectPreset(TuningPreset::Pythagorean));
+    TEST_ASSERT_EQUAL(TuningPreset::Pythagorean, Tuning::getPreset());
+
+    const double fifth = 1200.0 * std::log2(Tuning::frequency(67) / Tuning::frequency(60));
+    const double third = 1200.0 * std::log2(Tuning::frequency(64) / Tuning::frequency(60));
+    TEST_ASSERT_FLOAT_WITHIN(0.02, 701.96, fifth);
+    TEST_ASSERT_FLOAT_WITHIN(0.02, 407.82, third);
+
+    TEST_ASSERT_FALSE(Tuning::selectPreset(TuningPreset::Custom));
+    TEST_ASSERT_EQUAL(TuningPreset::Pythagorean, Tuning::getPreset());
+}
+
+void test_retune_is_staged_until_commit(void)
+{
+    const Tuning::Tables& before = Tuning::active();
+    const uint16_t period = before.periods[69];
+
+    // Staging leaves the tables alone, the commit swaps in the other buffer
+    Tuning::setNotePitch(69, 70 * Tuning::SEMITONE);
+    TEST_ASSERT_EQUAL_PTR(&before, &Tuning::active());
+    TEST_ASSERT_EQUAL_UINT16(period, Tuning::active().periods[69]);
+    TEST_ASSERT_EQUAL(TuningPreset::Custom, Tuning::getPreset());
+
+    Tuning::commit();
+    TEST_ASSERT_NOT_EQUAL(&before, &Tuning::active());
+    TEST_ASSERT_EQUAL_UINT16(NoteTables::NOTE_PERIODS[70], Tuning::active().periods[69]);
+    TEST_ASSERT_EQUAL_UINT16(period, before.periods[69]);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_equal_temperament_frequencies);
+    RUN_TEST(test_built_tables_match_the_compile_time_tables);
+    RUN_TEST(test_fractional_pitches);
+    RUN_TEST(test_presets_apply_their_offsets);
+    RUN_TEST(test_retune_is_staged_until_commit);
+    return UNITY_END();
+}
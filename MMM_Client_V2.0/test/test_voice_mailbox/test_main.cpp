@@ -0,0 +1,212 @@
+/*
+ * test_main.cpp
+ * VoiceMailbox single stepped, then under stress. For the stress test an interval timer
+ * signals the control thread and the handler plays the tick, so it preempts the control
+ * code at arbitrary points mid-write the way the tick interrupt does on one core. Two
+ * threads running side by side would not model it, the mailbox doesn't support that.
+ */
+
+#include <unity.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/time.h>
+#include "Instruments/Components/VoiceMailbox.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr uint8_t VOICES = 32;
+
+// Written field by field, check is always ~sequence in a slot the tick may read
+struct Params {
+    uint32_t sequence;
+    bool restart;
+    uint32_t check;
+};
+
+VoiceMailbox<Params, VOICES> mailbox;
+
+// Stages a change the way the SwPWM stageUpdate() does, keeping a restart the tick hasn't taken
+void stage(VoiceMailbox<Params, VOICES>& box, uint8_t voice, uint32_t sequence, bool restart)
+{
+    bool pending;
+    Params& slot = box.open(voice, pending);
+    slot.restart = restart || (pending && slot.restart);
+    slot.sequence = sequence;
+    slot.check = ~sequence;
+}
+
+// Tick side state, only touched by the signal handler until the stress run stops
+struct TickRecord {
+    uint32_t lastSequence;
+    uint32_t restartedUpTo;
+};
+std::array<TickRecord, VOICES> tickRecords;
+constexpr sig_atomic_t MIN_TICKS = 10000;
+volatile sig_atomic_t ticks = 0;
+volatile sig_atomic_t tornSlots = 0;
+volatile sig_atomic_t outOfOrder = 0;
+volatile sig_atomic_t splitGroups = 0;
+
+void takeUpdates()
+{
+    const uint32_t taken = mailbox.take();
+    for (uint8_t voice = 0; voice < VOICES; voice++) {
+        if (!(taken & (1UL << voice))) continue;
+        const Params& slot = mailbox.slot(voice);
+        if (slot.check != ~slot.sequence) tornSlots = tornSlots + 1;
+        if (slot.sequence < tickRecords[voice].lastSequence) outOfOrder = outOfOrder + 1;
+        tickRecords[voice].lastSequence = slot.sequence;
+        if (slot.restart) tickRecords[voice].restartedUpTo = slot.sequence;
+    }
+
+    // Voices 0 and 1 are always committed together, taking both means they are from one commit
+    if ((taken & 0x3) == 0x3 && mailbox.slot(0).sequence != mailbox.slot(1).sequence) splitGroups = splitGroups + 1;
+}
+
+void onTick(int)
+{
+    ticks = ticks + 1;
+    takeUpdates();
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_commit_hands_over_together(void)
+{
+    VoiceMailbox<Params, VOICES> box;
+    TEST_ASSERT_EQUAL_HEX32(0, box.take());
+
+    stage(box, 3, 7, true);
+    stage(box, 9, 8, false);
+    TEST_ASSERT_EQUAL_HEX32(0, box.take());
+
+    box.commit((1UL << 3) | (1UL << 9));
+    TEST_ASSERT_EQUAL_HEX32((1UL << 3) | (1UL << 9), box.take());
+    TEST_ASSERT_EQUAL_UINT32(7, box.slot(3).sequence);
+    TEST_ASSERT_TRUE(box.slot(3).restart);
+    TEST_ASSERT_EQUAL_UINT32(8, box.slot(9).sequence);
+    TEST_ASSERT_EQUAL_HEX32(0, box.take());
+}
+
+void test_pending_change_is_merged(void)
+{
+    VoiceMailbox<Params, VOICES> box;
+    bool pending;
+
+    // Committed and not taken yet, the next open reports it and keeps the restart
+    stage(box, 5, 1, true);
+    box.commit(1UL << 5);
+    box.open(5, pending);
+    TEST_ASSERT_TRUE(pending);
+    stage(box, 5, 2, false);
+    box.commit(1UL << 5);
+    TEST_ASSERT_EQUAL_HEX32(1UL << 5, box.take());
+    TEST_ASSERT_EQUAL_UINT32(2, box.slot(5).sequence);
+    TEST_ASSERT_TRUE(box.slot(5).restart);
+
+    // Taken, so the next change starts clean
+    box.open(5, pending);
+    TEST_ASSERT_FALSE(pending);
+    box.commit(1UL << 5);
+    box.take();
+
+    // Opened and not committed also counts as pending
+    box.open(6, pending);
+    TEST_ASSERT_FALSE(pending);
+    box.open(6, pending);
+    TEST_ASSERT_TRUE(pending);
+}
+
+void test_open_withdraws_the_voice(void)
+{
+    // A tick landing while a committed voice is rewritten leaves it for the next tick
+    VoiceMailbox<Params, VOICES> box;
+    stage(box, 2, 1, false);
+    stage(box, 4, 1, false);
+    box.commit((1UL << 2) | (1UL << 4));
+
+    bool pending;
+    box.open(2, pending);
+    TEST_ASSERT_EQUAL_HEX32(1UL << 4, box.take());
+
+    box.commit(1UL << 2);
+    TEST_ASSERT_EQUAL_HEX32(1UL << 2, box.take());
+}
+
+void test_stress_with_preempting_tick(void)
+{
+    tickRecords = {};
+    std::array<uint32_t, VOICES> lastCommitted = {};
+    std::array<uint32_t, VOICES> lastRestart = {};
+
+    struct sigaction action = {};
+    action.sa_handler = onTick;
+    sigemptyset(&action.sa_mask);
+    TEST_ASSERT_EQUAL(0, sigaction(SIGALRM, &action, nullptr));
+
+    // The interrupt source, a tick every 20us, which lands anywhere in the control code
+    struct itimerval interval = {{0, 20}, {0, 20}};
+    TEST_ASSERT_EQUAL(0, setitimer(ITIMER_REAL, &interval, nullptr));
+
+    srand(46);
+    uint32_t sequence = 0;
+    while (ticks < MIN_TICKS && sequence < 100000000) {
+        sequence++;
+        if (rand() % 4 == 0) {
+            // A chord, voices 0 and 1 go out in one commit
+            const bool restart = rand() % 2;
+            stage(mailbox, 0, sequence, restart);
+            stage(mailbox, 1, sequence, restart);
+            mailbox.commit(0x3);
+            for (uint8_t voice = 0; voice < 2; voice++) {
+                lastCommitted[voice] = sequence;
+                if (restart) lastRestart[voice] = sequence;
+            }
+        } else {
+            const uint8_t voice = 2 + rand() % (VOICES - 2);
+            const bool restart = rand() % 8 == 0;
+            stage(mailbox, voice, sequence, restart);
+            mailbox.commit(1UL << voice);
+            lastCommitted[voice] = sequence;
+            if (restart) lastRestart[voice] = sequence;
+        }
+    }
+
+    interval = {};
+    setitimer(ITIMER_REAL, &interval, nullptr);
+    signal(SIGALRM, SIG_DFL);
+    takeUpdates();
+
+    char line[96];
+    snprintf(line, sizeof(line), "Ticks taken during %lu control changes: %ld", static_cast<unsigned long>(sequence), static_cast<long>(ticks));
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_OR_EQUAL(MIN_TICKS, ticks);
+
+    TEST_ASSERT_EQUAL(0, tornSlots);
+    TEST_ASSERT_EQUAL(0, outOfOrder);
+    TEST_ASSERT_EQUAL(0, splitGroups);
+
+    // Every voice ends on its last change and no restart was lost in a merge
+    for (uint8_t voice = 0; voice < VOICES; voice++) {
+        TEST_ASSERT_EQUAL_UINT32(lastCommitted[voice], tickRecords[voice].lastSequence);
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32(lastRestart[voice], tickRecords[voice].restartedUpTo);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_commit_hands_over_together);
+    RUN_TEST(test_pending_change_is_merged);
+    RUN_TEST(test_open_withdraws_the_voice);
+    RUN_TEST(test_stress_with_preempting_tick);
+    return UNITY_END();
+}
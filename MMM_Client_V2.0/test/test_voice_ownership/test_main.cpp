@@ -0,0 +1,234 @@
+/*
+ * test_main.cpp
+ * Voice ownership: the packed VoiceOwner records and the per distributor bitmasks stay in
+ * step through claims, steals, releases and resetAll, and a distributor only stops the
+ * voices it owns.
+ */
+
+#include <unity.h>
+#include <cstdlib>
+#include "Distributors/DistributorManager.h"
+#include "Instruments/InstrumentControllerBase.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Monophonic Stand-in Instruments
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Keeps ownership the way the instrument drivers do, stopNote releases the voice and
+// resetAll goes through stopAll
+class FakeInstruments : public InstrumentControllerBase {
+    std::array<uint8_t, NUM_Instruments> m_notes = {};
+    std::array<bool, NUM_Instruments> m_sounding = {};
+
+public:
+    uint32_t stops = 0;
+
+    void reset(uint8_t instrument) override { m_sounding[instrument] = false; }
+    void resetAll() override { stopAll(); }
+    void playNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) override {
+        m_notes[instrument] = note;
+        m_sounding[instrument] = true;
+    }
+    void stopNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) override {
+        if (!m_sounding[instrument] || m_notes[instrument] != note) return;
+        m_sounding[instrument] = false;
+        releaseVoiceOwner(instrument);
+        stops++;
+    }
+    void stopAll() override {
+        m_sounding = {};
+        releaseAllVoiceOwners();
+    }
+    uint8_t getNumActiveNotes(uint8_t instrument) override { return m_sounding[instrument] ? 1 : 0; }
+    bool isNoteActive(uint8_t instrument, uint8_t note) override { return m_sounding[instrument] && m_notes[instrument] == note; }
+};
+
+std::shared_ptr<FakeInstruments> instruments;
+std::shared_ptr<DistributorManager> manager;
+
+MidiMessage channelMessage(uint8_t type, uint8_t channel, uint8_t data1, uint8_t data2)
+{
+    MidiMessage message;
+    message.buffer[0] = type | (channel & 0x0F);
+    message.buffer[1] = data1 & 0x7F;
+    message.buffer[2] = data2 & 0x7F;
+    message.length = 3;
+    return message;
+}
+
+// Every owned voice is in its owner's bitmask and nowhere else
+void checkOwnership()
+{
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+        const uint8_t owner = instruments->getOwner(i);
+        for (uint8_t slot = 0; slot < HardwareConfig::MAX_NUM_DISTRIBUTORS; slot++) {
+            TEST_ASSERT_EQUAL(owner == slot, (instruments->getOwnedVoices(slot) >> i) & 1);
+        }
+        if (owner == NONE) TEST_ASSERT_EQUAL_UINT8(NONE, instruments->getOwnerChannel(i));
+    }
+}
+
+uint32_t allOwnedVoices()
+{
+    uint32_t voices = 0;
+    for (uint8_t slot = 0; slot < HardwareConfig::MAX_NUM_DISTRIBUTORS; slot++) voices |= instruments->getOwnedVoices(slot);
+    return voices;
+}
+
+// Two distributors, channel 0 and channel 1, sharing every instrument
+void addTwoDistributors(DistributionMethod method)
+{
+    for (uint8_t id = 0; id < 2; id++) {
+        manager->addDistributor();
+        manager->setDistributorChannels(id, 1 << id);
+        manager->setDistributorInstruments(id, 0xFF);
+        manager->setDistributorMethod(id, method);
+    }
+}
+
+void setUp(void)
+{
+    manager->removeAllDistributors();
+    instruments->stops = 0;
+}
+
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_claim_and_release(void)
+{
+    instruments->claimVoice(3, 5, 2, 60);
+    TEST_ASSERT_EQUAL_UINT8(5, instruments->getOwner(3));
+    TEST_ASSERT_EQUAL_UINT8(2, instruments->getOwnerChannel(3));
+    TEST_ASSERT_EQUAL_UINT8(60, instruments->getOwnerNote(3));
+    TEST_ASSERT_TRUE(instruments->isOwnedBy(3, 5, 2));
+    TEST_ASSERT_FALSE(instruments->isOwnedBy(3, 5, 1));
+    TEST_ASSERT_EQUAL_HEX32(1UL << 3, instruments->getOwnedVoices(5));
+
+    // Claimed by another distributor, the bit moves with it
+    instruments->claimVoice(3, 7, 0, 62);
+    TEST_ASSERT_EQUAL_HEX32(0, instruments->getOwnedVoices(5));
+    TEST_ASSERT_EQUAL_HEX32(1UL << 3, instruments->getOwnedVoices(7));
+    checkOwnership();
+
+    instruments->releaseVoiceOwner(3);
+    TEST_ASSERT_EQUAL_UINT8(NONE, instruments->getOwner(3));
+    TEST_ASSERT_EQUAL_HEX32(0, instruments->getOwnedVoices(7));
+
+    // Out of range queries and claims are ignored
+    instruments->claimVoice(NUM_Instruments, 0, 0, 60);
+    TEST_ASSERT_EQUAL_UINT8(NONE, instruments->getOwner(NUM_Instruments));
+    TEST_ASSERT_EQUAL_HEX32(0, instruments->getOwnedVoices(HardwareConfig::MAX_NUM_DISTRIBUTORS));
+    checkOwnership();
+}
+
+void test_distributors_record_their_voices(void)
+{
+    addTwoDistributors(DistributionMethod::Ascending);
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 0, 60, 100));
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 0, 62, 100));
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 1, 64, 100));
+    checkOwnership();
+
+    const uint8_t first = manager->getDistributor(0).getSlot();
+    const uint8_t second = manager->getDistributor(1).getSlot();
+    TEST_ASSERT_EQUAL_HEX32(0x3, instruments->getOwnedVoices(first));
+    TEST_ASSERT_EQUAL_HEX32(0x4, instruments->getOwnedVoices(second));
+    TEST_ASSERT_EQUAL_UINT8(64, instruments->getOwnerNote(2));
+    TEST_ASSERT_EQUAL_UINT8(1, instruments->getOwnerChannel(2));
+
+    // Note off releases the voice and clears its bit
+    manager->distributeMessage(channelMessage(Midi::NoteOff, 0, 60, 0));
+    TEST_ASSERT_EQUAL_HEX32(0x2, instruments->getOwnedVoices(first));
+    checkOwnership();
+}
+
+void test_remove_stops_only_owned_voices(void)
+{
+    addTwoDistributors(DistributionMethod::RoundRobin);
+    for (uint8_t note = 60; note < 63; note++) {
+        manager->distributeMessage(channelMessage(Midi::NoteOn, 0, note, 100));
+        manager->distributeMessage(channelMessage(Midi::NoteOn, 1, note + 12, 100));
+    }
+    const uint8_t second = manager->getDistributor(1).getSlot();
+    const uint32_t secondVoices = instruments->getOwnedVoices(second);
+    TEST_ASSERT_EQUAL(3, __builtin_popcount(secondVoices));
+
+    manager->removeDistributor(0);
+    TEST_ASSERT_EQUAL_UINT32(3, instruments->stops);
+    TEST_ASSERT_EQUAL_HEX32(secondVoices, allOwnedVoices());
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+        TEST_ASSERT_EQUAL(((secondVoices >> i) & 1) != 0, instruments->getNumActiveNotes(i) != 0);
+    }
+    checkOwnership();
+}
+
+void test_reset_all_releases_every_owner(void)
+{
+    addTwoDistributors(DistributionMethod::Ascending);
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 0, 60, 100));
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 1, 64, 100));
+    TEST_ASSERT_NOT_EQUAL(0, allOwnedVoices());
+
+    instruments->resetAll();
+    TEST_ASSERT_EQUAL_HEX32(0, allOwnedVoices());
+    for (uint8_t i = 0; i < HardwareConfig::MAX_NUM_INSTRUMENTS; i++) {
+        TEST_ASSERT_EQUAL_UINT8(NONE, instruments->getOwner(i));
+    }
+    checkOwnership();
+
+    // The other distributor takes the freed instrument, the old owner's late note off leaves it alone
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 1, 60, 100));
+    const uint8_t second = manager->getDistributor(1).getSlot();
+    TEST_ASSERT_EQUAL_HEX32(0x1, instruments->getOwnedVoices(second));
+    manager->distributeMessage(channelMessage(Midi::NoteOff, 0, 60, 0));
+    TEST_ASSERT_TRUE(instruments->isNoteActive(0, 60));
+    TEST_ASSERT_EQUAL_HEX32(0x1, instruments->getOwnedVoices(second));
+}
+
+void test_random_traffic_keeps_records_consistent(void)
+{
+    addTwoDistributors(DistributionMethod::RoundRobinBalance);
+    manager->addDistributor();
+    manager->setDistributorChannels(2, 0x3);
+    manager->setDistributorInstruments(2, 0xF0);
+    manager->setDistributorMethod(2, DistributionMethod::Descending);
+
+    srand(30);
+    for (uint32_t i = 0; i < 50000; i++) {
+        const uint8_t channel = rand() % 2;
+        const uint8_t note = 48 + rand() % 24;
+        switch (rand() % 16) {
+            case 0: instruments->resetAll(); break;
+            case 1: case 2: case 3: case 4: case 5:
+                manager->distributeMessage(channelMessage(Midi::NoteOff, channel, note, 0));
+                break;
+            default:
+                manager->distributeMessage(channelMessage(Midi::NoteOn, channel, note, 100));
+                break;
+        }
+        checkOwnership();
+
+        // A silent instrument has no owner
+        for (uint8_t instrument = 0; instrument < HardwareConfig::MAX_NUM_INSTRUMENTS; instrument++) {
+            if (instruments->getNumActiveNotes(instrument) == 0) TEST_ASSERT_EQUAL_UINT8(NONE, instruments->getOwner(instrument));
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    instruments = std::make_shared<FakeInstruments>();
+    manager = DistributorManager::getInstance(instruments);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_claim_and_release);
+    RUN_TEST(test_distributors_record_their_voices);
+    RUN_TEST(test_remove_stops_only_owned_voices);
+    RUN_TEST(test_reset_all_releases_every_owner);
+    RUN_TEST(test_random_traffic_keeps_records_consistent);
+    return UNITY_END();
+}
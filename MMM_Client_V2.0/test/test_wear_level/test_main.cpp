@@ -0,0 +1,221 @@
+/*
+ * test_main.cpp
+ * Wear leveling: the least used first order kept in constant time per actuation, the
+ * WearLevel strategy picking the least actuated instrument, ties rotating, and the order
+ * rebuilt from counters reloaded the way main.cpp restores them from local storage.
+ */
+
+#include <unity.h>
+#include <algorithm>
+#include <cstdlib>
+#include "Distributors/DistributorManager.h"
+#include "Instruments/InstrumentControllerBase.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Monophonic Stand-in Instruments
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr uint8_t N = HardwareConfig::MAX_NUM_INSTRUMENTS;
+
+class FakeInstruments : public InstrumentControllerBase {
+    std::array<uint8_t, NUM_Instruments> m_notes = {};
+    std::array<bool, NUM_Instruments> m_sounding = {};
+
+public:
+    uint8_t lastPlayed = NONE;
+
+    void reset(uint8_t instrument) override { m_sounding[instrument] = false; }
+    void resetAll() override { stopAll(); }
+    void playNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) override {
+        m_notes[instrument] = note;
+        m_sounding[instrument] = true;
+        lastPlayed = instrument;
+    }
+    void stopNote(uint8_t instrument, uint8_t note, uint8_t velocity, uint8_t channel) override {
+        if (!m_sounding[instrument] || m_notes[instrument] != note) return;
+        m_sounding[instrument] = false;
+        releaseVoiceOwner(instrument);
+    }
+    void stopAll() override {
+        m_sounding = {};
+        releaseAllVoiceOwners();
+    }
+    uint8_t getNumActiveNotes(uint8_t instrument) override { return m_sounding[instrument] ? 1 : 0; }
+    bool isNoteActive(uint8_t instrument, uint8_t note) override { return m_sounding[instrument] && m_notes[instrument] == note; }
+
+    void actuate(uint8_t instrument) { countActuation(instrument); }
+
+    // The order is sorted, the ranks invert it, and each group spans exactly the ranks of one count
+    void checkOrder() const {
+        uint32_t usedGroups = 0;
+        for (uint8_t rank = 0; rank < N; rank++) {
+            const uint8_t instrument = m_wearOrder[rank];
+            TEST_ASSERT_EQUAL_UINT8(rank, m_wearRank[instrument]);
+            if (rank > 0) TEST_ASSERT_LESS_OR_EQUAL(m_wear[instrument].actuations, m_wear[m_wearOrder[rank - 1]].actuations);
+
+            const WearGroup& group = m_wearGroups[m_wearGroup[instrument]];
+            TEST_ASSERT_TRUE(group.first <= rank && rank <= group.last);
+            TEST_ASSERT_EQUAL_UINT32(m_wear[instrument].actuations, m_wear[m_wearOrder[group.first]].actuations);
+            TEST_ASSERT_EQUAL_UINT32(m_wear[instrument].actuations, m_wear[m_wearOrder[group.last]].actuations);
+            if (group.first > 0) TEST_ASSERT_NOT_EQUAL(m_wear[instrument].actuations, m_wear[m_wearOrder[group.first - 1]].actuations);
+            if (group.last + 1 < N) TEST_ASSERT_NOT_EQUAL(m_wear[instrument].actuations, m_wear[m_wearOrder[group.last + 1]].actuations);
+            usedGroups |= (1UL << m_wearGroup[instrument]);
+        }
+        TEST_ASSERT_EQUAL_HEX32(0, usedGroups & m_freeWearGroups);
+    }
+};
+
+std::shared_ptr<FakeInstruments> instruments;
+std::shared_ptr<DistributorManager> manager;
+
+MidiMessage channelMessage(uint8_t type, uint8_t channel, uint8_t data1, uint8_t data2)
+{
+    MidiMessage message;
+    message.buffer[0] = type | (channel & 0x0F);
+    message.buffer[1] = data1 & 0x7F;
+    message.buffer[2] = data2 & 0x7F;
+    message.length = 3;
+    return message;
+}
+
+// Plays and releases one note, returns the instrument it went to
+uint8_t strike()
+{
+    instruments->lastPlayed = NONE;
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 0, 60, 100));
+    manager->distributeMessage(channelMessage(Midi::NoteOff, 0, 60, 0));
+    return instruments->lastPlayed;
+}
+
+void loadWear(FakeInstruments& target, const std::array<InstrumentWear, N>& wear)
+{
+    for (uint8_t i = 0; i < N; i++) target.setInstrumentWear(i, wear[i]);
+}
+
+void setUp(void)
+{
+    manager->removeAllDistributors();
+    loadWear(*instruments, {});
+    manager->addDistributor();
+    manager->setDistributorChannels(0, 0x1);
+    manager->setDistributorInstruments(0, 0xFFFFFFFF);
+    manager->setDistributorMethod(0, DistributionMethod::WearLevel);
+}
+
+void tearDown(void) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tests
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_picks_the_least_actuated(void)
+{
+    std::array<InstrumentWear, N> wear = {};
+    for (uint8_t i = 0; i < N; i++) wear[i].actuations = 10 + i;
+    wear[5].actuations = 3;
+    loadWear(*instruments, wear);
+    instruments->checkOrder();
+    TEST_ASSERT_EQUAL_UINT8(5, instruments->getWearOrder()[0]);
+
+    // Instrument 5 is struck until it catches up with instrument 0, then they alternate
+    for (uint8_t i = 0; i < 7; i++) TEST_ASSERT_EQUAL_UINT8(5, strike());
+    TEST_ASSERT_EQUAL_UINT32(10, instruments->getInstrumentWear(5).actuations);
+    const uint8_t next = strike();
+    TEST_ASSERT_TRUE(next == 0 || next == 5);
+    TEST_ASSERT_EQUAL_UINT8(next == 0 ? 5 : 0, strike());
+    instruments->checkOrder();
+}
+
+void test_busy_least_used_is_skipped(void)
+{
+    // The least used instrument is sounding, the next least used takes the note
+    std::array<InstrumentWear, N> wear = {};
+    for (uint8_t i = 0; i < N; i++) wear[i].actuations = 100 - i;
+    loadWear(*instruments, wear);
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 0, 60, 100));
+    TEST_ASSERT_EQUAL_UINT8(N - 1, instruments->lastPlayed);
+    manager->distributeMessage(channelMessage(Midi::NoteOn, 0, 62, 100));
+    TEST_ASSERT_EQUAL_UINT8(N - 2, instruments->lastPlayed);
+}
+
+void test_ties_rotate(void)
+{
+    // Fresh counters all tie, every instrument is used once before any is used twice
+    for (uint8_t round = 1; round <= 3; round++) {
+        uint32_t used = 0;
+        for (uint8_t i = 0; i < N; i++) {
+            const uint8_t instrument = strike();
+            TEST_ASSERT_NOT_EQUAL(NONE, instrument);
+            TEST_ASSERT_EQUAL(0, (used >> instrument) & 1);
+            used |= (1UL << instrument);
+            instruments->checkOrder();
+        }
+        for (uint8_t i = 0; i < N; i++) TEST_ASSERT_EQUAL_UINT32(round, instruments->getInstrumentWear(i).actuations);
+    }
+}
+
+void test_order_survives_reload(void)
+{
+    srand(32);
+    for (uint32_t i = 0; i < 500; i++) {
+        if (rand() % 3 == 0) {
+            instruments->actuate(rand() % 3); // A few instruments played outside the distributor too
+        } else {
+            strike();
+        }
+    }
+    instruments->checkOrder();
+
+    // Saved and restored into a fresh controller, as main.cpp does at boot
+    std::array<InstrumentWear, N> saved = {};
+    for (uint8_t i = 0; i < N; i++) saved[i] = instruments->getInstrumentWear(i);
+    FakeInstruments restored;
+    loadWear(restored, saved);
+    restored.checkOrder();
+
+    // The same counts in the same order, ties may list their members differently
+    for (uint8_t rank = 0; rank < N; rank++) {
+        TEST_ASSERT_EQUAL_UINT32(instruments->getInstrumentWear(instruments->getWearOrder()[rank]).actuations,
+            restored.getInstrumentWear(restored.getWearOrder()[rank]).actuations);
+    }
+
+    // Counting carries on from the restored order
+    for (uint32_t i = 0; i < 1000; i++) {
+        restored.actuate(restored.getWearOrder()[0]);
+        restored.checkOrder();
+    }
+    uint32_t least = UINT32_MAX, most = 0;
+    for (uint8_t i = 0; i < N; i++) {
+        least = std::min(least, restored.getInstrumentWear(i).actuations);
+        most = std::max(most, restored.getInstrumentWear(i).actuations);
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(1, most - least);
+}
+
+void test_random_actuations_keep_order(void)
+{
+    srand(320);
+    for (uint32_t i = 0; i < 100000; i++) {
+        const uint8_t instrument = rand() % N;
+        if (rand() % 1000 == 0) {
+            instruments->resetInstrumentWear(instrument);
+        } else {
+            instruments->actuate((rand() % 4 == 0) ? instruments->getWearOrder()[rand() % N] : instrument);
+        }
+        instruments->checkOrder();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    instruments = std::make_shared<FakeInstruments>();
+    manager = DistributorManager::getInstance(instruments);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_picks_the_least_actuated);
+    RUN_TEST(test_busy_least_used_is_skipped);
+    RUN_TEST(test_ties_rotate);
+    RUN_TEST(test_order_survives_reload);
+    RUN_TEST(test_random_actuations_keep_order);
+    return UNITY_END();
+}